@@ -67,6 +67,7 @@ podman run -d \
   -e ROCKSDB_SERVICE_URL="http://${MASTER_IP}:47007" \
   -v /etc/piccolo/settings.yaml:/etc/piccolo/settings.yaml:Z \
   -v /run/piccololog/:/run/piccololog/ \
+  -v /var/log/piccolo/:/var/log/piccolo/ \
   ${CONTAINER_IMAGE} \
   /piccolo/logservice
 
@@ -0,0 +1,16 @@
+#!/bin/bash
+# SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+# SPDX-License-Identifier: Apache-2.0
+
+# Applies the helloworld scenario, then publishes its DDS trigger and reports
+# per-stage latency. Extra arguments go to pipeline_bench, e.g. --rate 0.2,0.5
+
+BODY=$(< ./resources/helloworld.yaml)
+HOST_IP=$(hostname -I | awk '{print $1}')
+BENCH=${BENCH:-../src/target/release/pipeline_bench}
+
+curl -X POST "http://${HOST_IP}:47099/api/artifact" \
+--header 'Content-Type: text/plain' \
+--data "${BODY}"
+
+"${BENCH}" --logservice "http://${HOST_IP}:47097" "$@"
@@ -26,6 +26,20 @@ pub enum ConfigError {
 pub struct MetricsConfig {
     pub collection_interval: u64,
     pub batch_size: u32,
+    #[serde(default)]
+    pub sampling: SamplingConfig,
+}
+
+/// Node info sampling period of each metric group in milliseconds.
+/// Groups left unset use the sampler defaults.
+#[derive(Debug, Deserialize, Clone, Default, PartialEq)]
+pub struct SamplingConfig {
+    pub cpu_ms: Option<u64>,
+    pub memory_ms: Option<u64>,
+    pub network_ms: Option<u64>,
+    pub disk_ms: Option<u64>,
+    pub gpu_ms: Option<u64>,
+    pub system_ms: Option<u64>,
 }
 
 #[derive(Debug, Deserialize, Clone, Default, PartialEq)]
@@ -52,6 +66,12 @@ pub struct NodeAgentConfig {
     pub system: SystemConfig,
     #[serde(default = "default_yaml_storage")]
     pub yaml_storage: String,
+    /// Pull the images of models assigned to this node when they are applied
+    #[serde(default = "default_prepull_images")]
+    pub prepull_images: bool,
+    /// Latency-critical models whose containers are created ahead of a start
+    #[serde(default)]
+    pub warm_models: Vec<String>,
 }
 
 fn default_node_name() -> String {
@@ -73,6 +93,10 @@ fn default_yaml_storage() -> String {
     "/etc/piccolo/yaml".to_string()
 }
 
+fn default_prepull_images() -> bool {
+    true
+}
+
 #[derive(Debug, Deserialize, Clone, Default, PartialEq)]
 pub struct Config {
     pub nodeagent: NodeAgentConfig,
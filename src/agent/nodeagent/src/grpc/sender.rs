@@ -4,7 +4,7 @@
  */
 
 use common::apiserver::api_server_connection_client::ApiServerConnectionClient;
-use common::monitoringserver::{ContainerList, SendContainerListResponse};
+use common::monitoringserver::{ContainerList, SendContainerListResponse, TelemetryFrame};
 use common::nodeagent::fromapiserver::{
     HeartbeatRequest, HeartbeatResponse, NodeRegistrationRequest, NodeRegistrationResponse,
     StatusAck, StatusReport,
@@ -14,8 +14,13 @@ use common::statemanager::{
 };
 
 use common::monitoringserver::monitoring_server_connection_client::MonitoringServerConnectionClient;
+use tokio::sync::mpsc;
 use tonic::{Request, Status};
 
+/// Frames buffered while the telemetry stream connects or the server is slow.
+/// A sender that fills it up closes the stream instead of dropping a delta.
+const TELEMETRY_QUEUE_SIZE: usize = 8;
+
 /// Sender for making gRPC requests to Monitoring Server
 #[derive(Clone, Default)]
 pub struct NodeAgentSender {}
@@ -178,6 +183,58 @@ impl NodeAgentSender {
     }
 }
 
+/// Long-lived `StreamTelemetry` call to the monitoring server
+///
+/// One tonic channel carries every frame instead of connecting per message.
+/// When the call fails, or frames cannot be queued, the stream is closed and
+/// the caller has to reopen it and start over with a keyframe.
+#[derive(Default)]
+pub struct TelemetrySender {
+    tx: Option<mpsc::Sender<TelemetryFrame>>,
+}
+
+impl TelemetrySender {
+    /// Whether frames sent now still reach the stream opened last
+    pub fn is_open(&self) -> bool {
+        self.tx.as_ref().is_some_and(|tx| !tx.is_closed())
+    }
+
+    /// Start a new stream; frames sent before it connects are queued
+    pub fn open(&mut self) {
+        let (tx, rx) = mpsc::channel(TELEMETRY_QUEUE_SIZE);
+        self.tx = Some(tx);
+
+        let config = crate::config::Config::get();
+        let addr = format!("http://{}:47003", config.nodeagent.master_ip);
+        tokio::spawn(async move {
+            let frames = futures::stream::unfold(rx, |mut rx| async move {
+                rx.recv().await.map(|frame| (frame, rx))
+            });
+            match MonitoringServerConnectionClient::connect(addr).await {
+                Ok(mut client) => match client.stream_telemetry(Request::new(frames)).await {
+                    Ok(resp) => println!(
+                        "[NodeAgent] Telemetry stream closed after {} frames",
+                        resp.into_inner().frames
+                    ),
+                    Err(e) => eprintln!("[NodeAgent] Telemetry stream failed: {}", e),
+                },
+                Err(e) => eprintln!("[NodeAgent] Failed to connect telemetry stream: {}", e),
+            }
+        });
+    }
+
+    /// Queue a frame on the open stream
+    pub fn send(&mut self, frame: TelemetryFrame) -> Result<(), String> {
+        let tx = self.tx.as_ref().ok_or("telemetry stream is not open")?;
+        if let Err(e) = tx.try_send(frame) {
+            // Frames after a lost one would not apply; close and resync
+            self.tx = None;
+            return Err(format!("telemetry stream closed: {}", e));
+        }
+        Ok(())
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use crate::grpc::sender::NodeAgentSender;
@@ -191,6 +248,16 @@ mod tests {
     use common::statemanager::{Action, Response as SMResponse};
     use tonic::{Request, Response, Status};
 
+    #[tokio::test]
+    async fn test_telemetry_sender_requires_open_stream() {
+        use crate::grpc::sender::TelemetrySender;
+        use common::monitoringserver::TelemetryFrame;
+
+        let mut telemetry = TelemetrySender::default();
+        assert!(!telemetry.is_open());
+        assert!(telemetry.send(TelemetryFrame::default()).is_err());
+    }
+
     #[tokio::test]
     async fn test_trigger_action_success() {
         let mut sender = NodeAgentSender::default();
@@ -9,7 +9,9 @@
 //! It is designed to be thread-safe and run in an async context.
 use crate::desired_state::DesiredState;
 use crate::grpc::sender::NodeAgentSender;
-use common::monitoringserver::{ContainerInfo, ContainerList};
+use crate::resource::cache::ContainerCache;
+use crate::resource::stats::StatsTracker;
+use common::monitoringserver::{ContainerList, NodeInfo};
 use common::nodeagent::fromapiserver::HandleYamlRequest;
 use common::Result;
 use std::collections::HashMap;
@@ -30,6 +32,12 @@ pub struct NodeAgentManager {
     /// In-memory cache of desired states for self-healing.
     /// Shared with the gRPC receiver so both can read/write the same state.
     pub desired_states_cache: Arc<Mutex<HashMap<String, DesiredState>>>,
+    /// Containers on this node, kept in sync from the Podman event stream.
+    pub containers: Arc<ContainerCache>,
+    /// Latest stats of running containers from the Podman stats stream.
+    stats: Arc<StatsTracker>,
+    /// Node info sampled since the last telemetry frame.
+    latest_node_info: Mutex<Option<NodeInfo>>,
 }
 
 impl NodeAgentManager {
@@ -47,6 +55,9 @@ impl NodeAgentManager {
         Self {
             rx_grpc: Arc::new(Mutex::new(rx)),
             sender: Arc::new(Mutex::new(NodeAgentSender::default())),
+            containers: Arc::new(ContainerCache::new(hostname.clone())),
+            stats: Arc::new(StatsTracker::new()),
+            latest_node_info: Mutex::new(None),
             hostname,
             desired_states_cache,
         }
@@ -79,72 +90,119 @@ impl NodeAgentManager {
         Ok(())
     }
 
-    /// Background task: Periodically gathers container info using inspect().
+    /// Background task: Periodically streams container and node telemetry to the monitoring server.
     ///
-    /// This runs in an infinite loop and logs or processes container info as needed.
-    async fn gather_container_info_loop(&self) {
-        use crate::resource::container::inspect;
+    /// The container list comes from the shared cache and the stats of running
+    /// containers from the stats stream. A container is sampled on its own only
+    /// while the stream is down or has not reported it yet. Frames only carry what changed
+    /// since the previous one, with a keyframe every `DEFAULT_KEYFRAME_INTERVAL` frames
+    /// and after every reconnect.
+    ///
+    /// Nothing is sent while the cache is not synced: a keyframe taken from
+    /// an incomplete cache would tell the monitoring server that containers
+    /// which are still running are gone.
+    async fn stream_telemetry_loop(&self) {
+        use crate::grpc::sender::TelemetrySender;
+        use crate::resource::container::stats_sample;
+        use common::monitoringserver::telemetry::{stats_map, TelemetryEncoder};
+        use futures::future::join_all;
+        use std::collections::{HashMap, HashSet};
         use tokio::time::{sleep, Duration};
 
-        // This is the previous container list for comparison
-        let mut previous_container_list = Vec::new();
+        let mut telemetry = TelemetrySender::default();
+        let mut encoder = TelemetryEncoder::default();
+        // Sample last written to the cache per container
+        let mut cached_samples = HashMap::new();
 
         loop {
-            let container_list = inspect(self.hostname.clone()).await.unwrap_or_default();
-            let node = self.hostname.clone();
+            sleep(Duration::from_secs(1)).await;
 
-            // Send the container info to the monitoring server
-            {
-                let mut sender = self.sender.lock().await;
-                if let Err(e) = sender
-                    .send_container_list(ContainerList {
-                        node_name: node.clone(),
-                        containers: container_list.clone(),
-                    })
-                    .await
-                {
-                    eprintln!("[NodeAgent] Error sending container info: {}", e);
+            if !self.containers.is_synced() {
+                continue;
+            }
+            let container_list = self.containers.snapshot();
+            let stream_live = self.stats.is_live();
+            let samples = join_all(container_list.iter().map(|info| async move {
+                if info.state.get("Status").map(String::as_str) != Some("running") {
+                    return None;
+                }
+                let streamed = if stream_live {
+                    self.stats.get(&info.id)
+                } else {
+                    None
+                };
+                match streamed {
+                    Some(sample) => Some(sample),
+                    None => stats_sample(&info.id).await,
+                }
+            }))
+            .await;
+            for (info, sample) in container_list.iter().zip(&samples) {
+                if cached_samples.get(&info.id) != Some(sample) {
+                    self.containers
+                        .set_stats(&info.id, stats_map(sample.as_ref()));
+                    cached_samples.insert(info.id.clone(), sample.clone());
                 }
             }
+            let current: HashSet<&str> = container_list.iter().map(|c| c.id.as_str()).collect();
+            cached_samples.retain(|id: &String, _| current.contains(id.as_str()));
+            let node_info = self.latest_node_info.lock().await.take();
 
-            // Check if the container list is changed from the previous one except for ContainerList.stats
-            // (which is not included in the comparison)
-            if !containers_equal_except_stats(&previous_container_list, &container_list) {
-                // println!(
-                //     "Container list changed for node: {}. Previous: {:?}, Current: {:?}",
-                //     node, previous_container_list, container_list
-                // );
-
-                // Save the previous container list for comparison
-                previous_container_list = container_list.clone();
-
-                // Send the changed container list to the state manager
-                let mut sender = self.sender.lock().await;
-                if let Err(e) = sender
-                    .send_changed_container_list(ContainerList {
-                        node_name: node.clone(),
-                        containers: container_list,
-                    })
-                    .await
-                {
-                    eprintln!("[NodeAgent] Error sending changed container list: {}", e);
-                }
+            if !telemetry.is_open() {
+                telemetry.open();
+                encoder.force_keyframe();
+            }
+            let frame = encoder.encode(
+                &self.hostname,
+                container_list.into_iter().zip(samples).collect(),
+                node_info,
+            );
+            if let Err(e) = telemetry.send(frame) {
+                eprintln!("[NodeAgent] Error sending telemetry: {}", e);
             }
+        }
+    }
 
-            sleep(Duration::from_secs(1)).await;
+    /// Background task: Reports container lifecycle changes to the state manager.
+    ///
+    /// Wakes up on every cache revision, so an exit reaches the state manager as
+    /// soon as Podman reports it. Stats-only changes do not move the revision.
+    async fn report_container_changes_loop(&self) {
+        let mut revision = self.containers.subscribe();
+
+        while revision.changed().await.is_ok() {
+            if !self.containers.is_synced() {
+                continue;
+            }
+
+            // Send the changed container list to the state manager
+            let mut sender = self.sender.lock().await;
+            if let Err(e) = sender
+                .send_changed_container_list(ContainerList {
+                    node_name: self.hostname.clone(),
+                    containers: self.containers.snapshot(),
+                })
+                .await
+            {
+                eprintln!("[NodeAgent] Error sending changed container list: {}", e);
+            }
         }
     }
 
-    /// Background task: Periodically gathers system info using extract_system_info().
+    /// Background task: Publishes node info from the system info sampler.
     ///
-    /// This runs in an infinite loop and logs or processes system info as needed.
+    /// The sampler runs on its own thread with the per-group periods from the
+    /// `metrics.sampling` config; this loop wakes up on each new sample.
     async fn gather_node_info_loop(&self) {
-        use crate::resource::nodeinfo::extract_node_info_delta;
-        use common::monitoringserver::NodeInfo;
-        use tokio::time::{sleep, Duration};
+        use crate::resource::nodeinfo::{spawn, SamplingIntervals};
 
-        loop {
-            let node_info_data = extract_node_info_delta();
+        let config = crate::config::Config::get();
+        let mut samples = spawn(SamplingIntervals::from_config(
+            &config.nodeagent.metrics.sampling,
+        ));
+
+        while samples.changed().await.is_ok() {
+            let node_info_data = samples.borrow_and_update().clone();
 
             // Create NodeInfo message for gRPC
             let node_info = NodeInfo {
@@ -164,13 +222,8 @@ impl NodeAgentManager {
                 ip: node_info_data.ip,
             };
 
-            // Send NodeInfo to monitoring server
-            {
-                let mut sender = self.sender.lock().await;
-                if let Err(e) = sender.send_node_info(node_info.clone()).await {
-                    eprintln!("[NodeAgent] Error sending node info: {}", e);
-                }
-            }
+            // Hand NodeInfo to the telemetry stream for the monitoring server
+            *self.latest_node_info.lock().await = Some(node_info.clone());
 
             println!(
                 "[NodeInfo] CPU: {:.2}%, CPU Count: {}, GPU Count: {}, Mem: {}/{} KB ({:.2}%), Net RX: {} B, Net TX: {} B, Disk Read: {} B, Disk Write: {} B, OS: {}, Arch: {}, IP: {}",
@@ -188,8 +241,8 @@ impl NodeAgentManager {
                 node_info.arch,
                 node_info.ip
             );
-            sleep(Duration::from_secs(1)).await;
         }
+        eprintln!("[NodeAgent] Node info sampler stopped");
     }
 
     /// Runs the NodeAgentManager event loop.
@@ -203,9 +256,23 @@ impl NodeAgentManager {
                 eprintln!("Error in gRPC processor: {:?}", e);
             }
         });
+        // Keep the shared container cache in sync with the Podman event stream
+        let tracked = Arc::clone(&arc_self.containers);
+        let container_tracker = tokio::spawn(async move {
+            crate::resource::cache::track_containers(&tracked).await;
+        });
+        // Keep one stats request open for all running containers
+        let tracked_stats = Arc::clone(&arc_self.stats);
+        let stats_tracker = tokio::spawn(async move {
+            crate::resource::stats::track_stats(&tracked_stats).await;
+        });
         let container_manager = Arc::clone(&arc_self);
         let container_gatherer = tokio::spawn(async move {
-            container_manager.gather_container_info_loop().await;
+            container_manager.stream_telemetry_loop().await;
+        });
+        let change_manager = Arc::clone(&arc_self);
+        let change_reporter = tokio::spawn(async move {
+            change_manager.report_container_changes_loop().await;
         });
 
         // Spawn a background task to periodically extract and print system info
@@ -214,21 +281,35 @@ impl NodeAgentManager {
             nodeinfo_manager.gather_node_info_loop().await;
         });
 
+        // Pull images and create warm containers for models applied to this node
+        let config = crate::config::Config::get();
+        if config.nodeagent.prepull_images {
+            tokio::spawn(crate::runtime::podman::prewarm::watch_artifacts(
+                config.get_node_name(),
+                config.nodeagent.warm_models.clone(),
+            ));
+        }
+
         // Spawn the reconciliation loop to detect and recover exited containers
         let reconcile_cache = Arc::clone(&arc_self.desired_states_cache);
+        let reconcile_containers = Arc::clone(&arc_self.containers);
         let reconciler = tokio::spawn(async move {
-            reconciliation_loop(reconcile_cache).await;
+            reconciliation_loop(reconcile_cache, reconcile_containers).await;
         });
 
         // Spawn the liveness probe loop to monitor running containers
         let probe_cache = Arc::clone(&arc_self.desired_states_cache);
+        let probe_containers = Arc::clone(&arc_self.containers);
         let probe_task = tokio::spawn(async move {
-            crate::probe::probe_loop(probe_cache).await;
+            crate::probe::probe_loop(probe_cache, probe_containers).await;
         });
 
         let _ = tokio::try_join!(
             grpc_processor,
+            container_tracker,
+            stats_tracker,
             container_gatherer,
+            change_reporter,
             nodeinfo_task,
             reconciler,
             probe_task
@@ -257,17 +338,21 @@ fn calculate_backoff(restart_count: u32) -> std::time::Duration {
     std::time::Duration::from_secs(wait_seconds)
 }
 
-/// Runs the reconciliation loop: periodically compares desired vs actual container states.
+/// Runs the reconciliation loop: compares desired vs actual container states.
 ///
-/// Every second, this function reads all desired states from the in-memory cache and
-/// compares them against actual container states reported by Podman. If a container that
+/// This function runs whenever the container cache reports a change, and at least once
+/// per second so restart backoffs are re-evaluated. It reads all desired states from the
+/// in-memory cache and compares them against the actual container states kept in
+/// `containers`, without querying Podman. If a container that
 /// should be running is found to be exited or dead, `handle_exited_container` is called
 /// (the Podman restart API preserves the same container ID). If the container is completely
 /// missing (removed from Podman), `handle_missing_container` recreates it from the stored
 /// pod YAML and updates the cache with the new container ID.
-pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String, DesiredState>>>) {
-    use crate::resource::container::{get_inspect, get_list};
-    use tokio::time::{sleep, Duration};
+pub async fn reconciliation_loop(
+    desired_states_cache: Arc<Mutex<HashMap<String, DesiredState>>>,
+    containers: Arc<ContainerCache>,
+) {
+    let mut revision = containers.subscribe();
 
     // In-memory backoff state per container ID.
     let backoff_states: Arc<Mutex<HashMap<String, BackoffState>>> =
@@ -280,15 +365,11 @@ pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String,
             cache.clone()
         };
 
-        // Get actual container list from Podman.
-        let actual_containers = match get_list().await {
-            Ok(containers) => containers,
-            Err(e) => {
-                eprintln!("[Reconciliation] Failed to list containers: {:?}", e);
-                sleep(Duration::from_secs(1)).await;
-                continue;
-            }
-        };
+        // A cache that is not synced could report running containers as missing.
+        if !containers.is_synced() {
+            wait_for_change(&mut revision).await;
+            continue;
+        }
 
         // Compare desired vs actual for each tracked pod.
         for (pod_name, desired) in &desired_states {
@@ -297,9 +378,7 @@ pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String,
                 continue;
             }
 
-            let actual = actual_containers
-                .iter()
-                .find(|c| c.Id == desired.container_id);
+            let actual = containers.get(&desired.container_id);
 
             match actual {
                 None => {
@@ -312,6 +391,12 @@ pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String,
                     // new container ID) and update the cache so subsequent iterations use
                     // the new ID.
                     if let Some(new_id) = handle_missing_container(desired).await {
+                        // Record the new container before the next pass so it is not
+                        // seen as missing while its events are still in flight.
+                        if let Err(e) = containers.refresh(&new_id).await {
+                            // Its create/start events update the entry instead
+                            eprintln!("[Reconciliation] {}", e);
+                        }
                         let mut cache = desired_states_cache.lock().await;
                         if let Some(state) = cache.get_mut(pod_name) {
                             eprintln!(
@@ -334,21 +419,26 @@ pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String,
                         states.remove(&desired.container_id);
                     }
                 }
-                Some(container) if container.State == "exited" || container.State == "dead" => {
-                    // Container has stopped; retrieve the exit code via inspect.
-                    let exit_code = match get_inspect(&desired.container_id).await {
-                        Ok(inspect) => inspect.State.ExitCode,
-                        Err(e) => {
+                Some(container)
+                    if matches!(
+                        container.state.get("Status").map(String::as_str),
+                        Some("exited") | Some("dead")
+                    ) =>
+                {
+                    // Container has stopped; the exit code comes with the cached inspect.
+                    let exit_code = match container.state.get("ExitCode").map(|c| c.parse()) {
+                        Some(Ok(code)) => code,
+                        _ => {
                             eprintln!(
-                                "[Reconciliation] Failed to inspect container '{}': {:?}; using exit code 1",
-                                desired.container_id, e
+                                "[Reconciliation] No exit code for container '{}'; using exit code 1",
+                                desired.container_id
                             );
                             1
                         }
                     };
                     eprintln!(
                         "[Reconciliation] Container '{}' in state '{}' for pod '{}' (exit code {})",
-                        desired.container_id, container.State, pod_name, exit_code
+                        desired.container_id, container.state["Status"], pod_name, exit_code
                     );
                     // Podman's restart API restarts the container in-place, preserving the
                     // same container ID. No cache update needed.
@@ -360,7 +450,17 @@ pub async fn reconciliation_loop(desired_states_cache: Arc<Mutex<HashMap<String,
             }
         }
 
-        sleep(Duration::from_secs(1)).await;
+        wait_for_change(&mut revision).await;
+    }
+}
+
+/// Waits for the next container cache change, or one second at most.
+async fn wait_for_change(revision: &mut tokio::sync::watch::Receiver<u64>) {
+    use tokio::time::{timeout, Duration};
+
+    if let Ok(Err(_)) = timeout(Duration::from_secs(1), revision.changed()).await {
+        // The cache is gone; fall back to the timer alone.
+        tokio::time::sleep(Duration::from_secs(1)).await;
     }
 }
 
@@ -535,21 +635,6 @@ async fn handle_exited_container(
     }
 }
 
-fn containers_equal_except_stats<'a>(a: &'a [ContainerInfo], b: &'a [ContainerInfo]) -> bool {
-    if a.len() != b.len() {
-        return false;
-    }
-    a.iter().zip(b.iter()).all(|(c1, c2)| {
-        c1.id == c2.id
-            && c1.names == c2.names
-            && c1.image == c2.image
-            && c1.state == c2.state
-            && c1.config == c2.config
-            && c1.annotation == c2.annotation
-        // do NOT compare c1.stats/c2.stats
-    })
-}
-
 // unit test cases
 #[cfg(test)]
 mod tests {
@@ -597,7 +682,8 @@ spec:
 "#;
     use crate::desired_state::DesiredState;
     use crate::manager::NodeAgentManager;
-    use common::monitoringserver::{ContainerInfo, ContainerList, NodeInfo};
+    use crate::resource::cache::ContainerCache;
+    use common::monitoringserver::{ContainerList, NodeInfo};
     use common::nodeagent::fromapiserver::HandleYamlRequest;
     use std::collections::HashMap;
     use std::sync::Arc;
@@ -609,51 +695,8 @@ spec:
         Arc::new(Mutex::new(HashMap::new()))
     }
 
-    #[test]
-    fn test_containers_equal_except_stats_true_and_false() {
-        let c1 = ContainerInfo {
-            id: "id1".to_string(),
-            names: vec!["n1".to_string()],
-            image: "img".to_string(),
-            state: HashMap::new(),
-            config: HashMap::new(),
-            annotation: HashMap::new(),
-            stats: HashMap::new(),
-        };
-        let c2 = ContainerInfo {
-            id: "id1".to_string(),
-            names: vec!["n1".to_string()],
-            image: "img".to_string(),
-            state: HashMap::new(),
-            config: HashMap::new(),
-            annotation: HashMap::new(),
-            stats: HashMap::new(),
-        };
-        let c3 = ContainerInfo {
-            id: "id2".to_string(),
-            names: vec!["n2".to_string()],
-            image: "img2".to_string(),
-            state: HashMap::new(),
-            config: HashMap::new(),
-            annotation: HashMap::new(),
-            stats: HashMap::new(),
-        };
-
-        // True: stats ignored, all else equal
-        assert!(super::containers_equal_except_stats(
-            &[c1.clone()],
-            &[c2.clone()]
-        ));
-        // False: id differs
-        assert!(!super::containers_equal_except_stats(
-            &[c1.clone()],
-            &[c3.clone()]
-        ));
-        // False: length differs
-        assert!(!super::containers_equal_except_stats(
-            &[c1.clone(), c2.clone()],
-            &[c1.clone()]
-        ));
+    fn make_containers() -> Arc<ContainerCache> {
+        Arc::new(ContainerCache::new("test-host".to_string()))
     }
 
     #[tokio::test]
@@ -738,7 +781,7 @@ spec:
         // The loop runs indefinitely; a timeout verifies it doesn't panic in the first iteration.
         let result = timeout(
             Duration::from_millis(200),
-            super::reconciliation_loop(cache),
+            super::reconciliation_loop(cache, make_containers()),
         )
         .await;
         // Err means the timeout fired, which is the expected outcome for an infinite loop.
@@ -755,11 +798,11 @@ spec:
             // DesiredState::new leaves container_id empty, so the loop should skip it.
             c.insert("pod-a".to_string(), DesiredState::new("pod-a".to_string()));
         }
-        // The loop will try to contact Podman (get_list) and either succeed or log an error;
+        // The container cache never syncs without Podman, so the loop only waits;
         // either way it must not panic.
         let result = timeout(
             Duration::from_millis(200),
-            super::reconciliation_loop(cache),
+            super::reconciliation_loop(cache, make_containers()),
         )
         .await;
         assert!(result.is_err());
@@ -920,7 +963,7 @@ spec:
         // Run loop for a short time
         let result = timeout(
             Duration::from_millis(200),
-            super::reconciliation_loop(Arc::clone(&cache)),
+            super::reconciliation_loop(Arc::clone(&cache), make_containers()),
         )
         .await;
         assert!(result.is_err()); // Timeout expected (loop is infinite)
@@ -5,14 +5,54 @@
 
 //! Probe checker implementations for HTTP, TCP, and Exec probe types.
 
+use hyper::client::HttpConnector;
+use hyper::Client;
+use std::collections::HashMap;
+use std::sync::{Mutex, OnceLock};
 use tokio::time::{timeout, Duration};
 
+/// Probe target IPs by container ID, resolved once per container instance.
+static TARGET_IPS: OnceLock<Mutex<HashMap<String, String>>> = OnceLock::new();
+
+/// HTTP client shared by all HTTP probes so keep-alive connections are reused.
+static HTTP_CLIENT: OnceLock<Client<HttpConnector>> = OnceLock::new();
+
+fn target_ips() -> std::sync::MutexGuard<'static, HashMap<String, String>> {
+    TARGET_IPS
+        .get_or_init(Default::default)
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+}
+
+/// Drop the cached target IP of a container that stopped or restarted.
+pub fn forget_target(container_id: &str) {
+    target_ips().remove(container_id);
+}
+
 /// Get the target IP address for probing a container.
 ///
+/// The address is inspected on the first probe of a container and cached
+/// until [`forget_target`] is called; fallbacks after a failed inspection are
+/// not cached.
+async fn get_container_target_ip(container_id: &str) -> String {
+    if let Some(ip) = target_ips().get(container_id) {
+        return ip.clone();
+    }
+    match inspect_target_ip(container_id).await {
+        Some(ip) => {
+            target_ips().insert(container_id.to_string(), ip.clone());
+            ip
+        }
+        None => "127.0.0.1".to_string(),
+    }
+}
+
+/// Inspect the target IP address for probing a container.
+///
 /// - If the container uses host network mode, returns "127.0.0.1"
 /// - If the container uses bridge network, returns the container's IP address
-/// - Returns "127.0.0.1" as fallback if inspection fails
-async fn get_container_target_ip(container_id: &str) -> String {
+/// - Returns `None` if inspection fails
+async fn inspect_target_ip(container_id: &str) -> Option<String> {
     let inspect_path = format!("/v4.0.0/libpod/containers/{}/json", container_id);
 
     match crate::runtime::podman::get(&inspect_path).await {
@@ -26,7 +66,7 @@ async fn get_container_target_ip(container_id: &str) -> String {
                                 "[Probe] Container {} uses host network, targeting localhost",
                                 container_id
                             );
-                            return "127.0.0.1".to_string();
+                            return Some("127.0.0.1".to_string());
                         }
                     }
 
@@ -37,7 +77,7 @@ async fn get_container_target_ip(container_id: &str) -> String {
                                 "[Probe] Container {} uses bridge network, targeting {}",
                                 container_id, ip
                             );
-                            return ip.to_string();
+                            return Some(ip.to_string());
                         }
                     }
 
@@ -45,11 +85,11 @@ async fn get_container_target_ip(container_id: &str) -> String {
                         "[Probe] Could not determine IP for container {}, using localhost",
                         container_id
                     );
-                    "127.0.0.1".to_string()
+                    Some("127.0.0.1".to_string())
                 }
                 Err(e) => {
                     eprintln!("[Probe] Failed to parse container inspect JSON: {}", e);
-                    "127.0.0.1".to_string()
+                    None
                 }
             }
         }
@@ -58,7 +98,7 @@ async fn get_container_target_ip(container_id: &str) -> String {
                 "[Probe] Failed to inspect container {}: {}",
                 container_id, e
             );
-            "127.0.0.1".to_string()
+            None
         }
     }
 }
@@ -72,7 +112,7 @@ async fn get_container_target_ip(container_id: &str) -> String {
 /// Returns `true` if the response status code is in the range 200–399.
 /// Returns `false` on connection error, timeout, or non-2xx/3xx response.
 pub async fn check_http(container_id: &str, path: &str, port: u16, timeout_secs: u32) -> bool {
-    use hyper::{Client, Uri};
+    use hyper::Uri;
 
     let target_ip = get_container_target_ip(container_id).await;
     let uri_str = format!("http://{}:{}{}", target_ip, port, path);
@@ -87,7 +127,7 @@ pub async fn check_http(container_id: &str, path: &str, port: u16, timeout_secs:
         }
     };
 
-    let client = Client::new();
+    let client = HTTP_CLIENT.get_or_init(Client::new);
     let duration = Duration::from_secs(timeout_secs as u64);
 
     match timeout(duration, client.get(uri)).await {
@@ -196,6 +236,22 @@ mod tests {
         assert!(!result);
     }
 
+    #[tokio::test]
+    async fn test_target_ip_fallback_is_not_cached() {
+        // Podman does not know this container, so localhost is used but not remembered
+        let ip = get_container_target_ip("uncached-container").await;
+        assert_eq!(ip, "127.0.0.1");
+        assert!(!target_ips().contains_key("uncached-container"));
+
+        target_ips().insert("cached-container".to_string(), "10.88.0.5".to_string());
+        assert_eq!(
+            get_container_target_ip("cached-container").await,
+            "10.88.0.5"
+        );
+        forget_target("cached-container");
+        assert!(!target_ips().contains_key("cached-container"));
+    }
+
     #[tokio::test]
     async fn test_check_exec_empty_command_returns_false() {
         let result = check_exec("some-container", &[], 5).await;
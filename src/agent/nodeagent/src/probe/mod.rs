@@ -12,151 +12,173 @@
 
 pub mod checker;
 pub mod liveness;
+pub mod scheduler;
 
 use crate::desired_state::DesiredState;
+use crate::resource::cache::ContainerCache;
+use common::monitoringserver::ContainerInfo;
+use scheduler::{ProbeOutcome, ProbeSchedule, ProbeTarget};
 use std::collections::HashMap;
 use std::sync::Arc;
-use std::time::SystemTime;
 use tokio::sync::Mutex;
-use tokio::time::{sleep, Duration};
-
-/// Tracks per-container probe timing state.
-struct ProbeState {
-    /// When this probe state was first created (used as a proxy for container start time
-    /// to determine when `initial_delay_seconds` has elapsed).
-    first_seen_at: SystemTime,
-    /// The last time a liveness probe was executed for this container.
-    last_probe_at: Option<SystemTime>,
-}
+use tokio::task::JoinSet;
+use tokio::time::{sleep_until, Duration, Instant};
+
+/// Upper bound of liveness probes running at the same time
+const MAX_CONCURRENT_PROBES: usize = 8;
+/// How often the probed containers are matched against the desired states
+/// when no container event arrives
+const SYNC_INTERVAL: Duration = Duration::from_secs(1);
 
 /// Main liveness probe loop.
 ///
-/// Runs every second. For each running container that has a `probe_config` in the
-/// `desired_states_cache`, the loop:
-/// 1. Checks whether `initial_delay_seconds` has elapsed since the container was first seen.
-/// 2. Checks whether `period_seconds` has elapsed since the last probe.
-/// 3. Executes the liveness probe.
-/// 4. Increments the failure counter on failure, resets it on success.
-/// 5. Stops the container via Podman if `failure_threshold` consecutive failures occur.
-pub async fn probe_loop(desired_states_cache: Arc<Mutex<HashMap<String, DesiredState>>>) {
-    use crate::resource::container::get_list;
-
-    let mut failure_counts: HashMap<String, u8> = HashMap::new();
-    let mut probe_states: HashMap<String, ProbeState> = HashMap::new();
+/// Every running container in `containers` that has a liveness probe in the
+/// `desired_states_cache` is scheduled on its own deadline:
+/// 1. The first probe runs `initial_delay_seconds` after the container was first seen
+///    (or restarted).
+/// 2. Every later probe runs `period_seconds` after the previous one finished.
+/// 3. Up to `MAX_CONCURRENT_PROBES` probes run concurrently, so a slow probe only
+///    delays its own container.
+/// 4. The failure counter is incremented on failure and reset on success.
+/// 5. The container is stopped via Podman after `failure_threshold` consecutive failures.
+pub async fn probe_loop(
+    desired_states_cache: Arc<Mutex<HashMap<String, DesiredState>>>,
+    containers: Arc<ContainerCache>,
+) {
+    let mut schedule = ProbeSchedule::new();
+    let mut probes: JoinSet<(String, u64, bool)> = JoinSet::new();
+    let mut revision = containers.subscribe();
+    let mut revision_open = true;
+    let mut next_sync = Instant::now();
 
     loop {
-        // Get the list of running containers from Podman.
-        let running_containers = match get_list().await {
-            Ok(containers) => containers
-                .into_iter()
-                .filter(|c| c.State == "running")
-                .collect::<Vec<_>>(),
-            Err(e) => {
-                eprintln!("[Probe] Failed to list containers: {}", e);
-                sleep(Duration::from_secs(1)).await;
-                continue;
+        let now = Instant::now();
+        if now >= next_sync {
+            // Targets are only trusted once the cache reflects Podman
+            if containers.is_synced() {
+                let targets = probe_targets(&desired_states_cache, &containers.snapshot()).await;
+                for id in schedule.sync(targets, now.into_std()) {
+                    checker::forget_target(&id);
+                }
             }
-        };
-
-        // Remove probe state for containers that are no longer running.
-        let running_ids: std::collections::HashSet<String> =
-            running_containers.iter().map(|c| c.Id.clone()).collect();
-        probe_states.retain(|id, _| running_ids.contains(id));
-        failure_counts.retain(|id, _| running_ids.contains(id));
-
-        // Take a snapshot of the desired states (release lock immediately).
-        let desired_states = {
-            let cache = desired_states_cache.lock().await;
-            cache.clone()
-        };
-
-        let now = SystemTime::now();
-
-        for container in &running_containers {
-            let container_id = &container.Id;
-
-            // Find the desired state for this container by matching the container ID.
-            let desired = match desired_states
-                .values()
-                .find(|d| &d.container_id == container_id)
-            {
-                Some(d) => d,
-                None => continue, // No desired state → no probe configured
-            };
+            next_sync = now + SYNC_INTERVAL;
+        }
 
-            // Check whether the desired state includes a liveness probe config.
-            let liveness_probe = match desired
-                .probe_config
-                .as_ref()
-                .and_then(|pc| pc.liveness.as_ref())
-            {
-                Some(lp) => lp,
-                None => continue, // No liveness probe configured → skip
+        while probes.len() < MAX_CONCURRENT_PROBES {
+            let Some((container_id, generation, probe)) = schedule.pop_due(now.into_std()) else {
+                break;
             };
+            probes.spawn(async move {
+                let success = liveness::check_liveness_probe(&container_id, &probe).await;
+                (container_id, generation, success)
+            });
+        }
 
-            // Get or create the probe state for this container.
-            let probe_state =
-                probe_states
-                    .entry(container_id.clone())
-                    .or_insert_with(|| ProbeState {
-                        first_seen_at: now,
-                        last_probe_at: None,
-                    });
-
-            // Check initial_delay_seconds: skip probe until delay has elapsed.
-            let elapsed_since_start = now
-                .duration_since(probe_state.first_seen_at)
-                .unwrap_or_default();
-            if elapsed_since_start.as_secs() < liveness_probe.initial_delay_seconds as u64 {
-                continue;
+        // While every slot is busy only a finished probe or a sync can free a new one
+        let wake_at = match schedule.next_deadline() {
+            Some(deadline) if probes.len() < MAX_CONCURRENT_PROBES => {
+                Instant::from_std(deadline).min(next_sync)
             }
+            _ => next_sync,
+        };
 
-            // Check period_seconds: skip probe if not enough time has passed since last probe.
-            if let Some(last_probe_at) = probe_state.last_probe_at {
-                let elapsed_since_last = now.duration_since(last_probe_at).unwrap_or_default();
-                if elapsed_since_last.as_secs() < liveness_probe.period_seconds as u64 {
-                    continue;
+        tokio::select! {
+            Some(joined) = probes.join_next(), if !probes.is_empty() => {
+                match joined {
+                    Ok((container_id, generation, success)) => {
+                        let outcome = schedule.complete(
+                            &container_id,
+                            generation,
+                            success,
+                            Instant::now().into_std(),
+                        );
+                        handle_outcome(&container_id, outcome);
+                    }
+                    Err(e) => eprintln!("[Probe] Liveness probe task failed: {}", e),
                 }
             }
+            changed = revision.changed(), if revision_open => {
+                // A started, restarted or stopped container is picked up right away
+                revision_open = changed.is_ok();
+                next_sync = Instant::now();
+            }
+            _ = sleep_until(wake_at) => {}
+        }
+    }
+}
 
-            // Execute the liveness probe.
-            let success = liveness::check_liveness_probe(container_id, liveness_probe).await;
-
-            // Update the timestamp of the last probe execution.
-            probe_state.last_probe_at = Some(now);
+/// Running containers that have a liveness probe configured.
+async fn probe_targets(
+    desired_states_cache: &Mutex<HashMap<String, DesiredState>>,
+    containers: &[ContainerInfo],
+) -> Vec<ProbeTarget> {
+    // Map container ID → probe while holding the lock, then release it
+    let probes: HashMap<String, crate::desired_state::LivenessProbe> = {
+        let cache = desired_states_cache.lock().await;
+        cache
+            .values()
+            .filter_map(|d| {
+                let liveness = d.probe_config.as_ref()?.liveness.as_ref()?;
+                Some((d.container_id.clone(), liveness.clone()))
+            })
+            .collect()
+    };
+    if probes.is_empty() {
+        return Vec::new();
+    }
 
-            let previous_count = failure_counts.get(container_id).copied().unwrap_or(0);
+    containers
+        .iter()
+        .filter(|c| c.state.get("Status").map(String::as_str) == Some("running"))
+        .filter_map(|c| {
+            let probe = probes.get(&c.id)?.clone();
+            Some(ProbeTarget {
+                container_id: c.id.clone(),
+                started_at: c.state.get("StartedAt").cloned().unwrap_or_default(),
+                probe,
+            })
+        })
+        .collect()
+}
 
-            if success {
-                // Log only on state transition from failing to healthy.
-                if previous_count > 0 {
-                    println!(
-                        "[Probe] Liveness probe for container {} recovered (was {} failures)",
-                        container_id, previous_count
-                    );
-                }
-                failure_counts.insert(container_id.clone(), 0);
-            } else {
-                let count = failure_counts.entry(container_id.clone()).or_insert(0);
-                *count += 1;
+fn handle_outcome(container_id: &str, outcome: Option<ProbeOutcome>) {
+    match outcome {
+        // The container stopped or restarted while the probe was running
+        None => {}
+        Some(ProbeOutcome::Healthy { recovered_from }) => {
+            // Log only on state transition from failing to healthy.
+            if recovered_from > 0 {
                 println!(
-                    "[Probe] Liveness probe failed ({}/{}) for container {}",
-                    count, liveness_probe.failure_threshold, container_id
+                    "[Probe] Liveness probe for container {} recovered (was {} failures)",
+                    container_id, recovered_from
                 );
-
-                if *count >= liveness_probe.failure_threshold {
-                    println!(
-                        "[NodeAgent] Stopping container {} due to liveness probe failure",
-                        container_id
-                    );
-                    stop_container_by_id(container_id).await;
-                    failure_counts.remove(container_id);
-                    probe_states.remove(container_id);
-                }
             }
         }
-
-        sleep(Duration::from_secs(1)).await;
+        Some(ProbeOutcome::Failed {
+            failures,
+            threshold,
+        }) => {
+            println!(
+                "[Probe] Liveness probe failed ({}/{}) for container {}",
+                failures, threshold, container_id
+            );
+        }
+        Some(ProbeOutcome::Unhealthy { failures }) => {
+            println!(
+                "[Probe] Liveness probe failed ({}/{}) for container {}",
+                failures, failures, container_id
+            );
+            println!(
+                "[NodeAgent] Stopping container {} due to liveness probe failure",
+                container_id
+            );
+            checker::forget_target(container_id);
+            // Stopping waits for the container's grace period; keep probing others
+            let container_id = container_id.to_string();
+            tokio::spawn(async move {
+                stop_container_by_id(&container_id).await;
+            });
+        }
     }
 }
 
@@ -180,6 +202,7 @@ mod tests {
     use crate::desired_state::{DesiredState, LivenessProbe, ProbeConfig, ProbeType};
     use std::collections::HashMap;
     use std::sync::Arc;
+    use std::time::SystemTime;
     use tokio::sync::Mutex;
     use tokio::time::{sleep, Duration};
 
@@ -187,18 +210,63 @@ mod tests {
         Arc::new(Mutex::new(HashMap::new()))
     }
 
-    #[test]
-    fn test_probe_state_initializes_correctly() {
-        let now = SystemTime::now();
-        let state = ProbeState {
-            first_seen_at: now,
-            last_probe_at: None,
-        };
-        assert!(state.last_probe_at.is_none());
-        assert!(state
-            .first_seen_at
-            .duration_since(std::time::UNIX_EPOCH)
-            .is_ok());
+    fn make_containers() -> Arc<ContainerCache> {
+        Arc::new(ContainerCache::new("test-host".to_string()))
+    }
+
+    fn container(id: &str, status: &str) -> ContainerInfo {
+        let mut state = HashMap::new();
+        state.insert("Status".to_string(), status.to_string());
+        state.insert("StartedAt".to_string(), "t0".to_string());
+        ContainerInfo {
+            id: id.to_string(),
+            names: vec![],
+            image: String::new(),
+            state,
+            config: HashMap::new(),
+            annotation: HashMap::new(),
+            stats: HashMap::new(),
+        }
+    }
+
+    fn tcp_probe() -> LivenessProbe {
+        LivenessProbe {
+            probe_type: ProbeType::Tcp { port: 80 },
+            initial_delay_seconds: 0,
+            period_seconds: 1,
+            timeout_seconds: 1,
+            failure_threshold: 3,
+        }
+    }
+
+    #[tokio::test]
+    async fn test_probe_targets_only_running_containers_with_probe() {
+        let cache = make_cache();
+        {
+            let mut c = cache.lock().await;
+            for (name, id, probe) in [
+                ("probed", "abc", Some(tcp_probe())),
+                ("stopped", "def", Some(tcp_probe())),
+                ("unprobed", "ghi", None),
+            ] {
+                let mut state = DesiredState::new(name.to_string());
+                state.container_id = id.to_string();
+                state.probe_config = probe.map(|liveness| ProbeConfig {
+                    liveness: Some(liveness),
+                });
+                c.insert(name.to_string(), state);
+            }
+        }
+        let containers = vec![
+            container("abc", "running"),
+            container("def", "exited"),
+            container("ghi", "running"),
+        ];
+
+        let targets = probe_targets(&cache, &containers).await;
+        assert_eq!(targets.len(), 1);
+        assert_eq!(targets[0].container_id, "abc");
+        assert_eq!(targets[0].started_at, "t0");
     }
 
     #[tokio::test]
@@ -208,7 +276,7 @@ mod tests {
 
         // Run probe_loop for a short time - it should not panic even with empty cache
         let probe_task = tokio::spawn(async move {
-            probe_loop(cache_clone).await;
+            probe_loop(cache_clone, make_containers()).await;
         });
 
         sleep(Duration::from_millis(150)).await;
@@ -231,7 +299,7 @@ mod tests {
 
         let cache_clone = Arc::clone(&cache);
         let probe_task = tokio::spawn(async move {
-            probe_loop(cache_clone).await;
+            probe_loop(cache_clone, make_containers()).await;
         });
 
         sleep(Duration::from_millis(150)).await;
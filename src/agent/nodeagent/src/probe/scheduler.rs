@@ -0,0 +1,300 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Deadline queue of liveness probes.
+//!
+//! Each probed container has its own next run time derived from its
+//! `initial_delay_seconds` and `period_seconds`. Deadlines live in a binary
+//! heap; entries that were rescheduled or dropped are left in the heap and
+//! skipped when they surface, which keeps every operation logarithmic.
+
+use crate::desired_state::LivenessProbe;
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, HashMap};
+use std::time::{Duration, Instant};
+
+/// A running container that has a liveness probe configured.
+#[derive(Debug, Clone)]
+pub struct ProbeTarget {
+    pub container_id: String,
+    /// Start time reported by Podman; a change means the container restarted.
+    pub started_at: String,
+    pub probe: LivenessProbe,
+}
+
+/// Result of a finished probe, as far as the caller has to act on it.
+#[derive(Debug, PartialEq, Eq)]
+pub enum ProbeOutcome {
+    /// The probe passed; `recovered_from` is the number of failures before it.
+    Healthy { recovered_from: u8 },
+    /// The probe failed but the failure threshold is not reached yet.
+    Failed { failures: u8, threshold: u8 },
+    /// The failure threshold was reached; the container is no longer scheduled.
+    Unhealthy { failures: u8 },
+}
+
+struct Entry {
+    started_at: String,
+    probe: LivenessProbe,
+    /// Matches the heap item that is currently valid for this container.
+    generation: u64,
+    failures: u8,
+    in_flight: bool,
+}
+
+#[derive(Default)]
+pub struct ProbeSchedule {
+    heap: BinaryHeap<Reverse<(Instant, u64, String)>>,
+    entries: HashMap<String, Entry>,
+    next_generation: u64,
+}
+
+impl ProbeSchedule {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Track exactly `targets`.
+    ///
+    /// New and restarted containers get their first probe after the initial
+    /// delay; a changed probe config applies from the next run.
+    ///
+    /// # Returns
+    ///
+    /// * `Vec<String>` - containers that were dropped or restarted, whose
+    ///   cached probe data is stale
+    pub fn sync(&mut self, targets: Vec<ProbeTarget>, now: Instant) -> Vec<String> {
+        let mut stale = Vec::new();
+        let mut seen = std::collections::HashSet::with_capacity(targets.len());
+        for target in targets {
+            seen.insert(target.container_id.clone());
+            match self.entries.get_mut(&target.container_id) {
+                Some(entry) if entry.started_at == target.started_at => {
+                    entry.probe = target.probe;
+                    continue;
+                }
+                Some(_) => stale.push(target.container_id.clone()),
+                None => {}
+            }
+            let first_run = now + Duration::from_secs(target.probe.initial_delay_seconds as u64);
+            self.entries.insert(
+                target.container_id.clone(),
+                Entry {
+                    started_at: target.started_at,
+                    probe: target.probe,
+                    generation: 0,
+                    failures: 0,
+                    in_flight: false,
+                },
+            );
+            self.schedule(&target.container_id, first_run);
+        }
+
+        let gone: Vec<String> = self
+            .entries
+            .keys()
+            .filter(|id| !seen.contains(*id))
+            .cloned()
+            .collect();
+        for id in &gone {
+            self.entries.remove(id);
+        }
+        stale.extend(gone);
+        stale
+    }
+
+    /// Deadline of the next probe, `None` when nothing is scheduled.
+    pub fn next_deadline(&mut self) -> Option<Instant> {
+        self.drop_stale_head();
+        self.heap.peek().map(|Reverse((at, _, _))| *at)
+    }
+
+    /// Take the next probe due at `now`.
+    ///
+    /// The container is not scheduled again until [`complete`](Self::complete)
+    /// is called with the returned generation.
+    pub fn pop_due(&mut self, now: Instant) -> Option<(String, u64, LivenessProbe)> {
+        self.drop_stale_head();
+        match self.heap.peek() {
+            Some(Reverse((at, _, _))) if *at <= now => {}
+            _ => return None,
+        }
+        let Reverse((_, generation, id)) = self.heap.pop()?;
+        let entry = self.entries.get_mut(&id)?;
+        entry.in_flight = true;
+        Some((id, generation, entry.probe.clone()))
+    }
+
+    /// Record the result of a probe taken with [`pop_due`](Self::pop_due).
+    ///
+    /// Returns `None` if the container was dropped or restarted meanwhile.
+    pub fn complete(
+        &mut self,
+        container_id: &str,
+        generation: u64,
+        success: bool,
+        now: Instant,
+    ) -> Option<ProbeOutcome> {
+        let entry = self.entries.get_mut(container_id)?;
+        if entry.generation != generation || !entry.in_flight {
+            return None;
+        }
+        entry.in_flight = false;
+
+        let outcome = if success {
+            let recovered_from = entry.failures;
+            entry.failures = 0;
+            ProbeOutcome::Healthy { recovered_from }
+        } else {
+            entry.failures = entry.failures.saturating_add(1);
+            if entry.failures >= entry.probe.failure_threshold {
+                let failures = entry.failures;
+                self.entries.remove(container_id);
+                return Some(ProbeOutcome::Unhealthy { failures });
+            }
+            ProbeOutcome::Failed {
+                failures: entry.failures,
+                threshold: entry.probe.failure_threshold,
+            }
+        };
+
+        let period = Duration::from_secs(entry.probe.period_seconds.max(1) as u64);
+        self.schedule(container_id, now + period);
+        Some(outcome)
+    }
+
+    fn schedule(&mut self, container_id: &str, at: Instant) {
+        self.next_generation += 1;
+        let generation = self.next_generation;
+        if let Some(entry) = self.entries.get_mut(container_id) {
+            entry.generation = generation;
+            self.heap
+                .push(Reverse((at, generation, container_id.to_string())));
+        }
+    }
+
+    fn drop_stale_head(&mut self) {
+        while let Some(Reverse((_, generation, id))) = self.heap.peek() {
+            let valid = self
+                .entries
+                .get(id)
+                .is_some_and(|e| e.generation == *generation && !e.in_flight);
+            if valid {
+                break;
+            }
+            self.heap.pop();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::desired_state::ProbeType;
+
+    fn target(id: &str, started_at: &str, delay: u32, period: u32) -> ProbeTarget {
+        ProbeTarget {
+            container_id: id.to_string(),
+            started_at: started_at.to_string(),
+            probe: LivenessProbe {
+                probe_type: ProbeType::Tcp { port: 80 },
+                initial_delay_seconds: delay,
+                period_seconds: period,
+                timeout_seconds: 1,
+                failure_threshold: 2,
+            },
+        }
+    }
+
+    #[test]
+    fn test_initial_delay_and_period_per_container() {
+        let mut schedule = ProbeSchedule::new();
+        let start = Instant::now();
+        schedule.sync(
+            vec![target("a", "t0", 0, 10), target("b", "t0", 5, 1)],
+            start,
+        );
+
+        let (id, generation, _) = schedule.pop_due(start).unwrap();
+        assert_eq!(id, "a");
+        // b is still in its initial delay
+        assert!(schedule.pop_due(start).is_none());
+        assert_eq!(
+            schedule.next_deadline(),
+            Some(start + Duration::from_secs(5))
+        );
+
+        assert_eq!(
+            schedule.complete("a", generation, true, start),
+            Some(ProbeOutcome::Healthy { recovered_from: 0 })
+        );
+        let later = start + Duration::from_secs(5);
+        assert_eq!(schedule.pop_due(later).unwrap().0, "b");
+        // a runs again after its own 10 s period, not b's
+        assert!(schedule.pop_due(later).is_none());
+        assert_eq!(
+            schedule.next_deadline(),
+            Some(start + Duration::from_secs(10))
+        );
+    }
+
+    #[test]
+    fn test_failures_reach_threshold() {
+        let mut schedule = ProbeSchedule::new();
+        let now = Instant::now();
+        schedule.sync(vec![target("a", "t0", 0, 1)], now);
+
+        let (_, generation, _) = schedule.pop_due(now).unwrap();
+        assert_eq!(
+            schedule.complete("a", generation, false, now),
+            Some(ProbeOutcome::Failed {
+                failures: 1,
+                threshold: 2
+            })
+        );
+        let next = now + Duration::from_secs(1);
+        let (_, generation, _) = schedule.pop_due(next).unwrap();
+        assert_eq!(
+            schedule.complete("a", generation, false, next),
+            Some(ProbeOutcome::Unhealthy { failures: 2 })
+        );
+        assert!(schedule.is_empty());
+        assert!(schedule.next_deadline().is_none());
+    }
+
+    #[test]
+    fn test_restart_resets_schedule_and_ignores_stale_result() {
+        let mut schedule = ProbeSchedule::new();
+        let now = Instant::now();
+        schedule.sync(vec![target("a", "t0", 0, 1)], now);
+        let (_, old_generation, _) = schedule.pop_due(now).unwrap();
+
+        let stale = schedule.sync(vec![target("a", "t1", 3, 1)], now);
+        assert_eq!(stale, vec!["a".to_string()]);
+        assert!(schedule.complete("a", old_generation, false, now).is_none());
+        assert!(schedule.pop_due(now).is_none());
+        assert_eq!(schedule.next_deadline(), Some(now + Duration::from_secs(3)));
+    }
+
+    #[test]
+    fn test_sync_drops_containers_no_longer_running() {
+        let mut schedule = ProbeSchedule::new();
+        let now = Instant::now();
+        schedule.sync(vec![target("a", "t0", 0, 1), target("b", "t0", 0, 1)], now);
+        let stale = schedule.sync(vec![target("b", "t0", 0, 1)], now);
+        assert_eq!(stale, vec!["a".to_string()]);
+        assert_eq!(schedule.len(), 1);
+        assert_eq!(schedule.pop_due(now).unwrap().0, "b");
+        assert!(schedule.pop_due(now).is_none());
+    }
+}
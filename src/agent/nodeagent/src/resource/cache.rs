@@ -0,0 +1,335 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Shared view of the containers on this node
+//!
+//! [`track_containers`] keeps the cache in sync with Podman from its event
+//! stream: every lifecycle event re-inspects only the affected container.
+//! Consumers read the cache instead of listing containers from Podman, and
+//! wait on [`ContainerCache::subscribe`] to react to changes right away.
+//!
+//! The revision only moves when something other than the stats changes;
+//! stats are sampled separately and written with [`ContainerCache::set_stats`].
+
+use super::container::{get_list, inspect_one, is_not_found};
+use crate::runtime::podman::events::{EventEffect, EventStream};
+use common::monitoringserver::ContainerInfo;
+use futures::future::join_all;
+use std::collections::{BTreeMap, HashMap};
+use std::sync::RwLock;
+use tokio::sync::watch;
+use tokio::time::{sleep, Duration};
+
+/// First delay before reconnecting to a dropped event stream
+const RECONNECT_DELAY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the reconnect backoff
+const RECONNECT_DELAY_MAX: Duration = Duration::from_secs(30);
+
+#[derive(Default)]
+struct Inner {
+    /// Container ID → latest known info, ordered for stable lists
+    containers: BTreeMap<String, ContainerInfo>,
+    /// Whether `containers` reflects Podman; false until the first resync
+    /// and again while the event stream is down
+    synced: bool,
+}
+
+pub struct ContainerCache {
+    hostname: String,
+    inner: RwLock<Inner>,
+    revision: watch::Sender<u64>,
+}
+
+impl ContainerCache {
+    pub fn new(hostname: String) -> Self {
+        let (revision, _) = watch::channel(0);
+        Self {
+            hostname,
+            inner: RwLock::new(Inner::default()),
+            revision,
+        }
+    }
+
+    /// Receiver that is notified whenever a container changes
+    pub fn subscribe(&self) -> watch::Receiver<u64> {
+        self.revision.subscribe()
+    }
+
+    /// Whether the cache can be trusted to contain every container
+    ///
+    /// Consumers must not infer that a container is missing while this is
+    /// false.
+    pub fn is_synced(&self) -> bool {
+        self.read().synced
+    }
+
+    /// All containers, ordered by ID
+    pub fn snapshot(&self) -> Vec<ContainerInfo> {
+        self.read().containers.values().cloned().collect()
+    }
+
+    pub fn get(&self, id: &str) -> Option<ContainerInfo> {
+        self.read().containers.get(id).cloned()
+    }
+
+    /// Replace the whole content after a full listing
+    pub fn replace_all(&self, infos: Vec<ContainerInfo>) {
+        let changed = {
+            let mut inner = self.write();
+            let mut containers = BTreeMap::new();
+            for mut info in infos {
+                if let Some(old) = inner.containers.get(&info.id) {
+                    info.stats = old.stats.clone();
+                }
+                containers.insert(info.id.clone(), info);
+            }
+            let old: Vec<&ContainerInfo> = inner.containers.values().collect();
+            let new: Vec<&ContainerInfo> = containers.values().collect();
+            let changed = !containers_equal_except_stats(&old, &new);
+            inner.containers = containers;
+            inner.synced = true;
+            changed
+        };
+        if changed {
+            self.bump();
+        }
+    }
+
+    /// Insert or update one container, keeping its last sampled stats
+    pub fn upsert(&self, mut info: ContainerInfo) {
+        let changed = {
+            let mut inner = self.write();
+            match inner.containers.get(&info.id) {
+                Some(old) if same_except_stats(old, &info) => false,
+                old => {
+                    if let Some(old) = old {
+                        info.stats = old.stats.clone();
+                    }
+                    inner.containers.insert(info.id.clone(), info);
+                    true
+                }
+            }
+        };
+        if changed {
+            self.bump();
+        }
+    }
+
+    pub fn remove(&self, id: &str) {
+        if self.write().containers.remove(id).is_some() {
+            self.bump();
+        }
+    }
+
+    /// Store freshly sampled stats; does not notify subscribers
+    pub fn set_stats(&self, id: &str, stats: HashMap<String, String>) {
+        if let Some(info) = self.write().containers.get_mut(id) {
+            info.stats = stats;
+        }
+    }
+
+    /// Re-inspect one container and update or drop its entry
+    ///
+    /// Only a definite not-found drops the entry, e.g. when the removal
+    /// raced with an earlier event. Any other failure keeps the entry as it
+    /// was and is returned, so the caller can resync.
+    pub async fn refresh(&self, id: &str) -> Result<(), String> {
+        match inspect_one(&self.hostname, id).await {
+            Ok(info) => {
+                self.upsert(info);
+                Ok(())
+            }
+            Err(e) if is_not_found(e.as_ref()) => {
+                self.remove(id);
+                Ok(())
+            }
+            Err(e) => Err(format!("Failed to inspect '{}': {}", id, e)),
+        }
+    }
+
+    /// List and inspect every container from Podman
+    pub async fn resync(&self) -> Result<(), String> {
+        let list = get_list().await.map_err(|e| e.to_string())?;
+        let infos = join_all(
+            list.iter()
+                .map(|container| inspect_one(&self.hostname, &container.Id)),
+        )
+        .await;
+        // A container removed between the listing and its inspection is
+        // simply skipped
+        self.replace_all(infos.into_iter().filter_map(|info| info.ok()).collect());
+        Ok(())
+    }
+
+    fn mark_unsynced(&self) {
+        self.write().synced = false;
+    }
+
+    fn bump(&self) {
+        self.revision.send_modify(|revision| *revision += 1);
+    }
+
+    fn read(&self) -> std::sync::RwLockReadGuard<'_, Inner> {
+        self.inner.read().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn write(&self) -> std::sync::RwLockWriteGuard<'_, Inner> {
+        self.inner.write().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+/// Keeps `cache` in sync with Podman for the lifetime of the agent.
+///
+/// The event stream is opened before the full resync so no change can fall
+/// between the two. When the stream drops or a container cannot be
+/// inspected, the cache is marked unsynced and the subscription and resync
+/// are retried with exponential backoff. The backoff is only reset once an
+/// event has been decoded, so a stream that fails right away does not turn
+/// into a tight resubscribe loop.
+pub async fn track_containers(cache: &ContainerCache) {
+    let mut delay = RECONNECT_DELAY_MIN;
+    loop {
+        let mut stream = match EventStream::subscribe().await {
+            Ok(stream) => stream,
+            Err(e) => {
+                eprintln!(
+                    "[ContainerCache] Failed to subscribe to Podman events: {}",
+                    e
+                );
+                sleep(delay).await;
+                delay = (delay * 2).min(RECONNECT_DELAY_MAX);
+                continue;
+            }
+        };
+        if let Err(e) = cache.resync().await {
+            eprintln!("[ContainerCache] Failed to list containers: {}", e);
+            sleep(delay).await;
+            delay = (delay * 2).min(RECONNECT_DELAY_MAX);
+            continue;
+        }
+
+        while let Some(event) = stream.next().await {
+            delay = RECONNECT_DELAY_MIN;
+            let refreshed = match event.effect() {
+                EventEffect::Changed(id) => cache.refresh(&id).await,
+                EventEffect::Removed(id) => {
+                    cache.remove(&id);
+                    Ok(())
+                }
+                EventEffect::Ignored => Ok(()),
+            };
+            if let Err(e) = refreshed {
+                eprintln!("[ContainerCache] {}, resyncing", e);
+                break;
+            }
+        }
+
+        eprintln!("[ContainerCache] Podman event stream closed, resubscribing");
+        cache.mark_unsynced();
+        sleep(delay).await;
+        delay = (delay * 2).min(RECONNECT_DELAY_MAX);
+    }
+}
+
+fn same_except_stats(a: &ContainerInfo, b: &ContainerInfo) -> bool {
+    a.id == b.id
+        && a.names == b.names
+        && a.image == b.image
+        && a.state == b.state
+        && a.config == b.config
+        && a.annotation == b.annotation
+    // do NOT compare a.stats/b.stats
+}
+
+pub fn containers_equal_except_stats(a: &[&ContainerInfo], b: &[&ContainerInfo]) -> bool {
+    a.len() == b.len()
+        && a.iter()
+            .zip(b.iter())
+            .all(|(c1, c2)| same_except_stats(c1, c2))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn info(id: &str, status: &str) -> ContainerInfo {
+        let mut state = HashMap::new();
+        state.insert("Status".to_string(), status.to_string());
+        ContainerInfo {
+            id: id.to_string(),
+            names: vec![format!("name-{}", id)],
+            image: "img".to_string(),
+            state,
+            config: HashMap::new(),
+            annotation: HashMap::new(),
+            stats: HashMap::new(),
+        }
+    }
+
+    fn stats(value: &str) -> HashMap<String, String> {
+        let mut stats = HashMap::new();
+        stats.insert("MemoryUsage".to_string(), value.to_string());
+        stats
+    }
+
+    #[test]
+    fn test_containers_equal_except_stats_true_and_false() {
+        let c1 = info("id1", "running");
+        let mut c2 = info("id1", "running");
+        c2.stats = stats("1");
+        let c3 = info("id2", "running");
+
+        // True: stats ignored, all else equal
+        assert!(containers_equal_except_stats(&[&c1], &[&c2]));
+        // False: id differs
+        assert!(!containers_equal_except_stats(&[&c1], &[&c3]));
+        // False: length differs
+        assert!(!containers_equal_except_stats(&[&c1, &c2], &[&c1]));
+    }
+
+    #[test]
+    fn test_upsert_notifies_only_on_state_change() {
+        let cache = ContainerCache::new("host".to_string());
+        let rx = cache.subscribe();
+
+        cache.upsert(info("a", "running"));
+        assert_eq!(*rx.borrow(), 1);
+        cache.upsert(info("a", "running"));
+        assert_eq!(*rx.borrow(), 1);
+        cache.set_stats("a", stats("1"));
+        assert_eq!(*rx.borrow(), 1);
+
+        cache.upsert(info("a", "exited"));
+        assert_eq!(*rx.borrow(), 2);
+        let a = cache.get("a").unwrap();
+        assert_eq!(a.state["Status"], "exited");
+        // Stats survive an inspect refresh
+        assert_eq!(a.stats, stats("1"));
+
+        cache.remove("a");
+        cache.remove("a");
+        assert_eq!(*rx.borrow(), 3);
+        assert!(cache.snapshot().is_empty());
+    }
+
+    #[test]
+    fn test_replace_all_marks_synced() {
+        let cache = ContainerCache::new("host".to_string());
+        let rx = cache.subscribe();
+        assert!(!cache.is_synced());
+
+        cache.replace_all(Vec::new());
+        assert!(cache.is_synced());
+        assert_eq!(*rx.borrow(), 0);
+
+        cache.replace_all(vec![info("b", "running"), info("a", "running")]);
+        assert_eq!(*rx.borrow(), 1);
+        let ids: Vec<String> = cache.snapshot().into_iter().map(|c| c.id).collect();
+        assert_eq!(ids, vec!["a".to_string(), "b".to_string()]);
+
+        cache.mark_unsynced();
+        assert!(!cache.is_synced());
+    }
+}
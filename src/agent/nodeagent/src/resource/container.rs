@@ -3,7 +3,8 @@
 * SPDX-License-Identifier: Apache-2.0
 */
 use super::{Container, ContainerError, ContainerInspect, ContainerStats};
-use crate::runtime::podman::get;
+use crate::runtime::podman::{get, get_checked, PodmanError};
+use common::monitoringserver::telemetry::{self, NetworkSample, StatsSample};
 use common::monitoringserver::ContainerInfo;
 use futures::future::try_join_all;
 use std::collections::HashMap;
@@ -17,111 +18,13 @@ pub async fn inspect(hostname: String) -> std::result::Result<Vec<ContainerInfo>
         let host_name = hostname.clone();
         async move {
             let inspect = get_inspect(&id).await?;
-            let mut stats_map = HashMap::new();
-            if inspect.State.Status == "running" {
-                match get_stats(&id).await {
-                    Ok(stats) => {
-                        stats_map.insert(
-                            "CpuTotalUsage".to_string(),
-                            stats.cpu_stats.cpu_usage.total_usage.to_string(),
-                        );
-                        stats_map.insert(
-                            "CpuUsageInKernelMode".to_string(),
-                            stats.cpu_stats.cpu_usage.usage_in_kernelmode.to_string(),
-                        );
-                        stats_map.insert(
-                            "CpuUsageInUserMode".to_string(),
-                            stats.cpu_stats.cpu_usage.usage_in_usermode.to_string(),
-                        );
-                        stats_map.insert(
-                            "MemoryUsage".to_string(),
-                            stats.memory_stats.usage.to_string(),
-                        );
-                        stats_map.insert(
-                            "MemoryLimit".to_string(),
-                            stats.memory_stats.limit.to_string(),
-                        );
-                        stats_map.insert(
-                            "Networks".to_string(),
-                            stats
-                                .networks
-                                .as_ref()
-                                .map(|nets| {
-                                    nets.iter()
-                                        .map(|(name, net)| format!("{}: {{{}}}", name, net))
-                                        .collect::<Vec<_>>()
-                                        .join(", ")
-                                })
-                                .unwrap_or_else(|| "None".to_string()),
-                        );
-                    }
-                    Err(e) => {
-                        println!("Failed to get stats for {}: {:?}", id, e);
-                        stats_map.insert("Status".to_string(), "StatsUnavailable".to_string());
-                    }
-                }
+            let stats_map = if inspect.State.Status == "running" {
+                stats_map(&id).await
             } else {
                 println!("Container {} is not running, stats unavailable.", id);
-                stats_map.insert("Status".to_string(), "StatsUnavailable".to_string());
-            }
-            let mut state_map = HashMap::new();
-            state_map.insert("Status".to_string(), inspect.State.Status);
-            state_map.insert("Running".to_string(), inspect.State.Running.to_string());
-            state_map.insert("Paused".to_string(), inspect.State.Paused.to_string());
-            state_map.insert(
-                "Restarting".to_string(),
-                inspect.State.Restarting.to_string(),
-            );
-            state_map.insert("OOMKilled".to_string(), inspect.State.OOMKilled.to_string());
-            state_map.insert("Dead".to_string(), inspect.State.Dead.to_string());
-            state_map.insert("Pid".to_string(), inspect.State.Pid.to_string());
-            state_map.insert("ExitCode".to_string(), inspect.State.ExitCode.to_string());
-            state_map.insert("Error".to_string(), inspect.State.Error);
-            state_map.insert("StartedAt".to_string(), inspect.State.StartedAt);
-            state_map.insert("FinishedAt".to_string(), inspect.State.FinishedAt);
-
-            let mut config_map = HashMap::new();
-            config_map.insert("Hostname".to_string(), host_name);
-            config_map.insert("Domainname".to_string(), inspect.Config.Domainname);
-            config_map.insert("User".to_string(), inspect.Config.User);
-            config_map.insert(
-                "AttachStdin".to_string(),
-                inspect.Config.AttachStdin.to_string(),
-            );
-            config_map.insert(
-                "AttachStdout".to_string(),
-                inspect.Config.AttachStdout.to_string(),
-            );
-            config_map.insert(
-                "AttachStderr".to_string(),
-                inspect.Config.AttachStderr.to_string(),
-            );
-            config_map.insert("Tty".to_string(), inspect.Config.Tty.to_string());
-            config_map.insert(
-                "OpenStdin".to_string(),
-                inspect.Config.OpenStdin.to_string(),
-            );
-            config_map.insert(
-                "StdinOnce".to_string(),
-                inspect.Config.StdinOnce.to_string(),
-            );
-            config_map.insert("Image".to_string(), inspect.Config.Image.clone());
-            config_map.insert("WorkingDir".to_string(), inspect.Config.WorkingDir);
-
-            let annotation_map = if let Some(ann_map) = inspect.Config.Annotations {
-                ann_map.clone()
-            } else {
-                HashMap::new()
+                unavailable_stats()
             };
-            Ok::<ContainerInfo, ContainerError>(ContainerInfo {
-                id: inspect.Id,
-                names: vec![inspect.Name],
-                image: inspect.Config.Image.clone(),
-                state: state_map,
-                config: config_map,
-                annotation: annotation_map,
-                stats: stats_map,
-            })
+            Ok::<ContainerInfo, ContainerError>(container_info(&host_name, inspect, stats_map))
         }
     }))
     .await
@@ -132,6 +35,130 @@ pub async fn inspect(hostname: String) -> std::result::Result<Vec<ContainerInfo>
     Ok(infos)
 }
 
+/// Inspects a single container without sampling its stats.
+///
+/// Used to refresh one entry of the container cache when Podman reports a
+/// lifecycle event, so the rest of the node is not re-inspected.
+pub async fn inspect_one(hostname: &str, id: &str) -> Result<ContainerInfo> {
+    let inspect = get_inspect(id).await?;
+    Ok(container_info(hostname, inspect, unavailable_stats()))
+}
+
+/// Stats map reported for containers that are not running or whose stats
+/// could not be read.
+pub fn unavailable_stats() -> HashMap<String, String> {
+    telemetry::stats_map(None)
+}
+
+/// Samples the stats of a running container into the map sent to the monitoring server.
+pub async fn stats_map(id: &str) -> HashMap<String, String> {
+    telemetry::stats_map(stats_sample(id).await.as_ref())
+}
+
+/// Samples the typed stats of a running container, `None` if they cannot be read.
+///
+/// The telemetry loop normally reads stats from [`super::stats::StatsTracker`];
+/// this one-off request is the fallback while the stats stream is down.
+pub async fn stats_sample(id: &str) -> Option<StatsSample> {
+    match get_stats(id).await {
+        Ok(stats) => Some(StatsSample {
+            cpu_total_usage: stats.cpu_stats.cpu_usage.total_usage,
+            cpu_kernel_usage: stats.cpu_stats.cpu_usage.usage_in_kernelmode,
+            cpu_user_usage: stats.cpu_stats.cpu_usage.usage_in_usermode,
+            memory_usage: stats.memory_stats.usage,
+            memory_limit: stats.memory_stats.limit,
+            networks: stats
+                .networks
+                .unwrap_or_default()
+                .into_iter()
+                .map(|(name, net)| {
+                    let sample = NetworkSample {
+                        rx_bytes: net.rx_bytes,
+                        rx_packets: net.rx_packets,
+                        rx_errors: net.rx_errors,
+                        rx_dropped: net.rx_dropped,
+                        tx_bytes: net.tx_bytes,
+                        tx_packets: net.tx_packets,
+                        tx_errors: net.tx_errors,
+                        tx_dropped: net.tx_dropped,
+                    };
+                    (name, sample)
+                })
+                .collect(),
+        }),
+        Err(e) => {
+            println!("Failed to get stats for {}: {:?}", id, e);
+            None
+        }
+    }
+}
+
+/// Converts an inspect result into the ContainerInfo reported by the node.
+pub fn container_info(
+    hostname: &str,
+    inspect: ContainerInspect,
+    stats_map: HashMap<String, String>,
+) -> ContainerInfo {
+    let mut state_map = HashMap::new();
+    state_map.insert("Status".to_string(), inspect.State.Status);
+    state_map.insert("Running".to_string(), inspect.State.Running.to_string());
+    state_map.insert("Paused".to_string(), inspect.State.Paused.to_string());
+    state_map.insert(
+        "Restarting".to_string(),
+        inspect.State.Restarting.to_string(),
+    );
+    state_map.insert("OOMKilled".to_string(), inspect.State.OOMKilled.to_string());
+    state_map.insert("Dead".to_string(), inspect.State.Dead.to_string());
+    state_map.insert("Pid".to_string(), inspect.State.Pid.to_string());
+    state_map.insert("ExitCode".to_string(), inspect.State.ExitCode.to_string());
+    state_map.insert("Error".to_string(), inspect.State.Error);
+    state_map.insert("StartedAt".to_string(), inspect.State.StartedAt);
+    state_map.insert("FinishedAt".to_string(), inspect.State.FinishedAt);
+
+    let mut config_map = HashMap::new();
+    config_map.insert("Hostname".to_string(), hostname.to_string());
+    config_map.insert("Domainname".to_string(), inspect.Config.Domainname);
+    config_map.insert("User".to_string(), inspect.Config.User);
+    config_map.insert(
+        "AttachStdin".to_string(),
+        inspect.Config.AttachStdin.to_string(),
+    );
+    config_map.insert(
+        "AttachStdout".to_string(),
+        inspect.Config.AttachStdout.to_string(),
+    );
+    config_map.insert(
+        "AttachStderr".to_string(),
+        inspect.Config.AttachStderr.to_string(),
+    );
+    config_map.insert("Tty".to_string(), inspect.Config.Tty.to_string());
+    config_map.insert(
+        "OpenStdin".to_string(),
+        inspect.Config.OpenStdin.to_string(),
+    );
+    config_map.insert(
+        "StdinOnce".to_string(),
+        inspect.Config.StdinOnce.to_string(),
+    );
+    config_map.insert("Image".to_string(), inspect.Config.Image.clone());
+    config_map.insert("WorkingDir".to_string(), inspect.Config.WorkingDir);
+
+    let annotation_map = if let Some(ann_map) = inspect.Config.Annotations {
+        ann_map.clone()
+    } else {
+        HashMap::new()
+    };
+    ContainerInfo {
+        id: inspect.Id,
+        names: vec![inspect.Name],
+        image: inspect.Config.Image.clone(),
+        state: state_map,
+        config: config_map,
+        annotation: annotation_map,
+        stats: stats_map,
+    }
+}
+
 pub async fn get_list() -> Result<Vec<Container>> {
     let body = get("/v4.0.0/libpod/containers/json?all=true").await?;
 
@@ -144,7 +171,7 @@ pub async fn get_inspect(
     id: &str,
 ) -> std::result::Result<ContainerInspect, Box<dyn std::error::Error + Send + Sync>> {
     let path = &format!("/v4.0.0/libpod/containers/{}/json?all=true", id);
-    let body = get(path).await?;
+    let body = get_checked(path).await?;
 
     let inspect: ContainerInspect = serde_json::from_slice(&body)?;
     //println!("inspect in container.rs{:#?}", inspect);
@@ -152,6 +179,14 @@ pub async fn get_inspect(
     Ok(inspect)
 }
 
+/// Whether `error` says the container does not exist, as opposed to a
+/// failure to reach Podman or to read its reply
+pub fn is_not_found(error: &(dyn std::error::Error + 'static)) -> bool {
+    error
+        .downcast_ref::<PodmanError>()
+        .is_some_and(PodmanError::is_not_found)
+}
+
 pub async fn get_stats(
     id: &str,
 ) -> std::result::Result<ContainerStats, Box<dyn std::error::Error + Send + Sync>> {
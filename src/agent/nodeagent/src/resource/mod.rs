@@ -2,15 +2,17 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
+pub mod cache;
 pub mod container;
 pub mod nodeinfo;
+pub mod stats;
 
 use serde::Deserialize;
 use std::collections::HashMap;
 use thiserror::Error;
 
 /// Node information matching the requested DataCache structure.
-#[derive(Deserialize, Debug)]
+#[derive(Deserialize, Debug, Clone, Default, PartialEq)]
 pub struct NodeInfo {
     // 1. CPU
     pub cpu_count: usize, // NodeInfo['cpu']['cpu_count']
@@ -67,8 +69,9 @@ pub struct ContainerInspect {
     pub Config: ContainerConfig,
 }
 
-#[allow(non_snake_case, unused)]
-#[derive(Deserialize, Debug)]
+#[allow(non_snake_case)]
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
 pub struct ContainerState {
     pub Status: String,
     pub Running: bool,
@@ -83,50 +86,29 @@ pub struct ContainerState {
     pub FinishedAt: String,
 }
 
-#[derive(Deserialize, Debug)]
-#[serde(untagged)]
-pub enum EntryPoint {
-    String(String),
-    Array(Vec<String>),
-}
-
-#[derive(Deserialize, Debug)]
-#[serde(untagged)]
-pub enum Command {
-    String(String),
-    Array(Vec<String>),
-}
-
-// Update ContainerConfig to use Option<Command> for Cmd
-#[allow(non_snake_case, unused)]
-#[derive(Deserialize, Debug)]
+/// Only the config fields reported in `ContainerInfo`; the rest of the
+/// inspect output (env, command, volumes, ...) is skipped while parsing
+#[allow(non_snake_case)]
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
 pub struct ContainerConfig {
-    pub Hostname: String,
     pub Domainname: String,
     pub User: String,
     pub AttachStdin: bool,
     pub AttachStdout: bool,
     pub AttachStderr: bool,
-    pub ExposedPorts: Option<HashMap<String, serde_json::Value>>,
     pub Tty: bool,
     pub OpenStdin: bool,
     pub StdinOnce: bool,
-    pub Env: Option<Vec<String>>,
-    pub Cmd: Option<Command>,
     pub Image: String,
-    pub Volumes: Option<HashMap<String, serde_json::Value>>,
     pub WorkingDir: String,
-    pub Entrypoint: Option<EntryPoint>,
-    pub OnBuild: Option<Vec<String>>,
-    pub Labels: Option<HashMap<String, String>>,
     pub Annotations: Option<HashMap<String, String>>,
 }
 
-#[allow(non_snake_case, unused)]
+/// Docker-compatible stats of one container, as returned by
+/// `/containers/{id}/stats?stream=false`
 #[derive(Deserialize, Debug)]
 pub struct ContainerStats {
-    pub Id: String,
-    pub name: String,
     pub cpu_stats: ContainerCpuStats,
     pub memory_stats: ContainerMemoryStats,
     pub networks: Option<HashMap<String, ContainerNetworkStats>>,
@@ -136,7 +118,6 @@ pub struct ContainerStats {
 #[derive(Deserialize, Debug)]
 pub struct ContainerCpuStats {
     pub cpu_usage: ContainerCpuUsage,
-    pub online_cpus: Option<u64>,
 }
 
 #[allow(non_snake_case, unused)]
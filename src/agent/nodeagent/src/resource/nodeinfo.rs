@@ -2,32 +2,237 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
+//! Node info sampler
+//!
+//! One long-lived [`NodeSampler`] keeps the `sysinfo` state between samples
+//! and refreshes each metric group only when its period is due, so CPU,
+//! network and disk deltas come from consecutive samples rather than from a
+//! fresh full scan. [`spawn`] runs it on a dedicated thread, off the async
+//! runtime, and publishes every new sample through a watch channel.
 use super::NodeInfo;
-use once_cell::sync::Lazy;
-use std::sync::Mutex;
-use sysinfo::{Networks, System};
-
-// Static storage for previous IO/network values for delta calculation
-type PrevIoType = Option<(u64, u64, u64, u64)>;
-static PREV_IO: Lazy<Mutex<PrevIoType>> = Lazy::new(|| Mutex::new(None));
-
-/// Returns NodeInfo with rx_bytes, tx_bytes, read_bytes, write_bytes as deltas since last call.
-pub fn extract_node_info_delta() -> NodeInfo {
-    let mut sys = System::new_all();
-    std::thread::sleep(sysinfo::MINIMUM_CPU_UPDATE_INTERVAL);
-    sys.refresh_cpu_usage();
-
-    // 1. CPU
-    let cpu_count = sys.cpus().len();
-    // Average all logical CPU usage values
-    let cpu_usage = if cpu_count > 0 {
-        sys.cpus().iter().map(|cpu| cpu.cpu_usage()).sum::<f32>() / cpu_count as f32
-    } else {
-        0.0
-    };
-
-    // 2. GPU
-    let gpu_count = match std::fs::read_dir("/sys/class/drm/") {
+use crate::config::SamplingConfig;
+use std::time::{Duration, Instant};
+use sysinfo::{CpuRefreshKind, MemoryRefreshKind, Networks, RefreshKind, System};
+use tokio::sync::watch;
+
+/// Metric groups refreshed independently of each other.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Group {
+    Cpu,
+    Memory,
+    Network,
+    Disk,
+    Gpu,
+    System,
+}
+
+const GROUPS: [Group; 6] = [
+    Group::Cpu,
+    Group::Memory,
+    Group::Network,
+    Group::Disk,
+    Group::Gpu,
+    Group::System,
+];
+
+/// Sampling period of each metric group.
+#[derive(Debug, Clone, PartialEq)]
+pub struct SamplingIntervals {
+    pub cpu: Duration,
+    pub memory: Duration,
+    pub network: Duration,
+    pub disk: Duration,
+    /// GPUs and OS/arch/IP rarely change; a slow period keeps them cheap.
+    pub gpu: Duration,
+    pub system: Duration,
+}
+
+impl Default for SamplingIntervals {
+    fn default() -> Self {
+        Self {
+            cpu: Duration::from_secs(1),
+            memory: Duration::from_secs(1),
+            network: Duration::from_secs(1),
+            disk: Duration::from_secs(1),
+            gpu: Duration::from_secs(60),
+            system: Duration::from_secs(60),
+        }
+    }
+}
+
+impl SamplingIntervals {
+    pub fn from_config(config: &SamplingConfig) -> Self {
+        let default = Self::default();
+        let pick =
+            |ms: Option<u64>, default: Duration| ms.map(Duration::from_millis).unwrap_or(default);
+        Self {
+            // CPU usage is only meaningful over sysinfo's minimum update interval
+            cpu: pick(config.cpu_ms, default.cpu).max(sysinfo::MINIMUM_CPU_UPDATE_INTERVAL),
+            memory: pick(config.memory_ms, default.memory),
+            network: pick(config.network_ms, default.network),
+            disk: pick(config.disk_ms, default.disk),
+            gpu: pick(config.gpu_ms, default.gpu),
+            system: pick(config.system_ms, default.system),
+        }
+    }
+
+    fn of(&self, group: Group) -> Duration {
+        match group {
+            Group::Cpu => self.cpu,
+            Group::Memory => self.memory,
+            Group::Network => self.network,
+            Group::Disk => self.disk,
+            Group::Gpu => self.gpu,
+            Group::System => self.system,
+        }
+    }
+}
+
+/// Long-lived node info sampler.
+///
+/// rx_bytes, tx_bytes, read_bytes and write_bytes are deltas over the last
+/// period of their group. The first sample reports them, and CPU usage, as 0.
+pub struct NodeSampler {
+    sys: System,
+    networks: Networks,
+    intervals: SamplingIntervals,
+    next_due: [Instant; GROUPS.len()],
+    /// Disk counters (read_bytes, write_bytes) at the last disk refresh
+    prev_disk: Option<(u64, u64)>,
+    current: NodeInfo,
+}
+
+impl NodeSampler {
+    pub fn new(intervals: SamplingIntervals) -> Self {
+        let sys = System::new_with_specifics(
+            RefreshKind::nothing()
+                .with_cpu(CpuRefreshKind::nothing().with_cpu_usage())
+                .with_memory(MemoryRefreshKind::nothing().with_ram()),
+        );
+        Self {
+            sys,
+            networks: Networks::new_with_refreshed_list(),
+            intervals,
+            next_due: [Instant::now(); GROUPS.len()],
+            prev_disk: None,
+            current: NodeInfo::default(),
+        }
+    }
+
+    /// Latest values of all groups
+    pub fn snapshot(&self) -> &NodeInfo {
+        &self.current
+    }
+
+    /// When the next group is due
+    pub fn next_due(&self) -> Instant {
+        self.next_due
+            .iter()
+            .copied()
+            .min()
+            .unwrap_or_else(Instant::now)
+    }
+
+    /// Refresh every group due at `now`
+    ///
+    /// # Returns
+    ///
+    /// * `bool` - whether any group was refreshed
+    pub fn refresh_due(&mut self, now: Instant) -> bool {
+        let mut refreshed = false;
+        for (i, group) in GROUPS.iter().enumerate() {
+            if self.next_due[i] <= now {
+                self.refresh(*group);
+                self.next_due[i] = now + self.intervals.of(*group);
+                refreshed = true;
+            }
+        }
+        refreshed
+    }
+
+    fn refresh(&mut self, group: Group) {
+        let info = &mut self.current;
+        match group {
+            Group::Cpu => {
+                self.sys.refresh_cpu_usage();
+                let cpus = self.sys.cpus();
+                info.cpu_count = cpus.len();
+                // Average all logical CPU usage values
+                info.cpu_usage = if cpus.is_empty() {
+                    0.0
+                } else {
+                    cpus.iter().map(|cpu| cpu.cpu_usage()).sum::<f32>() / cpus.len() as f32
+                };
+            }
+            Group::Memory => {
+                self.sys.refresh_memory();
+                info.total_memory = self.sys.total_memory();
+                info.used_memory = self.sys.used_memory();
+                info.mem_usage = if info.total_memory > 0 {
+                    (info.used_memory as f32) / (info.total_memory as f32) * 100.0
+                } else {
+                    0.0
+                };
+            }
+            Group::Network => {
+                // received()/transmitted() are already relative to the previous refresh
+                self.networks.refresh(true);
+                info.rx_bytes = self.networks.values().map(|data| data.received()).sum();
+                info.tx_bytes = self.networks.values().map(|data| data.transmitted()).sum();
+            }
+            Group::Disk => {
+                let (read_now, write_now) = get_disk_io_bytes();
+                (info.read_bytes, info.write_bytes) = match self.prev_disk {
+                    Some((read, write)) => (
+                        read_now.saturating_sub(read),
+                        write_now.saturating_sub(write),
+                    ),
+                    None => (0, 0),
+                };
+                self.prev_disk = Some((read_now, write_now));
+            }
+            Group::Gpu => info.gpu_count = get_gpu_count(),
+            Group::System => {
+                info.os = System::long_os_version().unwrap_or_else(|| "Unknown".to_string());
+                info.arch = System::cpu_arch();
+                // IP extraction (first non-loopback IPv4)
+                info.ip = get_local_ip().unwrap_or_else(|| "Unknown".to_string());
+            }
+        }
+    }
+}
+
+/// Runs a [`NodeSampler`] on its own thread.
+///
+/// The receiver starts with an empty NodeInfo and changes on every sample.
+/// The thread stops once all receivers are dropped.
+pub fn spawn(intervals: SamplingIntervals) -> watch::Receiver<NodeInfo> {
+    let (tx, rx) = watch::channel(NodeInfo::default());
+    let result = std::thread::Builder::new()
+        .name("nodeinfo-sampler".to_string())
+        .spawn(move || {
+            let mut sampler = NodeSampler::new(intervals);
+            loop {
+                let wait = sampler.next_due().saturating_duration_since(Instant::now());
+                if !wait.is_zero() {
+                    std::thread::sleep(wait);
+                }
+                if sampler.refresh_due(Instant::now())
+                    && tx.send(sampler.snapshot().clone()).is_err()
+                {
+                    break;
+                }
+            }
+        });
+    if let Err(e) = result {
+        eprintln!("[NodeInfo] Failed to start sampler thread: {}", e);
+    }
+    rx
+}
+
+/// Counts DRM cards (`/sys/class/drm/cardN`).
+fn get_gpu_count() -> usize {
+    match std::fs::read_dir("/sys/class/drm/") {
         Ok(entries) => entries
             .filter_map(|entry| entry.ok())
             .filter(|entry| {
@@ -37,67 +242,6 @@ pub fn extract_node_info_delta() -> NodeInfo {
             })
             .count(),
         Err(_) => 0,
-    };
-
-    // 3. Memory
-    let total_memory = sys.total_memory();
-    let used_memory = sys.used_memory();
-    let mem_usage = if total_memory > 0 {
-        (used_memory as f32) / (total_memory as f32) * 100.0
-    } else {
-        0.0
-    };
-
-    // 4. Network (sum over all interfaces)
-    let networks = Networks::new_with_refreshed_list();
-    // summation of each interface's received and transmitted bytes
-    let mut rx_bytes_now: u64 = 0;
-    let mut tx_bytes_now: u64 = 0;
-    for (_, data) in &networks {
-        rx_bytes_now += data.total_received();
-        tx_bytes_now += data.total_transmitted();
-    }
-
-    // 5. Storage (read_bytes, write_bytes) from /proc/diskstats
-    let (read_bytes_now, write_bytes_now) = get_disk_io_bytes();
-
-    // Calculate deltas from previous values
-    let mut prev = PREV_IO.lock().unwrap();
-    let (rx_bytes, tx_bytes, read_bytes, write_bytes) =
-        if let Some((prev_rx, prev_tx, prev_read, prev_write)) = *prev {
-            (
-                rx_bytes_now.saturating_sub(prev_rx),
-                tx_bytes_now.saturating_sub(prev_tx),
-                read_bytes_now.saturating_sub(prev_read),
-                write_bytes_now.saturating_sub(prev_write),
-            )
-        } else {
-            (0, 0, 0, 0)
-        };
-    // Store current values for next delta calculation
-    *prev = Some((rx_bytes_now, tx_bytes_now, read_bytes_now, write_bytes_now));
-
-    // OS and Arch extraction using sysinfo
-    let os = sysinfo::System::long_os_version().unwrap_or_else(|| "Unknown".to_string());
-    let arch = sysinfo::System::cpu_arch();
-
-    // IP extraction (first non-loopback IPv4)
-    let ip = get_local_ip().unwrap_or_else(|| "Unknown".to_string());
-
-    NodeInfo {
-        cpu_count,
-        cpu_usage,
-        gpu_count,
-        total_memory,
-        used_memory,
-        mem_usage,
-        rx_bytes,
-        tx_bytes,
-        read_bytes,
-        write_bytes,
-        os,
-        arch,
-        ip,
     }
 }
 
@@ -149,13 +293,59 @@ mod tests {
     use super::*;
 
     #[test]
-    fn test_extract_node_info_delta() {
-        let info = extract_node_info_delta();
+    fn test_sampler_fills_all_groups() {
+        let mut sampler = NodeSampler::new(SamplingIntervals::default());
+        assert!(sampler.refresh_due(Instant::now()));
+        std::thread::sleep(sysinfo::MINIMUM_CPU_UPDATE_INTERVAL);
+        sampler.refresh_due(Instant::now() + Duration::from_secs(1));
+
+        let info = sampler.snapshot();
         assert!(info.cpu_usage >= 0.0 && info.cpu_usage <= 100.0);
         assert!(info.cpu_count > 0);
         assert!(info.total_memory > 0);
         assert!(info.used_memory <= info.total_memory);
         assert!(info.mem_usage >= 0.0 && info.mem_usage <= 100.0);
-        // Removed always-true u64 >= 0 assertions
+        assert!(!info.arch.is_empty());
+    }
+
+    #[test]
+    fn test_sampler_refreshes_groups_on_their_own_period() {
+        let mut sampler = NodeSampler::new(SamplingIntervals::default());
+        let start = Instant::now();
+        assert!(sampler.refresh_due(start));
+        // Nothing is due right after a full refresh
+        assert!(!sampler.refresh_due(start));
+        assert_eq!(sampler.next_due(), start + Duration::from_secs(1));
+
+        let os = sampler.snapshot().os.clone();
+        sampler.current.os.clear();
+        assert!(sampler.refresh_due(start + Duration::from_secs(1)));
+        // The system group is only refreshed every minute
+        assert!(sampler.snapshot().os.is_empty());
+        sampler.refresh_due(start + Duration::from_secs(60));
+        assert_eq!(sampler.snapshot().os, os);
+    }
+
+    #[test]
+    fn test_intervals_from_config() {
+        let config = SamplingConfig {
+            cpu_ms: Some(1),
+            disk_ms: Some(5000),
+            ..Default::default()
+        };
+        let intervals = SamplingIntervals::from_config(&config);
+        assert_eq!(intervals.cpu, sysinfo::MINIMUM_CPU_UPDATE_INTERVAL);
+        assert_eq!(intervals.disk, Duration::from_secs(5));
+        assert_eq!(intervals.memory, SamplingIntervals::default().memory);
+    }
+
+    #[tokio::test]
+    async fn test_spawn_publishes_samples() {
+        let mut rx = spawn(SamplingIntervals::default());
+        tokio::time::timeout(Duration::from_secs(5), rx.changed())
+            .await
+            .unwrap()
+            .unwrap();
+        assert!(rx.borrow().cpu_count > 0);
     }
 }
@@ -0,0 +1,253 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Stats of every running container from one streaming request
+//!
+//! `/libpod/containers/stats?stream=true` without a container list reports
+//! all running containers and writes a fresh report every `interval`
+//! seconds on the same connection. [`track_stats`] keeps that request open
+//! and stores the latest sample per container, so the telemetry loop reads
+//! stats from memory instead of sending one request per container per tick.
+//!
+//! When the stream is down or goes quiet, [`StatsTracker::is_live`] turns
+//! false and callers fall back to sampling containers one by one.
+
+use crate::runtime::podman::events::LineDecoder;
+use crate::runtime::podman::get_stream;
+use common::monitoringserver::telemetry::{NetworkSample, StatsSample};
+use hyper::body::HttpBody;
+use serde::Deserialize;
+use std::collections::HashMap;
+use std::sync::RwLock;
+use tokio::time::{sleep, Duration, Instant};
+
+/// All running containers, one report per second
+const STATS_PATH: &str = "/v4.0.0/libpod/containers/stats?stream=true&interval=1";
+
+/// Samples older than this are not served; the stream is considered stalled
+const STALE_AFTER: Duration = Duration::from_secs(3);
+
+/// First delay before reopening a dropped stats stream
+const RECONNECT_DELAY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the reconnect backoff
+const RECONNECT_DELAY_MAX: Duration = Duration::from_secs(30);
+
+/// One line of the stats stream
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
+struct StatsReport {
+    /// Set instead of the stats when Podman failed to collect them
+    #[serde(rename = "Error")]
+    error: Option<serde_json::Value>,
+    #[serde(rename = "Stats")]
+    stats: Vec<LibpodStats>,
+}
+
+/// Libpod stats of one container; only the fields the agent reports
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
+struct LibpodStats {
+    #[serde(rename = "ContainerID")]
+    id: String,
+    /// Total CPU time in nanoseconds
+    #[serde(rename = "CPUNano")]
+    cpu_nano: u64,
+    /// CPU time spent in the kernel in nanoseconds
+    #[serde(rename = "CPUSystemNano")]
+    cpu_system_nano: u64,
+    #[serde(rename = "MemUsage")]
+    mem_usage: u64,
+    #[serde(rename = "MemLimit")]
+    mem_limit: u64,
+    /// Per-interface counters; missing on Podman releases before 4.4
+    #[serde(rename = "Network")]
+    network: Option<HashMap<String, LibpodNetworkStats>>,
+}
+
+#[derive(Deserialize, Debug, Default)]
+#[serde(default, rename_all = "PascalCase")]
+struct LibpodNetworkStats {
+    rx_bytes: u64,
+    rx_packets: u64,
+    rx_errors: u64,
+    rx_dropped: u64,
+    tx_bytes: u64,
+    tx_packets: u64,
+    tx_errors: u64,
+    tx_dropped: u64,
+}
+
+impl From<LibpodStats> for StatsSample {
+    fn from(stats: LibpodStats) -> Self {
+        StatsSample {
+            cpu_total_usage: stats.cpu_nano,
+            cpu_kernel_usage: stats.cpu_system_nano,
+            cpu_user_usage: stats.cpu_nano.saturating_sub(stats.cpu_system_nano),
+            memory_usage: stats.mem_usage,
+            memory_limit: stats.mem_limit,
+            networks: stats
+                .network
+                .unwrap_or_default()
+                .into_iter()
+                .map(|(name, net)| {
+                    let sample = NetworkSample {
+                        rx_bytes: net.rx_bytes,
+                        rx_packets: net.rx_packets,
+                        rx_errors: net.rx_errors,
+                        rx_dropped: net.rx_dropped,
+                        tx_bytes: net.tx_bytes,
+                        tx_packets: net.tx_packets,
+                        tx_errors: net.tx_errors,
+                        tx_dropped: net.tx_dropped,
+                    };
+                    (name, sample)
+                })
+                .collect(),
+        }
+    }
+}
+
+#[derive(Default)]
+struct Inner {
+    samples: HashMap<String, StatsSample>,
+    /// When the last report arrived, `None` while the stream is down
+    updated: Option<Instant>,
+}
+
+/// Latest stats of the running containers, fed by [`track_stats`]
+#[derive(Default)]
+pub struct StatsTracker {
+    inner: RwLock<Inner>,
+}
+
+impl StatsTracker {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Whether the stream delivered a report recently enough to be served
+    pub fn is_live(&self) -> bool {
+        self.read()
+            .updated
+            .is_some_and(|updated| updated.elapsed() < STALE_AFTER)
+    }
+
+    /// Latest sample of a container, `None` if the last report did not
+    /// include it, e.g. because it started after that report
+    pub fn get(&self, id: &str) -> Option<StatsSample> {
+        self.read().samples.get(id).cloned()
+    }
+
+    /// Replace all samples with those of `report`
+    fn apply(&self, report: StatsReport) {
+        let samples = report
+            .stats
+            .into_iter()
+            .filter(|stats| !stats.id.is_empty())
+            .map(|stats| (stats.id.clone(), StatsSample::from(stats)))
+            .collect();
+        let mut inner = self.write();
+        inner.samples = samples;
+        inner.updated = Some(Instant::now());
+    }
+
+    fn mark_down(&self) {
+        let mut inner = self.write();
+        inner.samples.clear();
+        inner.updated = None;
+    }
+
+    fn read(&self) -> std::sync::RwLockReadGuard<'_, Inner> {
+        self.inner.read().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn write(&self) -> std::sync::RwLockWriteGuard<'_, Inner> {
+        self.inner.write().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+/// Keeps `tracker` fed from the Podman stats stream for the lifetime of the
+/// agent, reopening the stream with exponential backoff when it drops.
+///
+/// The backoff is only reset by a report that carries stats, so an error
+/// reply or a stream of error reports keeps backing off.
+pub async fn track_stats(tracker: &StatsTracker) {
+    let mut delay = RECONNECT_DELAY_MIN;
+    loop {
+        let mut body = match get_stream(STATS_PATH).await {
+            Ok(body) => body,
+            Err(e) => {
+                eprintln!("[StatsTracker] Failed to open Podman stats stream: {}", e);
+                sleep(delay).await;
+                delay = (delay * 2).min(RECONNECT_DELAY_MAX);
+                continue;
+            }
+        };
+
+        let mut decoder = LineDecoder::<StatsReport>::new();
+        while let Some(chunk) = body.data().await {
+            match chunk {
+                Ok(chunk) => {
+                    for report in decoder.push(&chunk) {
+                        if let Some(error) = report.error.filter(|e| !e.is_null()) {
+                            eprintln!("[StatsTracker] Podman reported: {}", error);
+                            continue;
+                        }
+                        delay = RECONNECT_DELAY_MIN;
+                        tracker.apply(report);
+                    }
+                }
+                Err(e) => {
+                    eprintln!("[StatsTracker] Stats stream failed: {}", e);
+                    break;
+                }
+            }
+        }
+
+        eprintln!("[StatsTracker] Podman stats stream closed, reopening");
+        tracker.mark_down();
+        sleep(delay).await;
+        delay = (delay * 2).min(RECONNECT_DELAY_MAX);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const REPORT: &str = r#"{"Error":null,"Stats":[{"AvgCPU":0.5,"ContainerID":"abc","Name":"web","PerCPU":null,"CPU":0.5,"CPUNano":3000,"CPUSystemNano":1000,"SystemNano":1700000000000000000,"MemUsage":2048,"MemLimit":8192,"MemPerc":25,"NetInput":10,"NetOutput":20,"BlockInput":0,"BlockOutput":0,"PIDs":3,"UpTime":1000,"Duration":1000,"Network":{"eth0":{"RxBytes":10,"RxDropped":0,"RxErrors":0,"RxPackets":1,"TxBytes":20,"TxDropped":0,"TxErrors":0,"TxPackets":2}}},{"ContainerID":"def","CPUNano":5,"MemUsage":1}]}"#;
+
+    #[test]
+    fn test_report_maps_to_samples() {
+        let mut decoder = LineDecoder::<StatsReport>::new();
+        let reports = decoder.push(format!("{}\n", REPORT).as_bytes());
+        assert_eq!(reports.len(), 1);
+
+        let tracker = StatsTracker::new();
+        assert!(!tracker.is_live());
+        tracker.apply(reports.into_iter().next().unwrap());
+        assert!(tracker.is_live());
+
+        let web = tracker.get("abc").unwrap();
+        assert_eq!(web.cpu_total_usage, 3000);
+        assert_eq!(web.cpu_kernel_usage, 1000);
+        assert_eq!(web.cpu_user_usage, 2000);
+        assert_eq!(web.memory_limit, 8192);
+        assert_eq!(web.networks["eth0"].tx_packets, 2);
+
+        // Older Podman releases report no per-interface counters
+        let other = tracker.get("def").unwrap();
+        assert_eq!(other.memory_usage, 1);
+        assert!(other.networks.is_empty());
+        assert!(tracker.get("missing").is_none());
+
+        let failed = decoder.push(b"{\"Error\":{\"msg\":\"cgroup gone\"},\"Stats\":[]}\n");
+        assert!(failed[0].error.as_ref().is_some_and(|e| !e.is_null()));
+
+        tracker.mark_down();
+        assert!(!tracker.is_live());
+        assert!(tracker.get("abc").is_none());
+    }
+}
@@ -12,6 +12,7 @@
 //! - `start`: Create and start containers from a Pod YAML
 //! - `stop`: Stop and remove containers
 //! - `restart`: Restart running containers
+//! - `prepare`: Pull images and optionally create warm containers ahead of `start`
 //!
 //! # Architecture
 //! The module is organized into several logical sections:
@@ -21,10 +22,13 @@
 //! - Podman API communication (create, start, stop, restart)
 //! - Image management (existence check, pull)
 
-use super::{get, post};
-use hyper::Body;
+use super::prewarm::{model_turn, startup_metrics, warm_pool, StartupTiming, WarmLookup};
+use super::{delete_checked, get, get_checked, post, post_checked, PodmanError};
+use hyper::{Body, StatusCode};
+use serde::Deserialize;
 use serde_json::json;
 use std::path::Path;
+use std::time::{Duration, Instant};
 
 //const PODMAN_API_VERSION: &str = "/v4.0.0/libpod";
 const PODMAN_API_VERSION: &str = "/v4.0.0"; // docker-compatible API
@@ -66,6 +70,45 @@ const NVIDIA_LIB_HOST_PATHS: &[&str] = &[
 // Container path for NVIDIA libraries (avoid conflicts with existing paths)
 const NVIDIA_LIB_CONTAINER_PATH: &str = "/opt/nvidia/lib64";
 
+// Label marking containers created for the warm pool
+const WARM_LABEL: &str = "piccolo.warm";
+
+/// Response of `/containers/create`
+#[derive(Deserialize)]
+struct CreateResponse {
+    #[serde(rename = "Id")]
+    id: String,
+}
+
+/// Reply of `/containers/{name}/json`; only the labels and status are used
+#[derive(Deserialize)]
+struct ContainerInspect {
+    #[serde(rename = "Config")]
+    config: ContainerConfig,
+    #[serde(rename = "State")]
+    state: ContainerState,
+}
+
+#[derive(Deserialize)]
+struct ContainerState {
+    /// `created` until the container is started for the first time
+    #[serde(rename = "Status", default)]
+    status: String,
+}
+
+#[derive(Deserialize)]
+struct ContainerConfig {
+    #[serde(rename = "Labels", default)]
+    labels: Option<std::collections::HashMap<String, String>>,
+}
+
+/// Entry of `/images/json`; only the tags are used
+#[derive(Deserialize)]
+struct ImageSummary {
+    #[serde(rename = "RepoTags", default)]
+    repo_tags: Option<Vec<String>>,
+}
+
 /// Parse Pod YAML and extract pod name and spec
 fn parse_pod(pod_yaml: &str) -> Result<(String, serde_json::Value), Box<dyn std::error::Error>> {
     let pod = serde_yaml::from_str::<common::spec::k8s::Pod>(pod_yaml)?;
@@ -586,13 +629,13 @@ fn build_exposed_ports(container: &serde_json::Value) -> serde_json::Value {
     json!(exposed_ports)
 }
 
-/// Create container from spec
-async fn create_container(
+/// Image, container name and creation request of a container in a pod spec
+fn container_request(
     pod_name: &str,
     container: &serde_json::Value,
     spec: &serde_json::Value,
     host_network: bool,
-) -> Result<String, Box<dyn std::error::Error>> {
+) -> Result<(String, String, serde_json::Value), Box<dyn std::error::Error>> {
     let image = container["image"]
         .as_str()
         .ok_or("Container image field not found")?;
@@ -600,28 +643,71 @@ async fn create_container(
         .as_str()
         .ok_or("Container name field not found")?;
 
-    // Ensure image is available locally
-    ensure_image_available(image).await?;
-
     let name = format!("{}_{}", pod_name, container_name);
 
     // Build the complete container creation request
     let create_body = build_container_spec(&name, image, container, spec, host_network);
+    Ok((image.to_string(), name, create_body))
+}
+
+/// Create container from spec, or take its warm container
+///
+/// Returns the container ID and the time spent pulling and creating.
+async fn create_container(
+    pod_name: &str,
+    container: &serde_json::Value,
+    spec: &serde_json::Value,
+    host_network: bool,
+) -> Result<(String, StartupTiming), Box<dyn std::error::Error>> {
+    let (image, name, create_body) = container_request(pod_name, container, spec, host_network)?;
+
+    match warm_pool().take(&name, &create_body) {
+        WarmLookup::Hit(container_id) => {
+            println!("Using warm container {} for {}", container_id, name);
+            let timing = StartupTiming {
+                warm: true,
+                ..Default::default()
+            };
+            return Ok((container_id, timing));
+        }
+        WarmLookup::Stale(container_id) => {
+            println!(
+                "Removing outdated warm container {} for {}",
+                container_id, name
+            );
+            remove_container(&container_id).await?;
+        }
+        WarmLookup::Miss => {}
+    }
+
+    // Ensure image is available locally
+    let pull = ensure_image_available(&image).await?;
 
     println!("{}", create_body);
 
     // Create and return container ID
-    create_container_via_api(&name, create_body).await
+    let created = Instant::now();
+    let container_id = create_named_container(&name, create_body).await?;
+    let timing = StartupTiming {
+        pull,
+        create: created.elapsed(),
+        ..Default::default()
+    };
+    Ok((container_id, timing))
 }
 
 /// Ensure the container image is available locally (pull if needed)
-async fn ensure_image_available(image: &str) -> Result<(), Box<dyn std::error::Error>> {
-    if !image_exists(image).await? {
-        println!("Image {} not found locally, pulling...", image);
-        pull_image(image).await?;
-        println!("Image {} pulled successfully", image);
+///
+/// Returns the time spent pulling, zero if the image was present.
+async fn ensure_image_available(image: &str) -> Result<Duration, Box<dyn std::error::Error>> {
+    if image_exists(image).await? {
+        return Ok(Duration::ZERO);
     }
-    Ok(())
+    println!("Image {} not found locally, pulling...", image);
+    let pulled = Instant::now();
+    pull_image(image).await?;
+    println!("Image {} pulled successfully", image);
+    Ok(pulled.elapsed())
 }
 
 /// Build the complete container specification JSON
@@ -704,33 +790,116 @@ async fn create_container_via_api(
     println!("Creating container: {}", name);
 
     let create_path = format!("{}/containers/create?name={}", PODMAN_API_VERSION, name);
-    let create_response = post(&create_path, Body::from(create_body.to_string())).await?;
+    let create_response = post_checked(&create_path, Body::from(create_body.to_string())).await?;
 
-    let create_result: serde_json::Value = serde_json::from_slice(&create_response)?;
-    let container_id = create_result["Id"]
-        .as_str()
-        .ok_or("Failed to get container ID")?
-        .to_string();
+    let created: CreateResponse = serde_json::from_slice(&create_response)
+        .map_err(|e| format!("Failed to get container ID: {}", e))?;
+
+    Ok(created.id)
+}
+
+/// Create a container, first removing a leftover warm container of the
+/// same name
+///
+/// Warm containers outlive NodeAgent in Podman but not in the warm pool, so
+/// after a restart their names are taken by containers nobody tracks. Only
+/// containers carrying [`WARM_LABEL`] that were never started are removed;
+/// any other container under the name belongs to a start and is kept.
+async fn create_named_container(
+    name: &str,
+    create_body: serde_json::Value,
+) -> Result<String, Box<dyn std::error::Error>> {
+    let conflict = match create_container_via_api(name, create_body.clone()).await {
+        Err(e) if podman_status(e.as_ref()) == Some(StatusCode::CONFLICT) => e.to_string(),
+        result => return result,
+    };
+    if !is_warm_container(name).await {
+        println!("Warning: Keeping existing container {}", name);
+        return Err(conflict.into());
+    }
+    // Without force, Podman refuses to remove a container that was started
+    // since the check
+    let remove_path = format!("{}/containers/{}", PODMAN_API_VERSION, name);
+    if let Err(remove_error) = delete_checked(&remove_path).await {
+        println!(
+            "Warning: Keeping existing container {}: {}",
+            name, remove_error
+        );
+        return Err(conflict.into());
+    }
+    println!("Removed leftover warm container {}", name);
+    create_container_via_api(name, create_body).await
+}
 
-    Ok(container_id)
+/// Whether the container `name` was created for the warm pool and is still
+/// waiting for its first start
+async fn is_warm_container(name: &str) -> bool {
+    let inspect_path = format!("{}/containers/{}/json", PODMAN_API_VERSION, name);
+    let Ok(reply) = get_checked(&inspect_path).await else {
+        return false;
+    };
+    serde_json::from_slice::<ContainerInspect>(&reply).is_ok_and(|inspect| {
+        inspect.state.status == "created"
+            && inspect
+                .config
+                .labels
+                .is_some_and(|labels| labels.contains_key(WARM_LABEL))
+    })
+}
+
+/// Start a created container; one that already runs counts as started
+async fn start_container(container_id: &str) -> Result<(), PodmanError> {
+    let start_path = format!("{}/containers/{}/start", PODMAN_API_VERSION, container_id);
+    match post_checked(&start_path, Body::empty()).await {
+        Err(e) if e.status() == Some(StatusCode::NOT_MODIFIED) => Ok(()),
+        result => result.map(|_| ()),
+    }
+}
+
+fn podman_status(error: &(dyn std::error::Error + 'static)) -> Option<StatusCode> {
+    error.downcast_ref::<PodmanError>()?.status()
 }
 
 pub async fn start(pod_yaml: &str) -> Result<Vec<String>, Box<dyn std::error::Error>> {
     let (pod_name, spec) = parse_pod(pod_yaml)?;
     let host_network = spec["hostNetwork"].as_bool().unwrap_or(false);
+    // A preparation of the pod must not create its containers meanwhile
+    let _turn = model_turn(&pod_name).await;
 
     let mut container_ids = Vec::new();
 
     if let Some(containers) = spec["containers"].as_array() {
         for container in containers.iter() {
-            let container_id = create_container(&pod_name, container, &spec, host_network).await?;
+            let (mut container_id, mut timing) =
+                create_container(&pod_name, container, &spec, host_network).await?;
 
             // Start the container
             println!("Starting container: {}", container_id);
-            let start_path = format!("{}/containers/{}/start", PODMAN_API_VERSION, container_id);
-            post(&start_path, Body::empty()).await?;
+            let mut started = Instant::now();
+            if let Err(e) = start_container(&container_id).await {
+                if !(timing.warm && e.is_not_found()) {
+                    return Err(e.into());
+                }
+                // The warm container was removed outside of NodeAgent; its
+                // pool entry is gone, so this creates it from scratch
+                println!("Warm container {} is gone, recreating it", container_id);
+                (container_id, timing) =
+                    create_container(&pod_name, container, &spec, host_network).await?;
+                started = Instant::now();
+                start_container(&container_id).await?;
+            }
+            timing.start = started.elapsed();
+            startup_metrics().record_start(&timing);
 
-            println!("Container {} started successfully", container_id);
+            println!(
+                "Container {} started successfully in {}ms (pull {}ms, create {}ms, start {}ms{})",
+                container_id,
+                timing.total().as_millis(),
+                timing.pull.as_millis(),
+                timing.create.as_millis(),
+                timing.start.as_millis(),
+                if timing.warm { ", warm" } else { "" }
+            );
             container_ids.push(container_id);
         }
     }
@@ -743,6 +912,9 @@ pub async fn stop(pod_yaml: &str) -> Result<(), Box<dyn std::error::Error>> {
     let container_names = get_container_names(&pod_name, &spec)?;
 
     for full_container_name in container_names {
+        // A warm container is removed below like any other
+        warm_pool().discard(&full_container_name);
+
         // Stop the container with timeout=0 (immediate SIGKILL)
         println!("Stopping container: {}", full_container_name);
         let stop_path = format!(
@@ -805,22 +977,66 @@ pub async fn restart(pod_yaml: &str) -> Result<(), Box<dyn std::error::Error>> {
     Ok(())
 }
 
+/// Pull the images of a pod ahead of its start
+///
+/// With `warm`, its containers are also created without being started and
+/// kept in the warm pool for the next `start` of the pod. They carry
+/// [`WARM_LABEL`], so a stopped warm container from before a NodeAgent
+/// restart is replaced while containers of a start are left alone.
+pub async fn prepare(pod_yaml: &str, warm: bool) -> Result<(), Box<dyn std::error::Error>> {
+    let (pod_name, spec) = parse_pod(pod_yaml)?;
+    let host_network = spec["hostNetwork"].as_bool().unwrap_or(false);
+    let containers = spec["containers"]
+        .as_array()
+        .ok_or("No containers found in spec")?;
+
+    for container in containers {
+        let (image, name, create_body) =
+            container_request(&pod_name, container, &spec, host_network)?;
+
+        if !ensure_image_available(&image).await?.is_zero() {
+            startup_metrics().record_prepull();
+        }
+        if !warm || warm_pool().contains(&name, &create_body) {
+            continue;
+        }
+        if let Some(outdated) = warm_pool().discard(&name) {
+            remove_container(&outdated).await?;
+        }
+
+        let mut warm_body = create_body.clone();
+        warm_body["Labels"][WARM_LABEL] = json!("true");
+        match create_named_container(&name, warm_body).await {
+            Ok(container_id) => {
+                println!("Created warm container {} for {}", container_id, name);
+                warm_pool().offer(&pod_name, &name, container_id, &create_body);
+                startup_metrics().record_prewarm();
+            }
+            Err(e) => println!("Warning: Not keeping a warm container for {}: {}", name, e),
+        }
+    }
+
+    Ok(())
+}
+
+/// Force-remove a container by ID or name
+pub async fn remove_container(container: &str) -> Result<(), Box<dyn std::error::Error>> {
+    let remove_path = format!("{}/containers/{}?force=true", PODMAN_API_VERSION, container);
+    super::delete(&remove_path).await?;
+    Ok(())
+}
+
 /// Check if an image exists locally
 pub async fn image_exists(image_name: &str) -> Result<bool, Box<dyn std::error::Error>> {
     let path = "/v4.0.0/libpod/images/json";
 
     let result = get(path).await?;
-    let images: Vec<serde_json::Value> = serde_json::from_slice(&result)?;
-    for image in images {
-        if let Some(repo_tags) = image["RepoTags"].as_array() {
-            for tag in repo_tags {
-                if tag.as_str() == Some(image_name) {
-                    return Ok(true);
-                }
-            }
-        }
-    }
-    Ok(false)
+    let images: Vec<ImageSummary> = serde_json::from_slice(&result)?;
+    Ok(images
+        .iter()
+        .filter_map(|image| image.repo_tags.as_ref())
+        .flatten()
+        .any(|tag| tag == image_name))
 }
 
 /// Pull an image from a registry
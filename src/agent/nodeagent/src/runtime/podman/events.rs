@@ -0,0 +1,231 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Podman container event stream
+//!
+//! `/libpod/events?stream=true` keeps the connection open and writes one JSON
+//! object per line whenever a container changes. [`EventStream`] reads the
+//! body chunk by chunk and yields the decoded container events, so callers
+//! learn about exits and removals as they happen instead of polling the
+//! container list.
+
+use super::{get_stream, PodmanError};
+use hyper::body::HttpBody;
+use hyper::Body;
+use serde::de::DeserializeOwned;
+use serde::Deserialize;
+use std::collections::VecDeque;
+use std::marker::PhantomData;
+
+/// Container events only, as `filters={"type":["container"]}`
+const EVENTS_PATH: &str =
+    "/v4.0.0/libpod/events?stream=true&filters=%7B%22type%22%3A%5B%22container%22%5D%7D";
+
+/// Actions that never change the inspected state of a container
+const IGNORED_ACTIONS: &[&str] = &[
+    "attach",
+    "checkpoint",
+    "commit",
+    "copy",
+    "exec",
+    "exec_died",
+    "export",
+    "mount",
+    "sync",
+    "unmount",
+];
+
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
+struct Actor {
+    #[serde(rename = "ID")]
+    id: String,
+}
+
+/// One line of the Podman event stream; only the fields the agent uses
+#[derive(Deserialize, Debug, Default)]
+#[serde(default)]
+pub struct PodmanEvent {
+    #[serde(rename = "Type")]
+    pub kind: String,
+    #[serde(rename = "Action")]
+    pub action: String,
+    #[serde(rename = "Actor")]
+    actor: Actor,
+    /// Older API versions only fill the lowercase `id`
+    id: String,
+}
+
+/// What a container event means for the container cache
+#[derive(Debug, PartialEq, Eq)]
+pub enum EventEffect {
+    /// The container's state may have changed and it should be re-inspected
+    Changed(String),
+    /// The container no longer exists
+    Removed(String),
+    Ignored,
+}
+
+impl PodmanEvent {
+    pub fn container_id(&self) -> &str {
+        if self.actor.id.is_empty() {
+            &self.id
+        } else {
+            &self.actor.id
+        }
+    }
+
+    pub fn effect(&self) -> EventEffect {
+        let id = self.container_id();
+        if self.kind != "container" || id.is_empty() {
+            return EventEffect::Ignored;
+        }
+        match self.action.as_str() {
+            "remove" => EventEffect::Removed(id.to_string()),
+            action if IGNORED_ACTIONS.contains(&action) => EventEffect::Ignored,
+            _ => EventEffect::Changed(id.to_string()),
+        }
+    }
+}
+
+/// Splits a chunked body into newline-delimited JSON values
+///
+/// Chunk boundaries do not follow lines, so a partial line is kept until the
+/// rest of it arrives. Streaming endpoints such as `/events` and `/stats`
+/// write one value per line.
+pub struct LineDecoder<T> {
+    pending: Vec<u8>,
+    _marker: PhantomData<T>,
+}
+
+pub type EventDecoder = LineDecoder<PodmanEvent>;
+
+impl<T: DeserializeOwned> LineDecoder<T> {
+    pub fn new() -> Self {
+        Self {
+            pending: Vec::new(),
+            _marker: PhantomData,
+        }
+    }
+
+    /// Append `chunk` and decode every complete line it finishes
+    ///
+    /// Lines that cannot be decoded are logged and skipped.
+    pub fn push(&mut self, chunk: &[u8]) -> Vec<T> {
+        self.pending.extend_from_slice(chunk);
+        let mut values = Vec::new();
+        let mut start = 0;
+        while let Some(offset) = self.pending[start..].iter().position(|b| *b == b'\n') {
+            let line = &self.pending[start..start + offset];
+            start += offset + 1;
+            if line.iter().all(u8::is_ascii_whitespace) {
+                continue;
+            }
+            match serde_json::from_slice::<T>(line) {
+                Ok(value) => values.push(value),
+                Err(e) => eprintln!("[Podman] Skipping undecodable line: {}", e),
+            }
+        }
+        self.pending.drain(..start);
+        values
+    }
+}
+
+impl<T: DeserializeOwned> Default for LineDecoder<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Open connection to the Podman event stream
+pub struct EventStream {
+    body: Body,
+    decoder: EventDecoder,
+    ready: VecDeque<PodmanEvent>,
+}
+
+impl EventStream {
+    /// Subscribe to container events
+    ///
+    /// Only events that happen after this returns are delivered, so callers
+    /// that need a complete view list the containers afterwards.
+    pub async fn subscribe() -> Result<Self, PodmanError> {
+        Ok(Self {
+            body: get_stream(EVENTS_PATH).await?,
+            decoder: EventDecoder::new(),
+            ready: VecDeque::new(),
+        })
+    }
+
+    /// Wait for the next container event
+    ///
+    /// # Returns
+    ///
+    /// * `None` - the stream was closed or failed and has to be reopened
+    pub async fn next(&mut self) -> Option<PodmanEvent> {
+        loop {
+            if let Some(event) = self.ready.pop_front() {
+                return Some(event);
+            }
+            match self.body.data().await? {
+                Ok(chunk) => self.ready.extend(self.decoder.push(&chunk)),
+                Err(e) => {
+                    eprintln!("[Events] Event stream failed: {}", e);
+                    return None;
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const DIED: &str = r#"{"status":"died","id":"abc","from":"nginx","Type":"container","Action":"died","Actor":{"ID":"abc","Attributes":{"name":"web"}},"scope":"local","time":1700000000,"timeNano":1700000000000000000}"#;
+
+    #[test]
+    fn test_decoder_joins_lines_split_across_chunks() {
+        let mut decoder = EventDecoder::new();
+        let line = format!("{}\n", DIED);
+        let (head, tail) = line.split_at(40);
+
+        assert!(decoder.push(head.as_bytes()).is_empty());
+        let events = decoder.push(tail.as_bytes());
+        assert_eq!(events.len(), 1);
+        assert_eq!(events[0].action, "died");
+        assert_eq!(events[0].container_id(), "abc");
+    }
+
+    #[test]
+    fn test_decoder_skips_blank_and_invalid_lines() {
+        let mut decoder = EventDecoder::new();
+        let input = format!("\nnot json\n{}\n{}", DIED, DIED);
+        let events = decoder.push(input.as_bytes());
+        // The last event has no newline yet and stays pending
+        assert_eq!(events.len(), 1);
+        assert_eq!(decoder.push(b"\n").len(), 1);
+    }
+
+    #[test]
+    fn test_effect_of_actions() {
+        let event = |kind: &str, action: &str| PodmanEvent {
+            kind: kind.to_string(),
+            action: action.to_string(),
+            id: "abc".to_string(),
+            ..Default::default()
+        };
+        assert_eq!(
+            event("container", "died").effect(),
+            EventEffect::Changed("abc".to_string())
+        );
+        assert_eq!(
+            event("container", "remove").effect(),
+            EventEffect::Removed("abc".to_string())
+        );
+        assert_eq!(event("container", "exec").effect(), EventEffect::Ignored);
+        assert_eq!(event("image", "remove").effect(), EventEffect::Ignored);
+    }
+}
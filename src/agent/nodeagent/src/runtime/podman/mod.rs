@@ -4,71 +4,159 @@
 */
 
 pub mod container;
+pub mod events;
+pub mod prewarm;
 
 use common::nodeagent::fromactioncontroller::WorkloadCommand;
-use hyper::{Body, Client, Method, Request, Uri};
+use hyper::{Body, Client, Method, Request, Response, StatusCode, Uri};
 use hyperlocal::{UnixConnector, Uri as UnixUri};
+use std::sync::OnceLock;
+use std::time::Duration;
+
+// Modify this if you want to run without root authorization
+// or if you have a different socket path.
+// For example, if you run Podman as a user, you might use:
+// "/run/user/1000/podman/podman.sock"
+const PODMAN_SOCKET: &str = "/var/run/podman/podman.sock";
+
+/// Idle connections kept open to the Podman socket
+const POOL_MAX_IDLE: usize = 8;
+const POOL_IDLE_TIMEOUT: Duration = Duration::from_secs(90);
+
+/// Client shared by every Podman API call
+///
+/// Building a client per request opened a new socket connection for each
+/// list, inspect and stats call. The shared client keeps connections alive
+/// between requests and reuses them from its pool.
+static CLIENT: OnceLock<Client<UnixConnector, Body>> = OnceLock::new();
+
+fn client() -> &'static Client<UnixConnector, Body> {
+    CLIENT.get_or_init(|| {
+        Client::builder()
+            .pool_max_idle_per_host(POOL_MAX_IDLE)
+            .pool_idle_timeout(POOL_IDLE_TIMEOUT)
+            .build(UnixConnector)
+    })
+}
+
+fn uri(path: &str) -> Uri {
+    UnixUri::new(PODMAN_SOCKET, path).into()
+}
+
+/// Failure of a Podman API call that checks the response status
+#[derive(thiserror::Error, Debug)]
+pub enum PodmanError {
+    #[error("Podman request failed: {0}")]
+    Http(#[from] hyper::Error),
+    #[error("Podman API returned {status}: {message}")]
+    Status { status: StatusCode, message: String },
+}
+
+impl PodmanError {
+    /// Whether Podman reported that the object does not exist
+    pub fn is_not_found(&self) -> bool {
+        match self {
+            PodmanError::Status { status, message } => {
+                *status == StatusCode::NOT_FOUND || message.contains("no such container")
+            }
+            PodmanError::Http(_) => false,
+        }
+    }
+
+    /// Status of the reply, `None` when no reply was received
+    pub fn status(&self) -> Option<StatusCode> {
+        match self {
+            PodmanError::Status { status, .. } => Some(*status),
+            PodmanError::Http(_) => None,
+        }
+    }
+}
 
 pub async fn get(path: &str) -> Result<hyper::body::Bytes, hyper::Error> {
-    let connector = UnixConnector;
-    let client = Client::builder().build::<_, Body>(connector);
-
-    // Modify this if you want to run without root authorization
-    // or if you have a different socket path.
-    // For example, if you run Podman as root, you might use:
-    // let socket = "/var/run/podman/podman.sock";
-    // Or if you run it as a user, you might use:
-    // let socket = "/run/user/1000/podman/podman.sock
-    let socket = "/var/run/podman/podman.sock";
-    // let socket = "/var/run/podman/podman.sock";
-    let uri: Uri = UnixUri::new(socket, path).into();
-
-    let res = client.get(uri).await?;
+    let res = client().get(uri(path)).await?;
     hyper::body::to_bytes(res).await
 }
 
-pub async fn post(path: &str, body: Body) -> Result<hyper::body::Bytes, hyper::Error> {
-    let connector = UnixConnector;
-    let client = Client::builder().build::<_, Body>(connector);
-
-    // Modify this if you want to run without root authorization
-    // or if you have a different socket path.
-    // For example, if you run Podman as root, you might use:
-    // let socket = "/var/run/podman/podman.sock";
-    // Or if you run it as a user, you might use:
-    // let socket = "/run/user/1000/podman/podman.sock
-    let socket = "/var/run/podman/podman.sock";
-    // let socket = "/var/run/podman/podman.sock";
-    // let path = "/v4.0.0/libpod/containers/{name}/start";
-    let uri: Uri = UnixUri::new(socket, path).into();
-
-    let req = Request::builder()
-        .method(Method::POST)
-        .uri(uri)
-        .body(body)
-        .unwrap();
+/// Like [`get`], but a non-2xx reply is returned as [`PodmanError::Status`]
+/// instead of handing its error body to the caller.
+pub async fn get_checked(path: &str) -> Result<hyper::body::Bytes, PodmanError> {
+    let res = check_status(client().get(uri(path)).await?).await?;
+    Ok(hyper::body::to_bytes(res).await?)
+}
 
-    let res = client.request(req).await?;
-    hyper::body::to_bytes(res).await
+/// Sends a GET request and returns the response body without buffering it,
+/// for endpoints that keep streaming such as `/events`.
+///
+/// An error reply would otherwise read as a stream that ends at once, so
+/// non-2xx statuses are returned as errors.
+pub async fn get_stream(path: &str) -> Result<Body, PodmanError> {
+    let res = check_status(client().get(uri(path)).await?).await?;
+    Ok(res.into_body())
+}
+
+async fn check_status(res: Response<Body>) -> Result<Response<Body>, PodmanError> {
+    let status = res.status();
+    if status.is_success() {
+        return Ok(res);
+    }
+    // Podman error bodies look like {"cause":..,"message":..,"response":404}
+    let body = hyper::body::to_bytes(res).await?;
+    let message = serde_json::from_slice::<serde_json::Value>(&body)
+        .ok()
+        .and_then(|v| {
+            v.get("message")
+                .and_then(|m| m.as_str())
+                .map(str::to_string)
+        })
+        .unwrap_or_else(|| String::from_utf8_lossy(&body).into_owned());
+    Err(PodmanError::Status { status, message })
+}
+
+pub async fn post(path: &str, body: Body) -> Result<hyper::body::Bytes, hyper::Error> {
+    request(Method::POST, path, body).await
 }
 
 pub async fn delete(path: &str) -> Result<hyper::body::Bytes, hyper::Error> {
-    let connector = UnixConnector;
-    let client = Client::builder().build::<_, Body>(connector);
+    request(Method::DELETE, path, Body::empty()).await
+}
+
+/// Like [`post`], but a non-2xx reply is returned as [`PodmanError::Status`]
+pub async fn post_checked(path: &str, body: Body) -> Result<hyper::body::Bytes, PodmanError> {
+    request_checked(Method::POST, path, body).await
+}
 
-    let socket = "/var/run/podman/podman.sock";
-    let uri: Uri = UnixUri::new(socket, path).into();
+/// Like [`delete`], but a non-2xx reply is returned as [`PodmanError::Status`]
+pub async fn delete_checked(path: &str) -> Result<hyper::body::Bytes, PodmanError> {
+    request_checked(Method::DELETE, path, Body::empty()).await
+}
 
-    let req = Request::builder()
-        .method(Method::DELETE)
-        .uri(uri)
-        .body(Body::empty())
-        .unwrap();
+fn build_request(method: Method, path: &str, body: Body) -> Request<Body> {
+    Request::builder()
+        .method(method)
+        .uri(uri(path))
+        .body(body)
+        .unwrap()
+}
 
-    let res = client.request(req).await?;
+async fn request(
+    method: Method,
+    path: &str,
+    body: Body,
+) -> Result<hyper::body::Bytes, hyper::Error> {
+    let res = client().request(build_request(method, path, body)).await?;
     hyper::body::to_bytes(res).await
 }
 
+async fn request_checked(
+    method: Method,
+    path: &str,
+    body: Body,
+) -> Result<hyper::body::Bytes, PodmanError> {
+    let res = client().request(build_request(method, path, body)).await?;
+    let res = check_status(res).await?;
+    Ok(hyper::body::to_bytes(res).await?)
+}
+
 pub async fn handle_workload(
     command: i32,
     pod: &str,
@@ -100,11 +188,26 @@ pub async fn handle_workload(
 //Unit tets cases
 #[cfg(test)]
 mod tests {
-    use super::get;
+    use super::{get, PodmanError};
     use hyper::body::Bytes;
-    use hyper::Error;
+    use hyper::{Error, StatusCode};
     use tokio;
 
+    #[test]
+    fn test_is_not_found_only_for_missing_objects() {
+        let missing = PodmanError::Status {
+            status: StatusCode::NOT_FOUND,
+            message: "no container with name or ID \"web\" found: no such container".into(),
+        };
+        assert!(missing.is_not_found());
+
+        let busy = PodmanError::Status {
+            status: StatusCode::INTERNAL_SERVER_ERROR,
+            message: "timed out waiting for container lock".into(),
+        };
+        assert!(!busy.is_not_found());
+    }
+
     #[tokio::test]
     async fn test_get_with_valid_path() {
         let result: Result<Bytes, Error> = get("/v1.0/version").await;
@@ -0,0 +1,640 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Image pre-pull and warm containers
+//!
+//! The first start of a model used to pull its images and create its
+//! containers before anything could run. [`watch_artifacts`] follows the
+//! `Package/` and `Pod/` prefixes and prepares every model that a package
+//! assigns to this node as soon as it is applied:
+//!
+//! - the images of all its containers are pulled,
+//! - for models listed in `warm_models` of the NodeAgent config, the
+//!   containers are also created and kept in the [`WarmPool`] without being
+//!   started, so a trigger only pays for the start.
+//!
+//! [`container::start`](super::container::start) takes a warm container only
+//! if it was created from the same specification; a stale one is removed and
+//! recreated. Warm containers of withdrawn models are removed. The
+//! preparations and removals of one model run in the order the watch saw
+//! them, so a removal can never overtake the preparation it undoes. A start
+//! takes its turn in the same queue through [`model_turn`], so it never
+//! creates containers while a preparation of its pod does.
+//!
+//! Every start is split into pull, create and start time in
+//! [`StartupMetrics`].
+
+use common::spec::artifact::Package;
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Mutex, MutexGuard, OnceLock};
+use tokio::sync::{mpsc, oneshot};
+use tokio::time::{sleep, Duration};
+
+const PACKAGE_PREFIX: &str = "Package/";
+const POD_PREFIX: &str = "Pod/";
+
+/// First delay before re-opening a failed watch
+const RETRY_DELAY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the retry backoff
+const RETRY_DELAY_MAX: Duration = Duration::from_secs(30);
+
+static WARM_POOL: OnceLock<WarmPool> = OnceLock::new();
+static STARTUP_METRICS: StartupMetrics = StartupMetrics::new();
+static MODEL_QUEUES: OnceLock<Mutex<ModelQueues>> = OnceLock::new();
+
+/// Containers created ahead of time and not started yet
+pub fn warm_pool() -> &'static WarmPool {
+    WARM_POOL.get_or_init(WarmPool::default)
+}
+
+/// Time-to-running counters of this NodeAgent
+pub fn startup_metrics() -> &'static StartupMetrics {
+    &STARTUP_METRICS
+}
+
+// ===========================================================================
+// Warm pool
+// ===========================================================================
+
+struct WarmContainer {
+    pod_name: String,
+    id: String,
+    /// Creation request the container was made from
+    spec: String,
+}
+
+/// Result of looking up a warm container for a start
+#[derive(Debug, PartialEq, Eq)]
+pub enum WarmLookup {
+    /// Created from the requested spec; only needs a start
+    Hit(String),
+    /// Created from another spec; must be removed before creating again
+    Stale(String),
+    Miss,
+}
+
+/// Warm containers by container name
+#[derive(Default)]
+pub struct WarmPool {
+    containers: Mutex<HashMap<String, WarmContainer>>,
+}
+
+impl WarmPool {
+    /// Keep a created container for the next start of `pod_name`
+    pub fn offer(&self, pod_name: &str, name: &str, id: String, spec: &serde_json::Value) {
+        self.lock().insert(
+            name.to_string(),
+            WarmContainer {
+                pod_name: pod_name.to_string(),
+                id,
+                spec: spec.to_string(),
+            },
+        );
+    }
+
+    /// Whether a container created from `spec` is waiting under `name`
+    pub fn contains(&self, name: &str, spec: &serde_json::Value) -> bool {
+        self.lock()
+            .get(name)
+            .is_some_and(|warm| warm.spec == spec.to_string())
+    }
+
+    /// Take the container waiting under `name`
+    pub fn take(&self, name: &str, spec: &serde_json::Value) -> WarmLookup {
+        match self.lock().remove(name) {
+            Some(warm) if warm.spec == spec.to_string() => WarmLookup::Hit(warm.id),
+            Some(warm) => WarmLookup::Stale(warm.id),
+            None => WarmLookup::Miss,
+        }
+    }
+
+    /// Forget the container waiting under `name`, returning its ID
+    pub fn discard(&self, name: &str) -> Option<String> {
+        self.lock().remove(name).map(|warm| warm.id)
+    }
+
+    /// Forget all containers of `pod_name`, returning their IDs
+    pub fn discard_pod(&self, pod_name: &str) -> Vec<String> {
+        let mut containers = self.lock();
+        let names: Vec<String> = containers
+            .iter()
+            .filter(|(_, warm)| warm.pod_name == pod_name)
+            .map(|(name, _)| name.clone())
+            .collect();
+        names
+            .into_iter()
+            .filter_map(|name| containers.remove(&name).map(|warm| warm.id))
+            .collect()
+    }
+
+    pub fn len(&self) -> usize {
+        self.lock().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, HashMap<String, WarmContainer>> {
+        self.containers.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+// ===========================================================================
+// Startup metrics
+// ===========================================================================
+
+/// Time spent in each phase of bringing one container to running
+#[derive(Debug, Default, Clone, Copy, PartialEq)]
+pub struct StartupTiming {
+    /// Zero when the image was present
+    pub pull: Duration,
+    /// Zero when a warm container was used
+    pub create: Duration,
+    pub start: Duration,
+    /// Whether a warm container was used
+    pub warm: bool,
+}
+
+impl StartupTiming {
+    pub fn total(&self) -> Duration {
+        self.pull + self.create + self.start
+    }
+}
+
+/// Point-in-time copy of the startup counters
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct StartupStats {
+    /// Containers started
+    pub starts: u64,
+    /// Starts that used a warm container
+    pub warm_starts: u64,
+    /// Images pulled ahead of a start
+    pub prepulled_images: u64,
+    /// Containers created ahead of a start
+    pub prewarmed_containers: u64,
+    pub avg_pull_us: u64,
+    pub avg_create_us: u64,
+    pub avg_start_us: u64,
+    pub max_total_us: u64,
+}
+
+pub struct StartupMetrics {
+    starts: AtomicU64,
+    warm_starts: AtomicU64,
+    prepulled_images: AtomicU64,
+    prewarmed_containers: AtomicU64,
+    total_pull_us: AtomicU64,
+    total_create_us: AtomicU64,
+    total_start_us: AtomicU64,
+    max_total_us: AtomicU64,
+}
+
+impl StartupMetrics {
+    const fn new() -> Self {
+        Self {
+            starts: AtomicU64::new(0),
+            warm_starts: AtomicU64::new(0),
+            prepulled_images: AtomicU64::new(0),
+            prewarmed_containers: AtomicU64::new(0),
+            total_pull_us: AtomicU64::new(0),
+            total_create_us: AtomicU64::new(0),
+            total_start_us: AtomicU64::new(0),
+            max_total_us: AtomicU64::new(0),
+        }
+    }
+
+    /// Count a container that reached running
+    pub fn record_start(&self, timing: &StartupTiming) {
+        self.starts.fetch_add(1, Ordering::Relaxed);
+        if timing.warm {
+            self.warm_starts.fetch_add(1, Ordering::Relaxed);
+        }
+        self.total_pull_us
+            .fetch_add(timing.pull.as_micros() as u64, Ordering::Relaxed);
+        self.total_create_us
+            .fetch_add(timing.create.as_micros() as u64, Ordering::Relaxed);
+        self.total_start_us
+            .fetch_add(timing.start.as_micros() as u64, Ordering::Relaxed);
+        self.max_total_us
+            .fetch_max(timing.total().as_micros() as u64, Ordering::Relaxed);
+    }
+
+    pub fn record_prepull(&self) {
+        self.prepulled_images.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn record_prewarm(&self) {
+        self.prewarmed_containers.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn stats(&self) -> StartupStats {
+        let starts = self.starts.load(Ordering::Relaxed);
+        let avg = |total: &AtomicU64| {
+            if starts > 0 {
+                total.load(Ordering::Relaxed) / starts
+            } else {
+                0
+            }
+        };
+        StartupStats {
+            starts,
+            warm_starts: self.warm_starts.load(Ordering::Relaxed),
+            prepulled_images: self.prepulled_images.load(Ordering::Relaxed),
+            prewarmed_containers: self.prewarmed_containers.load(Ordering::Relaxed),
+            avg_pull_us: avg(&self.total_pull_us),
+            avg_create_us: avg(&self.total_create_us),
+            avg_start_us: avg(&self.total_start_us),
+            max_total_us: self.max_total_us.load(Ordering::Relaxed),
+        }
+    }
+}
+
+// ===========================================================================
+// Artifact watch
+// ===========================================================================
+
+/// Models of this node and their Pod definitions as seen in ETCD
+struct Artifacts {
+    node_name: String,
+    /// Package name → its models assigned to this node
+    local_models: HashMap<String, Vec<String>>,
+    /// Model name → Pod YAML
+    pods: HashMap<String, String>,
+    /// Model name → Pod YAML it was last prepared from
+    prepared: HashMap<String, String>,
+}
+
+impl Artifacts {
+    fn new(node_name: String, prepared: HashMap<String, String>) -> Self {
+        Self {
+            node_name,
+            local_models: HashMap::new(),
+            pods: HashMap::new(),
+            prepared,
+        }
+    }
+
+    fn apply(&mut self, event: common::etcd::WatchEvent) {
+        use common::etcd::WatchEvent;
+        match event {
+            WatchEvent::Put { key, value } => {
+                if let Some(name) = key.strip_prefix(PACKAGE_PREFIX) {
+                    let models = match serde_yaml::from_str::<Package>(&value) {
+                        Ok(package) => package
+                            .get_models()
+                            .iter()
+                            .filter(|mi| mi.get_node() == self.node_name)
+                            .map(|mi| mi.get_name())
+                            .collect(),
+                        Err(e) => {
+                            eprintln!("[Prewarm] Failed to parse package '{}': {}", name, e);
+                            Vec::new()
+                        }
+                    };
+                    self.local_models.insert(name.to_string(), models);
+                } else if let Some(name) = key.strip_prefix(POD_PREFIX) {
+                    self.pods.insert(name.to_string(), value);
+                }
+            }
+            WatchEvent::Delete { key } => {
+                if let Some(name) = key.strip_prefix(PACKAGE_PREFIX) {
+                    self.local_models.remove(name);
+                } else if let Some(name) = key.strip_prefix(POD_PREFIX) {
+                    self.pods.remove(name);
+                }
+            }
+        }
+    }
+
+    /// Models to prepare and models whose preparation is no longer wanted
+    ///
+    /// Both lists are taken into account as handled.
+    fn reconcile(&mut self) -> (Vec<(String, String)>, Vec<String>) {
+        let mut wanted: HashMap<&str, &String> = HashMap::new();
+        for model in self.local_models.values().flatten() {
+            if let Some(pod_yaml) = self.pods.get(model) {
+                wanted.insert(model, pod_yaml);
+            }
+        }
+
+        let withdrawn: Vec<String> = self
+            .prepared
+            .keys()
+            .filter(|model| !wanted.contains_key(model.as_str()))
+            .cloned()
+            .collect();
+        let pending: Vec<(String, String)> = wanted
+            .into_iter()
+            .filter(|(model, pod_yaml)| self.prepared.get(*model) != Some(*pod_yaml))
+            .map(|(model, pod_yaml)| (model.to_string(), pod_yaml.clone()))
+            .collect();
+
+        for model in &withdrawn {
+            self.prepared.remove(model);
+        }
+        for (model, pod_yaml) in &pending {
+            self.prepared.insert(model.clone(), pod_yaml.clone());
+        }
+        (pending, withdrawn)
+    }
+}
+
+/// Work queued for one model
+enum ModelJob {
+    Prepare {
+        pod_yaml: String,
+        warm: bool,
+    },
+    Release,
+    /// Work run outside the queue: `granted` is signalled once the jobs
+    /// before it are done, and the queue waits until `done` is dropped
+    Turn {
+        granted: oneshot::Sender<()>,
+        done: oneshot::Receiver<()>,
+    },
+}
+
+/// One worker per model, so the jobs of a model run one after the other
+/// while different models are prepared in parallel
+#[derive(Default)]
+struct ModelQueues {
+    queues: HashMap<String, mpsc::UnboundedSender<ModelJob>>,
+}
+
+impl ModelQueues {
+    fn push(&mut self, model: &str, job: ModelJob) {
+        let queue = self.queues.entry(model.to_string()).or_insert_with(|| {
+            let (tx, rx) = mpsc::unbounded_channel();
+            tokio::spawn(run_model_jobs(model.to_string(), rx));
+            tx
+        });
+        // The worker only stops once its sender is dropped
+        let _ = queue.send(job);
+    }
+}
+
+fn model_queues() -> MutexGuard<'static, ModelQueues> {
+    MODEL_QUEUES
+        .get_or_init(Default::default)
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+}
+
+async fn run_model_jobs(model: String, mut jobs: mpsc::UnboundedReceiver<ModelJob>) {
+    while let Some(job) = jobs.recv().await {
+        match job {
+            ModelJob::Prepare { pod_yaml, warm } => prepare_model(&model, &pod_yaml, warm).await,
+            ModelJob::Release => release_model(&model).await,
+            ModelJob::Turn { granted, done } => {
+                if granted.send(()).is_ok() {
+                    // Resolves with an error once the turn is dropped
+                    let _ = done.await;
+                }
+            }
+        }
+    }
+}
+
+/// Exclusive turn in the job queue of a model, ends when dropped
+pub struct ModelTurn {
+    _done: oneshot::Sender<()>,
+}
+
+/// Wait until the queued preparations and removals of `model` are done
+///
+/// No other job of the model runs until the returned turn is dropped.
+pub async fn model_turn(model: &str) -> ModelTurn {
+    let (granted_tx, granted_rx) = oneshot::channel();
+    let (done_tx, done_rx) = oneshot::channel();
+    model_queues().push(
+        model,
+        ModelJob::Turn {
+            granted: granted_tx,
+            done: done_rx,
+        },
+    );
+    // The worker keeps running as long as the queue does
+    let _ = granted_rx.await;
+    ModelTurn { _done: done_tx }
+}
+
+/// Prepare the models of `node_name` for the lifetime of NodeAgent
+///
+/// Both prefixes are loaded first; nothing is prepared or removed until
+/// both are synced. When a stream fails, both watches are re-opened with
+/// exponential backoff, keeping track of what was already prepared.
+pub async fn watch_artifacts(node_name: String, warm_models: Vec<String>) {
+    let mut delay = RETRY_DELAY_MIN;
+    let mut prepared = HashMap::new();
+    loop {
+        let watches = (
+            common::etcd::watch(PACKAGE_PREFIX, true).await,
+            common::etcd::watch(POD_PREFIX, true).await,
+        );
+        match watches {
+            (Ok(mut packages), Ok(mut pods)) => {
+                let mut artifacts =
+                    Artifacts::new(node_name.clone(), std::mem::take(&mut prepared));
+                let (mut packages_synced, mut pods_synced) = (false, false);
+                loop {
+                    let (batch, from_packages) = tokio::select! {
+                        batch = packages.next() => (batch, true),
+                        batch = pods.next() => (batch, false),
+                    };
+                    let batch = match batch {
+                        Ok(Some(batch)) => batch,
+                        Ok(None) => {
+                            eprintln!("[Prewarm] Artifact watch closed");
+                            break;
+                        }
+                        Err(e) => {
+                            eprintln!("[Prewarm] Artifact watch failed: {}", e);
+                            break;
+                        }
+                    };
+                    let synced = batch.synced;
+                    for event in batch.events {
+                        artifacts.apply(event);
+                    }
+                    if synced {
+                        if from_packages {
+                            packages_synced = true;
+                        } else {
+                            pods_synced = true;
+                        }
+                        delay = RETRY_DELAY_MIN;
+                    }
+                    if packages_synced && pods_synced {
+                        let (pending, withdrawn) = artifacts.reconcile();
+                        let mut queues = model_queues();
+                        for model in withdrawn {
+                            queues.push(&model, ModelJob::Release);
+                        }
+                        for (model, pod_yaml) in pending {
+                            let warm = warm_models.contains(&model);
+                            queues.push(&model, ModelJob::Prepare { pod_yaml, warm });
+                        }
+                    }
+                }
+                prepared = artifacts.prepared;
+            }
+            (Err(e), _) | (_, Err(e)) => {
+                eprintln!("[Prewarm] Failed to watch artifacts: {}", e)
+            }
+        }
+
+        sleep(delay).await;
+        delay = (delay * 2).min(RETRY_DELAY_MAX);
+    }
+}
+
+async fn prepare_model(model: &str, pod_yaml: &str, warm: bool) {
+    match super::container::prepare(pod_yaml, warm).await {
+        Ok(()) => println!(
+            "[Prewarm] Model '{}' prepared{}",
+            model,
+            if warm { " with warm containers" } else { "" }
+        ),
+        Err(e) => eprintln!("[Prewarm] Failed to prepare model '{}': {}", model, e),
+    }
+}
+
+async fn release_model(model: &str) {
+    for id in warm_pool().discard_pod(model) {
+        if let Err(e) = super::container::remove_container(&id).await {
+            eprintln!("[Prewarm] Failed to remove warm container {}: {}", id, e);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use common::etcd::WatchEvent;
+    use serde_json::json;
+
+    fn put(key: &str, value: &str) -> WatchEvent {
+        WatchEvent::Put {
+            key: key.to_string(),
+            value: value.to_string(),
+        }
+    }
+
+    fn package_yaml(name: &str, models: &[(&str, &str)]) -> String {
+        let models: Vec<String> = models
+            .iter()
+            .map(|(m, node)| {
+                format!(
+                    r#"{{"name":"{m}","node":"{node}","resources":{{"volume":null,"network":null}}}}"#
+                )
+            })
+            .collect();
+        format!(
+            r#"{{"apiVersion":"v1","kind":"Package","metadata":{{"name":"{name}"}},"spec":{{"pattern":[],"models":[{}]}}}}"#,
+            models.join(",")
+        )
+    }
+
+    #[test]
+    fn test_reconcile_prepares_local_models_once() {
+        let mut artifacts = Artifacts::new("HPC".to_string(), HashMap::new());
+        artifacts.apply(put(
+            "Package/p1",
+            &package_yaml("p1", &[("m1", "HPC"), ("m2", "ZONE")]),
+        ));
+        artifacts.apply(put("Pod/m1", "pod-m1"));
+        artifacts.apply(put("Pod/m2", "pod-m2"));
+
+        let (pending, withdrawn) = artifacts.reconcile();
+        assert_eq!(pending, vec![("m1".to_string(), "pod-m1".to_string())]);
+        assert!(withdrawn.is_empty());
+        assert_eq!(artifacts.reconcile(), (vec![], vec![]));
+
+        // A changed Pod is prepared again
+        artifacts.apply(put("Pod/m1", "pod-m1-v2"));
+        assert_eq!(artifacts.reconcile().0.len(), 1);
+    }
+
+    #[test]
+    fn test_reconcile_reports_withdrawn_models() {
+        let mut artifacts = Artifacts::new("HPC".to_string(), HashMap::new());
+        artifacts.apply(put("Package/p1", &package_yaml("p1", &[("m1", "HPC")])));
+        artifacts.apply(put("Pod/m1", "pod-m1"));
+        artifacts.reconcile();
+
+        artifacts.apply(WatchEvent::Delete {
+            key: "Package/p1".to_string(),
+        });
+        let (pending, withdrawn) = artifacts.reconcile();
+        assert!(pending.is_empty());
+        assert_eq!(withdrawn, vec!["m1".to_string()]);
+    }
+
+    #[test]
+    fn test_warm_pool_matches_spec() {
+        let pool = WarmPool::default();
+        let spec = json!({"Image": "nginx", "Name": "web_nginx"});
+        pool.offer("web", "web_nginx", "id1".to_string(), &spec);
+        assert!(pool.contains("web_nginx", &spec));
+        assert_eq!(
+            pool.take("web_nginx", &spec),
+            WarmLookup::Hit("id1".to_string())
+        );
+        assert_eq!(pool.take("web_nginx", &spec), WarmLookup::Miss);
+
+        pool.offer("web", "web_nginx", "id2".to_string(), &spec);
+        let changed = json!({"Image": "nginx:2", "Name": "web_nginx"});
+        assert_eq!(
+            pool.take("web_nginx", &changed),
+            WarmLookup::Stale("id2".to_string())
+        );
+
+        pool.offer("web", "web_a", "id3".to_string(), &spec);
+        pool.offer("other", "other_a", "id4".to_string(), &spec);
+        assert_eq!(pool.discard_pod("web"), vec!["id3".to_string()]);
+        assert_eq!(pool.len(), 1);
+    }
+
+    #[tokio::test]
+    async fn test_model_turns_run_one_after_the_other() {
+        let first = model_turn("turn-test").await;
+        let second = tokio::spawn(async { model_turn("turn-test").await });
+        // Other models are not held back
+        drop(model_turn("turn-test-other").await);
+
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        assert!(!second.is_finished());
+        drop(first);
+        tokio::time::timeout(Duration::from_secs(1), second)
+            .await
+            .unwrap()
+            .unwrap();
+    }
+
+    #[test]
+    fn test_startup_metrics_split_phases() {
+        let metrics = StartupMetrics::new();
+        metrics.record_start(&StartupTiming {
+            pull: Duration::from_millis(300),
+            create: Duration::from_millis(40),
+            start: Duration::from_millis(20),
+            warm: false,
+        });
+        metrics.record_start(&StartupTiming {
+            pull: Duration::ZERO,
+            create: Duration::ZERO,
+            start: Duration::from_millis(20),
+            warm: true,
+        });
+        let stats = metrics.stats();
+        assert_eq!((stats.starts, stats.warm_starts), (2, 1));
+        assert_eq!(stats.avg_pull_us, 150_000);
+        assert_eq!(stats.avg_create_us, 20_000);
+        assert_eq!(stats.avg_start_us, 20_000);
+        assert_eq!(stats.max_total_us, 360_000);
+    }
+}
@@ -5,15 +5,260 @@
 
 use crate::logd;
 use crate::rocksdbservice::{
-    rocks_db_service_client::RocksDbServiceClient, BatchPutRequest, DeleteRequest,
-    GetByPrefixRequest, GetRequest, HealthRequest, KeyValue, PutRequest,
+    rocks_db_service_client::RocksDbServiceClient, write_op, BatchPutRequest, DeleteRequest,
+    GetByPrefixRequest, GetRequest, HealthRequest, KeyValue, MultiGetRequest, PutRequest,
+    SnapshotRequest, WatchRequest, WatchResponse, WriteBatchRequest, WriteOp,
 };
+pub use crate::snapshot::Snapshot;
+use std::future::Future;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{OnceLock, RwLock};
+use std::time::{Duration, Instant};
+use tonic::transport::{Channel, Endpoint};
+use tonic::{Code, Status};
 
 lazy_static::lazy_static! {
     static ref ROCKSDB_SERVICE_URL: String = {
         std::env::var("ROCKSDB_SERVICE_URL")
             .unwrap_or_else(|_| "http://localhost:47007".to_string())
     };
+    /// Number of HTTP/2 connections kept open to the RocksDB service.
+    static ref ROCKSDB_POOL_SIZE: usize = {
+        std::env::var("ROCKSDB_POOL_SIZE")
+            .ok()
+            .and_then(|v| v.parse::<usize>().ok())
+            .filter(|v| *v > 0)
+            .unwrap_or(DEFAULT_POOL_SIZE)
+    };
+}
+
+const DEFAULT_POOL_SIZE: usize = 2;
+const MAX_RETRIES: u32 = 3;
+const INITIAL_BACKOFF: Duration = Duration::from_millis(50);
+const CONNECT_TIMEOUT: Duration = Duration::from_secs(3);
+const KEEP_ALIVE_INTERVAL: Duration = Duration::from_secs(30);
+
+// ===========================================
+// Channel pool
+// ===========================================
+
+/// Long-lived, lazily connected channels to the RocksDB service.
+///
+/// Channels are handed out round-robin. A slot whose channel hits a
+/// transport failure is rebuilt on the next retry, so callers never see a
+/// stale connection for longer than one backoff period.
+struct ChannelPool {
+    endpoint: Endpoint,
+    slots: Vec<RwLock<Option<Channel>>>,
+    next: AtomicUsize,
+}
+
+static CHANNEL_POOL: OnceLock<Result<ChannelPool, String>> = OnceLock::new();
+
+impl ChannelPool {
+    fn new(url: &str, size: usize) -> Result<Self, String> {
+        let endpoint = Endpoint::from_shared(url.to_string())
+            .map_err(|e| format!("Invalid RocksDB service URL '{}': {}", url, e))?
+            .connect_timeout(CONNECT_TIMEOUT)
+            .tcp_nodelay(true)
+            .tcp_keepalive(Some(KEEP_ALIVE_INTERVAL))
+            .http2_keep_alive_interval(KEEP_ALIVE_INTERVAL)
+            .keep_alive_while_idle(true);
+
+        Ok(Self {
+            endpoint,
+            slots: (0..size).map(|_| RwLock::new(None)).collect(),
+            next: AtomicUsize::new(0),
+        })
+    }
+
+    /// Pick the next slot and return its channel, connecting lazily.
+    fn checkout(&self) -> (usize, Channel) {
+        let slot = self.next.fetch_add(1, Ordering::Relaxed) % self.slots.len();
+        if let Some(channel) = self.slots[slot].read().unwrap().as_ref() {
+            return (slot, channel.clone());
+        }
+
+        let mut guard = self.slots[slot].write().unwrap();
+        let channel = guard
+            .get_or_insert_with(|| self.endpoint.connect_lazy())
+            .clone();
+        (slot, channel)
+    }
+
+    /// Drop the channel in `slot` so the next checkout reconnects.
+    fn invalidate(&self, slot: usize) {
+        *self.slots[slot].write().unwrap() = None;
+    }
+}
+
+fn pool() -> Result<&'static ChannelPool, String> {
+    CHANNEL_POOL
+        .get_or_init(|| ChannelPool::new(&ROCKSDB_SERVICE_URL, *ROCKSDB_POOL_SIZE))
+        .as_ref()
+        .map_err(|e| e.clone())
+}
+
+/// Whether a failed call should be retried on a fresh connection.
+///
+/// `Unavailable` covers refused/reset connections; the "not ready" message
+/// is what tonic reports when the channel's worker task is gone, e.g. after
+/// the runtime that created it has shut down.
+fn is_transport_error(status: &Status) -> bool {
+    status.code() == Code::Unavailable
+        || (status.code() == Code::Unknown && status.message().starts_with("Service was not ready"))
+}
+
+// ===========================================
+// Call statistics
+// ===========================================
+
+/// Latency and retry counters for one RocksDB service operation.
+pub struct OpStats {
+    name: &'static str,
+    calls: AtomicU64,
+    retries: AtomicU64,
+    errors: AtomicU64,
+    total_latency_us: AtomicU64,
+    max_latency_us: AtomicU64,
+}
+
+impl OpStats {
+    const fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            calls: AtomicU64::new(0),
+            retries: AtomicU64::new(0),
+            errors: AtomicU64::new(0),
+            total_latency_us: AtomicU64::new(0),
+            max_latency_us: AtomicU64::new(0),
+        }
+    }
+
+    fn record(&self, elapsed: Duration, retries: u32, failed: bool) {
+        let us = elapsed.as_micros() as u64;
+        self.calls.fetch_add(1, Ordering::Relaxed);
+        self.retries.fetch_add(retries as u64, Ordering::Relaxed);
+        if failed {
+            self.errors.fetch_add(1, Ordering::Relaxed);
+        }
+        self.total_latency_us.fetch_add(us, Ordering::Relaxed);
+        self.max_latency_us.fetch_max(us, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> CallStats {
+        let calls = self.calls.load(Ordering::Relaxed);
+        let total = self.total_latency_us.load(Ordering::Relaxed);
+        CallStats {
+            op: self.name,
+            calls,
+            retries: self.retries.load(Ordering::Relaxed),
+            errors: self.errors.load(Ordering::Relaxed),
+            avg_latency_us: if calls > 0 { total / calls } else { 0 },
+            max_latency_us: self.max_latency_us.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// Point-in-time copy of an operation's counters.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct CallStats {
+    pub op: &'static str,
+    pub calls: u64,
+    pub retries: u64,
+    pub errors: u64,
+    pub avg_latency_us: u64,
+    pub max_latency_us: u64,
+}
+
+static PUT_STATS: OpStats = OpStats::new("put");
+static GET_STATS: OpStats = OpStats::new("get");
+static GET_BY_PREFIX_STATS: OpStats = OpStats::new("get_all_with_prefix");
+static DELETE_STATS: OpStats = OpStats::new("delete");
+static BATCH_PUT_STATS: OpStats = OpStats::new("batch_put");
+static HEALTH_STATS: OpStats = OpStats::new("health_check");
+static MULTI_GET_STATS: OpStats = OpStats::new("multi_get");
+static WRITE_BATCH_STATS: OpStats = OpStats::new("write_batch");
+static WATCH_STATS: OpStats = OpStats::new("watch");
+static SNAPSHOT_STATS: OpStats = OpStats::new("snapshot");
+
+/// Return per-operation call counts, retries and latencies since startup.
+pub fn call_stats() -> Vec<CallStats> {
+    [
+        &PUT_STATS,
+        &GET_STATS,
+        &GET_BY_PREFIX_STATS,
+        &DELETE_STATS,
+        &BATCH_PUT_STATS,
+        &HEALTH_STATS,
+        &MULTI_GET_STATS,
+        &WRITE_BATCH_STATS,
+        &WATCH_STATS,
+        &SNAPSHOT_STATS,
+    ]
+    .iter()
+    .map(|s| s.snapshot())
+    .collect()
+}
+
+/// Run one RPC against a pooled client, retrying transport failures with
+/// exponential backoff on a freshly connected channel.
+///
+/// # Arguments
+/// * `stats` - Counters to update for this operation.
+/// * `f` - Builds and sends the request; called once per attempt.
+async fn call<T, F, Fut>(stats: &OpStats, mut f: F) -> Result<T, String>
+where
+    F: FnMut(RocksDbServiceClient<Channel>) -> Fut,
+    Fut: Future<Output = Result<tonic::Response<T>, Status>>,
+{
+    let pool = match pool() {
+        Ok(pool) => pool,
+        Err(e) => {
+            let error_msg = format!("Failed to create client: {}", e);
+            logd!(5, "[RocksDB] {}", error_msg);
+            return Err(error_msg);
+        }
+    };
+
+    let start = Instant::now();
+    let mut attempt = 0;
+    let mut backoff = INITIAL_BACKOFF;
+
+    loop {
+        let (slot, channel) = pool.checkout();
+        match f(RocksDbServiceClient::new(channel)).await {
+            Ok(response) => {
+                stats.record(start.elapsed(), attempt, false);
+                return Ok(response.into_inner());
+            }
+            Err(status) if is_transport_error(&status) && attempt < MAX_RETRIES => {
+                pool.invalidate(slot);
+                attempt += 1;
+                if DEV {
+                    logd!(
+                        2,
+                        "[RocksDB] {} attempt {} failed ({}), retrying in {:?}",
+                        stats.name,
+                        attempt,
+                        status.message(),
+                        backoff
+                    );
+                }
+                tokio::time::sleep(backoff).await;
+                backoff *= 2;
+            }
+            Err(status) => {
+                if is_transport_error(&status) {
+                    pool.invalidate(slot);
+                }
+                stats.record(start.elapsed(), attempt, true);
+                let error_msg = format!("gRPC request failed: {}", status);
+                logd!(5, "[RocksDB] {}", error_msg);
+                return Err(error_msg);
+            }
+        }
+    }
 }
 
 const DEV: bool = false;
@@ -29,36 +274,21 @@ pub async fn put(key: &str, value: &str) -> Result<(), String> {
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let request = tonic::Request::new(PutRequest {
-                key: key.to_string(),
-                value: value.to_string(),
-            });
-
-            match client.put(request).await {
-                Ok(response) => {
-                    let put_response = response.into_inner();
-                    if put_response.success {
-                        Ok(())
-                    } else {
-                        let error_msg = put_response.error;
-                        logd!(5, "[RocksDB] Put failed: {}", error_msg);
-                        Err(error_msg)
-                    }
-                }
-                Err(e) => {
-                    let error_msg = format!("gRPC request failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
-                }
-            }
-        }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
-        }
+    let put_response = call(&PUT_STATS, |mut client| {
+        let request = tonic::Request::new(PutRequest {
+            key: key.to_string(),
+            value: value.to_string(),
+        });
+        async move { client.put(request).await }
+    })
+    .await?;
+
+    if put_response.success {
+        Ok(())
+    } else {
+        let error_msg = put_response.error;
+        logd!(5, "[RocksDB] Put failed: {}", error_msg);
+        Err(error_msg)
     }
 }
 
@@ -73,42 +303,27 @@ pub async fn get(key: &str) -> Result<String, String> {
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let request = tonic::Request::new(GetRequest {
-                key: key.to_string(),
-            });
-
-            match client.get(request).await {
-                Ok(response) => {
-                    let get_response = response.into_inner();
-                    if get_response.success {
-                        if DEV {
-                            logd!(
-                                1,
-                                "[RocksDB] Successfully retrieved key: {} (value length: {})",
-                                key,
-                                get_response.value.len()
-                            );
-                        }
-                        Ok(get_response.value)
-                    } else {
-                        logd!(5, "[RocksDB] Key not found: {}", key);
-                        Err("Key not found".to_string())
-                    }
-                }
-                Err(e) => {
-                    let error_msg = format!("gRPC request failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
-                }
-            }
-        }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
+    let get_response = call(&GET_STATS, |mut client| {
+        let request = tonic::Request::new(GetRequest {
+            key: key.to_string(),
+        });
+        async move { client.get(request).await }
+    })
+    .await?;
+
+    if get_response.success {
+        if DEV {
+            logd!(
+                1,
+                "[RocksDB] Successfully retrieved key: {} (value length: {})",
+                key,
+                get_response.value.len()
+            );
         }
+        Ok(get_response.value)
+    } else {
+        logd!(5, "[RocksDB] Key not found: {}", key);
+        Err("Key not found".to_string())
     }
 }
 
@@ -123,48 +338,68 @@ pub async fn get_all_with_prefix(prefix: &str) -> Result<Vec<(String, String)>,
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let request = tonic::Request::new(GetByPrefixRequest {
-                prefix: prefix.to_string(),
-                limit: 0, // 0 means no limit
-            });
-
-            match client.get_by_prefix(request).await {
-                Ok(response) => {
-                    let get_response = response.into_inner();
-                    if get_response.error.is_empty() {
-                        let result: Vec<(String, String)> = get_response
-                            .pairs
-                            .into_iter()
-                            .map(|kv| (kv.key, kv.value))
-                            .collect();
-                        if DEV {
-                            logd!(
-                                1,
-                                "[RocksDB] Successfully retrieved {} keys with prefix '{}'",
-                                result.len(),
-                                prefix
-                            );
-                        }
-                        Ok(result)
-                    } else {
-                        logd!(5, "[RocksDB] Error from service: {}", get_response.error);
-                        Err(get_response.error)
-                    }
-                }
-                Err(e) => {
-                    let error_msg = format!("gRPC request failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
-                }
-            }
-        }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
+    let get_response = call(&GET_BY_PREFIX_STATS, |mut client| {
+        let request = tonic::Request::new(GetByPrefixRequest {
+            prefix: prefix.to_string(),
+            limit: 0, // 0 means no limit
+            start_after: String::new(),
+            reverse: false,
+        });
+        async move { client.get_by_prefix(request).await }
+    })
+    .await?;
+
+    if get_response.error.is_empty() {
+        let result: Vec<(String, String)> = get_response
+            .pairs
+            .into_iter()
+            .map(|kv| (kv.key, kv.value))
+            .collect();
+        if DEV {
+            logd!(
+                1,
+                "[RocksDB] Successfully retrieved {} keys with prefix '{}'",
+                result.len(),
+                prefix
+            );
         }
+        Ok(result)
+    } else {
+        logd!(5, "[RocksDB] Error from service: {}", get_response.error);
+        Err(get_response.error)
+    }
+}
+
+/// Get up to `limit` key-value pairs with the specified prefix, highest key
+/// first, starting below `start_before` when it is non-empty
+///
+/// With keys that sort in version order this reads the newest entries of a
+/// family without fetching the older ones.
+pub async fn get_with_prefix_reverse(
+    prefix: &str,
+    start_before: &str,
+    limit: usize,
+) -> Result<Vec<(String, String)>, String> {
+    let get_response = call(&GET_BY_PREFIX_STATS, |mut client| {
+        let request = tonic::Request::new(GetByPrefixRequest {
+            prefix: prefix.to_string(),
+            limit: i32::try_from(limit).unwrap_or(i32::MAX),
+            start_after: start_before.to_string(),
+            reverse: true,
+        });
+        async move { client.get_by_prefix(request).await }
+    })
+    .await?;
+
+    if get_response.error.is_empty() {
+        Ok(get_response
+            .pairs
+            .into_iter()
+            .map(|kv| (kv.key, kv.value))
+            .collect())
+    } else {
+        logd!(5, "[RocksDB] Error from service: {}", get_response.error);
+        Err(get_response.error)
     }
 }
 
@@ -179,38 +414,23 @@ pub async fn delete(key: &str) -> Result<(), String> {
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let request = tonic::Request::new(DeleteRequest {
-                key: key.to_string(),
-            });
-
-            match client.delete(request).await {
-                Ok(response) => {
-                    let delete_response = response.into_inner();
-                    if delete_response.success {
-                        if DEV {
-                            logd!(1, "[RocksDB] Successfully deleted key: {}", key);
-                        }
-                        Ok(())
-                    } else {
-                        let error_msg = delete_response.error;
-                        logd!(5, "[RocksDB] Delete failed: {}", error_msg);
-                        Err(error_msg)
-                    }
-                }
-                Err(e) => {
-                    let error_msg = format!("gRPC request failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
-                }
-            }
-        }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
+    let delete_response = call(&DELETE_STATS, |mut client| {
+        let request = tonic::Request::new(DeleteRequest {
+            key: key.to_string(),
+        });
+        async move { client.delete(request).await }
+    })
+    .await?;
+
+    if delete_response.success {
+        if DEV {
+            logd!(1, "[RocksDB] Successfully deleted key: {}", key);
         }
+        Ok(())
+    } else {
+        let error_msg = delete_response.error;
+        logd!(5, "[RocksDB] Delete failed: {}", error_msg);
+        Err(error_msg)
     }
 }
 
@@ -225,48 +445,299 @@ pub async fn batch_put(items: Vec<(String, String)>) -> Result<(), String> {
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let pairs: Vec<KeyValue> = items
-                .into_iter()
-                .map(|(key, value)| KeyValue { key, value })
-                .collect();
-
-            let request = tonic::Request::new(BatchPutRequest { pairs });
-
-            match client.batch_put(request).await {
-                Ok(response) => {
-                    let batch_response = response.into_inner();
-                    if batch_response.success {
-                        if DEV {
-                            logd!(
-                                1,
-                                "[RocksDB] Successfully stored {} items in batch",
-                                batch_response.processed_count
-                            );
-                        }
-                        Ok(())
-                    } else {
-                        let error_msg = batch_response.error;
-                        logd!(5, "[RocksDB] Batch put failed: {}", error_msg);
-                        Err(error_msg)
-                    }
+    let pairs: Vec<KeyValue> = items
+        .into_iter()
+        .map(|(key, value)| KeyValue { key, value })
+        .collect();
+
+    let batch_response = call(&BATCH_PUT_STATS, |mut client| {
+        let request = tonic::Request::new(BatchPutRequest {
+            pairs: pairs.clone(),
+        });
+        async move { client.batch_put(request).await }
+    })
+    .await?;
+
+    if batch_response.success {
+        if DEV {
+            logd!(
+                1,
+                "[RocksDB] Successfully stored {} items in batch",
+                batch_response.processed_count
+            );
+        }
+        Ok(())
+    } else {
+        let error_msg = batch_response.error;
+        logd!(5, "[RocksDB] Batch put failed: {}", error_msg);
+        Err(error_msg)
+    }
+}
+
+/// Get several keys in one round-trip from the gRPC RocksDB service
+///
+/// Returns one entry per requested key, in request order; missing keys are
+/// `None`. All keys are read from the same consistent view.
+pub async fn multi_get(keys: &[String]) -> Result<Vec<Option<String>>, String> {
+    if DEV {
+        logd!(
+            1,
+            "[RocksDB] Multi-getting {} keys from service: {}",
+            keys.len(),
+            *ROCKSDB_SERVICE_URL
+        );
+    }
+
+    if keys.is_empty() {
+        return Ok(Vec::new());
+    }
+
+    let multi_response = call(&MULTI_GET_STATS, |mut client| {
+        let request = tonic::Request::new(MultiGetRequest {
+            keys: keys.to_vec(),
+        });
+        async move { client.multi_get(request).await }
+    })
+    .await?;
+
+    if !multi_response.error.is_empty() {
+        logd!(5, "[RocksDB] Multi-get failed: {}", multi_response.error);
+        return Err(multi_response.error);
+    }
+
+    Ok(multi_response
+        .results
+        .into_iter()
+        .map(|r| if r.found { Some(r.value) } else { None })
+        .collect())
+}
+
+/// A single mutation applied by [`write_batch`]
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum BatchOp {
+    Put(String, String),
+    Delete(String),
+}
+
+/// Apply a mix of puts and deletes atomically using gRPC RocksDB service
+///
+/// Either every operation is applied or none is; operations on the same key
+/// take effect in order.
+pub async fn write_batch(ops: Vec<BatchOp>) -> Result<(), String> {
+    if DEV {
+        logd!(
+            1,
+            "[RocksDB] Writing batch of {} operations to service: {}",
+            ops.len(),
+            *ROCKSDB_SERVICE_URL
+        );
+    }
+
+    if ops.is_empty() {
+        return Ok(());
+    }
+
+    let ops: Vec<WriteOp> = ops
+        .into_iter()
+        .map(|op| match op {
+            BatchOp::Put(key, value) => WriteOp {
+                kind: write_op::Kind::Put as i32,
+                key,
+                value,
+            },
+            BatchOp::Delete(key) => WriteOp {
+                kind: write_op::Kind::Delete as i32,
+                key,
+                value: String::new(),
+            },
+        })
+        .collect();
+
+    let batch_response = call(&WRITE_BATCH_STATS, |mut client| {
+        let request = tonic::Request::new(WriteBatchRequest { ops: ops.clone() });
+        async move { client.write_batch(request).await }
+    })
+    .await?;
+
+    if batch_response.success {
+        if DEV {
+            logd!(
+                1,
+                "[RocksDB] Successfully applied {} operations in batch",
+                batch_response.processed_count
+            );
+        }
+        Ok(())
+    } else {
+        let error_msg = batch_response.error;
+        logd!(5, "[RocksDB] Write batch failed: {}", error_msg);
+        Err(error_msg)
+    }
+}
+
+/// A change to a watched key
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum WatchEvent {
+    Put { key: String, value: String },
+    Delete { key: String },
+}
+
+impl WatchEvent {
+    pub fn key(&self) -> &str {
+        match self {
+            WatchEvent::Put { key, .. } | WatchEvent::Delete { key } => key,
+        }
+    }
+}
+
+/// Events of one committed write, as delivered by [`Watcher::next`]
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct WatchBatch {
+    /// Revision of the commit; strictly increasing along a stream
+    pub revision: u64,
+    pub events: Vec<WatchEvent>,
+    /// Events describe the initial contents rather than a change
+    pub initial: bool,
+    /// Last batch of the initial contents; live changes follow
+    pub synced: bool,
+}
+
+impl From<WatchResponse> for WatchBatch {
+    fn from(response: WatchResponse) -> Self {
+        let events = response
+            .events
+            .into_iter()
+            .map(|event| match event.kind() {
+                crate::rocksdbservice::watch_event::Kind::Put => WatchEvent::Put {
+                    key: event.key,
+                    value: event.value,
+                },
+                crate::rocksdbservice::watch_event::Kind::Delete => {
+                    WatchEvent::Delete { key: event.key }
                 }
-                Err(e) => {
-                    let error_msg = format!("gRPC request failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
+            })
+            .collect();
+        WatchBatch {
+            revision: response.revision,
+            events,
+            initial: response.initial,
+            synced: response.synced,
+        }
+    }
+}
+
+/// Open change stream returned by [`watch`]
+pub struct Watcher {
+    stream: tonic::Streaming<WatchResponse>,
+    /// Live batches at or below this revision are already covered by a
+    /// snapshot and skipped
+    after_revision: u64,
+}
+
+impl Watcher {
+    /// Wait for the next committed change.
+    ///
+    /// Returns `Ok(None)` when the service closes the stream. An error means
+    /// events may have been missed (e.g. the watcher fell behind); callers
+    /// should re-`watch` with `send_initial` and rebuild their view.
+    pub async fn next(&mut self) -> Result<Option<WatchBatch>, String> {
+        loop {
+            match self.stream.message().await {
+                Ok(Some(response))
+                    if !response.initial && response.revision <= self.after_revision =>
+                {
+                    continue
+                }
+                Ok(response) => return Ok(response.map(WatchBatch::from)),
+                Err(status) => {
+                    let error_msg = format!("Watch stream failed: {}", status);
+                    logd!(4, "[RocksDB] {}", error_msg);
+                    return Err(error_msg);
                 }
             }
         }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
-        }
     }
 }
 
+/// Subscribe to puts and deletes of keys under `prefix` using gRPC RocksDB service
+///
+/// With `send_initial`, the stream starts with the current contents of the
+/// prefix as `initial` batches, ending with one marked `synced`. Following
+/// batches carry only changes committed after that snapshot, so a consumer
+/// can keep an exact cache without polling.
+pub async fn watch(prefix: &str, send_initial: bool) -> Result<Watcher, String> {
+    if DEV {
+        logd!(
+            1,
+            "[RocksDB] Watching prefix '{}' on service: {}",
+            prefix,
+            *ROCKSDB_SERVICE_URL
+        );
+    }
+
+    let stream = call(&WATCH_STATS, |mut client| {
+        let request = tonic::Request::new(WatchRequest {
+            prefix: prefix.to_string(),
+            send_initial,
+        });
+        async move { client.watch(request).await }
+    })
+    .await?;
+
+    Ok(Watcher {
+        stream,
+        after_revision: 0,
+    })
+}
+
+/// Export every key under `prefixes` at one revision using gRPC RocksDB service
+///
+/// An empty `prefixes` exports the whole store. The entries arrive in the
+/// compact [`Snapshot`] encoding and are all read from the same view.
+pub async fn snapshot(prefixes: &[&str]) -> Result<Snapshot, String> {
+    if DEV {
+        logd!(
+            1,
+            "[RocksDB] Taking snapshot of {:?} from service: {}",
+            prefixes,
+            *ROCKSDB_SERVICE_URL
+        );
+    }
+
+    let prefixes: Vec<String> = prefixes.iter().map(|p| p.to_string()).collect();
+    let snapshot_response = call(&SNAPSHOT_STATS, |mut client| {
+        let request = tonic::Request::new(SnapshotRequest {
+            prefixes: prefixes.clone(),
+        });
+        async move { client.snapshot(request).await }
+    })
+    .await?;
+
+    if !snapshot_response.error.is_empty() {
+        logd!(5, "[RocksDB] Snapshot failed: {}", snapshot_response.error);
+        return Err(snapshot_response.error);
+    }
+    Snapshot::decode(snapshot_response.revision, &snapshot_response.data)
+}
+
+/// Load `prefixes` from one snapshot and keep a watcher per prefix that
+/// continues right after it
+///
+/// The watchers subscribe before the snapshot is taken, so no commit can
+/// fall between the two; batches the snapshot already contains are skipped.
+/// This replaces one `watch(prefix, true)` scan per prefix on startup.
+pub async fn snapshot_and_watch(prefixes: &[&str]) -> Result<(Snapshot, Vec<Watcher>), String> {
+    let mut watchers = Vec::with_capacity(prefixes.len());
+    for prefix in prefixes {
+        watchers.push(watch(prefix, false).await?);
+    }
+    let snapshot = snapshot(prefixes).await?;
+    for watcher in &mut watchers {
+        watcher.after_revision = snapshot.revision();
+    }
+    Ok((snapshot, watchers))
+}
+
 /// Health check for the gRPC RocksDB service
 pub async fn health_check() -> Result<bool, String> {
     if DEV {
@@ -277,34 +748,107 @@ pub async fn health_check() -> Result<bool, String> {
         );
     }
 
-    match RocksDbServiceClient::connect(ROCKSDB_SERVICE_URL.clone()).await {
-        Ok(mut client) => {
-            let request = tonic::Request::new(HealthRequest {});
-
-            match client.health(request).await {
-                Ok(response) => {
-                    let health_response = response.into_inner();
-                    let is_healthy = health_response.status == "healthy";
-                    if DEV {
-                        logd!(
-                            1,
-                            "[RocksDB] Health check result: {}",
-                            health_response.status
-                        );
-                    }
-                    Ok(is_healthy)
-                }
-                Err(e) => {
-                    let error_msg = format!("Health check failed: {}", e);
-                    logd!(5, "[RocksDB] {}", error_msg);
-                    Err(error_msg)
-                }
-            }
-        }
-        Err(e) => {
-            let error_msg = format!("Failed to create client: {}", e);
-            logd!(5, "[RocksDB] {}", error_msg);
-            Err(error_msg)
-        }
+    let health_response = call(&HEALTH_STATS, |mut client| {
+        let request = tonic::Request::new(HealthRequest {});
+        async move { client.health(request).await }
+    })
+    .await
+    .map_err(|e| e.replace("gRPC request failed", "Health check failed"))?;
+
+    let is_healthy = health_response.status == "healthy";
+    if DEV {
+        logd!(
+            1,
+            "[RocksDB] Health check result: {}",
+            health_response.status
+        );
+    }
+    Ok(is_healthy)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_is_transport_error() {
+        assert!(is_transport_error(&Status::unavailable(
+            "connection refused"
+        )));
+        assert!(is_transport_error(&Status::unknown(
+            "Service was not ready: buffer's worker closed unexpectedly"
+        )));
+        assert!(!is_transport_error(&Status::unknown("other")));
+        assert!(!is_transport_error(&Status::invalid_argument("bad key")));
+    }
+
+    #[tokio::test]
+    async fn test_pool_checkout_round_robin() {
+        let pool = ChannelPool::new("http://127.0.0.1:1", 3).unwrap();
+        let slots: Vec<usize> = (0..6).map(|_| pool.checkout().0).collect();
+        assert_eq!(slots, vec![0, 1, 2, 0, 1, 2]);
+        assert!(pool.slots.iter().all(|s| s.read().unwrap().is_some()));
+
+        pool.invalidate(1);
+        assert!(pool.slots[1].read().unwrap().is_none());
+    }
+
+    #[test]
+    fn test_pool_rejects_invalid_url() {
+        assert!(ChannelPool::new("not a url", 1).is_err());
+    }
+
+    #[test]
+    fn test_watch_batch_from_response() {
+        use crate::rocksdbservice::{watch_event, WatchEvent as ProtoWatchEvent};
+
+        let response = WatchResponse {
+            revision: 42,
+            events: vec![
+                ProtoWatchEvent {
+                    kind: watch_event::Kind::Put as i32,
+                    key: "Package/a".to_string(),
+                    value: "yaml".to_string(),
+                },
+                ProtoWatchEvent {
+                    kind: watch_event::Kind::Delete as i32,
+                    key: "Package/b".to_string(),
+                    value: String::new(),
+                },
+            ],
+            initial: false,
+            synced: false,
+        };
+
+        let batch = WatchBatch::from(response);
+        assert_eq!(batch.revision, 42);
+        assert_eq!(
+            batch.events,
+            vec![
+                WatchEvent::Put {
+                    key: "Package/a".to_string(),
+                    value: "yaml".to_string()
+                },
+                WatchEvent::Delete {
+                    key: "Package/b".to_string()
+                },
+            ]
+        );
+        assert_eq!(batch.events[1].key(), "Package/b");
+    }
+
+    #[test]
+    fn test_op_stats_record() {
+        let stats = OpStats::new("test");
+        stats.record(Duration::from_micros(100), 0, false);
+        stats.record(Duration::from_micros(300), 2, true);
+
+        let snap = stats.snapshot();
+        assert_eq!(snap.op, "test");
+        assert_eq!(snap.calls, 2);
+        assert_eq!(snap.retries, 2);
+        assert_eq!(snap.errors, 1);
+        assert_eq!(snap.avg_latency_us, 200);
+        assert_eq!(snap.max_latency_us, 300);
     }
 }
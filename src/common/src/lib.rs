@@ -7,11 +7,23 @@ pub use crate::error::Result;
 pub mod error;
 pub mod etcd;
 pub mod setting;
+pub mod snapshot;
 pub mod spec;
+pub mod startup;
+pub mod trace;
 
 // gRPC protobuf module for RocksDB service
 pub mod rocksdbservice {
     include!("generated/rocksdbservice.rs");
+
+    /// Longest key accepted by the RocksDB service
+    pub const MAX_KEY_LEN: usize = 1024;
+
+    /// Keys must be non-empty, at most [`MAX_KEY_LEN`] bytes and free of
+    /// template characters.
+    pub fn is_valid_key(key: &str) -> bool {
+        !key.is_empty() && key.len() <= MAX_KEY_LEN && !key.contains(['<', '>', '?', '{', '}'])
+    }
 }
 
 fn open_server(port: u16) -> String {
@@ -78,6 +90,8 @@ pub mod filtergateway {
 pub mod monitoringserver {
     include!("generated/monitoringserver.rs");
 
+    pub mod telemetry;
+
     pub fn open_server() -> String {
         super::open_server(47003)
     }
@@ -5,26 +5,44 @@
 use bytes::BytesMut;
 use prost::Message;
 use std::collections::{HashMap, VecDeque};
-use std::sync::{Arc, OnceLock};
+use std::sync::atomic::{AtomicI32, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
 use std::time::Duration;
 use tokio::net::UnixDatagram;
-use tokio::runtime::Handle;
 use tokio::sync::mpsc::error::TrySendError;
 use tokio::sync::mpsc::{channel, Receiver, Sender};
-use tokio::sync::Mutex;
 
 use crate::logd::LogEnvelope;
 
 /// Global singleton that holds the active async logger instance.
 static LOGGER: OnceLock<AsyncLogger> = OnceLock::new();
 
+/// Lowest level that is formatted and enqueued; everything by default.
+static MIN_LEVEL: AtomicI32 = AtomicI32::new(1);
+
+/// Environment variable read by `init_async_logger` for the minimum level.
+pub const LOGD_LEVEL_ENV: &str = "LOGD_LEVEL";
+
+/// Message waiting in a queue. The tag is the same for every message of a
+/// process, so it is only attached when the envelope is encoded.
+struct LogEntry {
+    ts_real_ns: u64,
+    level: i32,
+    message: String,
+}
+
 /// Bounded FIFO queue that drops the oldest entry when capacity is reached.
-struct BoundedQueue<LogEnvelope> {
-    inner: Mutex<VecDeque<LogEnvelope>>,
+///
+/// Pushing never awaits, so synchronous call sites enqueue directly instead
+/// of spawning a task per message.
+struct BoundedQueue<T> {
+    inner: Mutex<VecDeque<T>>,
     capacity: usize,
+    /// Entries discarded because the queue was full.
+    dropped: AtomicU64,
 }
 
-impl BoundedQueue<LogEnvelope> {
+impl<T> BoundedQueue<T> {
     /// Construct a queue with the given capacity.
     ///
     /// # Arguments
@@ -33,17 +51,23 @@ impl BoundedQueue<LogEnvelope> {
         Self {
             inner: Mutex::new(VecDeque::with_capacity(capacity)),
             capacity,
+            dropped: AtomicU64::new(0),
         }
     }
 
+    fn lock(&self) -> std::sync::MutexGuard<'_, VecDeque<T>> {
+        self.inner.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
     /// Push an item, dropping the oldest element if the queue is full.
     ///
     /// # Arguments
-    /// * `item` - Envelope to enqueue.
-    async fn push_drop_oldest(&self, item: LogEnvelope) {
-        let mut guard = self.inner.lock().await;
+    /// * `item` - Entry to enqueue.
+    fn push_drop_oldest(&self, item: T) {
+        let mut guard = self.lock();
         if guard.len() == self.capacity {
             guard.pop_front();
+            self.dropped.fetch_add(1, Ordering::Relaxed);
         }
         guard.push_back(item);
     }
@@ -51,29 +75,34 @@ impl BoundedQueue<LogEnvelope> {
     /// Drain all pending items, returning them as a `Vec`.
     ///
     /// # Returns
-    /// All enqueued envelopes in FIFO order.
-    async fn drain(&self) -> Vec<LogEnvelope> {
-        let mut guard = self.inner.lock().await;
-        guard.drain(..).collect()
+    /// All enqueued entries in FIFO order.
+    fn drain(&self) -> Vec<T> {
+        self.lock().drain(..).collect()
     }
 
     /// Reinsert a batch of items at the front so they are retried first.
     ///
     /// # Arguments
-    /// * `items` - Envelopes to re-queue.
-    async fn push_front_batch(&self, mut items: Vec<LogEnvelope>) {
+    /// * `items` - Entries to re-queue.
+    fn push_front_batch(&self, mut items: Vec<T>) {
         if items.is_empty() {
             return;
         }
 
-        let mut guard = self.inner.lock().await;
+        let mut guard = self.lock();
         while let Some(item) = items.pop() {
             guard.push_front(item);
             if guard.len() > self.capacity {
                 guard.pop_back();
+                self.dropped.fetch_add(1, Ordering::Relaxed);
             }
         }
     }
+
+    /// Number of entries dropped since the queue was created.
+    fn dropped(&self) -> u64 {
+        self.dropped.load(Ordering::Relaxed)
+    }
 }
 
 /// Logical channels supported by the logger.
@@ -99,20 +128,29 @@ enum DrainState {
 
 /// Aggregated state for the global async logger instance.
 pub struct AsyncLogger {
-    q: HashMap<Ch, Arc<BoundedQueue<LogEnvelope>>>,
+    q: HashMap<Ch, Arc<BoundedQueue<LogEntry>>>,
     notify_tx: Sender<()>,
-    tag: String,
 }
 
 /// Initialize the async logger for the given tag and spawn the worker task.
 ///
+/// The minimum level is taken from `LOGD_LEVEL` when set, either as a
+/// number (`3`) or a level letter (`I`).
+///
 /// # Arguments
 /// * `tag` - Tag field to stamp on outgoing envelopes.
 ///
 /// # Errors
 /// Propagates I/O errors from socket creation or queue setup.
 pub async fn init_async_logger(tag: &str) -> std::io::Result<()> {
-    let logd_q = Arc::new(BoundedQueue::<LogEnvelope>::new(8192));
+    if let Some(level) = std::env::var(LOGD_LEVEL_ENV)
+        .ok()
+        .and_then(|v| parse_level(&v))
+    {
+        set_min_level(level);
+    }
+
+    let logd_q = Arc::new(BoundedQueue::<LogEntry>::new(8192));
     let (tx, rx) = channel::<()>(1);
 
     let mut q = HashMap::new();
@@ -121,45 +159,88 @@ pub async fn init_async_logger(tag: &str) -> std::io::Result<()> {
     let logger = AsyncLogger {
         q,
         notify_tx: tx.clone(),
-        tag: tag.to_string(),
     };
     let _ = LOGGER.set(logger);
 
-    spawn_worker(rx, logd_q).await;
+    spawn_worker(rx, logd_q, tag.to_string()).await;
 
     Ok(())
 }
 
-/// Convenience API for async contexts: await enqueue completion and log
-/// failures to stderr.
+/// Set the lowest level that is formatted and enqueued.
+///
+/// # Arguments
+/// * `level` - Severity level code, 1 (verbose) to 6 (fatal).
+pub fn set_min_level(level: i32) {
+    MIN_LEVEL.store(level, Ordering::Relaxed);
+}
+
+/// Current minimum level.
+pub fn min_level() -> i32 {
+    MIN_LEVEL.load(Ordering::Relaxed)
+}
+
+/// Whether a message of `level` would be kept. Checked by `logd!` before
+/// the message is formatted.
+///
+/// # Arguments
+/// * `level` - Severity level code.
+#[inline]
+pub fn enabled(level: i32) -> bool {
+    level >= MIN_LEVEL.load(Ordering::Relaxed) && LOGGER.get().is_some()
+}
+
+/// Number of messages dropped because the queue was full.
+pub fn dropped_count() -> u64 {
+    LOGGER
+        .get()
+        .and_then(|gl| gl.q.get(&Ch::Logd))
+        .map(|q| q.dropped())
+        .unwrap_or(0)
+}
+
+/// Parse a level given as a number or as its letter.
+///
+/// # Arguments
+/// * `value` - `1`..`6` or one of `V`, `D`, `I`, `W`, `E`, `F`.
+pub fn parse_level(value: &str) -> Option<i32> {
+    let value = value.trim();
+    if let Ok(level) = value.parse::<i32>() {
+        return (1..=6).contains(&level).then_some(level);
+    }
+    match value.to_ascii_uppercase().as_str() {
+        "V" | "VERBOSE" => Some(1),
+        "D" | "DEBUG" => Some(2),
+        "I" | "INFO" => Some(3),
+        "W" | "WARN" => Some(4),
+        "E" | "ERROR" => Some(5),
+        "F" | "FATAL" => Some(6),
+        _ => None,
+    }
+}
+
+/// Convenience API for async contexts: enqueue and log failures to stderr.
 ///
 /// # Arguments
 /// * `level` - Severity level code.
 /// * `message` - Formatted log message.
 pub async fn log(level: i32, message: String) {
-    if let Err(err) = enqueue(level, message).await {
-        crate::logd!(6, "logger enqueue failed: {err}");
-    }
+    log_nowait(level, message);
 }
 
-/// Fire-and-forget API for synchronous call sites. Spawns a task on the
-/// current Tokio runtime (if any) to enqueue the log message.
+/// Fire-and-forget API for synchronous call sites. Enqueuing never blocks
+/// on the worker, so no task is spawned.
 ///
 /// # Arguments
 /// * `level` - Severity level code.
 /// * `message` - Formatted log message.
 pub fn log_nowait(level: i32, message: String) {
-    match Handle::try_current() {
-        Ok(handle) => {
-            handle.spawn(async move {
-                if let Err(err) = enqueue(level, message).await {
-                    crate::logd!(6, "logger enqueue failed: {err}");
-                }
-            });
-        }
-        Err(_) => {
-            crate::logd!(4, "logger not running inside a Tokio runtime; dropping log");
-        }
+    if level < min_level() {
+        return;
+    }
+    // Reporting through logd! here could recurse, use stderr instead
+    if let Err(err) = push(level, message) {
+        eprintln!("logger enqueue failed: {err}");
     }
 }
 
@@ -173,19 +254,22 @@ pub fn log_nowait(level: i32, message: String) {
 /// Returns an error when the logger is not initialized or the notify
 /// channel has been closed.
 pub async fn enqueue(level: i32, message: String) -> std::io::Result<()> {
+    push(level, message)
+}
+
+fn push(level: i32, message: String) -> std::io::Result<()> {
     let Some(gl) = LOGGER.get() else {
         return Err(std::io::Error::other("logger not initialized"));
     };
 
-    let env = LogEnvelope {
+    let entry = LogEntry {
         ts_real_ns: real_time_ns(),
-        tag: gl.tag.clone(),
         level,
         message,
     };
 
     let q = gl.q.get(&Ch::Logd).unwrap();
-    q.push_drop_oldest(env).await;
+    q.push_drop_oldest(entry);
 
     match gl.notify_tx.try_send(()) {
         Ok(()) | Err(TrySendError::Full(_)) => Ok(()),
@@ -201,17 +285,31 @@ pub async fn enqueue(level: i32, message: String) -> std::io::Result<()> {
 ///
 /// # Arguments
 /// * `notify_rx` - Receiver for edge-triggered wakeups.
-/// * `logd_q` - Queue storing outgoing envelopes.
-async fn spawn_worker(mut notify_rx: Receiver<()>, logd_q: Arc<BoundedQueue<LogEnvelope>>) {
+/// * `logd_q` - Queue storing outgoing entries.
+/// * `tag` - Tag stamped on every envelope.
+async fn spawn_worker(
+    mut notify_rx: Receiver<()>,
+    logd_q: Arc<BoundedQueue<LogEntry>>,
+    tag: String,
+) {
     tokio::spawn(async move {
         let mut socks: HashMap<Ch, (UnixDatagram, bool)> = HashMap::new();
 
         let sock = UnixDatagram::unbound().expect("unbound sock");
         socks.insert(Ch::Logd, (sock, false));
 
+        // Reused for every message so the tag is allocated only once
+        let mut env = LogEnvelope {
+            ts_real_ns: 0,
+            tag,
+            level: 0,
+            message: String::new(),
+        };
+        let mut buf = BytesMut::new();
+
         while notify_rx.recv().await.is_some() {
             loop {
-                match drain_channel(Ch::Logd, &logd_q, &mut socks).await {
+                match drain_channel(Ch::Logd, &logd_q, &mut socks, &mut env, &mut buf).await {
                     DrainState::Idle => break,
                     DrainState::Pending => continue,
                 }
@@ -219,7 +317,7 @@ async fn spawn_worker(mut notify_rx: Receiver<()>, logd_q: Arc<BoundedQueue<LogE
         }
 
         while matches!(
-            drain_channel(Ch::Logd, &logd_q, &mut socks).await,
+            drain_channel(Ch::Logd, &logd_q, &mut socks, &mut env, &mut buf).await,
             DrainState::Pending
         ) {}
     });
@@ -232,16 +330,20 @@ async fn spawn_worker(mut notify_rx: Receiver<()>, logd_q: Arc<BoundedQueue<LogE
 /// * `ch` - Logical channel identifier.
 /// * `q` - Queue backing the channel.
 /// * `socks` - Cached sockets paired with connection status flags.
+/// * `env` - Envelope reused for encoding, carries the tag.
+/// * `buf` - Encode buffer reused across messages.
 ///
 /// # Returns
 /// `DrainState::Idle` when no work remains, otherwise `DrainState::Pending`.
 async fn drain_channel(
     ch: Ch,
-    q: &BoundedQueue<LogEnvelope>,
+    q: &BoundedQueue<LogEntry>,
     socks: &mut HashMap<Ch, (UnixDatagram, bool)>,
+    env: &mut LogEnvelope,
+    buf: &mut BytesMut,
 ) -> DrainState {
     let (sock, connected) = socks.get_mut(&ch).unwrap();
-    let batch = q.drain().await;
+    let batch = q.drain();
 
     if batch.is_empty() {
         return DrainState::Idle;
@@ -251,24 +353,32 @@ async fn drain_channel(
         if sock.connect(ch.socket_path()).is_ok() {
             *connected = true;
         } else {
-            q.push_front_batch(batch).await;
+            q.push_front_batch(batch);
             tokio::time::sleep(Duration::from_millis(50)).await;
             return DrainState::Pending;
         }
     }
 
     let mut iter = batch.into_iter();
-    while let Some(env) = iter.next() {
-        print_stdout(&env);
-        let mut buf = BytesMut::with_capacity(env.encoded_len());
-        if env.encode(&mut buf).is_err() {
+    while let Some(entry) = iter.next() {
+        env.ts_real_ns = entry.ts_real_ns;
+        env.level = entry.level;
+        env.message = entry.message;
+        print_stdout(env);
+
+        buf.clear();
+        if env.encode(buf).is_err() {
             continue;
         }
-        if sock.send(&buf).await.is_err() {
+        if sock.send(&buf[..]).await.is_err() {
             *connected = false;
-            let mut retry_items = vec![env];
+            let mut retry_items = vec![LogEntry {
+                ts_real_ns: env.ts_real_ns,
+                level: env.level,
+                message: std::mem::take(&mut env.message),
+            }];
             retry_items.extend(iter);
-            q.push_front_batch(retry_items).await;
+            q.push_front_batch(retry_items);
             tokio::time::sleep(Duration::from_millis(50)).await;
             return DrainState::Pending;
         }
@@ -284,8 +394,8 @@ fn print_stdout(env: &LogEnvelope) {
     let sys_time = UNIX_EPOCH + Duration::from_nanos(env.ts_real_ns);
     let chrono_time: DateTime<Local> = DateTime::from(sys_time);
     let time_str = chrono_time.format("%Y-%m-%d %H:%M:%S%.3f");
-    let tag = env.tag.clone();
-    let message = env.message.clone();
+    let tag = &env.tag;
+    let message = &env.message;
 
     let level = match env.level {
         1 => "V",
@@ -311,3 +421,41 @@ fn real_time_ns() -> u64 {
         (ts.tv_sec as u64) * 1_000_000_000u64 + (ts.tv_nsec as u64)
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_queue_counts_dropped_entries() {
+        let q = BoundedQueue::new(2);
+        q.push_drop_oldest(1);
+        q.push_drop_oldest(2);
+        q.push_drop_oldest(3);
+        assert_eq!(q.dropped(), 1);
+        assert_eq!(q.drain(), vec![2, 3]);
+
+        q.push_drop_oldest(4);
+        q.push_front_batch(vec![1, 2]);
+        assert_eq!(q.dropped(), 2);
+        assert_eq!(q.drain(), vec![1, 2]);
+    }
+
+    #[test]
+    fn test_parse_level() {
+        assert_eq!(parse_level("3"), Some(3));
+        assert_eq!(parse_level("w"), Some(4));
+        assert_eq!(parse_level("error"), Some(5));
+        assert_eq!(parse_level("7"), None);
+        assert_eq!(parse_level("loud"), None);
+    }
+
+    #[test]
+    fn test_min_level_gates_enabled() {
+        let previous = min_level();
+        set_min_level(6);
+        assert_eq!(min_level(), 6);
+        assert!(!enabled(5));
+        set_min_level(previous);
+    }
+}
@@ -2,14 +2,19 @@
 
 /// Enqueue a formatted message into the async logger without awaiting.
 ///
+/// The arguments are only formatted when `$level` passes the logger's
+/// minimum level (see `logger::set_min_level`), so disabled levels cost one
+/// atomic load.
+///
 /// # Arguments
 /// * `$level` - Integer log level.
 /// * `$($arg:tt)*` - `format!`-style tokens that build the message body.
 #[macro_export]
 macro_rules! logd {
     ($level:expr, $($arg:tt)*) => {{
-        $crate::logd::logger::log_nowait(
-            $level, format!($($arg)*)
-        );
+        let level: i32 = $level;
+        if $crate::logd::logger::enabled(level) {
+            $crate::logd::logger::log_nowait(level, format!($($arg)*));
+        }
     }};
 }
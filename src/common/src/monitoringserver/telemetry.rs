@@ -0,0 +1,579 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Delta encoding of the `StreamTelemetry` RPC
+//!
+//! NodeAgent feeds the full container view of its node to a
+//! [`TelemetryEncoder`] every tick and sends the resulting frames, which only
+//! carry containers whose info or stats changed. MonitoringServer applies
+//! them to a [`TelemetryDecoder`] to rebuild the same view. Every
+//! `keyframe_interval` frames, and whenever the stream is reopened, a
+//! keyframe resends everything so both sides cannot drift apart.
+
+use super::{
+    ContainerInfo, ContainerList, ContainerStatsDelta, ContainerTelemetry, NetworkStatsDelta,
+    NodeInfo, TelemetryFrame,
+};
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::fmt;
+
+/// Frames between keyframes when NodeAgent sends one frame per second
+pub const DEFAULT_KEYFRAME_INTERVAL: u64 = 30;
+
+/// Counters of one container network
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct NetworkSample {
+    pub rx_bytes: u64,
+    pub rx_packets: u64,
+    pub rx_errors: u64,
+    pub rx_dropped: u64,
+    pub tx_bytes: u64,
+    pub tx_packets: u64,
+    pub tx_errors: u64,
+    pub tx_dropped: u64,
+}
+
+impl fmt::Display for NetworkSample {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "rx_bytes: {}, rx_packets: {}, rx_errors: {}, rx_dropped: {}, tx_bytes: {}, tx_packets: {}, tx_errors: {}, tx_dropped: {}",
+            self.rx_bytes,
+            self.rx_packets,
+            self.rx_errors,
+            self.rx_dropped,
+            self.tx_bytes,
+            self.tx_packets,
+            self.tx_errors,
+            self.tx_dropped
+        )
+    }
+}
+
+/// Typed stats of one running container
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct StatsSample {
+    pub cpu_total_usage: u64,
+    pub cpu_kernel_usage: u64,
+    pub cpu_user_usage: u64,
+    pub memory_usage: u64,
+    pub memory_limit: u64,
+    pub networks: BTreeMap<String, NetworkSample>,
+}
+
+/// The `ContainerInfo.stats` map of a sample, `None` if stats are unavailable
+pub fn stats_map(sample: Option<&StatsSample>) -> HashMap<String, String> {
+    let mut stats = HashMap::new();
+    let Some(sample) = sample else {
+        stats.insert("Status".to_string(), "StatsUnavailable".to_string());
+        return stats;
+    };
+    stats.insert(
+        "CpuTotalUsage".to_string(),
+        sample.cpu_total_usage.to_string(),
+    );
+    stats.insert(
+        "CpuUsageInKernelMode".to_string(),
+        sample.cpu_kernel_usage.to_string(),
+    );
+    stats.insert(
+        "CpuUsageInUserMode".to_string(),
+        sample.cpu_user_usage.to_string(),
+    );
+    stats.insert("MemoryUsage".to_string(), sample.memory_usage.to_string());
+    stats.insert("MemoryLimit".to_string(), sample.memory_limit.to_string());
+    let networks = if sample.networks.is_empty() {
+        "None".to_string()
+    } else {
+        sample
+            .networks
+            .iter()
+            .map(|(name, net)| format!("{}: {{{}}}", name, net))
+            .collect::<Vec<_>>()
+            .join(", ")
+    };
+    stats.insert("Networks".to_string(), networks);
+    stats
+}
+
+fn delta(old: u64, new: u64) -> i64 {
+    (new as i64).wrapping_sub(old as i64)
+}
+
+fn undelta(old: u64, delta: i64) -> u64 {
+    (old as i64).wrapping_add(delta) as u64
+}
+
+fn network_delta(old: &NetworkSample, new: &NetworkSample) -> NetworkStatsDelta {
+    NetworkStatsDelta {
+        rx_bytes: delta(old.rx_bytes, new.rx_bytes),
+        rx_packets: delta(old.rx_packets, new.rx_packets),
+        rx_errors: delta(old.rx_errors, new.rx_errors),
+        rx_dropped: delta(old.rx_dropped, new.rx_dropped),
+        tx_bytes: delta(old.tx_bytes, new.tx_bytes),
+        tx_packets: delta(old.tx_packets, new.tx_packets),
+        tx_errors: delta(old.tx_errors, new.tx_errors),
+        tx_dropped: delta(old.tx_dropped, new.tx_dropped),
+    }
+}
+
+fn apply_network_delta(net: &mut NetworkSample, d: &NetworkStatsDelta) {
+    net.rx_bytes = undelta(net.rx_bytes, d.rx_bytes);
+    net.rx_packets = undelta(net.rx_packets, d.rx_packets);
+    net.rx_errors = undelta(net.rx_errors, d.rx_errors);
+    net.rx_dropped = undelta(net.rx_dropped, d.rx_dropped);
+    net.tx_bytes = undelta(net.tx_bytes, d.tx_bytes);
+    net.tx_packets = undelta(net.tx_packets, d.tx_packets);
+    net.tx_errors = undelta(net.tx_errors, d.tx_errors);
+    net.tx_dropped = undelta(net.tx_dropped, d.tx_dropped);
+}
+
+/// Stats delta from `old` to `new`
+///
+/// `old` is `None` when the receiver knows nothing about the container yet.
+/// Returns `None` when nothing changed.
+fn stats_delta(
+    old: Option<&Option<StatsSample>>,
+    new: Option<&StatsSample>,
+) -> Option<ContainerStatsDelta> {
+    let unavailable = ContainerStatsDelta {
+        available: false,
+        ..Default::default()
+    };
+    let (old, new) = match (old, new) {
+        (None, None) => return Some(unavailable),
+        (Some(Some(_)), None) => return Some(unavailable),
+        (Some(None), None) => return None,
+        (Some(Some(old)), Some(new)) if old == new => return None,
+        (Some(Some(old)), Some(new)) if old.networks.keys().eq(new.networks.keys()) => {
+            (Some(old), new)
+        }
+        // New container, stats just became available or the networks changed
+        (_, Some(new)) => (None, new),
+    };
+
+    let zero = StatsSample::default();
+    let base = old.unwrap_or(&zero);
+    let networks = new
+        .networks
+        .iter()
+        .filter_map(|(name, net)| match old.and_then(|o| o.networks.get(name)) {
+            Some(old_net) if old_net == net => None,
+            Some(old_net) => Some((name.clone(), network_delta(old_net, net))),
+            None => Some((name.clone(), network_delta(&NetworkSample::default(), net))),
+        })
+        .collect();
+    Some(ContainerStatsDelta {
+        available: true,
+        reset: old.is_none(),
+        cpu_total_usage: delta(base.cpu_total_usage, new.cpu_total_usage),
+        cpu_kernel_usage: delta(base.cpu_kernel_usage, new.cpu_kernel_usage),
+        cpu_user_usage: delta(base.cpu_user_usage, new.cpu_user_usage),
+        memory_usage: delta(base.memory_usage, new.memory_usage),
+        memory_limit: delta(base.memory_limit, new.memory_limit),
+        networks,
+    })
+}
+
+fn apply_stats_delta(
+    sample: &mut Option<StatsSample>,
+    d: &ContainerStatsDelta,
+) -> Result<(), String> {
+    if !d.available {
+        *sample = None;
+        return Ok(());
+    }
+    let mut next = if d.reset {
+        StatsSample::default()
+    } else {
+        sample
+            .take()
+            .ok_or_else(|| "stats delta without previous stats".to_string())?
+    };
+    next.cpu_total_usage = undelta(next.cpu_total_usage, d.cpu_total_usage);
+    next.cpu_kernel_usage = undelta(next.cpu_kernel_usage, d.cpu_kernel_usage);
+    next.cpu_user_usage = undelta(next.cpu_user_usage, d.cpu_user_usage);
+    next.memory_usage = undelta(next.memory_usage, d.memory_usage);
+    next.memory_limit = undelta(next.memory_limit, d.memory_limit);
+    for (name, net) in &d.networks {
+        apply_network_delta(next.networks.entry(name.clone()).or_default(), net);
+    }
+    *sample = Some(next);
+    Ok(())
+}
+
+/// What the receiver knows about a container after the last frame
+struct Known {
+    /// Info with an empty stats map
+    info: ContainerInfo,
+    stats: Option<StatsSample>,
+}
+
+/// Sending side of one telemetry stream
+pub struct TelemetryEncoder {
+    keyframe_interval: u64,
+    sequence: u64,
+    since_keyframe: u64,
+    keyframe_pending: bool,
+    sent: HashMap<String, Known>,
+    node: Option<NodeInfo>,
+}
+
+impl TelemetryEncoder {
+    pub fn new(keyframe_interval: u64) -> Self {
+        Self {
+            keyframe_interval: keyframe_interval.max(1),
+            sequence: 0,
+            since_keyframe: 0,
+            keyframe_pending: true,
+            sent: HashMap::new(),
+            node: None,
+        }
+    }
+
+    /// Make the next frame a keyframe, e.g. after the stream was reopened
+    pub fn force_keyframe(&mut self) {
+        self.keyframe_pending = true;
+    }
+
+    /// Encode the current view of the node
+    ///
+    /// # Arguments
+    ///
+    /// * `containers` - every container of the node with its stats, `None`
+    ///   when unavailable; the stats map of the info is ignored
+    /// * `node` - latest node info, if one was sampled since the last frame
+    pub fn encode(
+        &mut self,
+        node_name: &str,
+        containers: Vec<(ContainerInfo, Option<StatsSample>)>,
+        node: Option<NodeInfo>,
+    ) -> TelemetryFrame {
+        let keyframe = self.keyframe_pending || self.since_keyframe >= self.keyframe_interval;
+        if keyframe {
+            self.sent.clear();
+            self.since_keyframe = 0;
+            self.keyframe_pending = false;
+        }
+        self.since_keyframe += 1;
+        self.sequence += 1;
+
+        let mut frame = TelemetryFrame {
+            node_name: node_name.to_string(),
+            sequence: self.sequence,
+            keyframe,
+            ..Default::default()
+        };
+
+        let mut seen = HashSet::with_capacity(containers.len());
+        for (mut info, stats) in containers {
+            info.stats.clear();
+            seen.insert(info.id.clone());
+            let known = self.sent.get(&info.id);
+            let info_changed = known.map_or(true, |k| k.info != info);
+            let stats_changed = stats_delta(known.map(|k| &k.stats), stats.as_ref());
+            if !info_changed && stats_changed.is_none() {
+                continue;
+            }
+            frame.containers.push(ContainerTelemetry {
+                id: info.id.clone(),
+                info: info_changed.then(|| info.clone()),
+                stats: stats_changed,
+            });
+            self.sent.insert(info.id.clone(), Known { info, stats });
+        }
+
+        let removed: Vec<String> = self
+            .sent
+            .keys()
+            .filter(|id| !seen.contains(*id))
+            .cloned()
+            .collect();
+        for id in &removed {
+            self.sent.remove(id);
+        }
+        frame.removed = removed;
+
+        match node {
+            Some(node) if keyframe || self.node.as_ref() != Some(&node) => {
+                frame.node = Some(node.clone());
+                self.node = Some(node);
+            }
+            None if keyframe => frame.node = self.node.clone(),
+            _ => {}
+        }
+        frame
+    }
+}
+
+impl Default for TelemetryEncoder {
+    fn default() -> Self {
+        Self::new(DEFAULT_KEYFRAME_INTERVAL)
+    }
+}
+
+/// Receiving side of one telemetry stream
+#[derive(Default)]
+pub struct TelemetryDecoder {
+    node_name: String,
+    /// Sequence of the last applied frame, `None` before the first keyframe
+    sequence: Option<u64>,
+    containers: BTreeMap<String, Known>,
+}
+
+impl TelemetryDecoder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Apply the next frame of the stream
+    ///
+    /// Fails on a delta that does not follow the previous frame, after which
+    /// the stream has to be restarted from a keyframe.
+    pub fn apply(&mut self, frame: &TelemetryFrame) -> Result<(), String> {
+        if frame.keyframe {
+            self.containers.clear();
+            self.node_name = frame.node_name.clone();
+        } else {
+            match self.sequence {
+                None => return Err("telemetry delta before the first keyframe".to_string()),
+                Some(sequence) if frame.sequence != sequence + 1 => {
+                    return Err(format!(
+                        "telemetry frame {} does not follow frame {}",
+                        frame.sequence, sequence
+                    ))
+                }
+                _ => {}
+            }
+        }
+
+        for id in &frame.removed {
+            self.containers.remove(id);
+        }
+        for container in &frame.containers {
+            if let Some(info) = &container.info {
+                self.containers
+                    .entry(container.id.clone())
+                    .and_modify(|known| known.info = info.clone())
+                    .or_insert_with(|| Known {
+                        info: info.clone(),
+                        stats: None,
+                    });
+            }
+            let known = self
+                .containers
+                .get_mut(&container.id)
+                .ok_or_else(|| format!("telemetry for unknown container {}", container.id))?;
+            if let Some(stats) = &container.stats {
+                apply_stats_delta(&mut known.stats, stats)?;
+            }
+        }
+        self.sequence = Some(frame.sequence);
+        Ok(())
+    }
+
+    /// The full container view, with stats maps as sent by `SendContainerList`
+    pub fn container_list(&self) -> ContainerList {
+        ContainerList {
+            node_name: self.node_name.clone(),
+            containers: self
+                .containers
+                .values()
+                .map(|known| {
+                    let mut info = known.info.clone();
+                    info.stats = stats_map(known.stats.as_ref());
+                    info
+                })
+                .collect(),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn info(id: &str, status: &str) -> ContainerInfo {
+        ContainerInfo {
+            id: id.to_string(),
+            names: vec![id.to_string()],
+            state: HashMap::from([("Status".to_string(), status.to_string())]),
+            ..Default::default()
+        }
+    }
+
+    fn sample(cpu: u64, rx: u64) -> StatsSample {
+        StatsSample {
+            cpu_total_usage: cpu,
+            memory_usage: 1024,
+            memory_limit: 4096,
+            networks: BTreeMap::from([(
+                "eth0".to_string(),
+                NetworkSample {
+                    rx_bytes: rx,
+                    ..Default::default()
+                },
+            )]),
+            ..Default::default()
+        }
+    }
+
+    fn roundtrip(decoder: &mut TelemetryDecoder, frame: &TelemetryFrame) -> ContainerList {
+        decoder.apply(frame).unwrap();
+        decoder.container_list()
+    }
+
+    #[test]
+    fn test_deltas_only_carry_changes() {
+        let mut encoder = TelemetryEncoder::new(10);
+        let mut decoder = TelemetryDecoder::new();
+
+        let first = encoder.encode(
+            "node",
+            vec![
+                (info("a", "running"), Some(sample(100, 10))),
+                (info("b", "exited"), None),
+            ],
+            None,
+        );
+        assert!(first.keyframe);
+        assert_eq!(first.containers.len(), 2);
+        roundtrip(&mut decoder, &first);
+
+        let second = encoder.encode(
+            "node",
+            vec![
+                (info("a", "running"), Some(sample(150, 10))),
+                (info("b", "exited"), None),
+            ],
+            None,
+        );
+        assert!(!second.keyframe);
+        assert_eq!(second.containers.len(), 1);
+        let a = &second.containers[0];
+        assert!(a.info.is_none());
+        let stats = a.stats.as_ref().unwrap();
+        assert!(!stats.reset);
+        assert_eq!(stats.cpu_total_usage, 50);
+        assert_eq!(stats.memory_usage, 0);
+        // Unchanged networks are left out
+        assert!(stats.networks.is_empty());
+
+        let list = roundtrip(&mut decoder, &second);
+        assert_eq!(list.containers.len(), 2);
+        assert_eq!(list.containers[0].stats["CpuTotalUsage"], "150");
+        assert_eq!(
+            list.containers[0].stats["Networks"],
+            "eth0: {rx_bytes: 10, rx_packets: 0, rx_errors: 0, rx_dropped: 0, tx_bytes: 0, tx_packets: 0, tx_errors: 0, tx_dropped: 0}"
+        );
+        assert_eq!(list.containers[1].stats["Status"], "StatsUnavailable");
+    }
+
+    #[test]
+    fn test_state_change_and_removal() {
+        let mut encoder = TelemetryEncoder::new(10);
+        let mut decoder = TelemetryDecoder::new();
+        roundtrip(
+            &mut decoder,
+            &encoder.encode(
+                "node",
+                vec![
+                    (info("a", "running"), Some(sample(1, 1))),
+                    (info("b", "running"), None),
+                ],
+                None,
+            ),
+        );
+
+        let frame = encoder.encode("node", vec![(info("a", "exited"), None)], None);
+        assert_eq!(frame.removed, vec!["b".to_string()]);
+        assert!(frame.containers[0].info.is_some());
+        assert!(!frame.containers[0].stats.as_ref().unwrap().available);
+
+        let list = roundtrip(&mut decoder, &frame);
+        assert_eq!(list.containers.len(), 1);
+        assert_eq!(list.containers[0].state["Status"], "exited");
+        assert_eq!(list.containers[0].stats["Status"], "StatsUnavailable");
+    }
+
+    #[test]
+    fn test_keyframe_interval_and_forced_keyframe() {
+        let mut encoder = TelemetryEncoder::new(2);
+        let view = || vec![(info("a", "running"), Some(sample(1, 1)))];
+        assert!(encoder.encode("node", view(), None).keyframe);
+        let idle = encoder.encode("node", view(), None);
+        assert!(!idle.keyframe);
+        assert!(idle.containers.is_empty());
+        let key = encoder.encode("node", view(), None);
+        assert!(key.keyframe);
+        assert_eq!(key.containers.len(), 1);
+
+        encoder.force_keyframe();
+        assert!(encoder.encode("node", view(), None).keyframe);
+    }
+
+    #[test]
+    fn test_node_info_sent_when_changed() {
+        let mut encoder = TelemetryEncoder::new(3);
+        let node = |cpu: f64| NodeInfo {
+            node_name: "node".to_string(),
+            cpu_usage: cpu,
+            ..Default::default()
+        };
+        assert!(encoder
+            .encode("node", vec![], Some(node(1.0)))
+            .node
+            .is_some());
+        assert!(encoder
+            .encode("node", vec![], Some(node(1.0)))
+            .node
+            .is_none());
+        assert!(encoder
+            .encode("node", vec![], Some(node(2.0)))
+            .node
+            .is_some());
+        // The keyframe repeats the last node info even without a new sample
+        let key = encoder.encode("node", vec![], None);
+        assert!(key.keyframe);
+        assert_eq!(key.node.unwrap().cpu_usage, 2.0);
+    }
+
+    #[test]
+    fn test_decoder_rejects_out_of_order_deltas() {
+        let mut encoder = TelemetryEncoder::new(10);
+        let mut decoder = TelemetryDecoder::new();
+        let key = encoder.encode("node", vec![], None);
+        let delta1 = encoder.encode("node", vec![], None);
+        let delta2 = encoder.encode("node", vec![], None);
+
+        assert!(decoder.apply(&delta1).is_err());
+        decoder.apply(&key).unwrap();
+        assert!(decoder.apply(&delta2).is_err());
+        decoder.apply(&delta1).unwrap();
+        decoder.apply(&delta2).unwrap();
+    }
+
+    #[test]
+    fn test_counter_wraparound_roundtrip() {
+        let mut encoder = TelemetryEncoder::new(10);
+        let mut decoder = TelemetryDecoder::new();
+        let mut high = sample(u64::MAX - 1, 0);
+        high.memory_usage = u64::MAX;
+        roundtrip(
+            &mut decoder,
+            &encoder.encode("node", vec![(info("a", "running"), Some(high))], None),
+        );
+        let list = roundtrip(
+            &mut decoder,
+            &encoder.encode(
+                "node",
+                vec![(info("a", "running"), Some(sample(3, 0)))],
+                None,
+            ),
+        );
+        assert_eq!(list.containers[0].stats["CpuTotalUsage"], "3");
+        assert_eq!(list.containers[0].stats["MemoryUsage"], "1024");
+    }
+}
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Point-in-time export of store contents
+//!
+//! The RocksDB service answers a `Snapshot` call with every key under the
+//! requested prefixes at one revision. Entries are sent in key order as
+//!
+//! ```text
+//! "PSNP" version:u8 count:varint
+//! { shared:varint suffix_len:varint suffix value_len:varint value }*
+//! ```
+//!
+//! where `shared` is the length of the prefix the key has in common with
+//! the previous key. Keys of one family share most of their bytes
+//! (`Scenario/...`, `Package/...`), so they shrink to their distinct tail.
+
+const MAGIC: &[u8; 4] = b"PSNP";
+const VERSION: u8 = 1;
+
+/// Keys and values of the store at one revision, sorted by key
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct Snapshot {
+    revision: u64,
+    entries: Vec<(String, String)>,
+}
+
+impl Snapshot {
+    /// Build a snapshot; entries are sorted and a repeated key keeps its
+    /// last value
+    pub fn new(revision: u64, mut entries: Vec<(String, String)>) -> Self {
+        // Stable, so the last of several equal keys stays last
+        entries.sort_by(|a, b| a.0.cmp(&b.0));
+        let mut unique: Vec<(String, String)> = Vec::with_capacity(entries.len());
+        for entry in entries {
+            match unique.last_mut() {
+                Some(last) if last.0 == entry.0 => *last = entry,
+                _ => unique.push(entry),
+            }
+        }
+        Self {
+            revision,
+            entries: unique,
+        }
+    }
+
+    /// Commit revision the snapshot was taken at
+    pub fn revision(&self) -> u64 {
+        self.revision
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    pub fn entries(&self) -> &[(String, String)] {
+        &self.entries
+    }
+
+    /// Entries whose key starts with `prefix`, in key order
+    pub fn with_prefix(&self, prefix: &str) -> &[(String, String)] {
+        let start = self
+            .entries
+            .partition_point(|(key, _)| key.as_str() < prefix);
+        let len = self.entries[start..]
+            .iter()
+            .take_while(|(key, _)| key.starts_with(prefix))
+            .count();
+        &self.entries[start..start + len]
+    }
+
+    /// Encode the entries; the revision travels next to the data
+    pub fn encode(&self) -> Vec<u8> {
+        let size: usize = self.entries.iter().map(|(k, v)| k.len() + v.len()).sum();
+        let mut out = Vec::with_capacity(MAGIC.len() + 1 + size + 4 * self.entries.len());
+        out.extend_from_slice(MAGIC);
+        out.push(VERSION);
+        write_varint(&mut out, self.entries.len() as u64);
+
+        let mut previous: &[u8] = &[];
+        for (key, value) in &self.entries {
+            let key = key.as_bytes();
+            let shared = previous.iter().zip(key).take_while(|(a, b)| a == b).count();
+            write_varint(&mut out, shared as u64);
+            write_varint(&mut out, (key.len() - shared) as u64);
+            out.extend_from_slice(&key[shared..]);
+            write_varint(&mut out, value.len() as u64);
+            out.extend_from_slice(value.as_bytes());
+            previous = key;
+        }
+        out
+    }
+
+    /// Decode entries written by [`Snapshot::encode`]
+    pub fn decode(revision: u64, data: &[u8]) -> Result<Self, String> {
+        let mut reader = Reader { data, pos: 0 };
+        if reader.take(MAGIC.len())? != MAGIC {
+            return Err("Not a snapshot".to_string());
+        }
+        let version = reader.take(1)?[0];
+        if version != VERSION {
+            return Err(format!("Unsupported snapshot version {}", version));
+        }
+
+        let count = reader.varint()? as usize;
+        // Every entry takes at least three bytes, so a corrupt count cannot
+        // reserve more than the data could hold
+        let mut entries = Vec::with_capacity(count.min(data.len() / 3));
+        let mut key: Vec<u8> = Vec::new();
+        for _ in 0..count {
+            let shared = reader.varint()? as usize;
+            if shared > key.len() {
+                return Err("Corrupt snapshot key".to_string());
+            }
+            key.truncate(shared);
+            let suffix_len = reader.varint()? as usize;
+            key.extend_from_slice(reader.take(suffix_len)?);
+            let value_len = reader.varint()? as usize;
+            let value = reader.take(value_len)?;
+
+            let key_str = String::from_utf8(key.clone()).map_err(|e| e.to_string())?;
+            let value_str = String::from_utf8(value.to_vec()).map_err(|e| e.to_string())?;
+            entries.push((key_str, value_str));
+        }
+        if reader.pos != data.len() {
+            return Err("Trailing bytes after snapshot".to_string());
+        }
+
+        Ok(Self { revision, entries })
+    }
+}
+
+fn write_varint(out: &mut Vec<u8>, mut value: u64) {
+    while value >= 0x80 {
+        out.push((value as u8) | 0x80);
+        value >>= 7;
+    }
+    out.push(value as u8);
+}
+
+struct Reader<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> Result<&'a [u8], String> {
+        let end = self
+            .pos
+            .checked_add(len)
+            .filter(|end| *end <= self.data.len())
+            .ok_or("Truncated snapshot")?;
+        let bytes = &self.data[self.pos..end];
+        self.pos = end;
+        Ok(bytes)
+    }
+
+    fn varint(&mut self) -> Result<u64, String> {
+        let mut value = 0u64;
+        for shift in (0..64).step_by(7) {
+            let byte = self.take(1)?[0];
+            value |= ((byte & 0x7f) as u64) << shift;
+            if byte & 0x80 == 0 {
+                return Ok(value);
+            }
+        }
+        Err("Corrupt snapshot varint".to_string())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn entry(key: &str, value: &str) -> (String, String) {
+        (key.to_string(), value.to_string())
+    }
+
+    #[test]
+    fn test_round_trip_shares_key_prefixes() {
+        let snapshot = Snapshot::new(
+            42,
+            vec![
+                entry("Scenario/helloworld", "a"),
+                entry("Package/helloworld", "b"),
+                entry("Scenario/hello", "c"),
+                entry("Package/helloworld", "d"),
+                entry("Scenario/é", ""),
+            ],
+        );
+        assert_eq!(snapshot.len(), 4);
+        assert_eq!(snapshot.entries()[0], entry("Package/helloworld", "d"));
+
+        let data = snapshot.encode();
+        let raw: usize = snapshot
+            .entries()
+            .iter()
+            .map(|(k, v)| k.len() + v.len())
+            .sum();
+        assert!(data.len() < raw, "{} >= {}", data.len(), raw);
+        assert_eq!(Snapshot::decode(42, &data).unwrap(), snapshot);
+    }
+
+    #[test]
+    fn test_with_prefix_selects_range() {
+        let snapshot = Snapshot::new(
+            1,
+            vec![
+                entry("Package/a", "1"),
+                entry("Scenario/a", "2"),
+                entry("Scenario/b", "3"),
+                entry("ScenarioX", "4"),
+            ],
+        );
+        let keys: Vec<&str> = snapshot
+            .with_prefix("Scenario/")
+            .iter()
+            .map(|(k, _)| k.as_str())
+            .collect();
+        assert_eq!(keys, vec!["Scenario/a", "Scenario/b"]);
+        assert!(snapshot.with_prefix("Model/").is_empty());
+        assert_eq!(snapshot.with_prefix("").len(), 4);
+    }
+
+    #[test]
+    fn test_decode_rejects_corrupt_data() {
+        let data = Snapshot::new(1, vec![entry("Package/a", "yaml")]).encode();
+        assert!(Snapshot::decode(1, &data[..data.len() - 1]).is_err());
+        assert!(Snapshot::decode(1, b"XXXX\x01\x00").is_err());
+        let mut trailing = data.clone();
+        trailing.push(0);
+        assert!(Snapshot::decode(1, &trailing).is_err());
+        assert!(Snapshot::decode(1, &Snapshot::default().encode())
+            .unwrap()
+            .is_empty());
+    }
+}
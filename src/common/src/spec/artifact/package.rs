@@ -38,6 +38,9 @@ pub struct ModelInfo {
     name: String,
     node: String,
     resources: Resource,
+    /// Models of the same package that must be handled before this one
+    #[serde(default, rename = "dependsOn")]
+    depends_on: Vec<String>,
 }
 
 impl ModelInfo {
@@ -52,6 +55,10 @@ impl ModelInfo {
     pub fn get_resources(&self) -> Resource {
         self.resources.clone()
     }
+
+    pub fn get_depends_on(&self) -> &Vec<String> {
+        &self.depends_on
+    }
 }
 
 #[derive(Clone, Debug, serde::Deserialize, PartialEq)]
@@ -120,6 +127,7 @@ mod tests {
                             volume: Some("vol1".to_string()),
                             network: Some("net1".to_string()),
                         },
+                        depends_on: vec![],
                     },
                     ModelInfo {
                         name: "model2".to_string(),
@@ -128,6 +136,7 @@ mod tests {
                             volume: Some("vol2".to_string()),
                             network: None,
                         },
+                        depends_on: vec!["model1".to_string()],
                     },
                 ],
             },
@@ -159,6 +168,27 @@ mod tests {
         assert_eq!(models.len(), 2);
         assert_eq!(models[0].name, "model1");
         assert_eq!(models[1].name, "model2");
+        assert_eq!(models[1].get_depends_on(), &vec!["model1".to_string()]);
+    }
+
+    #[test]
+    fn test_depends_on_is_optional() {
+        let yaml = r#"
+name: web
+node: node1
+resources:
+  volume:
+  network:
+dependsOn:
+  - db
+"#;
+        let model: ModelInfo = serde_yaml::from_str(yaml).unwrap();
+        assert_eq!(model.get_depends_on(), &vec!["db".to_string()]);
+
+        let model: ModelInfo =
+            serde_yaml::from_str("name: db\nnode: node1\nresources:\n  volume:\n  network:\n")
+                .unwrap();
+        assert!(model.get_depends_on().is_empty());
     }
 
     #[test]
@@ -170,6 +200,7 @@ mod tests {
                 volume: Some("test-vol".to_string()),
                 network: Some("test-net".to_string()),
             },
+            depends_on: vec![],
         };
 
         assert_eq!(model.get_name(), "test-model");
@@ -23,6 +23,11 @@ impl Scenario {
     pub fn get_targets(&self) -> String {
         self.spec.target.clone()
     }
+
+    /// Firing policy of the condition, level-triggered if not given
+    pub fn get_trigger(&self) -> Trigger {
+        self.spec.trigger.clone().unwrap_or_default()
+    }
 }
 
 #[derive(Debug, serde::Serialize, serde::Deserialize, PartialEq)]
@@ -30,6 +35,46 @@ pub struct ScenarioSpec {
     condition: Option<Condition>,
     action: String,
     target: String,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    trigger: Option<Trigger>,
+}
+
+/// When a satisfied condition fires its action
+#[derive(Debug, Clone, Default, serde::Serialize, serde::Deserialize, PartialEq)]
+#[serde(rename_all = "camelCase")]
+pub struct Trigger {
+    #[serde(default)]
+    mode: TriggerMode,
+    /// Band a numeric comparison has to leave before it is false again
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    hysteresis: Option<f32>,
+    /// Minimum time between two firings
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    min_interval_ms: Option<u64>,
+}
+
+impl Trigger {
+    pub fn get_mode(&self) -> TriggerMode {
+        self.mode
+    }
+
+    pub fn get_hysteresis(&self) -> Option<f32> {
+        self.hysteresis
+    }
+
+    pub fn get_min_interval_ms(&self) -> Option<u64> {
+        self.min_interval_ms
+    }
+}
+
+#[derive(Debug, Clone, Copy, Default, serde::Serialize, serde::Deserialize, PartialEq, Eq)]
+#[serde(rename_all = "lowercase")]
+pub enum TriggerMode {
+    /// Fire on every sample that satisfies the condition
+    #[default]
+    Level,
+    /// Fire only when the condition turns from false to true
+    Edge,
 }
 
 #[derive(Debug, serde::Serialize, serde::Deserialize, PartialEq)]
@@ -48,11 +93,23 @@ enum ScenarioState {
     Completed,
 }
 
+/// A single comparison, optionally combined with nested conditions.
+///
+/// A condition holds when its own comparison (if `express` is set) holds,
+/// every condition in `and` holds and, if `or` is not empty, at least one
+/// condition in `or` holds.
 #[derive(Debug, Clone, serde::Serialize, serde::Deserialize, PartialEq)]
 pub struct Condition {
+    #[serde(default)]
     express: String,
+    #[serde(default)]
     value: String,
+    #[serde(default)]
     operands: Operand,
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    and: Vec<Condition>,
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    or: Vec<Condition>,
 }
 
 impl Condition {
@@ -71,9 +128,38 @@ impl Condition {
     pub fn get_operand_name(&self) -> String {
         self.operands.name.clone()
     }
+
+    pub fn get_and(&self) -> &[Condition] {
+        &self.and
+    }
+
+    pub fn get_or(&self) -> &[Condition] {
+        &self.or
+    }
+
+    /// Whether this condition carries a comparison of its own
+    pub fn has_comparison(&self) -> bool {
+        !self.express.is_empty()
+    }
+
+    /// Topics referenced anywhere in this condition, deduplicated, in order
+    pub fn get_topics(&self) -> Vec<String> {
+        let mut topics = Vec::new();
+        self.collect_topics(&mut topics);
+        topics
+    }
+
+    fn collect_topics(&self, topics: &mut Vec<String>) {
+        if self.has_comparison() && !topics.contains(&self.operands.value) {
+            topics.push(self.operands.value.clone());
+        }
+        for child in self.and.iter().chain(self.or.iter()) {
+            child.collect_topics(topics);
+        }
+    }
 }
 
-#[derive(Debug, Clone, serde::Serialize, serde::Deserialize, PartialEq)]
+#[derive(Debug, Clone, Default, serde::Serialize, serde::Deserialize, PartialEq)]
 struct Operand {
     r#type: String,
     name: String,
@@ -104,9 +190,12 @@ mod tests {
                         name: "test-pod".to_string(),
                         value: "status".to_string(),
                     },
+                    and: vec![],
+                    or: vec![],
                 }),
                 action: "start".to_string(),
                 target: "model-1".to_string(),
+                trigger: None,
             },
             status: Some(ScenarioStatus {
                 state: ScenarioState::None,
@@ -157,6 +246,7 @@ mod tests {
                 condition: None,
                 action: "stop".to_string(),
                 target: "model-2".to_string(),
+                trigger: None,
             },
             status: None,
         };
@@ -222,9 +312,12 @@ mod tests {
                     name: "cpu_usage".to_string(),
                     value: "value".to_string(),
                 },
+                and: vec![],
+                or: vec![],
             }),
             action: "scale".to_string(),
             target: "deployment".to_string(),
+            trigger: None,
         };
 
         let serialized = serde_json::to_string(&spec).unwrap();
@@ -243,9 +336,80 @@ mod tests {
                 name: "memory_usage".to_string(),
                 value: "value".to_string(),
             },
+            and: vec![],
+            or: vec![],
         };
 
         let cloned = condition.clone();
         assert_eq!(condition, cloned);
     }
+
+    #[test]
+    fn test_compound_condition_from_yaml() {
+        let yaml = r#"
+and:
+  - express: gt
+    value: "50"
+    operands:
+      type: DDS
+      name: speed
+      value: /rt/car/speed
+  - or:
+      - express: eq
+        value: "D"
+        operands:
+          type: DDS
+          name: gear
+          value: /rt/car/gear
+      - express: eq
+        value: "R"
+        operands:
+          type: DDS
+          name: gear
+          value: /rt/car/gear
+"#;
+        let condition: Condition = serde_yaml::from_str(yaml).unwrap();
+
+        assert!(!condition.has_comparison());
+        assert_eq!(condition.get_and().len(), 2);
+        assert_eq!(condition.get_and()[1].get_or().len(), 2);
+        assert_eq!(
+            condition.get_topics(),
+            vec!["/rt/car/speed".to_string(), "/rt/car/gear".to_string()]
+        );
+    }
+
+    #[test]
+    fn test_simple_condition_serializes_without_compound_fields() {
+        let condition = create_test_scenario().get_conditions().unwrap();
+        let json = serde_json::to_string(&condition).unwrap();
+
+        assert!(!json.contains("\"and\""));
+        assert!(!json.contains("\"or\""));
+        assert_eq!(condition.get_topics(), vec!["status".to_string()]);
+    }
+
+    #[test]
+    fn test_trigger_defaults_to_level() {
+        assert_eq!(create_test_scenario().get_trigger(), Trigger::default());
+        assert_eq!(Trigger::default().get_mode(), TriggerMode::Level);
+    }
+
+    #[test]
+    fn test_trigger_from_yaml() {
+        let yaml = r#"
+action: update
+target: model-1
+trigger:
+  mode: edge
+  hysteresis: 2.5
+  minIntervalMs: 1000
+"#;
+        let spec: ScenarioSpec = serde_yaml::from_str(yaml).unwrap();
+        let trigger = spec.trigger.unwrap();
+
+        assert_eq!(trigger.get_mode(), TriggerMode::Edge);
+        assert_eq!(trigger.get_hysteresis(), Some(2.5));
+        assert_eq!(trigger.get_min_interval_ms(), Some(1000));
+    }
 }
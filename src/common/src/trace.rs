@@ -0,0 +1,337 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Latency tracing along the scenario pipeline
+//!
+//! FilterGateway mints a trace ID when a scenario fires. The ID travels as
+//! the `x-piccolo-trace-id` gRPC metadata entry on the calls that follow and
+//! becomes the `transition_id` of the StateChange that ActionController sends
+//! when the scenario completes. Every component marks the stages it finishes
+//! with one log line at level I:
+//!
+//! ```text
+//! trace <id> <stage> <unix ns>
+//! ```
+//!
+//! The log service keeps the lines of all components, so a client reading
+//! them back from `/query` can rebuild each timeline with [`breakdown`].
+
+use std::collections::HashMap;
+use std::fmt;
+use std::future::Future;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+/// gRPC metadata key carrying the trace ID
+pub const METADATA_KEY: &str = "x-piccolo-trace-id";
+
+const ID_PREFIX: &str = "trace-";
+const MARK_PREFIX: &str = "trace";
+
+static NEXT_ID: AtomicU64 = AtomicU64::new(0);
+
+tokio::task_local! {
+    static CURRENT: String;
+}
+
+/// Points of the pipeline a trace passes, in order
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum Stage {
+    /// FilterGateway took the sample from the DDS reader
+    DdsReceived,
+    /// The scenario condition held and the trigger policy let it fire
+    ConditionMet,
+    /// ActionController received the trigger
+    ActionReceived,
+    /// NodeAgent returned from starting the workload
+    WorkloadStarted,
+    /// StateManager applied the completion state change
+    StateApplied,
+}
+
+impl Stage {
+    pub const ALL: [Stage; 5] = [
+        Stage::DdsReceived,
+        Stage::ConditionMet,
+        Stage::ActionReceived,
+        Stage::WorkloadStarted,
+        Stage::StateApplied,
+    ];
+
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Stage::DdsReceived => "dds_received",
+            Stage::ConditionMet => "condition_met",
+            Stage::ActionReceived => "action_received",
+            Stage::WorkloadStarted => "workload_started",
+            Stage::StateApplied => "state_applied",
+        }
+    }
+
+    pub fn parse(value: &str) -> Option<Self> {
+        Self::ALL.into_iter().find(|stage| stage.as_str() == value)
+    }
+}
+
+impl fmt::Display for Stage {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+/// Wall clock in nanoseconds since the epoch, comparable across processes
+/// on one host
+pub fn now_ns() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or_default()
+        .as_nanos() as u64
+}
+
+/// New trace ID; `source` names the component that starts the trace
+pub fn new_id(source: &str) -> String {
+    format!(
+        "{}{}-{}-{}",
+        ID_PREFIX,
+        source,
+        now_ns(),
+        NEXT_ID.fetch_add(1, Ordering::Relaxed)
+    )
+}
+
+/// Whether a transition ID was minted by [`new_id`]
+pub fn is_trace_id(id: &str) -> bool {
+    id.starts_with(ID_PREFIX)
+}
+
+/// Run `future` with `id` as the current trace of the task
+pub async fn scope<F: Future>(id: String, future: F) -> F::Output {
+    CURRENT.scope(id, future).await
+}
+
+/// Trace of the running task, if it is inside [`scope`]
+pub fn current() -> Option<String> {
+    CURRENT.try_with(|id| id.clone()).ok()
+}
+
+/// Wrap `message` in a request carrying the current trace, if any
+pub fn request<T>(message: T) -> tonic::Request<T> {
+    let mut request = tonic::Request::new(message);
+    if let Some(value) = current().and_then(|id| id.parse().ok()) {
+        request.metadata_mut().insert(METADATA_KEY, value);
+    }
+    request
+}
+
+/// Trace ID a caller attached to `request`
+pub fn from_request<T>(request: &tonic::Request<T>) -> Option<String> {
+    let value = request.metadata().get(METADATA_KEY)?.to_str().ok()?;
+    (!value.is_empty()).then(|| value.to_string())
+}
+
+/// Record that trace `id` reached `stage` now
+pub fn mark(id: &str, stage: Stage) {
+    mark_at(id, stage, now_ns());
+}
+
+/// Record that trace `id` reached `stage` at `ts_ns`
+pub fn mark_at(id: &str, stage: Stage, ts_ns: u64) {
+    crate::logd!(3, "{}", Mark::line(id, stage, ts_ns));
+}
+
+/// One stage of one trace, as read back from the log
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Mark {
+    pub id: String,
+    pub stage: Stage,
+    pub ts_ns: u64,
+}
+
+impl Mark {
+    fn line(id: &str, stage: Stage, ts_ns: u64) -> String {
+        format!("{MARK_PREFIX} {id} {stage} {ts_ns}")
+    }
+
+    /// Parse a log message written by [`mark`]; other messages give `None`
+    pub fn parse(message: &str) -> Option<Self> {
+        let mut parts = message.split_whitespace();
+        if parts.next()? != MARK_PREFIX {
+            return None;
+        }
+        let id = parts.next().filter(|id| is_trace_id(id))?;
+        let stage = Stage::parse(parts.next()?)?;
+        let ts_ns = parts.next()?.parse().ok()?;
+        if parts.next().is_some() {
+            return None;
+        }
+        Some(Self {
+            id: id.to_string(),
+            stage,
+            ts_ns,
+        })
+    }
+}
+
+/// Latencies of the traces that passed every stage
+#[derive(Debug, Default)]
+pub struct Breakdown {
+    /// Time from the previous stage to each stage after the first
+    pub hops: Vec<(Stage, Vec<Duration>)>,
+    /// Time from the first stage to the last
+    pub total: Vec<Duration>,
+    /// Traces missing at least one stage
+    pub incomplete: usize,
+}
+
+/// Group `marks` by trace and measure every hop
+///
+/// A stage marked more than once in a trace, such as one workload start
+/// per model, counts at its latest mark.
+pub fn breakdown(marks: impl IntoIterator<Item = Mark>) -> Breakdown {
+    let mut traces: HashMap<String, [Option<u64>; Stage::ALL.len()]> = HashMap::new();
+    for mark in marks {
+        let slot = &mut traces.entry(mark.id).or_default()[mark.stage as usize];
+        *slot = Some(slot.map_or(mark.ts_ns, |ts| ts.max(mark.ts_ns)));
+    }
+
+    let mut result = Breakdown {
+        hops: Stage::ALL[1..]
+            .iter()
+            .map(|stage| (*stage, Vec::new()))
+            .collect(),
+        ..Default::default()
+    };
+    for stamps in traces.values() {
+        let Some(stamps) = stamps.iter().copied().collect::<Option<Vec<u64>>>() else {
+            result.incomplete += 1;
+            continue;
+        };
+        for (i, pair) in stamps.windows(2).enumerate() {
+            result.hops[i]
+                .1
+                .push(Duration::from_nanos(pair[1].saturating_sub(pair[0])));
+        }
+        result.total.push(Duration::from_nanos(
+            stamps[stamps.len() - 1].saturating_sub(stamps[0]),
+        ));
+    }
+    result
+}
+
+/// Latency distribution of a set of samples
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LatencySummary {
+    pub count: usize,
+    pub p50: Duration,
+    pub p99: Duration,
+    pub max: Duration,
+}
+
+impl LatencySummary {
+    /// `None` when there are no samples
+    pub fn from_samples(mut samples: Vec<Duration>) -> Option<Self> {
+        let max = *samples.iter().max()?;
+        samples.sort_unstable();
+        let at = |q: f64| samples[((samples.len() - 1) as f64 * q).round() as usize];
+        Some(Self {
+            count: samples.len(),
+            p50: at(0.50),
+            p99: at(0.99),
+            max,
+        })
+    }
+}
+
+impl fmt::Display for LatencySummary {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "n {:>7}   p50 {:>11.3?}   p99 {:>11.3?}   max {:>11.3?}",
+            self.count, self.p50, self.p99, self.max
+        )
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn mark(id: &str, stage: Stage, ts_ns: u64) -> Mark {
+        Mark {
+            id: id.to_string(),
+            stage,
+            ts_ns,
+        }
+    }
+
+    #[test]
+    fn test_mark_line_round_trip() {
+        let id = new_id("filtergateway");
+        assert!(is_trace_id(&id));
+        assert_ne!(id, new_id("filtergateway"));
+
+        let line = Mark::line(&id, Stage::ActionReceived, 42);
+        assert_eq!(
+            Mark::parse(&line),
+            Some(mark(&id, Stage::ActionReceived, 42))
+        );
+        assert_eq!(Mark::parse("trace started for scenario helloworld"), None);
+        assert_eq!(Mark::parse(&format!("{line} extra")), None);
+        assert_eq!(Mark::parse("trace filtergateway-1 condition_met 1"), None);
+    }
+
+    #[tokio::test]
+    async fn test_request_carries_scoped_trace() {
+        assert!(from_request(&request(())).is_none());
+
+        let id = new_id("test");
+        let request = scope(id.clone(), async { request(()) }).await;
+        assert_eq!(from_request(&request), Some(id));
+        assert!(current().is_none());
+    }
+
+    #[test]
+    fn test_breakdown_measures_complete_traces() {
+        let a = "trace-a-0-0";
+        let mut marks = vec![
+            mark(a, Stage::DdsReceived, 1_000),
+            mark(a, Stage::ConditionMet, 1_500),
+            mark(a, Stage::ActionReceived, 3_000),
+            mark(a, Stage::WorkloadStarted, 9_000),
+            mark(a, Stage::WorkloadStarted, 10_000),
+            mark(a, Stage::StateApplied, 10_200),
+        ];
+        marks.push(mark("trace-b-0-0", Stage::DdsReceived, 5_000));
+
+        let result = breakdown(marks);
+        assert_eq!(result.incomplete, 1);
+        assert_eq!(result.total, vec![Duration::from_nanos(9_200)]);
+        let hops: Vec<(Stage, u128)> = result
+            .hops
+            .iter()
+            .map(|(stage, samples)| (*stage, samples[0].as_nanos()))
+            .collect();
+        assert_eq!(
+            hops,
+            vec![
+                (Stage::ConditionMet, 500),
+                (Stage::ActionReceived, 1_500),
+                (Stage::WorkloadStarted, 7_000),
+                (Stage::StateApplied, 200),
+            ]
+        );
+    }
+
+    #[test]
+    fn test_latency_summary_percentiles() {
+        assert_eq!(LatencySummary::from_samples(Vec::new()), None);
+        let samples = (1..=100).rev().map(Duration::from_millis).collect();
+        let summary = LatencySummary::from_samples(samples).unwrap();
+        assert_eq!(summary.count, 100);
+        assert_eq!(summary.p50, Duration::from_millis(51));
+        assert_eq!(summary.p99, Duration::from_millis(99));
+        assert_eq!(summary.max, Duration::from_millis(100));
+    }
+}
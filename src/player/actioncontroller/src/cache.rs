@@ -0,0 +1,515 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Parsed Resource Cache
+//!
+//! A trigger needs the scenario, its target package, the optional network
+//! and node definitions of the scenario, the Pod of every model and the
+//! role of every model node.
+//! [`ResourceCache`] keeps all of them parsed in memory so the trigger path
+//! does not read or parse anything from ETCD.
+//!
+//! # Consistency
+//! On startup every section is loaded from one store snapshot and then
+//! follows its ETCD prefix through [`watch_section`], which applies the puts
+//! and deletes written when ApiServer applies or withdraws an artifact or a
+//! node registers. A section whose stream fails reloads through a watch with
+//! initial contents. While
+//! a section is not synced, e.g. at startup or after its stream failed,
+//! lookups that depend on it return `None` and the caller reads ETCD.
+
+use common::etcd::Watcher;
+use common::logd;
+use common::spec::artifact::{Package, Scenario};
+use common::startup::StartupTimer;
+use std::collections::{HashMap, HashSet};
+use std::sync::{Arc, RwLock};
+use tokio::time::{sleep, Duration};
+
+/// First delay before re-opening a failed watch
+const RETRY_DELAY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the retry backoff
+const RETRY_DELAY_MAX: Duration = Duration::from_secs(30);
+
+/// ETCD prefix followed by one part of the cache
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum Section {
+    Scenario,
+    Package,
+    /// `Network/{scenario}` YAML
+    Network,
+    /// `Node/{scenario}` YAML
+    Node,
+    /// `cluster/nodes/{node}` NodeInfo JSON
+    NodeRole,
+    /// `Pod/{model}` YAML
+    Pod,
+}
+
+impl Section {
+    pub const ALL: [Section; 6] = [
+        Section::Scenario,
+        Section::Package,
+        Section::Network,
+        Section::Node,
+        Section::NodeRole,
+        Section::Pod,
+    ];
+
+    pub fn prefix(self) -> &'static str {
+        match self {
+            Section::Scenario => "Scenario/",
+            Section::Package => "Package/",
+            Section::Network => "Network/",
+            Section::Node => "Node/",
+            Section::NodeRole => "cluster/nodes/",
+            Section::Pod => "Pod/",
+        }
+    }
+}
+
+/// Sections a [`ScenarioResources`] lookup depends on
+const SCENARIO_SECTIONS: [Section; 4] = [
+    Section::Scenario,
+    Section::Package,
+    Section::Network,
+    Section::Node,
+];
+
+/// Everything a trigger reads for one scenario
+pub struct ScenarioResources {
+    pub scenario: Arc<Scenario>,
+    pub package: Arc<Package>,
+    pub network: Option<String>,
+    pub node: Option<String>,
+}
+
+#[derive(Default)]
+struct Inner {
+    scenarios: HashMap<String, Arc<Scenario>>,
+    packages: HashMap<String, Arc<Package>>,
+    networks: HashMap<String, String>,
+    nodes: HashMap<String, String>,
+    /// Node name → `node_role` of its NodeInfo
+    node_roles: HashMap<String, i32>,
+    /// Model name → Pod YAML
+    pods: HashMap<String, String>,
+    synced: HashSet<Section>,
+    /// Incremented on every change
+    version: u64,
+}
+
+impl Inner {
+    fn clear(&mut self, section: Section) {
+        match section {
+            Section::Scenario => self.scenarios.clear(),
+            Section::Package => self.packages.clear(),
+            Section::Network => self.networks.clear(),
+            Section::Node => self.nodes.clear(),
+            Section::NodeRole => self.node_roles.clear(),
+            Section::Pod => self.pods.clear(),
+        }
+    }
+
+    fn put(&mut self, section: Section, name: &str, value: &str) {
+        let parsed = match section {
+            Section::Scenario => parse_yaml(value).map(|s| {
+                self.scenarios.insert(name.to_string(), Arc::new(s));
+            }),
+            Section::Package => parse_yaml(value).map(|p| {
+                self.packages.insert(name.to_string(), Arc::new(p));
+            }),
+            Section::Network => {
+                self.networks.insert(name.to_string(), value.to_string());
+                Ok(())
+            }
+            Section::Node => {
+                self.nodes.insert(name.to_string(), value.to_string());
+                Ok(())
+            }
+            Section::Pod => {
+                self.pods.insert(name.to_string(), value.to_string());
+                Ok(())
+            }
+            Section::NodeRole => serde_json::from_str::<common::apiserver::NodeInfo>(value)
+                .map(|info| {
+                    self.node_roles.insert(name.to_string(), info.node_role);
+                })
+                .map_err(|e| e.to_string()),
+        };
+        if let Err(e) = parsed {
+            logd!(
+                4,
+                "[ResourceCache] Failed to parse {}{}: {}",
+                section.prefix(),
+                name,
+                e
+            );
+            // An unreadable definition must not keep serving the old one
+            self.delete(section, name);
+        }
+        self.version += 1;
+    }
+
+    fn delete(&mut self, section: Section, name: &str) {
+        match section {
+            Section::Scenario => {
+                self.scenarios.remove(name);
+            }
+            Section::Package => {
+                self.packages.remove(name);
+            }
+            Section::Network => {
+                self.networks.remove(name);
+            }
+            Section::Node => {
+                self.nodes.remove(name);
+            }
+            Section::NodeRole => {
+                self.node_roles.remove(name);
+            }
+            Section::Pod => {
+                self.pods.remove(name);
+            }
+        }
+        self.version += 1;
+    }
+}
+
+fn parse_yaml<T: serde::de::DeserializeOwned>(value: &str) -> Result<T, String> {
+    serde_yaml::from_str(value).map_err(|e| e.to_string())
+}
+
+/// Scenarios, packages and node topology as stored in ETCD
+#[derive(Default)]
+pub struct ResourceCache {
+    inner: RwLock<Inner>,
+}
+
+impl ResourceCache {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Whether `section` reflects ETCD
+    pub fn is_synced(&self, section: Section) -> bool {
+        self.read().synced.contains(&section)
+    }
+
+    /// Number of changes applied so far
+    pub fn version(&self) -> u64 {
+        self.read().version
+    }
+
+    /// Resources of `scenario_name`, `None` unless they can be served from memory
+    ///
+    /// A scenario or package that is not cached also yields `None`, so a
+    /// trigger that races with the watch still finds what was just applied.
+    pub fn scenario_resources(&self, scenario_name: &str) -> Option<ScenarioResources> {
+        let inner = self.read();
+        if !SCENARIO_SECTIONS
+            .iter()
+            .all(|section| inner.synced.contains(section))
+        {
+            return None;
+        }
+        let scenario = inner.scenarios.get(scenario_name)?.clone();
+        let package = inner.packages.get(&scenario.get_targets())?.clone();
+        Some(ScenarioResources {
+            scenario,
+            package,
+            network: inner.networks.get(scenario_name).cloned(),
+            node: inner.nodes.get(scenario_name).cloned(),
+        })
+    }
+
+    /// `node_role` of the registered node, `None` while not synced or unknown
+    pub fn node_role(&self, node_name: &str) -> Option<i32> {
+        let inner = self.read();
+        if !inner.synced.contains(&Section::NodeRole) {
+            return None;
+        }
+        inner.node_roles.get(node_name).copied()
+    }
+
+    /// Pod YAML of `model_name`, `None` while not synced or unknown
+    ///
+    /// An unknown model also yields `None`, so a trigger that races with
+    /// the watch still finds a Pod that was just applied.
+    pub fn pod(&self, model_name: &str) -> Option<String> {
+        let inner = self.read();
+        if !inner.synced.contains(&Section::Pod) {
+            return None;
+        }
+        inner.pods.get(model_name).cloned()
+    }
+
+    /// Replace `section` from `(key, value)` entries under its prefix
+    pub fn replace_section(&self, section: Section, entries: Vec<(String, String)>) {
+        let mut inner = self.write();
+        inner.clear(section);
+        for (key, value) in entries {
+            if let Some(name) = key.strip_prefix(section.prefix()) {
+                inner.put(section, name, &value);
+            }
+        }
+        inner.synced.insert(section);
+    }
+
+    pub fn apply_put(&self, section: Section, key: &str, value: &str) {
+        if let Some(name) = key.strip_prefix(section.prefix()) {
+            self.write().put(section, name, value);
+        }
+    }
+
+    pub fn apply_delete(&self, section: Section, key: &str) {
+        if let Some(name) = key.strip_prefix(section.prefix()) {
+            self.write().delete(section, name);
+        }
+    }
+
+    fn mark_unsynced(&self, section: Section) {
+        self.write().synced.remove(&section);
+    }
+
+    fn read(&self) -> std::sync::RwLockReadGuard<'_, Inner> {
+        self.inner.read().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn write(&self) -> std::sync::RwLockWriteGuard<'_, Inner> {
+        self.inner.write().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+/// Load every section from one snapshot, then start one watch per section
+/// for the lifetime of ActionController
+pub fn spawn_watchers(cache: &Arc<ResourceCache>) {
+    let cache = Arc::clone(cache);
+    tokio::spawn(async move {
+        let mut timer = StartupTimer::start("actioncontroller");
+        let prefixes: Vec<&str> = Section::ALL.iter().map(|s| s.prefix()).collect();
+        let watchers: Vec<Option<Watcher>> = match common::etcd::snapshot_and_watch(&prefixes).await
+        {
+            Ok((snapshot, watchers)) => {
+                timer.mark("snapshot");
+                for section in Section::ALL {
+                    let entries = snapshot.with_prefix(section.prefix()).to_vec();
+                    cache.replace_section(section, entries);
+                }
+                timer.mark("cache");
+                timer.note(format!(
+                    "{} entries at rev {}",
+                    snapshot.len(),
+                    snapshot.revision()
+                ));
+                timer.finish();
+                watchers.into_iter().map(Some).collect()
+            }
+            Err(e) => {
+                logd!(
+                    4,
+                    "[ResourceCache] Snapshot failed, loading each section: {}",
+                    e
+                );
+                Section::ALL.iter().map(|_| None).collect()
+            }
+        };
+        for (section, watcher) in Section::ALL.into_iter().zip(watchers) {
+            tokio::spawn(watch_section(Arc::clone(&cache), section, watcher));
+        }
+    });
+}
+
+/// Keeps `section` of `cache` in sync with its ETCD prefix
+///
+/// `warm` is a watcher that continues from the snapshot the section was
+/// loaded from. Otherwise the initial contents replace the section at once
+/// when the watch reports `synced`. When the stream fails or closes the
+/// section is marked unsynced and the watch is re-opened with exponential
+/// backoff.
+pub async fn watch_section(cache: Arc<ResourceCache>, section: Section, mut warm: Option<Watcher>) {
+    let mut delay = RETRY_DELAY_MIN;
+    loop {
+        let watcher = match warm.take() {
+            Some(watcher) => Ok(watcher),
+            None => common::etcd::watch(section.prefix(), true).await,
+        };
+        match watcher {
+            Ok(mut watcher) => {
+                let mut initial = Vec::new();
+                loop {
+                    let batch = match watcher.next().await {
+                        Ok(Some(batch)) => batch,
+                        Ok(None) => {
+                            logd!(4, "[ResourceCache] {} watch closed", section.prefix());
+                            break;
+                        }
+                        Err(e) => {
+                            logd!(
+                                4,
+                                "[ResourceCache] {} watch failed: {}",
+                                section.prefix(),
+                                e
+                            );
+                            break;
+                        }
+                    };
+                    if batch.initial {
+                        for event in batch.events {
+                            if let common::etcd::WatchEvent::Put { key, value } = event {
+                                initial.push((key, value));
+                            }
+                        }
+                        if batch.synced {
+                            cache.replace_section(section, std::mem::take(&mut initial));
+                            delay = RETRY_DELAY_MIN;
+                            logd!(2, "[ResourceCache] {} synced", section.prefix());
+                        }
+                        continue;
+                    }
+                    for event in batch.events {
+                        match event {
+                            common::etcd::WatchEvent::Put { key, value } => {
+                                cache.apply_put(section, &key, &value)
+                            }
+                            common::etcd::WatchEvent::Delete { key } => {
+                                cache.apply_delete(section, &key)
+                            }
+                        }
+                    }
+                }
+            }
+            Err(e) => logd!(
+                4,
+                "[ResourceCache] Failed to watch {}: {}",
+                section.prefix(),
+                e
+            ),
+        }
+
+        cache.mark_unsynced(section);
+        sleep(delay).await;
+        delay = (delay * 2).min(RETRY_DELAY_MAX);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const SCENARIO: &str = r#"
+apiVersion: v1
+kind: Scenario
+metadata:
+  name: s1
+spec:
+  condition:
+  action: launch
+  target: p1
+"#;
+
+    const PACKAGE: &str = r#"
+apiVersion: v1
+kind: Package
+metadata:
+  name: p1
+spec:
+  pattern:
+    - type: plain
+  models:
+    - name: m1
+      node: HPC
+      resources:
+        volume:
+        network:
+"#;
+
+    fn sync_all(cache: &ResourceCache) {
+        for section in Section::ALL {
+            cache.replace_section(section, vec![]);
+        }
+    }
+
+    #[test]
+    fn test_lookups_are_none_until_synced() {
+        let cache = ResourceCache::new();
+        cache.apply_put(Section::Scenario, "Scenario/s1", SCENARIO);
+        cache.apply_put(Section::Package, "Package/p1", PACKAGE);
+        assert!(cache.scenario_resources("s1").is_none());
+
+        for section in Section::ALL {
+            if section != Section::Scenario && section != Section::Package {
+                cache.replace_section(section, vec![]);
+            }
+        }
+        cache.replace_section(
+            Section::Scenario,
+            vec![("Scenario/s1".to_string(), SCENARIO.to_string())],
+        );
+        cache.replace_section(
+            Section::Package,
+            vec![("Package/p1".to_string(), PACKAGE.to_string())],
+        );
+        let resources = cache.scenario_resources("s1").unwrap();
+        assert_eq!(resources.package.get_models().len(), 1);
+        assert_eq!(resources.network, None);
+    }
+
+    #[test]
+    fn test_puts_and_deletes_update_entries() {
+        let cache = ResourceCache::new();
+        sync_all(&cache);
+        cache.apply_put(Section::Scenario, "Scenario/s1", SCENARIO);
+        assert!(cache.scenario_resources("s1").is_none(), "package missing");
+
+        let before = cache.version();
+        cache.apply_put(Section::Package, "Package/p1", PACKAGE);
+        cache.apply_put(Section::Network, "Network/s1", "net-yaml");
+        assert!(cache.version() > before);
+        let resources = cache.scenario_resources("s1").unwrap();
+        assert_eq!(resources.network.as_deref(), Some("net-yaml"));
+
+        cache.apply_delete(Section::Scenario, "Scenario/s1");
+        assert!(cache.scenario_resources("s1").is_none());
+    }
+
+    #[test]
+    fn test_pods_served_once_synced() {
+        let cache = ResourceCache::new();
+        cache.apply_put(Section::Pod, "Pod/m1", "pod-yaml");
+        assert_eq!(cache.pod("m1"), None);
+
+        cache.replace_section(
+            Section::Pod,
+            vec![("Pod/m1".to_string(), "pod-yaml".to_string())],
+        );
+        assert_eq!(cache.pod("m1").as_deref(), Some("pod-yaml"));
+        cache.apply_delete(Section::Pod, "Pod/m1");
+        assert_eq!(cache.pod("m1"), None);
+    }
+
+    #[test]
+    fn test_node_roles_follow_node_info() {
+        let cache = ResourceCache::new();
+        cache.apply_put(
+            Section::NodeRole,
+            "cluster/nodes/HPC",
+            r#"{"node_id":"HPC","hostname":"HPC","ip_address":"10.0.0.1","node_type":1,"node_role":2,"status":0,"resources":null,"last_heartbeat":0,"created_at":0,"metadata":{}}"#,
+        );
+        assert_eq!(cache.node_role("HPC"), None);
+
+        sync_all(&cache);
+        cache.apply_put(
+            Section::NodeRole,
+            "cluster/nodes/HPC",
+            r#"{"node_id":"HPC","hostname":"HPC","ip_address":"10.0.0.1","node_type":1,"node_role":2,"status":0,"resources":null,"last_heartbeat":0,"created_at":0,"metadata":{}}"#,
+        );
+        assert_eq!(cache.node_role("HPC"), Some(2));
+
+        // An unreadable update drops the stale role
+        cache.apply_put(Section::NodeRole, "cluster/nodes/HPC", "not json");
+        assert_eq!(cache.node_role("HPC"), None);
+    }
+}
@@ -0,0 +1,326 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Concurrent Model Fan-out
+//!
+//! A scenario action runs once per model of the target package. Models are
+//! arranged in waves by their `dependsOn` hints: a model starts only after
+//! every model it depends on has finished. Within a wave, the models of one
+//! node run one after the other in definition order while different nodes
+//! run concurrently, at most [`MAX_CONCURRENT_NODES`] at a time.
+//!
+//! A failing model does not stop the others. Its dependents are skipped and
+//! every failure is reported together once all models are done.
+
+use futures::future::join_all;
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::future::Future;
+use tokio::sync::Semaphore;
+use tokio::time::{Duration, Instant};
+
+/// Nodes processed at the same time within a wave
+pub const MAX_CONCURRENT_NODES: usize = 8;
+
+/// Model scheduled by the fan-out
+#[derive(Debug, Clone, PartialEq)]
+pub struct PlannedModel {
+    pub name: String,
+    pub node: String,
+    pub depends_on: Vec<String>,
+}
+
+/// Result of one model action
+#[derive(Debug)]
+pub struct ModelOutcome {
+    pub name: String,
+    pub node: String,
+    /// Time spent on the action, zero if the model was skipped
+    pub elapsed: Duration,
+    pub result: std::result::Result<(), String>,
+}
+
+/// Arrange `models` in waves of indices so that each model comes after the
+/// models it depends on
+///
+/// Dependencies on models that are not part of `models` are ignored, since
+/// nothing in this fan-out can satisfy them.
+pub fn plan_waves(models: &[PlannedModel]) -> Result<Vec<Vec<usize>>, String> {
+    let index: HashMap<&str, usize> = models
+        .iter()
+        .enumerate()
+        .map(|(i, model)| (model.name.as_str(), i))
+        .collect();
+
+    let mut remaining: Vec<HashSet<usize>> = models
+        .iter()
+        .map(|model| {
+            model
+                .depends_on
+                .iter()
+                .filter_map(|dep| index.get(dep.as_str()).copied())
+                .collect()
+        })
+        .collect();
+
+    let mut waves = Vec::new();
+    let mut done = vec![false; models.len()];
+    let mut placed = 0;
+    while placed < models.len() {
+        let wave: Vec<usize> = (0..models.len())
+            .filter(|&i| !done[i] && remaining[i].is_empty())
+            .collect();
+        if wave.is_empty() {
+            let cycle: Vec<&str> = (0..models.len())
+                .filter(|&i| !done[i])
+                .map(|i| models[i].name.as_str())
+                .collect();
+            return Err(format!(
+                "Dependency cycle between models: {}",
+                cycle.join(", ")
+            ));
+        }
+        for &i in &wave {
+            done[i] = true;
+        }
+        for deps in remaining.iter_mut() {
+            deps.retain(|dep| !done[*dep]);
+        }
+        placed += wave.len();
+        waves.push(wave);
+    }
+    Ok(waves)
+}
+
+/// Run `action` for every model, wave by wave
+///
+/// `action` receives the index of a model in `models`. Outcomes are returned
+/// in the order of `models`.
+pub async fn run<F, Fut>(
+    models: &[PlannedModel],
+    max_concurrent_nodes: usize,
+    action: F,
+) -> Result<Vec<ModelOutcome>, String>
+where
+    F: Fn(usize) -> Fut,
+    Fut: Future<Output = common::Result<()>>,
+{
+    let waves = plan_waves(models)?;
+    let limit = Semaphore::new(max_concurrent_nodes.max(1));
+    let mut failed: HashSet<&str> = HashSet::new();
+    let mut outcomes: Vec<Option<ModelOutcome>> = models.iter().map(|_| None).collect();
+
+    for wave in waves {
+        let mut groups: BTreeMap<&str, Vec<usize>> = BTreeMap::new();
+        for i in wave {
+            let model = &models[i];
+            if let Some(dep) = model
+                .depends_on
+                .iter()
+                .find(|dep| failed.contains(dep.as_str()))
+            {
+                outcomes[i] = Some(ModelOutcome {
+                    name: model.name.clone(),
+                    node: model.node.clone(),
+                    elapsed: Duration::ZERO,
+                    result: Err(format!("skipped because '{}' failed", dep)),
+                });
+                failed.insert(&model.name);
+                continue;
+            }
+            groups.entry(model.node.as_str()).or_default().push(i);
+        }
+
+        let tasks = groups
+            .into_values()
+            .map(|indices| run_node_group(models, indices, &limit, &action));
+        for (i, outcome) in join_all(tasks).await.into_iter().flatten() {
+            if outcome.result.is_err() {
+                failed.insert(&models[i].name);
+            }
+            outcomes[i] = Some(outcome);
+        }
+    }
+
+    Ok(outcomes.into_iter().flatten().collect())
+}
+
+/// Run the models of one node sequentially once a node slot is free
+async fn run_node_group<F, Fut>(
+    models: &[PlannedModel],
+    indices: Vec<usize>,
+    limit: &Semaphore,
+    action: &F,
+) -> Vec<(usize, ModelOutcome)>
+where
+    F: Fn(usize) -> Fut,
+    Fut: Future<Output = common::Result<()>>,
+{
+    // The semaphore is never closed
+    let _permit = limit.acquire().await.ok();
+    let mut outcomes = Vec::with_capacity(indices.len());
+    for i in indices {
+        let started = Instant::now();
+        let result = action(i).await.map_err(|e| e.to_string());
+        outcomes.push((
+            i,
+            ModelOutcome {
+                name: models[i].name.clone(),
+                node: models[i].node.clone(),
+                elapsed: started.elapsed(),
+                result,
+            },
+        ));
+    }
+    outcomes
+}
+
+/// Combine the failures of `outcomes` into one error
+pub fn aggregate_errors(outcomes: &[ModelOutcome]) -> common::Result<()> {
+    let failures: Vec<String> = outcomes
+        .iter()
+        .filter_map(|outcome| {
+            outcome
+                .result
+                .as_ref()
+                .err()
+                .map(|e| format!("'{}' on '{}': {}", outcome.name, outcome.node, e))
+        })
+        .collect();
+    if failures.is_empty() {
+        return Ok(());
+    }
+    Err(format!(
+        "{} of {} models failed: {}",
+        failures.len(),
+        outcomes.len(),
+        failures.join("; ")
+    )
+    .into())
+}
+
+/// Per-model timing on one line, e.g.
+/// `db@node1=120ms, web@node2=failed after 8ms`
+pub fn timing_report(outcomes: &[ModelOutcome]) -> String {
+    outcomes
+        .iter()
+        .map(|outcome| match outcome.result {
+            Ok(()) => format!(
+                "{}@{}={}ms",
+                outcome.name,
+                outcome.node,
+                outcome.elapsed.as_millis()
+            ),
+            Err(_) => format!(
+                "{}@{}=failed after {}ms",
+                outcome.name,
+                outcome.node,
+                outcome.elapsed.as_millis()
+            ),
+        })
+        .collect::<Vec<_>>()
+        .join(", ")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::Mutex;
+
+    fn model(name: &str, node: &str, depends_on: &[&str]) -> PlannedModel {
+        PlannedModel {
+            name: name.to_string(),
+            node: node.to_string(),
+            depends_on: depends_on.iter().map(|d| d.to_string()).collect(),
+        }
+    }
+
+    #[test]
+    fn test_plan_waves_orders_dependencies() {
+        let models = vec![
+            model("web", "n1", &["api"]),
+            model("db", "n2", &[]),
+            model("api", "n1", &["db", "external"]),
+            model("cache", "n3", &[]),
+        ];
+        assert_eq!(
+            plan_waves(&models).unwrap(),
+            vec![vec![1, 3], vec![2], vec![0]]
+        );
+    }
+
+    #[test]
+    fn test_plan_waves_rejects_cycle() {
+        let models = vec![
+            model("a", "n1", &["b"]),
+            model("b", "n1", &["a"]),
+            model("c", "n1", &[]),
+        ];
+        let err = plan_waves(&models).unwrap_err();
+        assert!(err.contains("a, b"), "{}", err);
+    }
+
+    #[tokio::test]
+    async fn test_run_overlaps_nodes_and_serializes_each_node() {
+        let models = vec![
+            model("a1", "n1", &[]),
+            model("a2", "n1", &[]),
+            model("b1", "n2", &[]),
+        ];
+        let running = AtomicUsize::new(0);
+        let peak = AtomicUsize::new(0);
+        let order = Mutex::new(Vec::new());
+
+        let outcomes = run(&models, MAX_CONCURRENT_NODES, |i| {
+            let (running, peak, order, models) = (&running, &peak, &order, &models);
+            async move {
+                let now = running.fetch_add(1, Ordering::SeqCst) + 1;
+                peak.fetch_max(now, Ordering::SeqCst);
+                tokio::time::sleep(Duration::from_millis(20)).await;
+                order.lock().unwrap().push(models[i].name.clone());
+                running.fetch_sub(1, Ordering::SeqCst);
+                Ok(())
+            }
+        })
+        .await
+        .unwrap();
+
+        assert_eq!(peak.load(Ordering::SeqCst), 2);
+        let order = order.into_inner().unwrap();
+        let pos = |name: &str| order.iter().position(|n| n == name).unwrap();
+        assert!(pos("a1") < pos("a2"));
+        assert_eq!(outcomes.len(), 3);
+        assert!(aggregate_errors(&outcomes).is_ok());
+        assert!(timing_report(&outcomes).starts_with("a1@n1="));
+    }
+
+    #[tokio::test]
+    async fn test_run_aggregates_errors_and_skips_dependents() {
+        let models = vec![
+            model("db", "n1", &[]),
+            model("api", "n2", &["db"]),
+            model("cache", "n3", &[]),
+        ];
+        let outcomes = run(&models, 1, |i| {
+            let fails = models[i].name == "db";
+            async move {
+                let result: common::Result<()> = if fails {
+                    Err("pull failed".into())
+                } else {
+                    Ok(())
+                };
+                result
+            }
+        })
+        .await
+        .unwrap();
+
+        assert!(outcomes[0].result.is_err());
+        assert!(outcomes[1].result.as_ref().unwrap_err().contains("skipped"));
+        assert!(outcomes[2].result.is_ok());
+        let err = aggregate_errors(&outcomes).unwrap_err().to_string();
+        assert!(err.starts_with("2 of 3 models failed"), "{}", err);
+    }
+}
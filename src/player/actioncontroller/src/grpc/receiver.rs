@@ -78,6 +78,10 @@ impl ActionControllerConnection for ActionControllerReceiver {
 
         logd!(1, "trigger_action in grpc receiver");
 
+        let trace_id = common::trace::from_request(&request);
+        if let Some(id) = &trace_id {
+            common::trace::mark(id, common::trace::Stage::ActionReceived);
+        }
         let scenario_name = request.into_inner().scenario_name;
         logd!(2, "trigger_action scenario: {}", scenario_name);
 
@@ -100,7 +104,12 @@ impl ActionControllerConnection for ActionControllerReceiver {
         );
 
         logd!(1, "   🎯 Processing scenario actions...");
-        let result = match self.manager.trigger_manager_action(&scenario_name).await {
+        let action = self.manager.trigger_manager_action(&scenario_name);
+        let outcome = match trace_id {
+            Some(id) => common::trace::scope(id, action).await,
+            None => action.await,
+        };
+        let result = match outcome {
             Ok(_) => Ok(Response::new(TriggerActionResponse {
                 status: 0,
                 desc: "Action triggered successfully".to_string(),
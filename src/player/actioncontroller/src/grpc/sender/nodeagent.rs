@@ -2,7 +2,7 @@ use common::nodeagent::fromactioncontroller::{
     connect_server, HandleWorkloadRequest, HandleWorkloadResponse,
 };
 use common::nodeagent::node_agent_connection_client::NodeAgentConnectionClient;
-use tonic::{Request, Status};
+use tonic::Status;
 
 pub async fn send_workload_handle_request(
     addr: &str,
@@ -13,7 +13,7 @@ pub async fn send_workload_handle_request(
         .unwrap();
 
     let response = client
-        .handle_workload(Request::new(request))
+        .handle_workload(common::trace::request(request))
         .await?
         .into_inner();
     Ok(response)
@@ -17,7 +17,7 @@ use common::statemanager::{
     connect_server, state_manager_connection_client::StateManagerConnectionClient, ResourceType,
     StateChange, StateChangeResponse,
 };
-use tonic::{Request, Status};
+use tonic::Status;
 
 /// StateManager gRPC client for ActionController component.
 ///
@@ -202,7 +202,9 @@ impl StateManagerSender {
 
         if let Some(client) = &mut self.client {
             // Send the state change message via gRPC
-            client.send_state_change(Request::new(state_change)).await
+            client
+                .send_state_change(common::trace::request(state_change))
+                .await
         } else {
             // This should never happen due to ensure_connected, but provide safety fallback
             Err(Status::unknown("Client not connected"))
@@ -6,6 +6,8 @@ use common::logd;
 use common::logd::logger;
 use std::error::Error;
 
+mod cache;
+mod fanout;
 mod grpc;
 mod manager;
 mod runtime;
@@ -50,6 +52,7 @@ async fn initialize(skip_grpc: bool) -> Result<(), Box<dyn Error>> {
 
     // gRPC 서버 초기화 (테스트 모드가 아닌 경우)
     if !skip_grpc {
+        cache::spawn_watchers(manager.resource_cache());
         grpc::init(manager).await?;
     }
 
@@ -2,8 +2,10 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
-use std::{collections::HashMap, thread, time::Duration};
+use std::{collections::HashMap, sync::Arc, thread, time::Duration};
 
+use crate::cache::ResourceCache;
+use crate::fanout::{self, ModelOutcome, PlannedModel, MAX_CONCURRENT_NODES};
 use crate::grpc::sender::pharos::request_network_pod;
 use crate::grpc::sender::statemanager::StateManagerSender;
 use common::logd;
@@ -42,6 +44,8 @@ pub struct ActionControllerManager {
     pub nodeagent_nodes: Vec<String>,
     /// StateManager sender for scenario state changes
     state_sender: StateManagerSender,
+    /// Parsed scenarios, packages and node roles kept current by a watch
+    cache: Arc<ResourceCache>,
     // Add other fields as needed
 }
 #[allow(dead_code)]
@@ -60,9 +64,15 @@ impl ActionControllerManager {
         Self {
             nodeagent_nodes: Vec::new(),
             state_sender: StateManagerSender::new(),
+            cache: Arc::new(ResourceCache::new()),
         }
     }
 
+    /// Cache to keep in sync with [`crate::cache::spawn_watchers`]
+    pub fn resource_cache(&self) -> &Arc<ResourceCache> {
+        &self.cache
+    }
+
     /// Fetches node role information from etcd
     ///
     /// Retrieves node information from etcd to determine if it is a nodeagent node.
@@ -148,6 +158,21 @@ impl ActionControllerManager {
                 continue;
             }
 
+            if let Some(node_role) = self.cache.node_role(&model_node) {
+                if node_role == NODE_ROLE_NODEAGENT {
+                    node_roles.insert(model_node, NODE_TYPE_NODEAGENT.to_string());
+                } else if self.nodeagent_nodes.contains(&model_node) {
+                    logd!(
+                        4,
+                        "Warning: Unknown role {} for node '{}', using cached nodeagent_nodes",
+                        node_role,
+                        model_node
+                    );
+                    node_roles.insert(model_node, NODE_TYPE_NODEAGENT.to_string());
+                }
+                continue;
+            }
+
             match self.get_node_role_from_etcd(&model_node).await {
                 Ok(role) => {
                     node_roles.insert(model_node.clone(), role);
@@ -174,11 +199,21 @@ impl ActionControllerManager {
         node_roles
     }
 
-    /// Get ETCD keys for scenario resources
+    /// Get scenario resources, from the cache when it has them
     async fn get_scenario_resources(
         &self,
         scenario_name: &str,
-    ) -> Result<(Scenario, Package, Option<String>, Option<String>)> {
+    ) -> Result<(Arc<Scenario>, Arc<Package>, Option<String>, Option<String>)> {
+        if let Some(cached) = self.cache.scenario_resources(scenario_name) {
+            logd!(
+                1,
+                "Scenario '{}' served from cache (version {})",
+                scenario_name,
+                self.cache.version()
+            );
+            return Ok((cached.scenario, cached.package, cached.network, cached.node));
+        }
+
         let etcd_scenario_key = format!("{}/{}", ETCD_SCENARIO_PREFIX, scenario_name);
         let scenario_str = common::etcd::get(&etcd_scenario_key)
             .await
@@ -205,7 +240,7 @@ impl ActionControllerManager {
             .await
             .ok();
 
-        Ok((scenario, package, network_str, node_str))
+        Ok((Arc::new(scenario), Arc::new(package), network_str, node_str))
     }
 
     /// Execute action on a model
@@ -220,7 +255,10 @@ impl ActionControllerManager {
     ) -> Result<()> {
         let model_name = model_info.get_name();
         let model_node = model_info.get_node();
-        let pod = common::etcd::get(&format!("{}/{}", ETCD_POD_PREFIX, model_name)).await?;
+        let pod = match self.cache.pod(&model_name) {
+            Some(pod) => pod,
+            None => common::etcd::get(&format!("{}/{}", ETCD_POD_PREFIX, model_name)).await?,
+        };
 
         match action {
             "launch" => {
@@ -292,7 +330,15 @@ impl ActionControllerManager {
     }
 
     /// Send state change notification to StateManager
-    async fn notify_state_change(&self, scenario_name: &str, current: &str, target: &str) {
+    ///
+    /// The per-model timing of the action is logged with the notification.
+    async fn notify_state_change(
+        &self,
+        scenario_name: &str,
+        current: &str,
+        target: &str,
+        outcomes: &[ModelOutcome],
+    ) {
         let timestamp = std::time::SystemTime::now()
             .duration_since(std::time::UNIX_EPOCH)
             .unwrap()
@@ -303,7 +349,9 @@ impl ActionControllerManager {
             resource_name: scenario_name.to_string(),
             current_state: current.to_string(),
             target_state: target.to_string(),
-            transition_id: format!("actioncontroller-processing-complete-{}", timestamp),
+            // StateManager marks the end of a trace when it applies this change
+            transition_id: common::trace::current()
+                .unwrap_or_else(|| format!("actioncontroller-processing-complete-{}", timestamp)),
             timestamp_ns: timestamp,
             source: "actioncontroller".to_string(),
         };
@@ -316,16 +364,18 @@ impl ActionControllerManager {
         {
             logd!(
                 5,
-                "  ❌ Failed to send state change to StateManager: {:?}",
-                e
+                "  ❌ Failed to send state change to StateManager: {:?} ({})",
+                e,
+                fanout::timing_report(outcomes)
             );
         } else {
             logd!(
                 3,
-                "  ✅ Successfully notified StateManager: scenario {}, {} → {}",
+                "  ✅ Successfully notified StateManager: scenario {}, {} → {} ({})",
                 scenario_name,
                 current,
-                target
+                target,
+                fanout::timing_report(outcomes)
             );
         }
     }
@@ -388,54 +438,63 @@ impl ActionControllerManager {
         let action = scenario.get_actions();
         let node_roles = self.load_node_roles(&package).await;
 
+        // Models on nodes without a known role are left out of the fan-out
+        let mut targets: Vec<(&ModelInfo, &str)> = Vec::new();
         for mi in package.get_models() {
-            let model_name = mi.get_name();
             let model_node = mi.get_node();
-
-            let node_type = match node_roles.get(&model_node) {
+            match node_roles.get(&model_node) {
                 Some(role) => {
                     logd!(2, "Using node {} as {}", model_node, role);
-                    role.as_str()
+                    targets.push((mi, role.as_str()));
                 }
                 None => {
                     logd!(4, "Warning: Node '{}' is not configured or cannot determine its role. Skipping deployment.", model_node);
-                    continue;
                 }
-            };
-
-            logd!(
-                2,
-                "Processing model '{}' on node '{}' with action '{}'",
-                model_name,
-                model_node,
-                action
-            );
-
-            self.execute_model_action(
-                &action,
-                &mi,
-                node_type,
-                scenario_name,
-                &network_str,
-                &node_str,
-            )
-            .await
-            .map_err(|e| {
-                format!(
-                    "Failed to execute action '{}' on model '{}': {}",
-                    action, model_name, e
-                )
-            })?;
+            }
         }
 
-        if let Some(sched) = package.get_schedule() {
-            self.handle_realtime_sched(sched).await?;
+        let planned: Vec<PlannedModel> = targets.iter().map(|(mi, _)| planned_model(mi)).collect();
+        let outcomes = fanout::run(&planned, MAX_CONCURRENT_NODES, |i| {
+            let (mi, node_type) = targets[i];
+            let (action, network_str, node_str) = (&action, &network_str, &node_str);
+            async move {
+                logd!(
+                    2,
+                    "Processing model '{}' on node '{}' with action '{}'",
+                    mi.get_name(),
+                    mi.get_node(),
+                    action
+                );
+                let result: Result<()> = self
+                    .execute_model_action(
+                        action,
+                        mi,
+                        node_type,
+                        scenario_name,
+                        network_str,
+                        node_str,
+                    )
+                    .await
+                    .map_err(|e| format!("Failed to execute action '{}': {}", action, e).into());
+                result
+            }
+        })
+        .await?;
+        // StateManager learns the outcome and the timing is logged even when
+        // part of the waves failed; the package state then follows the
+        // containers that did start
+        let failures = fanout::aggregate_errors(&outcomes);
+
+        if failures.is_ok() {
+            if let Some(sched) = package.get_schedule() {
+                self.handle_realtime_sched(sched).await?;
+            }
         }
 
-        self.notify_state_change(scenario_name, "allowed", "completed")
+        self.notify_state_change(scenario_name, "allowed", "completed", &outcomes)
             .await;
 
-        Ok(())
+        failures
     }
 
     /// Reconciles current and desired states for a scenario
@@ -485,19 +544,13 @@ impl ActionControllerManager {
             .into());
         }
 
-        let etcd_scenario_key: String = format!("scenario/{}", scenario_name);
-        let scenario_str = common::etcd::get(&etcd_scenario_key).await?;
-        let scenario: Scenario = serde_yaml::from_str(&scenario_str)?;
-
-        let etcd_package_key = format!("package/{}", scenario.get_targets());
-        let package_str = common::etcd::get(&etcd_package_key).await?;
-        let package: Package = serde_yaml::from_str(&package_str)?;
+        let (_, package, _, _) = self.get_scenario_resources(&scenario_name).await?;
 
+        let mut targets: Vec<&ModelInfo> = Vec::new();
         for mi in package.get_models() {
-            let model_name = format!("{}.service", mi.get_name());
             let model_node = mi.get_node();
-            let node_type = if self.nodeagent_nodes.contains(&model_node) {
-                "nodeagent"
+            if self.nodeagent_nodes.contains(&model_node) {
+                targets.push(mi);
             } else {
                 // Log warning for unknown node types and skip processing
                 logd!(
@@ -505,14 +558,29 @@ impl ActionControllerManager {
                     "Warning: Node '{}' is not explicitly configured. Skipping deployment.",
                     model_node
                 );
-                continue;
-            };
-
-            if desired == Status::Running {
-                self.start_workload(&model_name, &model_node, node_type)
-                    .await?;
             }
         }
+        if desired != Status::Running {
+            return Ok(());
+        }
+
+        let planned: Vec<PlannedModel> = targets.iter().map(|mi| planned_model(mi)).collect();
+        let outcomes = fanout::run(&planned, MAX_CONCURRENT_NODES, |i| {
+            let mi = targets[i];
+            async move {
+                let model_name = format!("{}.service", mi.get_name());
+                self.start_workload(&model_name, &mi.get_node(), NODE_TYPE_NODEAGENT)
+                    .await
+            }
+        })
+        .await?;
+        logd!(
+            2,
+            "Reconciled scenario '{}': {}",
+            scenario_name,
+            fanout::timing_report(&outcomes)
+        );
+        fanout::aggregate_errors(&outcomes)?;
 
         Ok(())
     }
@@ -661,6 +729,15 @@ impl ActionControllerManager {
     }
 }
 
+/// Fan-out entry for a model of a package
+fn planned_model(model_info: &ModelInfo) -> PlannedModel {
+    PlannedModel {
+        name: model_info.get_name(),
+        node: model_info.get_node(),
+        depends_on: model_info.get_depends_on().clone(),
+    }
+}
+
 //UNIT TEST SKELTON
 
 #[cfg(test)]
@@ -874,6 +951,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("launch-test").await;
@@ -924,6 +1002,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("terminate-test").await;
@@ -976,6 +1055,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("update-test").await;
@@ -1025,6 +1105,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("rollback-test").await;
@@ -1075,6 +1156,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("unknown-node-test").await;
@@ -1129,6 +1211,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec!["ZONE".to_string()],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("nodeagent-test").await;
@@ -1199,6 +1282,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec!["ZONE".to_string()],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager
@@ -1227,6 +1311,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec!["ZONE".to_string()],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager
@@ -1259,6 +1344,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
         let result = manager
             .reconcile_do("antipinch-enable".into(), Status::Running, Status::Running)
@@ -1309,6 +1395,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("antipinch-enable").await;
@@ -1334,6 +1421,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager.trigger_manager_action("invalid_scenario").await;
@@ -1345,6 +1433,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager
@@ -1358,6 +1447,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result: std::result::Result<(), Box<dyn Error>> = manager
@@ -1371,6 +1461,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         let result = manager
@@ -1391,6 +1482,7 @@ spec:
         let manager = ActionControllerManager {
             nodeagent_nodes: vec![],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         assert!(manager.create_workload("test".into()).await.is_ok());
@@ -1398,11 +1490,48 @@ spec:
         assert!(manager.pause_workload("test".into()).await.is_ok());
     }
 
+    #[tokio::test]
+    async fn test_cached_node_role_skips_etcd() {
+        let manager = ActionControllerManager::new();
+        let cache = manager.resource_cache();
+        cache.replace_section(crate::cache::Section::NodeRole, vec![]);
+        cache.apply_put(
+            crate::cache::Section::NodeRole,
+            "cluster/nodes/CACHED",
+            r#"{"node_id":"CACHED","hostname":"CACHED","ip_address":"10.0.0.9","node_type":1,"node_role":2,"status":0,"resources":null,"last_heartbeat":0,"created_at":0,"metadata":{}}"#,
+        );
+        let package: Package = serde_yaml::from_str(
+            r#"
+apiVersion: v1
+kind: Package
+metadata:
+  name: cached-pkg
+spec:
+  pattern:
+    - type: plain
+  models:
+    - name: m1
+      node: CACHED
+      resources:
+        volume:
+        network:
+"#,
+        )
+        .unwrap();
+
+        let roles = manager.load_node_roles(&package).await;
+        assert_eq!(
+            roles.get("CACHED").map(String::as_str),
+            Some(NODE_TYPE_NODEAGENT)
+        );
+    }
+
     #[test]
     fn test_unknown_nodes_skipped() {
         let manager = ActionControllerManager {
             nodeagent_nodes: vec!["ZONE".to_string()],
             state_sender: StateManagerSender::new(),
+            cache: Default::default(),
         };
 
         assert!(manager.nodeagent_nodes.contains(&"ZONE".to_string()));
@@ -4,6 +4,7 @@
 */
 use common::logd;
 use common::nodeagent::fromactioncontroller::{HandleWorkloadRequest, WorkloadCommand};
+use common::trace::{self, Stage};
 use common::Result;
 /// Runtime implementation for NodeAgent API interactions
 ///
@@ -26,6 +27,13 @@ pub async fn handle_workload(cmd: WorkloadCommand, pod: &str, node_name: &str) -
             pod: pod.to_string(),
         };
         crate::grpc::sender::nodeagent::send_workload_handle_request(&addr, request).await?;
+
+        // NodeAgent answers once Podman has started the containers
+        if matches!(cmd, WorkloadCommand::Start | WorkloadCommand::Restart) {
+            if let Some(id) = trace::current() {
+                trace::mark(&id, Stage::WorkloadStarted);
+            }
+        }
     } else {
         logd!(2, "Node {} not found in DB", node_name);
         return Err(format!("Node {} not found in DB", node_name).into());
@@ -9,7 +9,7 @@ use std::io::Write;
 use std::path::{Path, PathBuf};
 
 use crate::build_scripts::idl::IdlParser;
-use crate::build_scripts::types::idl_to_rust_type;
+use crate::build_scripts::types::{field_value_expr, idl_to_rust_type};
 
 /// Function to generate struct file
 pub fn generate_struct_file(
@@ -43,6 +43,58 @@ pub fn generate_struct_file(
     // Close struct (removed manual impl of DdsType)
     writeln!(file, "}}")?;
 
+    generate_field_access(&mut file, struct_name, fields)?;
+
+    Ok(())
+}
+
+/// Write the `FieldAccess` impl of a struct
+///
+/// Listeners read condition fields through it instead of serializing every
+/// sample to JSON.
+fn generate_field_access(
+    file: &mut fs::File,
+    struct_name: &str,
+    fields: &HashMap<String, String>,
+) -> Result<(), Box<dyn std::error::Error>> {
+    // Sorted for a stable output across builds
+    let mut names: Vec<&String> = fields.keys().collect();
+    names.sort();
+
+    let quoted: Vec<String> = names.iter().map(|name| format!("\"{}\"", name)).collect();
+
+    writeln!(file)?;
+    writeln!(
+        file,
+        "impl crate::vehicle::dds::fields::FieldAccess for {} {{",
+        struct_name
+    )?;
+    writeln!(
+        file,
+        "    const FIELD_NAMES: &'static [&'static str] = &[{}];",
+        quoted.join(", ")
+    )?;
+    writeln!(file)?;
+    writeln!(
+        file,
+        "    fn field(&self, name: &str) -> Option<crate::vehicle::dds::fields::FieldValue<'_>> {{"
+    )?;
+    writeln!(file, "        use crate::vehicle::dds::fields::FieldValue;")?;
+    writeln!(file, "        match name {{")?;
+    for name in names {
+        let rust_type = idl_to_rust_type(&fields[name]);
+        writeln!(
+            file,
+            "            \"{}\" => Some({}),",
+            name,
+            field_value_expr(rust_type, name)
+        )?;
+    }
+    writeln!(file, "            _ => None,")?;
+    writeln!(file, "        }}")?;
+    writeln!(file, "    }}")?;
+    writeln!(file, "}}")?;
+
     Ok(())
 }
 
@@ -32,3 +32,18 @@ pub fn idl_to_rust_type(idl_type: &str) -> &str {
         _ => "String", // Default to String for complex types
     }
 }
+
+/// Expression reading field `name` of a generated struct as a `FieldValue`
+pub fn field_value_expr(rust_type: &str, name: &str) -> String {
+    match rust_type {
+        "bool" => format!("FieldValue::Bool(self.{})", name),
+        "i16" | "i32" => format!("FieldValue::Int(i64::from(self.{}))", name),
+        "i64" => format!("FieldValue::Int(self.{})", name),
+        "u8" | "u16" | "u32" => format!("FieldValue::UInt(u64::from(self.{}))", name),
+        "u64" => format!("FieldValue::UInt(self.{})", name),
+        "f32" => format!("FieldValue::F32(self.{})", name),
+        "f64" => format!("FieldValue::F64(self.{})", name),
+        "char" => format!("FieldValue::Char(self.{})", name),
+        _ => format!("FieldValue::Str(&self.{})", name),
+    }
+}
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Evaluation cost of compiled scenario conditions.
+//!
+//! Compiles a few condition shapes and feeds each one synthetic samples,
+//! timing every `evaluate` call and, separately, a whole batch so the
+//! timer overhead can be told apart. Runs in-process without any service.
+
+use clap::Parser;
+use common::spec::artifact::scenario::Condition;
+use common::trace::LatencySummary;
+use filtergateway::filter::condition::CompiledCondition;
+use filtergateway::DdsData;
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+#[derive(Parser)]
+#[command(name = "bench_filter")]
+#[command(about = "Latency of scenario condition evaluation")]
+struct Args {
+    /// Evaluations measured per case
+    #[arg(short, long, default_value = "200000")]
+    iterations: usize,
+}
+
+struct Case {
+    name: &'static str,
+    condition: String,
+    hysteresis: Option<f32>,
+    samples: Vec<DdsData>,
+}
+
+fn leaf(express: &str, value: &str, topic: &str, field: &str) -> String {
+    format!(
+        "{{\"express\":\"{}\",\"value\":\"{}\",\"operands\":{{\"type\":\"DDS\",\"name\":\"{}\",\"value\":\"{}\"}}}}",
+        express, value, field, topic
+    )
+}
+
+fn sample(topic: &str, field: &str, value: &str) -> DdsData {
+    DdsData {
+        name: topic.to_string(),
+        value: String::new(),
+        fields: [(field.into(), value.to_string())].into(),
+        received_ns: 0,
+    }
+}
+
+fn cases() -> Vec<Case> {
+    let warning = "ADASObstacleDetectionIsWarning";
+    vec![
+        Case {
+            name: "eq bool",
+            condition: leaf("eq", "true", warning, "value"),
+            hysteresis: None,
+            samples: vec![
+                sample(warning, "value", "true"),
+                sample(warning, "value", "false"),
+            ],
+        },
+        Case {
+            name: "gt hysteresis",
+            condition: leaf("gt", "50", "/speed", "kph"),
+            hysteresis: Some(5.0),
+            samples: (40..60)
+                .map(|kph| sample("/speed", "kph", &kph.to_string()))
+                .collect(),
+        },
+        Case {
+            name: "and/or 2 topics",
+            condition: format!(
+                "{{\"and\":[{},{{\"or\":[{},{}]}}]}}",
+                leaf("gt", "50", "/speed", "kph"),
+                leaf("eq", "D", "/gear", "position"),
+                leaf("eq", "S", "/gear", "position")
+            ),
+            hysteresis: None,
+            samples: vec![
+                sample("/speed", "kph", "80"),
+                sample("/gear", "position", "D"),
+                sample("/speed", "kph", "30"),
+                sample("/gear", "position", "P"),
+            ],
+        },
+        Case {
+            name: "other topic",
+            condition: leaf("eq", "true", warning, "value"),
+            hysteresis: None,
+            samples: vec![sample("/speed", "kph", "80")],
+        },
+    ]
+}
+
+fn compile(case: &Case) -> Result<CompiledCondition, String> {
+    let condition: Condition = serde_json::from_str(&case.condition).map_err(|e| e.to_string())?;
+    let mut compiled = CompiledCondition::compile(&condition)?;
+    if let Some(hysteresis) = case.hysteresis {
+        compiled.set_hysteresis(hysteresis);
+    }
+    Ok(compiled)
+}
+
+/// Per-call distribution and mean over an untimed batch
+fn measure(case: &Case, iterations: usize) -> Result<(LatencySummary, Duration), String> {
+    let mut compiled = compile(case)?;
+    let samples = || case.samples.iter().cycle().take(iterations);
+
+    // Warm up caches and the branch predictor
+    for data in samples().take(10_000) {
+        let _ = black_box(compiled.evaluate(data));
+    }
+
+    let mut timings = Vec::with_capacity(iterations);
+    for data in samples() {
+        let start = Instant::now();
+        let outcome = compiled.evaluate(data);
+        timings.push(start.elapsed());
+        let _ = black_box(outcome);
+    }
+
+    let start = Instant::now();
+    for data in samples() {
+        let _ = black_box(compiled.evaluate(black_box(data)));
+    }
+    let mean = start.elapsed() / iterations.max(1) as u32;
+
+    let summary = LatencySummary::from_samples(timings).ok_or("no iterations")?;
+    Ok((summary, mean))
+}
+
+fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let args = Args::parse();
+
+    println!("Condition evaluation over {} samples:", args.iterations);
+    for case in cases() {
+        let (summary, mean) = measure(&case, args.iterations)?;
+        println!("{:<16} {}   batch mean {:.1?}", case.name, summary, mean);
+    }
+
+    println!();
+    let compiles = (args.iterations / 100).max(1);
+    for case in cases() {
+        let start = Instant::now();
+        for _ in 0..compiles {
+            black_box(compile(&case)?);
+        }
+        println!(
+            "{:<16} parse + compile mean {:.1?}",
+            case.name,
+            start.elapsed() / compiles as u32
+        );
+    }
+
+    Ok(())
+}
@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! End-to-end latency of the scenario pipeline.
+//!
+//! Publishes synthetic `ADASObstacleDetectionIsWarning` samples at each
+//! requested rate, waits for the pipeline to settle, then reads back the
+//! trace marks the components logged and reports p50/p99 per hop:
+//!
+//! ```text
+//! DDS sample -> FilterGateway condition -> ActionController trigger
+//!            -> NodeAgent workload start -> StateManager state change
+//! ```
+//!
+//! A scenario matching the samples must be applied first; the script
+//! `examples/pipeline-bench.sh` does that with the helloworld scenario.
+//! Marks carry wall-clock timestamps, so hops between hosts include their
+//! clock offset.
+
+use clap::Parser;
+use common::trace::{self, LatencySummary, Mark};
+use dust_dds::{
+    domain::domain_participant::DomainParticipant,
+    domain::domain_participant_factory::DomainParticipantFactory,
+    infrastructure::{qos::QosKind, status::NO_STATUS},
+    publication::data_writer::DataWriter,
+};
+use dust_dds_derive::DdsType;
+use serde::{Deserialize, Serialize};
+use std::time::Duration;
+
+/// Same layout as the type generated from `ADASObstacleDetection.idl`
+#[derive(Default, Debug, Clone, Serialize, Deserialize, DdsType)]
+struct ADASObstacleDetectionIsWarning {
+    value: bool,
+}
+
+#[derive(Parser)]
+#[command(name = "pipeline_bench")]
+#[command(about = "Per-stage latency from DDS sample to StateManager state change")]
+struct Args {
+    /// DDS topic watched by the scenario condition
+    #[arg(long, default_value = "ADASObstacleDetectionIsWarning")]
+    topic: String,
+
+    /// DDS domain of FilterGateway (`dds.domain_id` in settings.yaml)
+    #[arg(long, default_value = "100")]
+    domain_id: i32,
+
+    /// Samples per second; a comma-separated list runs one round per rate
+    #[arg(short, long, value_delimiter = ',', default_value = "0.5")]
+    rate: Vec<f64>,
+
+    /// Samples published per round
+    #[arg(short, long, default_value = "20")]
+    count: usize,
+
+    /// Log service URL
+    #[arg(long, default_value = "http://localhost:47097")]
+    logservice: String,
+
+    /// Seconds to wait after the last sample of a round
+    #[arg(long, default_value = "30")]
+    settle: u64,
+}
+
+struct Publisher {
+    _participant: DomainParticipant,
+    writer: DataWriter<ADASObstacleDetectionIsWarning>,
+}
+
+impl Publisher {
+    fn new(topic_name: &str, domain_id: i32) -> Result<Self, String> {
+        let participant = DomainParticipantFactory::get_instance()
+            .create_participant(domain_id, QosKind::Default, None, NO_STATUS)
+            .map_err(|e| format!("Failed to create domain participant: {:?}", e))?;
+        // FilterGateway registers the topic under its own name as type name
+        let topic = participant
+            .create_topic::<ADASObstacleDetectionIsWarning>(
+                topic_name,
+                topic_name,
+                QosKind::Default,
+                None,
+                NO_STATUS,
+            )
+            .map_err(|e| format!("Failed to create topic: {:?}", e))?;
+        let publisher = participant
+            .create_publisher(QosKind::Default, None, NO_STATUS)
+            .map_err(|e| format!("Failed to create publisher: {:?}", e))?;
+        let writer = publisher
+            .create_datawriter::<ADASObstacleDetectionIsWarning>(
+                &topic,
+                QosKind::Default,
+                None,
+                NO_STATUS,
+            )
+            .map_err(|e| format!("Failed to create data writer: {:?}", e))?;
+        Ok(Self {
+            _participant: participant,
+            writer,
+        })
+    }
+
+    fn publish(&self) -> Result<(), String> {
+        self.writer
+            .write(&ADASObstacleDetectionIsWarning { value: true }, None)
+            .map_err(|e| format!("Failed to write sample: {:?}", e))
+    }
+}
+
+#[derive(Deserialize)]
+struct QueryPage {
+    entries: Vec<QueryEntry>,
+    more: bool,
+}
+
+#[derive(Deserialize)]
+struct QueryEntry {
+    seq: u64,
+    message: String,
+}
+
+/// Trace marks logged since `from_ns`, following the `/query` cursor
+async fn fetch_marks(
+    client: &reqwest::Client,
+    logservice: &str,
+    from_ns: u64,
+) -> Result<Vec<Mark>, String> {
+    let mut marks = Vec::new();
+    let mut after: Option<u64> = None;
+    loop {
+        let mut query = vec![
+            ("from", from_ns.to_string()),
+            ("level", "I".to_string()),
+            ("limit", "10000".to_string()),
+        ];
+        if let Some(seq) = after {
+            query.push(("after", seq.to_string()));
+        }
+        let page: QueryPage = client
+            .get(format!("{}/query", logservice.trim_end_matches('/')))
+            .query(&query)
+            .send()
+            .await
+            .and_then(|response| response.error_for_status())
+            .map_err(|e| format!("Log service query failed: {}", e))?
+            .json()
+            .await
+            .map_err(|e| format!("Invalid log service response: {}", e))?;
+
+        marks.extend(page.entries.iter().filter_map(|e| Mark::parse(&e.message)));
+        match page.entries.last() {
+            Some(last) if page.more => after = Some(last.seq),
+            _ => return Ok(marks),
+        }
+    }
+}
+
+fn print_round(rate: f64, published: usize, marks: Vec<Mark>) {
+    let result = trace::breakdown(marks);
+    println!();
+    println!(
+        "{:.2} samples/s: {} published, {} traces complete, {} incomplete",
+        rate,
+        published,
+        result.total.len(),
+        result.incomplete
+    );
+    for (stage, samples) in result.hops {
+        if let Some(summary) = LatencySummary::from_samples(samples) {
+            println!("  -> {:<18} {}", stage, summary);
+        }
+    }
+    if let Some(summary) = LatencySummary::from_samples(result.total) {
+        println!("  {:<21} {}", "end to end", summary);
+    }
+}
+
+#[tokio::main]
+async fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let args = Args::parse();
+    let client = reqwest::Client::new();
+    let publisher = Publisher::new(&args.topic, args.domain_id)?;
+
+    // Give discovery time to match the FilterGateway reader
+    tokio::time::sleep(Duration::from_secs(3)).await;
+
+    for rate in args.rate.iter().copied().filter(|rate| *rate > 0.0) {
+        println!(
+            "Publishing {} samples on '{}' at {:.2}/s...",
+            args.count, args.topic, rate
+        );
+        let from_ns = trace::now_ns();
+        let mut ticks = tokio::time::interval(Duration::from_secs_f64(1.0 / rate));
+        for _ in 0..args.count {
+            ticks.tick().await;
+            publisher.publish()?;
+        }
+
+        tokio::time::sleep(Duration::from_secs(args.settle)).await;
+        let marks = fetch_marks(&client, &args.logservice, from_ns).await?;
+        print_round(rate, args.count, marks);
+    }
+
+    Ok(())
+}
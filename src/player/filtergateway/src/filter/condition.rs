@@ -0,0 +1,411 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Scenario conditions compiled into typed predicates
+//!
+//! A [`Condition`] from the scenario spec is compiled once when the filter is
+//! created. Expressions are resolved to a [`Predicate`] and target values are
+//! parsed or lowercased up front, so evaluating a DDS sample only compares
+//! the incoming field against a ready value.
+//!
+//! Compound conditions keep the last outcome of every comparison. A sample
+//! only updates the comparisons on its own topic, which lets `and`/`or`
+//! combine fields published on different topics.
+
+use crate::vehicle::dds::DdsData;
+use common::spec::artifact::scenario::Condition;
+
+/// Comparison against a pre-normalised target value
+#[derive(Debug, Clone, PartialEq)]
+pub enum Predicate {
+    /// Case-insensitive string equality, target already lowercased
+    Eq(String),
+    Lt(f32),
+    Le(f32),
+    Ge(f32),
+    Gt(f32),
+}
+
+impl Predicate {
+    fn compile(express: &str, target: &str) -> Result<Self, String> {
+        let number = || {
+            target
+                .parse::<f32>()
+                .map_err(|_| "target_value parse error".to_string())
+        };
+        match express {
+            "eq" => Ok(Predicate::Eq(target.to_lowercase())),
+            "lt" => Ok(Predicate::Lt(number()?)),
+            "le" => Ok(Predicate::Le(number()?)),
+            "ge" => Ok(Predicate::Ge(number()?)),
+            "gt" => Ok(Predicate::Gt(number()?)),
+            _ => Err("wrong expression in condition".to_string()),
+        }
+    }
+
+    pub fn matches(&self, field_value: &str) -> Result<bool, String> {
+        let number = || {
+            field_value
+                .parse::<f32>()
+                .map_err(|_| "field_value parse error".to_string())
+        };
+        Ok(match self {
+            Predicate::Eq(target) => {
+                if field_value.is_ascii() && target.is_ascii() {
+                    field_value.eq_ignore_ascii_case(target)
+                } else {
+                    field_value.to_lowercase() == *target
+                }
+            }
+            Predicate::Lt(target) => number()? < *target,
+            Predicate::Le(target) => number()? <= *target,
+            Predicate::Ge(target) => number()? >= *target,
+            Predicate::Gt(target) => number()? > *target,
+        })
+    }
+
+    /// Like [`Predicate::matches`], but a numeric comparison that was met
+    /// stays met until the value leaves the target by more than `hysteresis`
+    pub fn matches_latched(
+        &self,
+        field_value: &str,
+        was_met: bool,
+        hysteresis: f32,
+    ) -> Result<bool, String> {
+        if !was_met || hysteresis <= 0.0 {
+            return self.matches(field_value);
+        }
+        let latched = match self {
+            Predicate::Eq(_) => return self.matches(field_value),
+            Predicate::Lt(target) => Predicate::Lt(target + hysteresis),
+            Predicate::Le(target) => Predicate::Le(target + hysteresis),
+            Predicate::Ge(target) => Predicate::Ge(target - hysteresis),
+            Predicate::Gt(target) => Predicate::Gt(target - hysteresis),
+        };
+        latched.matches(field_value)
+    }
+}
+
+/// One compiled comparison of a topic field
+struct Comparison {
+    topic: String,
+    field: String,
+    predicate: Predicate,
+}
+
+enum Node {
+    /// Index into `CompiledCondition::comparisons`
+    Leaf(usize),
+    All(Vec<Node>),
+    Any(Vec<Node>),
+}
+
+impl Node {
+    fn eval(&self, outcomes: &[Option<bool>]) -> bool {
+        match self {
+            Node::Leaf(i) => outcomes[*i].unwrap_or(false),
+            Node::All(nodes) => nodes.iter().all(|n| n.eval(outcomes)),
+            Node::Any(nodes) => nodes.iter().any(|n| n.eval(outcomes)),
+        }
+    }
+}
+
+/// Condition tree ready to be evaluated against DDS samples
+pub struct CompiledCondition {
+    comparisons: Vec<Comparison>,
+    /// Last outcome of each comparison, `None` until its topic is seen
+    outcomes: Vec<Option<bool>>,
+    /// Topic name → indexes of the comparisons reading it
+    by_topic: Vec<(String, Vec<usize>)>,
+    root: Node,
+    /// Hysteresis band of numeric comparisons, 0 for none
+    hysteresis: f32,
+}
+
+impl CompiledCondition {
+    /// Compile a scenario condition
+    ///
+    /// # Errors
+    ///
+    /// Fails on an unknown expression, a non-numeric target for an ordering
+    /// expression, or a condition with neither a comparison nor children.
+    pub fn compile(condition: &Condition) -> Result<Self, String> {
+        let mut comparisons = Vec::new();
+        let root = Self::compile_node(condition, &mut comparisons)?;
+
+        let mut by_topic: Vec<(String, Vec<usize>)> = Vec::new();
+        for (i, comparison) in comparisons.iter().enumerate() {
+            match by_topic.iter_mut().find(|(t, _)| *t == comparison.topic) {
+                Some((_, indexes)) => indexes.push(i),
+                None => by_topic.push((comparison.topic.clone(), vec![i])),
+            }
+        }
+
+        Ok(Self {
+            outcomes: vec![None; comparisons.len()],
+            comparisons,
+            by_topic,
+            root,
+            hysteresis: 0.0,
+        })
+    }
+
+    /// Keep met numeric comparisons met until their value leaves the target
+    /// by more than `hysteresis`
+    pub fn set_hysteresis(&mut self, hysteresis: f32) {
+        self.hysteresis = hysteresis.max(0.0);
+    }
+
+    fn compile_node(
+        condition: &Condition,
+        comparisons: &mut Vec<Comparison>,
+    ) -> Result<Node, String> {
+        let mut all = Vec::new();
+        if condition.has_comparison() {
+            comparisons.push(Comparison {
+                topic: condition.get_operand_value(),
+                field: condition.get_operand_name(),
+                predicate: Predicate::compile(&condition.get_express(), &condition.get_value())?,
+            });
+            all.push(Node::Leaf(comparisons.len() - 1));
+        }
+        for child in condition.get_and() {
+            all.push(Self::compile_node(child, comparisons)?);
+        }
+        if !condition.get_or().is_empty() {
+            let any = condition
+                .get_or()
+                .iter()
+                .map(|child| Self::compile_node(child, comparisons))
+                .collect::<Result<Vec<_>, _>>()?;
+            all.push(Node::Any(any));
+        }
+
+        match all.len() {
+            0 => Err("wrong expression in condition".to_string()),
+            1 => Ok(all.pop().unwrap()),
+            _ => Ok(Node::All(all)),
+        }
+    }
+
+    /// Whether samples of `topic` can affect this condition
+    pub fn watches(&self, topic: &str) -> bool {
+        self.by_topic.iter().any(|(t, _)| t == topic)
+    }
+
+    /// Topics read by this condition, in definition order
+    pub fn topics(&self) -> impl Iterator<Item = &str> {
+        self.by_topic.iter().map(|(t, _)| t.as_str())
+    }
+
+    /// Fields of `topic` read by this condition
+    pub fn fields(&self, topic: &str) -> impl Iterator<Item = &str> {
+        self.by_topic
+            .iter()
+            .filter(move |(t, _)| t == topic)
+            .flat_map(|(_, indexes)| indexes.iter())
+            .map(|&i| self.comparisons[i].field.as_str())
+    }
+
+    /// Update the comparisons on `data`'s topic and evaluate the whole tree
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the topic is not part of the condition, or if
+    /// none of the comparisons on the topic could read its field.
+    pub fn evaluate(&mut self, data: &DdsData) -> Result<bool, String> {
+        let indexes = match self.by_topic.iter().find(|(t, _)| *t == data.name) {
+            Some((_, indexes)) => indexes,
+            None => return Err("data topic does not match".to_string()),
+        };
+
+        let mut updated = false;
+        let mut first_error = None;
+        for &i in indexes {
+            let comparison = &self.comparisons[i];
+            let outcome = match data.fields.get(comparison.field.as_str()) {
+                Some(value) => comparison.predicate.matches_latched(
+                    value,
+                    self.outcomes[i] == Some(true),
+                    self.hysteresis,
+                ),
+                None => Err(format!(
+                    "field '{}' not found in data.fields",
+                    comparison.field
+                )),
+            };
+            match outcome {
+                Ok(met) => {
+                    self.outcomes[i] = Some(met);
+                    updated = true;
+                }
+                Err(e) => {
+                    self.outcomes[i] = None;
+                    first_error.get_or_insert(e);
+                }
+            }
+        }
+
+        match first_error {
+            Some(e) if !updated => Err(e),
+            _ => Ok(self.root.eval(&self.outcomes)),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::HashMap;
+    use std::sync::Arc;
+
+    fn leaf(express: &str, value: &str, topic: &str, field: &str) -> String {
+        format!(
+            "{{\"express\":\"{}\",\"value\":\"{}\",\"operands\":{{\"type\":\"DDS\",\"name\":\"{}\",\"value\":\"{}\"}}}}",
+            express, value, field, topic
+        )
+    }
+
+    fn condition(json: &str) -> Condition {
+        serde_json::from_str(json).unwrap()
+    }
+
+    fn sample(topic: &str, fields: &[(&str, &str)]) -> DdsData {
+        DdsData {
+            name: topic.to_string(),
+            value: String::new(),
+            fields: fields
+                .iter()
+                .map(|(k, v)| (Arc::from(*k), v.to_string()))
+                .collect::<HashMap<_, _>>(),
+            received_ns: 0,
+        }
+    }
+
+    #[test]
+    fn test_predicate_compile_normalises_target() {
+        assert_eq!(
+            Predicate::compile("eq", "Drive").unwrap(),
+            Predicate::Eq("drive".to_string())
+        );
+        assert_eq!(Predicate::compile("ge", "1.5").unwrap(), Predicate::Ge(1.5));
+        assert_eq!(
+            Predicate::compile("gt", "fast").unwrap_err(),
+            "target_value parse error"
+        );
+        assert_eq!(
+            Predicate::compile("ne", "1").unwrap_err(),
+            "wrong expression in condition"
+        );
+    }
+
+    #[test]
+    fn test_predicate_matches() {
+        assert!(Predicate::Eq("drive".into()).matches("DRIVE").unwrap());
+        assert!(Predicate::Eq("größe".into()).matches("GRÖSSE").is_ok());
+        assert!(Predicate::Lt(10.0).matches("9.5").unwrap());
+        assert!(!Predicate::Le(10.0).matches("10.1").unwrap());
+        assert!(Predicate::Ge(10.0).matches("10").unwrap());
+        assert!(!Predicate::Gt(10.0).matches("10").unwrap());
+        assert_eq!(
+            Predicate::Gt(10.0).matches("ten").unwrap_err(),
+            "field_value parse error"
+        );
+    }
+
+    #[test]
+    fn test_predicate_matches_latched() {
+        let gt = Predicate::Gt(50.0);
+        assert!(!gt.matches_latched("49", false, 5.0).unwrap());
+        assert!(gt.matches_latched("49", true, 5.0).unwrap());
+        assert!(!gt.matches_latched("45", true, 5.0).unwrap());
+
+        let le = Predicate::Le(10.0);
+        assert!(le.matches_latched("14", true, 4.0).unwrap());
+        assert!(!le.matches_latched("14.5", true, 4.0).unwrap());
+    }
+
+    #[test]
+    fn test_hysteresis_holds_condition() {
+        let mut compiled =
+            CompiledCondition::compile(&condition(&leaf("gt", "50", "/speed", "kph"))).unwrap();
+        compiled.set_hysteresis(5.0);
+
+        assert!(!compiled
+            .evaluate(&sample("/speed", &[("kph", "48")]))
+            .unwrap());
+        assert!(compiled
+            .evaluate(&sample("/speed", &[("kph", "51")]))
+            .unwrap());
+        assert!(compiled
+            .evaluate(&sample("/speed", &[("kph", "48")]))
+            .unwrap());
+        assert!(!compiled
+            .evaluate(&sample("/speed", &[("kph", "44")]))
+            .unwrap());
+    }
+
+    #[test]
+    fn test_single_condition_keeps_errors() {
+        let mut compiled =
+            CompiledCondition::compile(&condition(&leaf("gt", "50", "/speed", "kph"))).unwrap();
+
+        assert!(compiled.watches("/speed"));
+        assert_eq!(
+            compiled.evaluate(&sample("/gear", &[])).unwrap_err(),
+            "data topic does not match"
+        );
+        assert_eq!(
+            compiled.evaluate(&sample("/speed", &[])).unwrap_err(),
+            "field 'kph' not found in data.fields"
+        );
+        assert!(compiled
+            .evaluate(&sample("/speed", &[("kph", "60")]))
+            .unwrap());
+        assert!(!compiled
+            .evaluate(&sample("/speed", &[("kph", "40")]))
+            .unwrap());
+    }
+
+    #[test]
+    fn test_compound_condition_across_topics() {
+        let json = format!(
+            "{{\"and\":[{},{{\"or\":[{},{}]}}]}}",
+            leaf("gt", "50", "/speed", "kph"),
+            leaf("eq", "D", "/gear", "position"),
+            leaf("eq", "S", "/gear", "position")
+        );
+        let mut compiled = CompiledCondition::compile(&condition(&json)).unwrap();
+        assert_eq!(
+            compiled.topics().collect::<Vec<_>>(),
+            vec!["/speed", "/gear"]
+        );
+
+        // Gear not seen yet
+        assert!(!compiled
+            .evaluate(&sample("/speed", &[("kph", "80")]))
+            .unwrap());
+        assert!(compiled
+            .evaluate(&sample("/gear", &[("position", "s")]))
+            .unwrap());
+        assert!(!compiled
+            .evaluate(&sample("/speed", &[("kph", "30")]))
+            .unwrap());
+    }
+
+    #[test]
+    fn test_compile_rejects_bad_nested_condition() {
+        let json = format!(
+            "{{\"or\":[{},{}]}}",
+            leaf("eq", "D", "/gear", "position"),
+            leaf("between", "1", "/gear", "position")
+        );
+        assert_eq!(
+            CompiledCondition::compile(&condition(&json)).err().unwrap(),
+            "wrong expression in condition"
+        );
+        assert!(CompiledCondition::compile(&condition("{}")).is_err());
+    }
+}
@@ -2,13 +2,20 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
+pub mod condition;
+pub mod table;
+pub mod trigger;
+
 use crate::grpc::sender::actioncontroller::FilterGatewaySender;
 use crate::grpc::sender::statemanager::StateManagerSender;
 use crate::vehicle::dds::DdsData;
 use common::logd;
 use common::spec::artifact::Scenario;
 use common::statemanager::{ResourceType, StateChange};
+use common::trace::{self, Stage};
 use common::Result;
+use condition::CompiledCondition;
+use trigger::TriggerGate;
 // use dust_dds::infrastructure::wait_set::Condition;
 // use std::sync::Arc;
 // use tokio::sync::{mpsc, Mutex};
@@ -26,6 +33,10 @@ pub struct Filter {
     sender: FilterGatewaySender,
     /// gRPC sender for state manager
     state_sender: StateManagerSender,
+    /// Scenario condition compiled once at creation
+    condition: Option<std::result::Result<CompiledCondition, String>>,
+    /// Firing policy from the scenario trigger spec
+    gate: TriggerGate,
 }
 
 #[allow(dead_code)]
@@ -48,12 +59,26 @@ impl Filter {
         is_active: bool,
         sender: FilterGatewaySender,
     ) -> Self {
+        let trigger = scenario.get_trigger();
+        let condition = scenario.get_conditions().map(|c| {
+            CompiledCondition::compile(&c).map(|mut compiled| {
+                if let Some(hysteresis) = trigger.get_hysteresis() {
+                    compiled.set_hysteresis(hysteresis);
+                }
+                compiled
+            })
+        });
+        if let Some(Err(e)) = &condition {
+            logd!(5, "Invalid condition in scenario {}: {}", scenario_name, e);
+        }
         Self {
             scenario_name,
             scenario,
             is_active,
             sender,
             state_sender: StateManagerSender::new(),
+            condition,
+            gate: TriggerGate::new(&trigger),
         }
     }
 
@@ -73,81 +98,47 @@ impl Filter {
         use std::time::Instant;
         let start = Instant::now();
 
-        let condition = self.scenario.get_conditions().unwrap();
-        let topic = condition.get_operand_value();
-        let value_name = condition.get_operand_name();
-        let target_value = condition.get_value();
-        let express = condition.get_express();
-
-        logd!(1,
-        "Checking condition for scenario: {}\nTopic: {}\nTarget Value: {}\nValue Name: {}\nExpression: {}\n",
-        self.scenario_name, topic, target_value, value_name, express
-    );
-
-        if !data.name.eq(&topic) {
-            let elapsed = start.elapsed();
-            logd!(1, "meet_scenario_condition: elapsed = {:?}", elapsed);
-            return Err("data topic does not match".into());
-        }
-
-        let field_value = match data.fields.get(&value_name) {
-            Some(v) => v,
-            None => {
-                let elapsed = start.elapsed();
-                logd!(3, "meet_scenario_condition: elapsed = {:?}", elapsed);
-                return Err(format!("field '{}' not found in data.fields", value_name).into());
-            }
+        let condition = match self.condition.as_mut() {
+            Some(Ok(condition)) => condition,
+            Some(Err(e)) => return Err(e.clone().into()),
+            None => return Err("scenario has no condition".into()),
         };
 
-        let check: bool = match express.as_str() {
-            "eq" => target_value.to_lowercase() == field_value.to_lowercase(),
-            "lt" => {
-                let target_v = target_value
-                    .parse::<f32>()
-                    .map_err(|_| "target_value parse error")?;
-                let current_v = field_value
-                    .parse::<f32>()
-                    .map_err(|_| "field_value parse error")?;
-                current_v < target_v
-            }
-            "le" => {
-                let target_v = target_value
-                    .parse::<f32>()
-                    .map_err(|_| "target_value parse error")?;
-                let current_v = field_value
-                    .parse::<f32>()
-                    .map_err(|_| "field_value parse error")?;
-                current_v <= target_v
-            }
-            "ge" => {
-                let target_v = target_value
-                    .parse::<f32>()
-                    .map_err(|_| "target_value parse error")?;
-                let current_v = field_value
-                    .parse::<f32>()
-                    .map_err(|_| "field_value parse error")?;
-                current_v >= target_v
-            }
-            "gt" => {
-                let target_v = target_value
-                    .parse::<f32>()
-                    .map_err(|_| "target_value parse error")?;
-                let current_v = field_value
-                    .parse::<f32>()
-                    .map_err(|_| "field_value parse error")?;
-                current_v > target_v
-            }
-            _ => {
+        logd!(
+            1,
+            "Checking condition for scenario: {}\nTopic: {}\n",
+            self.scenario_name,
+            data.name
+        );
+
+        let check = match condition.evaluate(data) {
+            Ok(check) => check,
+            Err(e) => {
                 let elapsed = start.elapsed();
-                logd!(3, "meet_scenario_condition: elapsed = {:?}", elapsed);
-                return Err("wrong expression in condition".into());
+                logd!(1, "meet_scenario_condition: elapsed = {:?}", elapsed);
+                return Err(e.into());
             }
         };
 
         let elapsed = start.elapsed();
         logd!(1, "meet_scenario_condition: elapsed = {:?}", elapsed);
 
+        let fire = self.gate.should_fire(check, start);
+        if check && !fire {
+            // Still satisfied but held back by the trigger policy
+            logd!(1, "Trigger suppressed for scenario: {}", self.scenario_name);
+            return Ok(());
+        }
+
         if check {
+            // The trace follows this firing through ActionController,
+            // NodeAgent and StateManager
+            let trace_id = trace::new_id("filtergateway");
+            if data.received_ns != 0 {
+                trace::mark_at(&trace_id, Stage::DdsReceived, data.received_ns);
+            }
+            trace::mark(&trace_id, Stage::ConditionMet);
+
             logd!(1, "Condition met for scenario: {}", self.scenario_name);
             logd!(1, "🔄 SCENARIO STATE TRANSITION: FilterGateway Processing");
             logd!(1, "   📋 Scenario: {}", self.scenario_name);
@@ -203,9 +194,11 @@ impl Filter {
             }
 
             logd!(1, "   📤 Triggering ActionController via gRPC...");
-            self.sender
-                .trigger_action(self.scenario_name.clone())
-                .await?;
+            trace::scope(
+                trace_id,
+                self.sender.trigger_action(self.scenario_name.clone()),
+            )
+            .await?;
             logd!(2, "   ✅ ActionController triggered successfully");
             Ok(())
         } else {
@@ -247,6 +240,30 @@ impl Filter {
         Ok(())
     }
 
+    /// Topics read by the scenario condition
+    ///
+    /// # Returns
+    ///
+    /// * `Vec<String>` - Topic names, empty if the condition is missing or invalid
+    pub fn topics(&self) -> Vec<String> {
+        match &self.condition {
+            Some(Ok(condition)) => condition.topics().map(str::to_string).collect(),
+            _ => Vec::new(),
+        }
+    }
+
+    /// Fields of `topic` read by the scenario condition
+    ///
+    /// # Returns
+    ///
+    /// * `Vec<String>` - Field names, may contain duplicates
+    pub fn fields(&self, topic: &str) -> Vec<String> {
+        match &self.condition {
+            Some(Ok(condition)) => condition.fields(topic).map(str::to_string).collect(),
+            _ => Vec::new(),
+        }
+    }
+
     /// Check if filter is active
     ///
     /// # Returns
@@ -284,20 +301,17 @@ impl Filter {
         );
 
         // Check if topic matches filter condition
-        let condition = match self.scenario.get_conditions() {
-            Some(c) => c,
-            None => return Ok(()), // No conditions case (already handled)
-        };
-
-        let topic = condition.get_operand_value();
-        if !data.name.eq(&topic) {
-            return Ok(()); // Ignore unrelated topics
+        match &self.condition {
+            Some(Ok(condition)) if condition.watches(&data.name) => {}
+            // Unrelated topic, no condition (already handled) or invalid
+            // condition (reported when the filter was created)
+            _ => return Ok(()),
         }
 
         // Perform condition check
         match self.meet_scenario_condition(data).await {
             Ok(_) => {
-                logd!(1, "Action triggered for scenario: {}", self.scenario_name);
+                logd!(1, "Condition handled for scenario: {}", self.scenario_name);
                 // Disable filter after condition is met (run only once)
                 // Add self.is_active = false; code if needed
             }
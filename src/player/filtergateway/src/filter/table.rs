@@ -0,0 +1,226 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Registry of active filters indexed by the topics they read
+//!
+//! Each filter sits behind its own lock so samples of unrelated topics can be
+//! evaluated at the same time. The table itself is only locked long enough
+//! to look up the filters interested in a topic.
+//!
+//! The table also publishes, per topic, the fields its filters read, so DDS
+//! listeners only extract those.
+
+use super::Filter;
+use crate::vehicle::dds::fields::selection_for;
+use std::collections::{BTreeSet, HashMap};
+use std::sync::Arc;
+use tokio::sync::Mutex;
+
+pub type SharedFilter = Arc<Mutex<Filter>>;
+
+#[derive(Default)]
+pub struct FilterTable {
+    /// Scenario name → filter
+    filters: HashMap<String, SharedFilter>,
+    /// Topic → filters whose condition reads the topic
+    by_topic: HashMap<String, Vec<SharedFilter>>,
+    /// Scenario name → (topic, fields of the topic) read by its condition
+    fields: HashMap<String, Vec<(String, Vec<String>)>>,
+}
+
+impl FilterTable {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Register a filter under its scenario name and condition topics
+    ///
+    /// # Returns
+    ///
+    /// * `bool` - `false` if a filter for the scenario already exists
+    pub fn insert(&mut self, filter: Filter) -> bool {
+        if self.filters.contains_key(&filter.scenario_name) {
+            return false;
+        }
+        let name = filter.scenario_name.clone();
+        let topic_fields: Vec<(String, Vec<String>)> = filter
+            .topics()
+            .into_iter()
+            .map(|topic| {
+                let fields = filter.fields(&topic);
+                (topic, fields)
+            })
+            .collect();
+        let filter = Arc::new(Mutex::new(filter));
+        for (topic, _) in &topic_fields {
+            self.by_topic
+                .entry(topic.clone())
+                .or_default()
+                .push(Arc::clone(&filter));
+        }
+        let topics: Vec<String> = topic_fields.iter().map(|(t, _)| t.clone()).collect();
+        self.filters.insert(name.clone(), filter);
+        self.fields.insert(name, topic_fields);
+        self.publish_fields(&topics);
+        true
+    }
+
+    /// Remove the filter of a scenario from the table and all its topics
+    pub fn remove(&mut self, scenario_name: &str) -> Option<SharedFilter> {
+        let filter = self.filters.remove(scenario_name)?;
+        self.by_topic.retain(|_, filters| {
+            filters.retain(|f| !Arc::ptr_eq(f, &filter));
+            !filters.is_empty()
+        });
+        let topics: Vec<String> = self
+            .fields
+            .remove(scenario_name)
+            .unwrap_or_default()
+            .into_iter()
+            .map(|(t, _)| t)
+            .collect();
+        self.publish_fields(&topics);
+        Some(filter)
+    }
+
+    /// Fields of `topic` read by any registered filter, sorted
+    pub fn fields_for_topic(&self, topic: &str) -> Vec<String> {
+        let fields: BTreeSet<&String> = self
+            .fields
+            .values()
+            .flatten()
+            .filter(|(t, _)| t == topic)
+            .flat_map(|(_, fields)| fields)
+            .collect();
+        fields.into_iter().cloned().collect()
+    }
+
+    /// Update the listener field selection of `topics`
+    fn publish_fields(&self, topics: &[String]) {
+        for topic in topics {
+            selection_for(topic).set(self.fields_for_topic(topic));
+        }
+    }
+
+    pub fn get(&self, scenario_name: &str) -> Option<SharedFilter> {
+        self.filters.get(scenario_name).cloned()
+    }
+
+    pub fn contains(&self, scenario_name: &str) -> bool {
+        self.filters.contains_key(scenario_name)
+    }
+
+    /// Whether any filter reads `topic`
+    pub fn watches(&self, topic: &str) -> bool {
+        self.by_topic.contains_key(topic)
+    }
+
+    /// Filters reading `topic`, in registration order
+    pub fn for_topic(&self, topic: &str) -> Vec<SharedFilter> {
+        self.by_topic.get(topic).cloned().unwrap_or_default()
+    }
+
+    pub fn len(&self) -> usize {
+        self.filters.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.filters.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::grpc::sender::actioncontroller::FilterGatewaySender;
+    use common::spec::artifact::Scenario;
+
+    fn filter(name: &str, condition: &str) -> Filter {
+        let yaml = format!(
+            r#"
+apiVersion: v1
+kind: Scenario
+metadata:
+  name: {name}
+spec:
+  condition:
+{condition}
+  action: update
+  target: {name}
+"#
+        );
+        let scenario: Scenario = serde_yaml::from_str(&yaml).unwrap();
+        Filter::new(name.to_string(), scenario, true, FilterGatewaySender::new())
+    }
+
+    const SPEED: &str = r#"    express: gt
+    value: "50"
+    operands:
+      type: DDS
+      name: kph
+      value: /speed"#;
+
+    const SPEED_AND_GEAR: &str = r#"    and:
+      - express: gt
+        value: "50"
+        operands:
+          type: DDS
+          name: kph
+          value: /speed
+      - express: eq
+        value: "D"
+        operands:
+          type: DDS
+          name: position
+          value: /gear"#;
+
+    #[tokio::test]
+    async fn test_insert_indexes_every_topic() {
+        let mut table = FilterTable::new();
+        assert!(table.insert(filter("a", SPEED)));
+        assert!(table.insert(filter("b", SPEED_AND_GEAR)));
+
+        assert_eq!(table.len(), 2);
+        assert_eq!(table.for_topic("/speed").len(), 2);
+        assert_eq!(table.for_topic("/gear").len(), 1);
+        assert!(!table.watches("/door"));
+        assert!(table.for_topic("/door").is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_insert_rejects_duplicate_scenario() {
+        let mut table = FilterTable::new();
+        assert!(table.insert(filter("a", SPEED)));
+        assert!(!table.insert(filter("a", SPEED_AND_GEAR)));
+        assert!(!table.watches("/gear"));
+    }
+
+    #[tokio::test]
+    async fn test_remove_drops_empty_topics() {
+        let mut table = FilterTable::new();
+        table.insert(filter("a", SPEED));
+        table.insert(filter("b", SPEED_AND_GEAR));
+
+        assert!(table.remove("b").is_some());
+        assert!(table.remove("b").is_none());
+        assert!(!table.watches("/gear"));
+        assert_eq!(table.for_topic("/speed").len(), 1);
+        assert!(table.contains("a"));
+        assert!(table.fields_for_topic("/gear").is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_fields_for_topic_merges_filters() {
+        let mut table = FilterTable::new();
+        table.insert(filter("a", SPEED));
+        table.insert(filter("b", SPEED_AND_GEAR));
+
+        assert_eq!(table.fields_for_topic("/speed"), vec!["kph".to_string()]);
+        assert_eq!(
+            table.fields_for_topic("/gear"),
+            vec!["position".to_string()]
+        );
+    }
+}
@@ -0,0 +1,105 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Local firing policy of a filter
+//!
+//! Decides whether a satisfied condition notifies StateManager and triggers
+//! ActionController, so repeated samples of a condition that stays true do
+//! not each turn into gRPC calls.
+
+use common::spec::artifact::scenario::{Trigger, TriggerMode};
+use std::time::{Duration, Instant};
+
+pub struct TriggerGate {
+    mode: TriggerMode,
+    min_interval: Option<Duration>,
+    /// Edge mode: set while the condition is false, cleared when firing
+    armed: bool,
+    last_fired: Option<Instant>,
+}
+
+impl TriggerGate {
+    pub fn new(trigger: &Trigger) -> Self {
+        Self {
+            mode: trigger.get_mode(),
+            min_interval: trigger.get_min_interval_ms().map(Duration::from_millis),
+            armed: true,
+            last_fired: None,
+        }
+    }
+
+    /// Feed the latest condition outcome
+    ///
+    /// # Returns
+    ///
+    /// * `bool` - `true` if the action should fire now
+    pub fn should_fire(&mut self, met: bool, now: Instant) -> bool {
+        if !met {
+            self.armed = true;
+            return false;
+        }
+        if self.mode == TriggerMode::Edge && !self.armed {
+            return false;
+        }
+        if let (Some(min_interval), Some(last_fired)) = (self.min_interval, self.last_fired) {
+            // An edge held back here fires on the first sample after the
+            // interval if the condition is still true
+            if now.duration_since(last_fired) < min_interval {
+                return false;
+            }
+        }
+        self.armed = false;
+        self.last_fired = Some(now);
+        true
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn trigger(yaml: &str) -> Trigger {
+        serde_yaml::from_str(yaml).unwrap()
+    }
+
+    #[test]
+    fn test_level_fires_on_every_met_sample() {
+        let mut gate = TriggerGate::new(&Trigger::default());
+        let now = Instant::now();
+        assert!(gate.should_fire(true, now));
+        assert!(gate.should_fire(true, now));
+        assert!(!gate.should_fire(false, now));
+    }
+
+    #[test]
+    fn test_edge_fires_once_per_rising_edge() {
+        let mut gate = TriggerGate::new(&trigger("mode: edge"));
+        let now = Instant::now();
+        assert!(gate.should_fire(true, now));
+        assert!(!gate.should_fire(true, now));
+        assert!(!gate.should_fire(false, now));
+        assert!(gate.should_fire(true, now));
+    }
+
+    #[test]
+    fn test_min_interval_limits_rate() {
+        let mut gate = TriggerGate::new(&trigger("minIntervalMs: 100"));
+        let start = Instant::now();
+        assert!(gate.should_fire(true, start));
+        assert!(!gate.should_fire(true, start + Duration::from_millis(50)));
+        assert!(gate.should_fire(true, start + Duration::from_millis(100)));
+    }
+
+    #[test]
+    fn test_edge_held_back_by_interval_fires_later() {
+        let mut gate = TriggerGate::new(&trigger("mode: edge\nminIntervalMs: 100"));
+        let start = Instant::now();
+        assert!(gate.should_fire(true, start));
+        assert!(!gate.should_fire(false, start + Duration::from_millis(10)));
+        assert!(!gate.should_fire(true, start + Duration::from_millis(20)));
+        assert!(gate.should_fire(true, start + Duration::from_millis(120)));
+        assert!(!gate.should_fire(true, start + Duration::from_millis(300)));
+    }
+}
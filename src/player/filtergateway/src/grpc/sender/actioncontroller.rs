@@ -49,7 +49,8 @@ impl FilterGatewaySender {
             .await
             .unwrap();
 
-        let request = TriggerActionRequest { scenario_name };
+        // Carries the trace of the firing filter, if any
+        let request = common::trace::request(TriggerActionRequest { scenario_name });
 
         client.trigger_action(request).await.map_err(|e| {
             common::logd!(5, "Failed to trigger action: {:?}", e);
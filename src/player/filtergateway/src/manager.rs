@@ -2,6 +2,7 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
+use crate::filter::table::FilterTable;
 use crate::filter::Filter;
 use crate::grpc::sender::actioncontroller::FilterGatewaySender;
 use crate::grpc::sender::statemanager::StateManagerSender;
@@ -9,11 +10,81 @@ use crate::vehicle::dds::DdsData;
 use crate::vehicle::VehicleManager;
 use common::logd;
 use common::spec::artifact::Scenario;
+use common::startup::StartupTimer;
 use common::statemanager::{ResourceType, StateChange};
 use common::{spec::artifact::Artifact, Result};
 // use dust_dds::infrastructure::wait_set::Condition;
+use std::collections::HashMap;
 use std::sync::Arc;
-use tokio::sync::{mpsc, Mutex};
+use std::time::{Duration, Instant};
+use tokio::sync::mpsc::error::TrySendError;
+use tokio::sync::{mpsc, Mutex, RwLock};
+
+/// Samples queued per topic worker before only the newest one is kept
+const TOPIC_QUEUE_SIZE: usize = 64;
+/// Minimum time between two reports of dropped samples of one topic
+const DROP_REPORT_INTERVAL: Duration = Duration::from_secs(10);
+
+/// Newest sample of a topic that did not fit in the worker queue
+///
+/// The worker takes it once the queue is drained. While it is set, new
+/// samples replace it instead of entering the queue, so the worker still
+/// sees samples in arrival order and always ends on the newest one.
+type LatestSlot = Arc<std::sync::Mutex<Option<DdsData>>>;
+
+/// Queue of one topic worker and the samples it had to drop
+struct TopicWorker {
+    tx: mpsc::Sender<DdsData>,
+    latest: LatestSlot,
+    drops: DropCounter,
+}
+
+impl TopicWorker {
+    /// Hand `dds_data` to the worker without waiting
+    ///
+    /// # Returns
+    ///
+    /// * `Ok(Some(n))` - A sample was replaced in the slot and `n` drops are due for a report
+    /// * `Ok(None)` - Nothing to report
+    /// * `Err(())` - The worker is gone
+    fn offer(&mut self, dds_data: DdsData) -> std::result::Result<Option<u64>, ()> {
+        let mut latest = self.latest.lock().unwrap_or_else(|e| e.into_inner());
+        if latest.is_some() {
+            *latest = Some(dds_data);
+            return Ok(self.drops.record(Instant::now()));
+        }
+        match self.tx.try_send(dds_data) {
+            Ok(()) => Ok(None),
+            Err(TrySendError::Full(dds_data)) => {
+                *latest = Some(dds_data);
+                Ok(None)
+            }
+            Err(TrySendError::Closed(_)) => Err(()),
+        }
+    }
+}
+
+/// Counts dropped samples and decides when to report them
+#[derive(Default)]
+struct DropCounter {
+    /// Drops since the last report
+    pending: u64,
+    last_report: Option<Instant>,
+}
+
+impl DropCounter {
+    /// Record one drop at `now`, returning the count to report if due
+    fn record(&mut self, now: Instant) -> Option<u64> {
+        self.pending += 1;
+        match self.last_report {
+            Some(last) if now.duration_since(last) < DROP_REPORT_INTERVAL => None,
+            _ => {
+                self.last_report = Some(now);
+                Some(std::mem::take(&mut self.pending))
+            }
+        }
+    }
+}
 
 /// Manager for FilterGateway
 ///
@@ -36,8 +107,8 @@ pub struct FilterGatewayManager {
     pub rx_grpc: Arc<Mutex<mpsc::Receiver<ScenarioParameter>>>,
     /// Receiver for DDS data
     pub rx_dds: Arc<Mutex<mpsc::Receiver<DdsData>>>,
-    /// Active filters for scenarios
-    pub filters: Arc<Mutex<Vec<Filter>>>,
+    /// Active filters for scenarios, indexed by topic
+    pub filters: Arc<RwLock<FilterTable>>,
     /// gRPC sender for action controller
     pub sender: Arc<Mutex<FilterGatewaySender>>,
     /// Vehicle manager for handling vehicle data
@@ -67,7 +138,7 @@ impl FilterGatewayManager {
         Self {
             rx_grpc: Arc::new(Mutex::new(rx_grpc)),
             rx_dds: Arc::new(Mutex::new(rx_dds)),
-            filters: Arc::new(Mutex::new(Vec::new())),
+            filters: Arc::new(RwLock::new(FilterTable::new())),
             sender: Arc::new(Mutex::new(FilterGatewaySender::new())),
             vehicle_manager: Arc::new(Mutex::new(vehicle_manager)),
         }
@@ -83,33 +154,37 @@ impl FilterGatewayManager {
     /// * `Result<()>` - Success or error result
     pub async fn initialize(&self) -> Result<()> {
         logd!(3, "FilterGatewayManager init");
+        let mut timer = StartupTimer::start("filtergateway");
         // Initialize vehicle manager
         let etcd_scenario = Self::read_all_scenario_from_etcd()
             .await
             .unwrap_or_default();
+        timer.mark("snapshot");
+        timer.note(format!("{} scenarios", etcd_scenario.len()));
 
         for scenario in etcd_scenario {
             let scenario: Scenario = serde_yaml::from_str(&scenario)?;
             logd!(3, "Scenario: {:?}", scenario);
-            let topic_name = scenario
+            // Compound conditions may read several topics; the data type
+            // name is the topic name for every listener
+            let topics = scenario
                 .get_conditions()
-                .as_ref()
-                .map(|cond| cond.get_operand_value())
-                .unwrap_or_default();
-            let data_type_name = scenario
-                .get_conditions()
-                .as_ref()
-                .map(|cond| cond.get_operand_value())
+                .map(|cond| cond.get_topics())
                 .unwrap_or_default();
             let mut vehicle_manager = self.vehicle_manager.lock().await;
-            if let Err(e) = vehicle_manager
-                .subscribe_topic(topic_name, data_type_name)
-                .await
-            {
-                logd!(5, "Error subscribing to vehicle data: {:?}", e);
+            for topic_name in topics {
+                if let Err(e) = vehicle_manager
+                    .subscribe_topic(topic_name.clone(), topic_name)
+                    .await
+                {
+                    logd!(5, "Error subscribing to vehicle data: {:?}", e);
+                }
             }
+            drop(vehicle_manager);
             self.launch_scenario_filter(scenario).await?;
         }
+        timer.mark("filters");
+        timer.finish();
 
         Ok(())
     }
@@ -117,6 +192,15 @@ impl FilterGatewayManager {
     /// Function to receive subscribed DDS data and pass it to filters
     ///
     /// This function runs as a separate task to continuously receive and process DDS data.
+    /// Samples are routed to one worker per topic, so only the filters reading a
+    /// topic see its samples, in arrival order, while other topics are evaluated
+    /// in parallel.
+    ///
+    /// The dispatcher never waits on a worker, so one slow topic does not
+    /// hold back the others. When the queue of a topic is full, only the
+    /// newest sample is kept until the worker catches up; the samples it
+    /// replaces are counted and reported. A condition therefore always sees
+    /// the latest value of a topic, even if intermediate values are skipped.
     ///
     /// # Returns
     ///
@@ -124,6 +208,8 @@ impl FilterGatewayManager {
     async fn process_dds_data(&self) -> Result<()> {
         // Create clone of shared receiver
         let rx_dds = Arc::clone(&self.rx_dds);
+        // Topic name → worker evaluating that topic
+        let mut workers: HashMap<String, TopicWorker> = HashMap::new();
 
         // Receive loop
         loop {
@@ -132,29 +218,45 @@ impl FilterGatewayManager {
             // Receive DDS data
             match receiver.recv().await {
                 Some(dds_data) => {
-                    // Only print if topic or value is not empty
-                    if !dds_data.name.is_empty() && !dds_data.value.is_empty() {
-                        logd!(
-                            3,
-                            "Received DDS data: topic={}, value={}",
-                            dds_data.name,
-                            dds_data.value
-                        );
+                    logd!(
+                        1,
+                        "Received DDS data: topic={}, fields={:?}",
+                        dds_data.name,
+                        dds_data.fields
+                    );
+
+                    // Drop samples no filter is interested in
+                    if !self.filters.read().await.watches(&dds_data.name) {
+                        continue;
                     }
 
-                    // Forward data to all active filters
-                    let mut filters = self.filters.lock().await;
-                    for filter in filters.iter_mut() {
-                        if filter.is_active() {
-                            // Pass DDS data to filter
-                            if let Err(e) = filter.process_data(&dds_data).await {
-                                logd!(
-                                    5,
-                                    "Error processing DDS data in filter {}: {:?}",
-                                    filter.scenario_name,
-                                    e
-                                );
-                            }
+                    let topic = dds_data.name.clone();
+                    let worker = workers.entry(topic.clone()).or_insert_with(|| {
+                        let latest = LatestSlot::default();
+                        TopicWorker {
+                            tx: Self::spawn_topic_worker(
+                                topic.clone(),
+                                Arc::clone(&self.filters),
+                                Arc::clone(&latest),
+                            ),
+                            latest,
+                            drops: DropCounter::default(),
+                        }
+                    });
+                    match worker.offer(dds_data) {
+                        Ok(None) => {}
+                        Ok(Some(dropped)) => {
+                            logd!(
+                                4,
+                                "Filter worker for topic {} is behind, skipped {} sample(s) for newer ones",
+                                topic,
+                                dropped
+                            );
+                        }
+                        Err(()) => {
+                            // Worker is gone, a new one is started for the next sample
+                            logd!(5, "Filter worker for topic {} stopped", topic);
+                            workers.remove(&topic);
                         }
                     }
                 }
@@ -169,6 +271,59 @@ impl FilterGatewayManager {
         Ok(())
     }
 
+    /// Start a task evaluating the filters of one topic
+    ///
+    /// # Arguments
+    ///
+    /// * `topic` - Topic whose samples the worker receives
+    /// * `filters` - Shared filter table
+    /// * `latest` - Newest sample that did not fit in the queue, taken once
+    ///   the queue is drained
+    ///
+    /// # Returns
+    ///
+    /// * `mpsc::Sender<DdsData>` - Queue of the worker, it stops once dropped
+    fn spawn_topic_worker(
+        topic: String,
+        filters: Arc<RwLock<FilterTable>>,
+        latest: LatestSlot,
+    ) -> mpsc::Sender<DdsData> {
+        let (tx, mut rx) = mpsc::channel::<DdsData>(TOPIC_QUEUE_SIZE);
+        tokio::spawn(async move {
+            loop {
+                let dds_data = match rx.try_recv() {
+                    Ok(dds_data) => dds_data,
+                    Err(_) => {
+                        let overflow = latest.lock().unwrap_or_else(|e| e.into_inner()).take();
+                        match overflow {
+                            Some(dds_data) => dds_data,
+                            None => match rx.recv().await {
+                                Some(dds_data) => dds_data,
+                                None => break,
+                            },
+                        }
+                    }
+                };
+                let interested = filters.read().await.for_topic(&topic);
+                for filter in interested {
+                    let mut filter = filter.lock().await;
+                    if filter.is_active() {
+                        // Pass DDS data to filter
+                        if let Err(e) = filter.process_data(&dds_data).await {
+                            logd!(
+                                5,
+                                "Error processing DDS data in filter {}: {:?}",
+                                filter.scenario_name,
+                                e
+                            );
+                        }
+                    }
+                }
+            }
+        });
+        tx
+    }
+
     /// Function to process gRPC requests
     ///
     /// This function processes scenario requests coming through gRPC.
@@ -191,25 +346,21 @@ impl FilterGatewayManager {
                         0 => {
                             // Allow
                             // Subscribe to vehicle data
-                            let topic_name = param
+                            let topics = param
                                 .scenario
                                 .get_conditions()
-                                .as_ref()
-                                .map(|cond| cond.get_operand_value())
-                                .unwrap_or_default();
-                            let data_type_name = param
-                                .scenario
-                                .get_conditions()
-                                .as_ref()
-                                .map(|cond| cond.get_operand_value())
+                                .map(|cond| cond.get_topics())
                                 .unwrap_or_default();
                             let mut vehicle_manager = self.vehicle_manager.lock().await;
-                            if let Err(e) = vehicle_manager
-                                .subscribe_topic(topic_name, data_type_name)
-                                .await
-                            {
-                                logd!(5, "Error subscribing to vehicle data: {:?}", e);
+                            for topic_name in topics {
+                                if let Err(e) = vehicle_manager
+                                    .subscribe_topic(topic_name.clone(), topic_name)
+                                    .await
+                                {
+                                    logd!(5, "Error subscribing to vehicle data: {:?}", e);
+                                }
                             }
+                            drop(vehicle_manager);
                             self.launch_scenario_filter(param.scenario).await?;
                         }
                         1 => {
@@ -406,26 +557,16 @@ impl FilterGatewayManager {
             let sender_guard = self.sender.lock().await;
             sender_guard.clone()
         };
-        let filter = Filter::new(scenario.get_name().to_string(), scenario, true, sender);
+        let scenario_name = scenario.get_name();
+        let filter = Filter::new(scenario_name.clone(), scenario, true, sender);
 
-        // Add the filter to our managed collection
-        {
-            // Prevent duplicate filters for the same scenario
-            let mut filters = self.filters.lock().await;
-            if filters
-                .iter()
-                .any(|f| f.scenario_name == filter.scenario_name)
-            {
-                logd!(
-                    3,
-                    "Filter for scenario '{}' already exists, skipping.",
-                    filter.scenario_name
-                );
-                let elapsed = start.elapsed();
-                logd!(1, "launch_scenario_filter: elapsed = {:?}", elapsed);
-                return Ok(());
-            }
-            filters.push(filter);
+        // Add the filter to our managed collection, duplicates are rejected
+        if !self.filters.write().await.insert(filter) {
+            logd!(
+                3,
+                "Filter for scenario '{}' already exists, skipping.",
+                scenario_name
+            );
         }
         let elapsed = start.elapsed();
         logd!(1, "launch_scenario_filter: elapsed = {:?}", elapsed);
@@ -446,24 +587,30 @@ impl FilterGatewayManager {
     pub async fn remove_scenario_filter(&self, scenario_name: String) -> Result<()> {
         logd!(3, "remove filter {}\n", scenario_name);
 
-        let arc_filters = Arc::clone(&self.filters);
-        let mut filters = arc_filters.lock().await;
-        let index = filters
-            .iter()
-            .position(|f| f.scenario_name == scenario_name);
-        if let Some(i) = index {
-            filters.remove(i);
-        }
+        self.filters.write().await.remove(&scenario_name);
         Ok(())
     }
 
     /// Read all scenario yaml string in etcd
     ///
+    /// Scenarios come from one compact store snapshot; the prefix scan is
+    /// only used when the snapshot cannot be taken.
+    ///
     /// ### Parameters
     /// * None
     /// ### Return
     /// * `Result<Vec<String>>` - `Ok(_)` contains scenario yaml string vector
     async fn read_all_scenario_from_etcd() -> common::Result<Vec<String>> {
+        match common::etcd::snapshot(&["Scenario/"]).await {
+            Ok(snapshot) => {
+                return Ok(snapshot
+                    .entries()
+                    .iter()
+                    .map(|(_, value)| value.clone())
+                    .collect())
+            }
+            Err(e) => logd!(4, "Scenario snapshot failed, scanning instead: {}", e),
+        }
         let kv_scenario = common::etcd::get_all_with_prefix("Scenario").await?;
         let values = kv_scenario.into_iter().map(|kv| kv.1).collect();
 
@@ -480,6 +627,9 @@ mod tests {
     };
     use tokio::sync::{mpsc, Mutex};
 
+    use super::{DropCounter, LatestSlot, TopicWorker, DROP_REPORT_INTERVAL};
+    use std::time::{Duration, Instant};
+
     // ===== Dummy scenario and condition structs for simulating scenarios =====
     #[derive(Debug, Clone)]
     struct DummyScenario {
@@ -1658,4 +1808,57 @@ spec:
             "Vehicle manager error should be triggered"
         );
     }
+
+    #[test]
+    fn test_drop_counter_reports_at_most_once_per_interval() {
+        let start = Instant::now();
+        let mut drops = DropCounter::default();
+        // The first drop is reported right away
+        assert_eq!(drops.record(start), Some(1));
+        assert_eq!(drops.record(start + Duration::from_secs(1)), None);
+        assert_eq!(drops.record(start + Duration::from_secs(2)), None);
+        // Drops in between are summed into the next report
+        assert_eq!(
+            drops.record(start + DROP_REPORT_INTERVAL + Duration::from_secs(1)),
+            Some(3)
+        );
+    }
+
+    fn sample(value: &str) -> crate::vehicle::dds::DdsData {
+        crate::vehicle::dds::DdsData {
+            name: "topic".to_string(),
+            value: value.to_string(),
+            fields: Default::default(),
+            received_ns: 0,
+        }
+    }
+
+    #[tokio::test]
+    async fn test_full_worker_keeps_newest_sample() {
+        let (tx, mut rx) = mpsc::channel(1);
+        let latest = LatestSlot::default();
+        let mut worker = TopicWorker {
+            tx,
+            latest: Arc::clone(&latest),
+            drops: DropCounter::default(),
+        };
+        assert_eq!(worker.offer(sample("1")), Ok(None));
+        // The queue is full, the sample waits in the slot
+        assert_eq!(worker.offer(sample("2")), Ok(None));
+        // Later samples replace it and are counted
+        assert_eq!(worker.offer(sample("3")), Ok(Some(1)));
+        assert_eq!(worker.offer(sample("4")), Ok(None));
+
+        assert_eq!(rx.recv().await.unwrap().value, "1");
+        let newest = latest.lock().unwrap().take().unwrap();
+        assert_eq!(newest.value, "4");
+
+        // Once the slot is taken, samples go through the queue again
+        assert_eq!(worker.offer(sample("5")), Ok(None));
+        assert_eq!(rx.recv().await.unwrap().value, "5");
+        assert!(latest.lock().unwrap().is_none());
+
+        drop(rx);
+        assert_eq!(worker.offer(sample("6")), Err(()));
+    }
 }
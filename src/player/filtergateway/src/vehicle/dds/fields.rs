@@ -0,0 +1,181 @@
+/*
+* SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+//! Typed field access for generated DDS types
+//!
+//! `build_scripts/generator.rs` implements [`FieldAccess`] for every IDL
+//! struct, so listeners read fields straight from the sample instead of
+//! going through JSON. Which fields are read is decided per topic by the
+//! registered scenario conditions through [`selection_for`].
+
+use std::collections::HashMap;
+use std::fmt;
+use std::fmt::Write;
+use std::sync::{Arc, Mutex, OnceLock, RwLock};
+
+/// Borrowed value of one field of a DDS sample
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum FieldValue<'a> {
+    Bool(bool),
+    Int(i64),
+    UInt(u64),
+    F32(f32),
+    F64(f64),
+    Char(char),
+    Str(&'a str),
+}
+
+impl fmt::Display for FieldValue<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            FieldValue::Bool(v) => v.fmt(f),
+            FieldValue::Int(v) => v.fmt(f),
+            FieldValue::UInt(v) => v.fmt(f),
+            FieldValue::F32(v) => v.fmt(f),
+            FieldValue::F64(v) => v.fmt(f),
+            FieldValue::Char(v) => v.fmt(f),
+            FieldValue::Str(v) => v.fmt(f),
+        }
+    }
+}
+
+/// Field accessors generated for each IDL type
+pub trait FieldAccess {
+    /// Names of all fields of the type
+    const FIELD_NAMES: &'static [&'static str];
+
+    /// Value of the field `name`, `None` if the type has no such field
+    fn field(&self, name: &str) -> Option<FieldValue<'_>>;
+}
+
+/// Shared field names, so a sample does not allocate a key per field
+pub type FieldNames = Arc<[Arc<str>]>;
+
+/// Fields of a topic that registered conditions read
+pub struct FieldSelection {
+    fields: RwLock<FieldNames>,
+}
+
+impl Default for FieldSelection {
+    fn default() -> Self {
+        Self {
+            fields: RwLock::new(Arc::from(Vec::new())),
+        }
+    }
+}
+
+impl FieldSelection {
+    /// Currently selected field names, empty if no condition reads the topic
+    pub fn get(&self) -> FieldNames {
+        Arc::clone(&self.fields.read().unwrap_or_else(|e| e.into_inner()))
+    }
+
+    pub fn set(&self, fields: Vec<String>) {
+        let fields: FieldNames = fields.into_iter().map(Arc::from).collect();
+        *self.fields.write().unwrap_or_else(|e| e.into_inner()) = fields;
+    }
+}
+
+static SELECTIONS: OnceLock<Mutex<HashMap<String, Arc<FieldSelection>>>> = OnceLock::new();
+
+/// Field selection of `topic`, shared by its listener and the filter manager
+pub fn selection_for(topic: &str) -> Arc<FieldSelection> {
+    let mut selections = SELECTIONS
+        .get_or_init(Default::default)
+        .lock()
+        .unwrap_or_else(|e| e.into_inner());
+    Arc::clone(selections.entry(topic.to_string()).or_default())
+}
+
+/// All field names of `T`, built once per listener
+pub fn all_field_names<T: FieldAccess>() -> FieldNames {
+    T::FIELD_NAMES.iter().map(|name| Arc::from(*name)).collect()
+}
+
+/// Room reserved for a formatted scalar; fits every integer and common floats
+const SCALAR_TEXT_CAPACITY: usize = 24;
+
+/// Format the `names` fields of `sample`
+///
+/// Unknown names are skipped. Keys share the allocation of `names`, and
+/// every value is written straight into the string the map keeps, sized
+/// up front, so a field costs one allocation.
+pub fn extract_fields<T: FieldAccess>(sample: &T, names: &[Arc<str>]) -> HashMap<Arc<str>, String> {
+    let mut fields = HashMap::with_capacity(names.len());
+    for name in names {
+        let text = match sample.field(name) {
+            Some(FieldValue::Str(value)) => String::from(value),
+            Some(value) => {
+                let mut text = String::with_capacity(SCALAR_TEXT_CAPACITY);
+                let _ = write!(text, "{}", value);
+                text
+            }
+            None => continue,
+        };
+        fields.insert(Arc::clone(name), text);
+    }
+    fields
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    struct Sample {
+        speed: f32,
+        gear: String,
+        active: bool,
+    }
+
+    impl FieldAccess for Sample {
+        const FIELD_NAMES: &'static [&'static str] = &["active", "gear", "speed"];
+
+        fn field(&self, name: &str) -> Option<FieldValue<'_>> {
+            match name {
+                "active" => Some(FieldValue::Bool(self.active)),
+                "gear" => Some(FieldValue::Str(&self.gear)),
+                "speed" => Some(FieldValue::F32(self.speed)),
+                _ => None,
+            }
+        }
+    }
+
+    fn sample() -> Sample {
+        Sample {
+            speed: 0.1,
+            gear: "D".to_string(),
+            active: true,
+        }
+    }
+
+    #[test]
+    fn test_extract_selected_fields_only() {
+        let names: FieldNames = vec![Arc::from("gear"), Arc::from("missing")].into();
+        let fields = extract_fields(&sample(), &names);
+        assert_eq!(fields.len(), 1);
+        // Strings are not quoted as they were with the JSON conversion
+        assert_eq!(fields["gear"], "D");
+        // The key is the selected name itself
+        let (key, _) = fields.iter().next().unwrap();
+        assert!(Arc::ptr_eq(key, &names[0]));
+    }
+
+    #[test]
+    fn test_extract_all_fields() {
+        let fields = extract_fields(&sample(), &all_field_names::<Sample>());
+        assert_eq!(fields.len(), 3);
+        assert_eq!(fields["speed"], "0.1");
+        assert_eq!(fields["active"], "true");
+    }
+
+    #[test]
+    fn test_selection_is_shared_per_topic() {
+        let a = selection_for("/fields/test");
+        let b = selection_for("/fields/test");
+        a.set(vec!["speed".to_string()]);
+        assert_eq!(&*b.get(), &[Arc::<str>::from("speed")]);
+        assert!(selection_for("/fields/other").get().is_empty());
+    }
+}
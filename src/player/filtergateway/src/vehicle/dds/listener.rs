@@ -2,6 +2,7 @@
 * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 * SPDX-License-Identifier: Apache-2.0
 */
+use crate::vehicle::dds::fields::{all_field_names, extract_fields, selection_for, FieldAccess};
 use crate::vehicle::dds::DdsData;
 use common::Result;
 use std::collections::HashMap;
@@ -37,7 +38,6 @@ use tokio::task::JoinHandle;
 use tokio::time;
 
 use anyhow::anyhow;
-use serde_json::Value;
 
 use async_trait::async_trait;
 // use clap::Parser;
@@ -208,6 +208,7 @@ impl TopicListener {
                 name: data_type_name.clone(),
                 value: "{}".to_string(), // 실제 값은 메시지 수신 시 채워짐
                 fields: HashMap::new(),
+                received_ns: common::trace::now_ns(),
             };
 
             // 데이터 전송 채널이 닫히면 루프 종료
@@ -233,6 +234,7 @@ pub struct GenericTopicListener<
         + Send
         + Sync
         + for<'de> DdsDeserialize<'de>
+        + FieldAccess
         + 'static,
 > {
     /// Topic name
@@ -259,6 +261,7 @@ impl<
             + Send
             + Sync
             + for<'de> DdsDeserialize<'de>
+            + FieldAccess
             + 'static,
     > GenericTopicListener<T>
 {
@@ -314,6 +317,12 @@ impl<
             topic_name
         );
 
+        // Fields wanted by the conditions on this topic, updated by the manager
+        let selection = selection_for(&topic_name);
+        // Without a registered condition every field is extracted, which
+        // keeps the listener useful for debugging
+        let all_fields = all_field_names::<T>();
+
         // 메시지 수신 루프
         let mut interval = time::interval(time::Duration::from_millis(2000));
 
@@ -329,25 +338,21 @@ impl<
                 Ok(samples) => {
                     for sample in samples {
                         if let Ok(data) = sample.data() {
-                            // 데이터를 JSON으로 직렬화
-                            let json_value = serde_json::to_string(&data)
-                                .map_err(|e| anyhow!("Failed to serialize data: {:?}", e))?;
-
-                            // json_value를 key, value로 파싱해서 fields에 추가
-                            let mut fields = HashMap::new();
-                            if let Ok(map) =
-                                serde_json::from_str::<serde_json::Map<String, Value>>(&json_value)
-                            {
-                                for (k, v) in map {
-                                    fields.insert(k, v.to_string());
-                                }
-                            }
+                            // Read only the fields registered conditions use
+                            let selected = selection.get();
+                            let names = if selected.is_empty() {
+                                &all_fields
+                            } else {
+                                &selected
+                            };
+                            let fields = extract_fields(&data, names);
 
                             // DdsData 객체 생성 및 전송
                             let dds_data = DdsData {
                                 name: data_type_name.clone(),
-                                value: json_value,
+                                value: String::new(),
                                 fields,
+                                received_ns: common::trace::now_ns(),
                             };
 
                             // Send data through channel
@@ -375,6 +380,7 @@ impl<
             + Send
             + Sync
             + for<'de> DdsDeserialize<'de>
+            + FieldAccess
             + 'static,
     > DdsTopicListener for GenericTopicListener<T>
 {
@@ -432,6 +438,7 @@ impl<
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::vehicle::dds::fields::FieldValue;
     use crate::vehicle::dds::listener::GenericTopicListener;
     use crate::vehicle::dds::listener::{DdsTopicListener, TopicListener};
     use crate::vehicle::dds::DdsData;
@@ -453,6 +460,30 @@ mod tests {
         pub value: bool,
     }
 
+    // Hand-written equivalents of the accessors build.rs generates
+    impl FieldAccess for DummyType {
+        const FIELD_NAMES: &'static [&'static str] = &["id", "label"];
+
+        fn field(&self, name: &str) -> Option<FieldValue<'_>> {
+            match name {
+                "id" => Some(FieldValue::Int(i64::from(self.id))),
+                "label" => Some(FieldValue::Str(&self.label)),
+                _ => None,
+            }
+        }
+    }
+
+    impl FieldAccess for ADASObstacleDetectionIsWarning {
+        const FIELD_NAMES: &'static [&'static str] = &["value"];
+
+        fn field(&self, name: &str) -> Option<FieldValue<'_>> {
+            match name {
+                "value" => Some(FieldValue::Bool(self.value)),
+                _ => None,
+            }
+        }
+    }
+
     #[tokio::test]
     async fn test_generic_listener_start_stop() {
         let (tx, mut rx) = mpsc::channel::<DdsData>(1);
@@ -646,22 +677,18 @@ mod tests {
         listener2.stop().await.unwrap();
     }
     #[tokio::test]
-    async fn test_json_field_extraction() {
+    async fn test_typed_field_extraction() {
         let dummy = DummyType {
             id: 42,
             label: "test_label".into(),
         };
 
-        let json_value = serde_json::to_string(&dummy).unwrap();
-        let parsed: serde_json::Map<String, Value> = serde_json::from_str(&json_value).unwrap();
-
-        let mut fields = HashMap::new();
-        for (k, v) in parsed {
-            fields.insert(k.clone(), v.to_string());
-        }
+        let fields = extract_fields(&dummy, &[std::sync::Arc::from("label")]);
+        assert_eq!(fields.len(), 1);
+        assert_eq!(fields.get("label").unwrap(), "test_label");
 
+        let fields = extract_fields(&dummy, &all_field_names::<DummyType>());
         assert_eq!(fields.get("id").unwrap(), "42");
-        assert_eq!(fields.get("label").unwrap(), "\"test_label\"");
     }
     #[tokio::test]
     async fn test_listener_loop_exits_when_channel_closed() {
@@ -10,9 +10,11 @@ use std::collections::HashMap;
 use std::env;
 use std::fs;
 use std::path::{Path, PathBuf};
+use std::sync::Arc;
 use tokio::sync::mpsc::{self, Receiver, Sender};
 use tokio::sync::Mutex;
 
+pub mod fields;
 pub mod listener;
 
 // Re-export the modules
@@ -23,7 +25,13 @@ pub use listener::{create_idl_listener, DdsTopicListener};
 pub struct DdsData {
     pub name: String,
     pub value: String,
-    pub fields: HashMap<String, String>,
+    /// Field name → formatted value; names are shared with the listener's
+    /// field selection
+    pub fields: HashMap<Arc<str>, String>,
+    /// When the sample was taken from the reader, in ns since the epoch;
+    /// 0 when unknown
+    #[serde(default)]
+    pub received_ns: u64,
 }
 
 /// DDS Manager - Manages multiple DDS listeners
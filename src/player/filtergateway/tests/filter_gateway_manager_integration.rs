@@ -338,6 +338,7 @@ async fn test_subscribe_and_unsubscribe_vehicle_data() {
         name: "test_topic".to_string(),
         value: "TestType".to_string(),
         fields,
+        received_ns: 0,
     };
 
     assert!(manager.subscribe_vehicle_data(data).await.is_ok());
@@ -348,6 +349,7 @@ async fn test_subscribe_and_unsubscribe_vehicle_data() {
         name: "test_topic".to_string(),
         value: "TestType".to_string(),
         fields: fields2,
+        received_ns: 0,
     };
 
     assert!(manager.unsubscribe_vehicle_data(data2).await.is_ok());
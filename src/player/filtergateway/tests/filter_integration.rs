@@ -47,6 +47,7 @@ fn build_dds_data(topic: &str, key: &str, value: &str) -> DdsData {
         name: topic.into(),
         value: value.to_string(),
         fields,
+        received_ns: 0,
     }
 }
 // === Expression Tests ===
@@ -113,8 +113,8 @@ spec:
     let resul1 = manager.launch_scenario_filter(scenario1).await;
     assert!(result.is_ok());
 
-    let filters = manager.filters.lock().await;
-    assert!(filters.iter().any(|f| f.scenario_name == "helloworld"));
+    let filters = manager.filters.read().await;
+    assert!(filters.contains("helloworld"));
 }
 
 #[tokio::test(flavor = "multi_thread")]
@@ -3,6 +3,7 @@
 * SPDX-License-Identifier: Apache-2.0
 */
 use dust_dds_derive::DdsType;
+use filtergateway::vehicle::dds::fields::{FieldAccess, FieldValue};
 use filtergateway::vehicle::dds::listener::{
     DdsTopicListener, GenericTopicListener, TopicListener,
 };
@@ -16,6 +17,17 @@ pub struct ADASObstacleDetectionIsWarning {
     pub value: bool,
 }
 
+impl FieldAccess for ADASObstacleDetectionIsWarning {
+    const FIELD_NAMES: &'static [&'static str] = &["value"];
+
+    fn field(&self, name: &str) -> Option<FieldValue<'_>> {
+        match name {
+            "value" => Some(FieldValue::Bool(self.value)),
+            _ => None,
+        }
+    }
+}
+
 #[tokio::test]
 async fn test_typed_listener_loop_runs_briefly_and_exits() {
     use tokio::task::JoinHandle;
@@ -0,0 +1,333 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Processing Lanes for Incoming Messages
+//!
+//! StateManager receives two kinds of messages: latency-critical state change
+//! requests from ApiServer, FilterGateway and ActionController, and bulk
+//! container lists from every nodeagent. Each kind is queued in its own
+//! [`Lane`] so that the container backlog cannot delay state changes:
+//! container lists are only taken while the state change lane is empty.
+//!
+//! A lane may deduplicate items by key. The container lane keys lists by node,
+//! so a node that reports faster than StateManager processes only ever has
+//! its newest list pending.
+//!
+//! A lane may also be bounded. The state change lane cannot deduplicate, so
+//! its intake waits in [`Lane::push_wait`] while it is full; the gRPC
+//! handlers then wait on their channel and the backlog pushes back on the
+//! senders instead of growing without limit.
+
+use std::collections::VecDeque;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::Mutex;
+use tokio::sync::Notify;
+use tokio::time::Instant;
+
+struct Entry<T> {
+    key: Option<String>,
+    item: T,
+    /// When the entry was first queued; kept when a newer item replaces it
+    enqueued_at: Instant,
+}
+
+/// Point-in-time copy of a lane's counters
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LaneStats {
+    pub lane: &'static str,
+    /// Items currently waiting
+    pub depth: usize,
+    pub max_depth: usize,
+    /// Items taken out of the lane
+    pub processed: u64,
+    /// Items replaced by a newer item with the same key before processing
+    pub superseded: u64,
+    /// Time from queueing to being taken out of the lane
+    pub avg_dwell_us: u64,
+    pub max_dwell_us: u64,
+}
+
+/// FIFO queue with optional per-key deduplication
+pub struct Lane<T> {
+    name: &'static str,
+    queue: Mutex<VecDeque<Entry<T>>>,
+    /// Signalled when an item is queued or the lane is closed
+    ready: Notify,
+    /// Signalled when the lane becomes empty
+    emptied: Notify,
+    /// Signalled when an item is taken out of a bounded lane
+    space: Notify,
+    /// Most items [`Lane::push_wait`] lets wait, `None` for no limit
+    capacity: Option<usize>,
+    closed: AtomicBool,
+    depth: AtomicUsize,
+    max_depth: AtomicUsize,
+    processed: AtomicU64,
+    superseded: AtomicU64,
+    total_dwell_us: AtomicU64,
+    max_dwell_us: AtomicU64,
+}
+
+impl<T> Lane<T> {
+    pub fn new(name: &'static str) -> Self {
+        Self::with_capacity(name, None)
+    }
+
+    /// Lane holding at most `capacity` items queued through [`Lane::push_wait`]
+    pub fn bounded(name: &'static str, capacity: usize) -> Self {
+        Self::with_capacity(name, Some(capacity.max(1)))
+    }
+
+    fn with_capacity(name: &'static str, capacity: Option<usize>) -> Self {
+        Self {
+            name,
+            queue: Mutex::new(VecDeque::new()),
+            ready: Notify::new(),
+            emptied: Notify::new(),
+            space: Notify::new(),
+            capacity,
+            closed: AtomicBool::new(false),
+            depth: AtomicUsize::new(0),
+            max_depth: AtomicUsize::new(0),
+            processed: AtomicU64::new(0),
+            superseded: AtomicU64::new(0),
+            total_dwell_us: AtomicU64::new(0),
+            max_dwell_us: AtomicU64::new(0),
+        }
+    }
+
+    /// Queue `item`, regardless of the capacity
+    ///
+    /// With a `key`, a pending item with the same key is replaced in place:
+    /// it keeps its position and its original queueing time.
+    pub fn push(&self, item: T, key: Option<&str>) {
+        let _ = self.insert(item, key, None);
+    }
+
+    /// Queue `item` like [`Lane::push`], waiting while a bounded lane is full
+    ///
+    /// Replacing a pending item with the same key never waits.
+    pub async fn push_wait(&self, mut item: T, key: Option<&str>) {
+        loop {
+            let space = self.space.notified();
+            tokio::pin!(space);
+            // Register before trying so a pop in between is not missed
+            space.as_mut().enable();
+            match self.insert(item, key, self.capacity) {
+                Ok(()) => return,
+                Err(rejected) => item = rejected,
+            }
+            space.await;
+        }
+    }
+
+    /// Replace or queue `item`, handing it back if `limit` items are waiting
+    fn insert(&self, item: T, key: Option<&str>, limit: Option<usize>) -> Result<(), T> {
+        {
+            let mut queue = self.lock();
+            if let Some(key) = key {
+                if let Some(entry) = queue
+                    .iter_mut()
+                    .find(|entry| entry.key.as_deref() == Some(key))
+                {
+                    entry.item = item;
+                    self.superseded.fetch_add(1, Ordering::Relaxed);
+                    return Ok(());
+                }
+            }
+            if limit.is_some_and(|limit| queue.len() >= limit) {
+                return Err(item);
+            }
+            queue.push_back(Entry {
+                key: key.map(str::to_string),
+                item,
+                enqueued_at: Instant::now(),
+            });
+            self.depth.store(queue.len(), Ordering::Relaxed);
+            self.max_depth.fetch_max(queue.len(), Ordering::Relaxed);
+        }
+        self.ready.notify_one();
+        Ok(())
+    }
+
+    /// Take the oldest item, if any
+    pub fn pop(&self) -> Option<T> {
+        let (entry, now_empty) = {
+            let mut queue = self.lock();
+            let entry = queue.pop_front()?;
+            self.depth.store(queue.len(), Ordering::Relaxed);
+            (entry, queue.is_empty())
+        };
+        if now_empty {
+            self.emptied.notify_waiters();
+        }
+        if self.capacity.is_some() {
+            self.space.notify_waiters();
+        }
+
+        let us = entry.enqueued_at.elapsed().as_micros() as u64;
+        self.processed.fetch_add(1, Ordering::Relaxed);
+        self.total_dwell_us.fetch_add(us, Ordering::Relaxed);
+        self.max_dwell_us.fetch_max(us, Ordering::Relaxed);
+        Some(entry.item)
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.lock().is_empty()
+    }
+
+    /// No more items will be queued; consumers stop once the lane is drained
+    pub fn close(&self) {
+        self.closed.store(true, Ordering::Release);
+        self.ready.notify_one();
+    }
+
+    /// Wait until an item is queued
+    ///
+    /// # Returns
+    ///
+    /// * `bool` - `false` if the lane is closed and drained
+    pub async fn ready(&self) -> bool {
+        loop {
+            if !self.is_empty() {
+                return true;
+            }
+            if self.closed.load(Ordering::Acquire) {
+                return false;
+            }
+            // A push between the checks above leaves a permit behind
+            self.ready.notified().await;
+        }
+    }
+
+    /// Wait for the next item, `None` once the lane is closed and drained
+    pub async fn next(&self) -> Option<T> {
+        loop {
+            if let Some(item) = self.pop() {
+                return Some(item);
+            }
+            if !self.ready().await {
+                return None;
+            }
+        }
+    }
+
+    /// Wait until no item is pending
+    pub async fn wait_empty(&self) {
+        loop {
+            let emptied = self.emptied.notified();
+            tokio::pin!(emptied);
+            // Register before checking so a pop in between is not missed
+            emptied.as_mut().enable();
+            if self.is_empty() {
+                return;
+            }
+            emptied.await;
+        }
+    }
+
+    pub fn stats(&self) -> LaneStats {
+        let processed = self.processed.load(Ordering::Relaxed);
+        let total = self.total_dwell_us.load(Ordering::Relaxed);
+        LaneStats {
+            lane: self.name,
+            depth: self.depth.load(Ordering::Relaxed),
+            max_depth: self.max_depth.load(Ordering::Relaxed),
+            processed,
+            superseded: self.superseded.load(Ordering::Relaxed),
+            avg_dwell_us: if processed > 0 { total / processed } else { 0 },
+            max_dwell_us: self.max_dwell_us.load(Ordering::Relaxed),
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, VecDeque<Entry<T>>> {
+        self.queue.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Arc;
+    use tokio::time::{timeout, Duration};
+
+    #[test]
+    fn test_push_with_key_replaces_pending_item() {
+        let lane = Lane::new("container");
+        lane.push("node-a v1", Some("node-a"));
+        lane.push("node-b v1", Some("node-b"));
+        lane.push("node-a v2", Some("node-a"));
+
+        let stats = lane.stats();
+        assert_eq!((stats.depth, stats.superseded), (2, 1));
+        // node-a keeps its place in the queue with its newest list
+        assert_eq!(lane.pop(), Some("node-a v2"));
+        assert_eq!(lane.pop(), Some("node-b v1"));
+        assert_eq!(lane.pop(), None);
+        assert_eq!(lane.stats().processed, 2);
+    }
+
+    #[test]
+    fn test_push_without_key_keeps_every_item() {
+        let lane = Lane::new("state_change");
+        lane.push(1, None);
+        lane.push(2, None);
+        assert_eq!(lane.pop(), Some(1));
+        assert_eq!(lane.pop(), Some(2));
+        assert_eq!(lane.stats().max_depth, 2);
+    }
+
+    #[tokio::test]
+    async fn test_push_wait_waits_while_full() {
+        let lane = Arc::new(Lane::bounded("state_change", 2));
+        lane.push_wait(1, None).await;
+        lane.push_wait(2, None).await;
+
+        let pusher = {
+            let lane = Arc::clone(&lane);
+            tokio::spawn(async move { lane.push_wait(3, None).await })
+        };
+        tokio::task::yield_now().await;
+        assert!(!pusher.is_finished());
+        assert_eq!(lane.stats().depth, 2);
+
+        assert_eq!(lane.pop(), Some(1));
+        timeout(Duration::from_secs(1), pusher)
+            .await
+            .expect("push_wait should return once there is space")
+            .unwrap();
+        assert_eq!(lane.pop(), Some(2));
+        assert_eq!(lane.pop(), Some(3));
+        assert_eq!(lane.stats().max_depth, 2);
+    }
+
+    #[tokio::test]
+    async fn test_next_returns_none_after_close_and_drain() {
+        let lane = Arc::new(Lane::new("state_change"));
+        lane.push(1, None);
+        lane.close();
+        assert_eq!(lane.next().await, Some(1));
+        assert_eq!(lane.next().await, None);
+    }
+
+    #[tokio::test]
+    async fn test_wait_empty_wakes_when_drained() {
+        let lane = Arc::new(Lane::new("state_change"));
+        lane.push(1, None);
+
+        let waiter = {
+            let lane = Arc::clone(&lane);
+            tokio::spawn(async move { lane.wait_empty().await })
+        };
+        tokio::task::yield_now().await;
+        assert!(!waiter.is_finished());
+
+        lane.pop();
+        timeout(Duration::from_secs(1), waiter)
+            .await
+            .expect("wait_empty should return once the lane is drained")
+            .unwrap();
+    }
+}
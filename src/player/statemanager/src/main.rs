@@ -23,8 +23,12 @@ use tokio::sync::mpsc::{channel, Receiver, Sender};
 use tonic::transport::Server;
 
 pub mod grpc;
+pub mod lanes;
 pub mod manager;
+pub mod package_index;
+pub mod resource_table;
 pub mod state_machine;
+pub mod state_writer;
 pub mod types;
 
 /// Launches the StateManagerManager in an asynchronous task.
@@ -14,7 +14,9 @@
 //! (Scenario, Package, Model, Volume, Network, Node).
 
 use crate::grpc::sender;
+use crate::lanes::{Lane, LaneStats};
 use crate::state_machine::StateMachine;
+use crate::state_writer::{StateWriter, WriteStats};
 use crate::types::{ActionCommand, TransitionResult};
 use common::monitoringserver::ContainerList;
 use common::spec::artifact::Artifact;
@@ -26,9 +28,15 @@ use common::statemanager::{
 use common::logd;
 use common::Result;
 use std::sync::Arc;
+use std::time::Duration;
 use tokio::sync::{mpsc, Mutex};
 use tokio::task;
 
+/// How often the write-behind and lane counters are logged while busy
+const STATS_REPORT_INTERVAL: Duration = Duration::from_secs(60);
+/// State changes queued before the intake stops reading the gRPC channel
+const STATE_CHANGE_LANE_CAPACITY: usize = 1024;
+
 /// Core state management engine for the StateManager service.
 ///
 /// This struct orchestrates all state management operations by receiving messages
@@ -44,11 +52,16 @@ use tokio::task;
 ///
 /// # Threading Model
 /// - Uses Arc<Mutex<mpsc::Receiver>> for safe multi-threaded access
+/// - Queues received messages in prioritized lanes (state changes first)
 /// - Spawns dedicated async tasks for each message type
 /// - Ensures lock-free message processing with proper channel patterns
 pub struct StateManagerManager {
     /// State machine for processing state transitions
-    state_machine: Arc<Mutex<StateMachine>>,
+    ///
+    /// Shared without an outer lock: the state machine locks only the
+    /// resource being transitioned, so container updates and state change
+    /// requests for different resources do not wait for each other.
+    state_machine: Arc<StateMachine>,
 
     /// Channel receiver for container status updates from nodeagent.
     ///
@@ -64,6 +77,12 @@ pub struct StateManagerManager {
     /// - FilterGateway: Policy-driven state transitions and filtering decisions
     /// - ActionController: Action execution results and state confirmations
     rx_state_change: Arc<Mutex<mpsc::Receiver<StateChange>>>,
+
+    /// Pending state changes; always served before container lists
+    state_change_lane: Arc<Lane<StateChange>>,
+
+    /// Pending container lists, only the newest one per node
+    container_lane: Arc<Lane<ContainerList>>,
 }
 
 impl StateManagerManager {
@@ -83,12 +102,24 @@ impl StateManagerManager {
         rx_state_change: mpsc::Receiver<StateChange>,
     ) -> Self {
         Self {
-            state_machine: Arc::new(Mutex::new(StateMachine::new())),
+            state_machine: Arc::new(StateMachine::new()),
             rx_container: Arc::new(Mutex::new(rx_container)),
             rx_state_change: Arc::new(Mutex::new(rx_state_change)),
+            state_change_lane: Arc::new(Lane::bounded("state_change", STATE_CHANGE_LANE_CAPACITY)),
+            container_lane: Arc::new(Lane::new("container_list")),
         }
     }
 
+    /// Queue depth and dwell time of the state change and container lanes
+    pub fn lane_stats(&self) -> Vec<LaneStats> {
+        vec![self.state_change_lane.stats(), self.container_lane.stats()]
+    }
+
+    /// Coalescing and flush latency of the write-behind state writer
+    pub fn writer_stats(&self) -> WriteStats {
+        self.state_machine.state_writer().stats()
+    }
+
     /// Initializes the StateManagerManager's internal state and resources.
     ///
     /// Performs startup operations required before beginning message processing:
@@ -109,16 +140,26 @@ impl StateManagerManager {
         logd!(3, "StateManagerManager initializing...");
 
         // Initialize the state machine with async action executor
-        let action_receiver = {
-            let mut state_machine = self.state_machine.lock().await;
-            state_machine.initialize_action_executor()
-        };
+        let action_receiver = self.state_machine.initialize_action_executor();
 
         // Start the async action executor
         tokio::spawn(async move {
             run_action_executor(action_receiver).await;
         });
 
+        // Write state changes back to ETCD in coalesced batches
+        tokio::spawn(self.state_machine.state_writer().run());
+        tokio::spawn(report_stats(
+            self.state_machine.state_writer(),
+            Arc::clone(&self.state_change_lane),
+            Arc::clone(&self.container_lane),
+        ));
+
+        // Keep the model/package index current for package state evaluation
+        tokio::spawn(crate::package_index::watch_packages(
+            self.state_machine.package_index(),
+        ));
+
         logd!(3, "State machine initialized with transition tables for Scenario, Package, and Model resources");
         logd!(
             3,
@@ -304,12 +345,11 @@ impl StateManagerManager {
         // - Condition evaluation for conditional transitions
         // - Action scheduling for follow-up operations
         // - Error detection and reporting
-        let result = {
-            // Acquire exclusive lock on the state machine for this transition
-            // Note: This serializes all state transitions to maintain consistency
-            let mut state_machine = self.state_machine.lock().await;
-            state_machine.process_state_change(state_change.clone())
-        }; // Lock is automatically released here
+        // Only this resource is locked for the duration of the transition;
+        // transitions of other resources proceed in parallel
+        let result = self
+            .state_machine
+            .process_state_change(state_change.clone());
 
         // ========================================
         // STEP 4: RESULT PROCESSING AND RESPONSE
@@ -321,6 +361,12 @@ impl StateManagerManager {
             // SUCCESS PATH: Log positive outcome and queue actions
             // ========================================
             logd!(1, "  ✓ State transition completed successfully");
+            if common::trace::is_trace_id(&state_change.transition_id) {
+                common::trace::mark(
+                    &state_change.transition_id,
+                    common::trace::Stage::StateApplied,
+                );
+            }
             // Convert new_state to string representation based on resource type only for logs
             let new_state_str = match resource_type {
                 ResourceType::Scenario => ScenarioState::try_from(result.new_state)
@@ -356,9 +402,13 @@ impl StateManagerManager {
                 logd!(1, "   📤 Saving to ETCD:");
                 logd!(1, "      • Key: {}", etcd_key);
                 logd!(1, "      • Value: {}", etcd_value);
-                logd!(1, "      • Operation: common::etcd::put()");
+                logd!(1, "      • Operation: StateWriter::submit()");
 
-                if let Err(e) = common::etcd::put(&etcd_key, etcd_value).await {
+                if let Err(e) = self
+                    .state_machine
+                    .state_writer()
+                    .submit(etcd_key.clone(), etcd_value.to_string())
+                {
                     logd!(4, "   ❌ Failed to save scenario state to ETCD: {:?}", e);
                 } else {
                     logd!(
@@ -489,14 +539,17 @@ impl StateManagerManager {
             .group_containers_by_model(&container_list.containers)
             .await;
 
+        // Models whose state changed, persisted together after evaluation
+        let mut changed_models = Vec::new();
+
         // Process each model's container states
         for (model_name, containers) in model_containers {
             logd!(2, "  Processing model: {}", model_name);
 
             // Process the state evaluation and transition through the state machine
-            let mut state_machine = self.state_machine.lock().await;
-            let transition_result =
-                state_machine.process_model_state_update(&model_name, &containers);
+            let transition_result = self
+                .state_machine
+                .process_model_state_update(&model_name, &containers);
 
             if transition_result.is_success() {
                 // Check if state actually changed by looking at actions_to_execute
@@ -519,20 +572,7 @@ impl StateManagerManager {
                         _ => common::statemanager::ModelState::Running,
                     };
 
-                    // Save the new model state to ETCD
-                    drop(state_machine); // Release the lock before async operation
-                    if let Err(e) = self
-                        .save_model_state_to_etcd(&model_name, new_model_state)
-                        .await
-                    {
-                        logd!(4, "    Failed to save model state to ETCD: {:?}", e);
-                    } else {
-                        logd!(1, "    Successfully saved model state to ETCD");
-
-                        // Trigger package state evaluation based on model state change
-                        // This implements the chain reaction described in the Korean documentation
-                        self.trigger_package_state_evaluation(&model_name).await;
-                    }
+                    changed_models.push((model_name, new_model_state));
                 } else {
                     logd!(
                         2,
@@ -549,6 +589,25 @@ impl StateManagerManager {
             }
         }
 
+        if !changed_models.is_empty() {
+            // Save all new model states to ETCD in one batch
+            if let Err(e) = self.save_model_states_to_etcd(&changed_models) {
+                logd!(4, "    Failed to save model states to ETCD: {:?}", e);
+            } else {
+                logd!(
+                    1,
+                    "    Successfully saved {} model states to ETCD",
+                    changed_models.len()
+                );
+
+                // Trigger package state evaluation based on model state changes
+                // This implements the chain reaction described in the Korean documentation
+                let model_names: Vec<String> =
+                    changed_models.into_iter().map(|(name, _)| name).collect();
+                self.trigger_package_state_evaluation(&model_names).await;
+            }
+        }
+
         logd!(2, "  Status: Container list processing completed");
         logd!(2, "=====================================");
     }
@@ -604,58 +663,76 @@ impl StateManagerManager {
         None
     }
 
-    /// Saves model state to ETCD using the format specified in the documentation
-    async fn save_model_state_to_etcd(
+    /// Saves model states to ETCD using the format specified in the documentation
+    ///
+    /// Format: /model/{model_name}/state -> state_value (e.g., "Running", "Dead")
+    ///
+    /// The states are handed to the write-behind [`StateWriter`](crate::state_writer::StateWriter)
+    /// and written together in its next batch; an error means no state was queued.
+    fn save_model_states_to_etcd(
         &self,
-        model_name: &str,
-        model_state: common::statemanager::ModelState,
+        model_states: &[(String, common::statemanager::ModelState)],
     ) -> std::result::Result<(), String> {
-        let key = format!("/model/{}/state", model_name);
-        let value = match model_state {
-            common::statemanager::ModelState::Created => "Created",
-            common::statemanager::ModelState::Paused => "Paused",
-            common::statemanager::ModelState::Exited => "Exited",
-            common::statemanager::ModelState::Dead => "Dead",
-            common::statemanager::ModelState::Running => "Running",
-            _ => "Unknown",
-        };
-
-        logd!(1, "    Saving to ETCD - Key: {}, Value: {}", key, value);
+        let items: Vec<(String, String)> = model_states
+            .iter()
+            .map(|(model_name, model_state)| {
+                let key = format!("/model/{}/state", model_name);
+                let value = match model_state {
+                    common::statemanager::ModelState::Created => "Created",
+                    common::statemanager::ModelState::Paused => "Paused",
+                    common::statemanager::ModelState::Exited => "Exited",
+                    common::statemanager::ModelState::Dead => "Dead",
+                    common::statemanager::ModelState::Running => "Running",
+                    _ => "Unknown",
+                };
+                logd!(1, "    Saving to ETCD - Key: {}, Value: {}", key, value);
+                (key, value.to_string())
+            })
+            .collect();
 
-        if let Err(e) = common::etcd::put(&key, value).await {
-            logd!(5, "    Failed to save model state: {:?}", e);
+        if let Err(e) = self.state_machine.state_writer().submit_all(items) {
+            logd!(5, "    Failed to save model states: {:?}", e);
             return Err(format!(
-                "Failed to save model state for {}: {:?}",
-                model_name, e
+                "Failed to save model states for {} models: {:?}",
+                model_states.len(),
+                e
             ));
         }
 
         Ok(())
     }
 
-    /// Saves package state to ETCD using the format specified in the Korean documentation
+    /// Saves package states to ETCD using the format specified in the Korean documentation
     ///
     /// Format: /package/{package_name}/state -> state_value (e.g., "running", "degraded", "error")
-    async fn save_package_state_to_etcd(
+    ///
+    /// Queued in the write-behind [`StateWriter`](crate::state_writer::StateWriter)
+    /// like [`save_model_states_to_etcd`](Self::save_model_states_to_etcd).
+    fn save_package_states_to_etcd(
         &self,
-        package_name: &str,
-        package_state: common::statemanager::PackageState,
+        package_states: &[(String, common::statemanager::PackageState)],
     ) -> std::result::Result<(), String> {
-        let key = format!("/package/{}/state", package_name);
-        let value = package_state.as_str_name();
-
-        logd!(
-            1,
-            "    Saving package state to ETCD - Key: {}, Value: {}",
-            key,
-            value
-        );
+        let items: Vec<(String, String)> = package_states
+            .iter()
+            .map(|(package_name, package_state)| {
+                let key = format!("/package/{}/state", package_name);
+                let value = package_state.as_str_name();
+                logd!(
+                    1,
+                    "    Saving package state to ETCD - Key: {}, Value: {}",
+                    key,
+                    value
+                );
+                (key, value.to_string())
+            })
+            .collect();
 
-        if let Err(e) = common::etcd::put(&key, value).await {
-            logd!(5, "    Failed to save package state: {:?}", e);
+        if let Err(e) = self.state_machine.state_writer().submit_all(items) {
+            logd!(5, "    Failed to save package states: {:?}", e);
             return Err(format!(
-                "Failed to save package state for {}: {:?}",
-                package_name, e
+                "Failed to save package states for {} packages: {:?}",
+                package_states.len(),
+                e
             ));
         }
 
@@ -667,70 +744,52 @@ impl StateManagerManager {
     /// This function implements the chain reaction described in the Korean documentation:
     /// When a model state changes, it triggers package state evaluation to see if the
     /// package state should also change based on the states of all models in the package.
-    async fn trigger_package_state_evaluation(&self, changed_model_name: &str) {
+    /// Every affected package is evaluated once and all changed package states are
+    /// written back in a single batch.
+    async fn trigger_package_state_evaluation(&self, changed_model_names: &[String]) {
         logd!(
             2,
-            "  Triggering package state evaluation for model: {}",
-            changed_model_name
+            "  Triggering package state evaluation for models: {:?}",
+            changed_model_names
         );
 
-        // Find all packages that contain this model using StateMachine
-        let packages = match StateMachine::find_packages_containing_model(changed_model_name).await
-        {
-            Ok(pkgs) => pkgs,
-            Err(e) => {
-                logd!(
-                    4,
-                    "    Failed to find packages for model {}: {:?}",
-                    changed_model_name,
-                    e
-                );
-                return;
+        // Find all packages that contain any of the changed models using StateMachine
+        let mut packages: Vec<String> = Vec::new();
+        for model_name in changed_model_names {
+            match self
+                .state_machine
+                .packages_containing_model(model_name)
+                .await
+            {
+                Ok(pkgs) => {
+                    for pkg in pkgs {
+                        if !packages.contains(&pkg) {
+                            packages.push(pkg);
+                        }
+                    }
+                }
+                Err(e) => {
+                    logd!(
+                        4,
+                        "    Failed to find packages for model {}: {:?}",
+                        model_name,
+                        e
+                    );
+                }
             }
-        };
+        }
 
-        // Evaluate and update state for each package using state machine
+        // Evaluate state for each package using state machine
+        let mut changed_packages = Vec::new();
         for package_name in packages {
-            let state_machine = self.state_machine.lock().await;
-            match state_machine
+            match self
+                .state_machine
                 .evaluate_and_update_package_state(&package_name)
                 .await
             {
                 Ok((state_changed, new_state)) => {
-                    drop(state_machine); // Release lock before async operations
-
                     if state_changed {
-                        // Save new state to ETCD
-                        if let Err(e) = self
-                            .save_package_state_to_etcd(&package_name, new_state)
-                            .await
-                        {
-                            logd!(5, "      Failed to save package state: {:?}", e);
-                            continue;
-                        }
-
-                        // If package is in error or degraded state, trigger ActionController reconcile
-                        if new_state == common::statemanager::PackageState::Error
-                            || new_state == common::statemanager::PackageState::Degraded
-                        {
-                            if let Err(e) = self
-                                .trigger_action_controller_reconcile_internal(&package_name)
-                                .await
-                            {
-                                logd!(
-                                    5,
-                                    "      Failed to trigger ActionController reconcile: {:?}",
-                                    e
-                                );
-                            }
-                        }
-
-                        logd!(
-                            1,
-                            "      Successfully updated package {} state to {}",
-                            package_name,
-                            new_state.as_str_name()
-                        );
+                        changed_packages.push((package_name, new_state));
                     }
                 }
                 Err(e) => {
@@ -743,6 +802,41 @@ impl StateManagerManager {
                 }
             }
         }
+
+        if changed_packages.is_empty() {
+            return;
+        }
+
+        // Save new states to ETCD
+        if let Err(e) = self.save_package_states_to_etcd(&changed_packages) {
+            logd!(5, "      Failed to save package states: {:?}", e);
+            return;
+        }
+
+        for (package_name, new_state) in changed_packages {
+            // If package is in error or degraded state, trigger ActionController reconcile
+            if new_state == common::statemanager::PackageState::Error
+                || new_state == common::statemanager::PackageState::Degraded
+            {
+                if let Err(e) = self
+                    .trigger_action_controller_reconcile_internal(&package_name)
+                    .await
+                {
+                    logd!(
+                        5,
+                        "      Failed to trigger ActionController reconcile: {:?}",
+                        e
+                    );
+                }
+            }
+
+            logd!(
+                1,
+                "      Successfully updated package {} state to {}",
+                package_name,
+                new_state.as_str_name()
+            );
+        }
     }
 
     /// Trigger ActionController reconcile request for dead/error package state
@@ -852,29 +946,33 @@ impl StateManagerManager {
     /// Main message processing loop for handling gRPC requests.
     ///
     /// Spawns dedicated async tasks for processing different message types:
-    /// 1. Container status processing task
+    /// 1. Intake tasks that move received messages into their lanes
     /// 2. State change processing task
+    /// 3. Container status processing task
     ///
-    /// Each task runs independently to ensure optimal throughput and prevent
-    /// blocking between different message types.
+    /// State changes are latency-critical and have priority: a container list
+    /// is only taken from its lane while no state change is waiting. Container
+    /// lists are deduplicated per node, so a backlog never holds more than the
+    /// newest list of each node.
     ///
     /// # Returns
     /// * `Result<()>` - Success or processing error
     ///
     /// # Architecture Notes
     /// - Uses separate tasks to prevent cross-contamination between message types
-    /// - Maintains proper async patterns for high-throughput processing
-    /// - Ensures graceful shutdown when channels are closed
+    /// - Intake only waits for processing once the bounded state change lane is
+    ///   full, so senders feel backpressure instead of queueing without limit
+    /// - Ensures graceful shutdown when channels are closed and lanes are drained
     pub async fn process_grpc_requests(&self) -> Result<()> {
         let rx_container = Arc::clone(&self.rx_container);
         let rx_state_change = Arc::clone(&self.rx_state_change);
 
         // ========================================
-        // CONTAINER STATUS PROCESSING TASK
+        // INTAKE TASKS
         // ========================================
-        // Handles ContainerList messages from nodeagent for container monitoring
-        let container_task = {
-            let state_manager = self.clone_for_task();
+        // Drain the channels into the lanes as fast as messages arrive
+        let container_intake = {
+            let lane = Arc::clone(&self.container_lane);
             tokio::spawn(async move {
                 loop {
                     let container_list_opt = {
@@ -883,8 +981,8 @@ impl StateManagerManager {
                     };
                     match container_list_opt {
                         Some(container_list) => {
-                            // Process container status update with comprehensive analysis
-                            state_manager.process_container_list(container_list).await;
+                            let node_name = container_list.node_name.clone();
+                            lane.push(container_list, Some(&node_name));
                         }
                         None => {
                             // Channel closed - graceful shutdown
@@ -892,20 +990,15 @@ impl StateManagerManager {
                                 4,
                                 "Container channel closed - shutting down container processing"
                             );
+                            lane.close();
                             break;
                         }
                     }
                 }
-                logd!(4, "ContainerList processing task stopped");
             })
         };
-
-        // ========================================
-        // STATE CHANGE PROCESSING TASK
-        // ========================================
-        // Handles StateChange messages from ApiServer, FilterGateway, ActionController
-        let state_change_task = {
-            let state_manager = self.clone_for_task();
+        let state_change_intake = {
+            let lane = Arc::clone(&self.state_change_lane);
             tokio::spawn(async move {
                 loop {
                     let state_change_opt = {
@@ -913,26 +1006,62 @@ impl StateManagerManager {
                         rx.recv().await
                     };
                     match state_change_opt {
-                        Some(state_change) => {
-                            // Process state change with comprehensive PICCOLO compliance
-                            state_manager.process_state_change(state_change).await;
-                        }
+                        Some(state_change) => lane.push_wait(state_change, None).await,
                         None => {
                             // Channel closed - graceful shutdown
                             logd!(
                                 4,
                                 "StateChange channel closed - shutting down state processing"
                             );
+                            lane.close();
                             break;
                         }
                     }
                 }
+            })
+        };
+
+        // ========================================
+        // STATE CHANGE PROCESSING TASK
+        // ========================================
+        // Handles StateChange messages from ApiServer, FilterGateway, ActionController
+        let state_change_task = {
+            let state_manager = self.clone_for_task();
+            tokio::spawn(async move {
+                while let Some(state_change) = state_manager.state_change_lane.next().await {
+                    // Process state change with comprehensive PICCOLO compliance
+                    state_manager.process_state_change(state_change).await;
+                }
                 logd!(4, "StateChange processing task stopped");
             })
         };
 
-        // Wait for both tasks to complete (typically on shutdown)
-        let result = tokio::try_join!(container_task, state_change_task);
+        // ========================================
+        // CONTAINER STATUS PROCESSING TASK
+        // ========================================
+        // Handles ContainerList messages from nodeagent for container monitoring
+        let container_task = {
+            let state_manager = self.clone_for_task();
+            tokio::spawn(async move {
+                while state_manager.container_lane.ready().await {
+                    // Yield to state changes queued meanwhile
+                    state_manager.state_change_lane.wait_empty().await;
+                    if let Some(container_list) = state_manager.container_lane.pop() {
+                        // Process container status update with comprehensive analysis
+                        state_manager.process_container_list(container_list).await;
+                    }
+                }
+                logd!(4, "ContainerList processing task stopped");
+            })
+        };
+
+        // Wait for all tasks to complete (typically on shutdown)
+        let result = tokio::try_join!(
+            container_intake,
+            state_change_intake,
+            container_task,
+            state_change_task
+        );
         match result {
             Ok(_) => {
                 logd!(3, "All processing tasks completed successfully");
@@ -957,6 +1086,8 @@ impl StateManagerManager {
             state_machine: Arc::clone(&self.state_machine),
             rx_container: Arc::clone(&self.rx_container),
             rx_state_change: Arc::clone(&self.rx_state_change),
+            state_change_lane: Arc::clone(&self.state_change_lane),
+            container_lane: Arc::clone(&self.container_lane),
         }
     }
 
@@ -1005,6 +1136,57 @@ impl StateManagerManager {
     }
 }
 
+/// Log the state writer and lane counters for the lifetime of StateManager
+///
+/// Nothing is logged for an interval in which no update was submitted and
+/// no lane item was processed.
+async fn report_stats(
+    writer: Arc<StateWriter>,
+    state_change_lane: Arc<Lane<StateChange>>,
+    container_lane: Arc<Lane<ContainerList>>,
+) {
+    let mut ticks = tokio::time::interval(STATS_REPORT_INTERVAL);
+    ticks.tick().await;
+    let mut last_activity = (0, 0);
+    loop {
+        ticks.tick().await;
+        let write = writer.stats();
+        let lanes = [state_change_lane.stats(), container_lane.stats()];
+        let activity = (
+            write.submitted,
+            lanes.iter().map(|lane| lane.processed).sum::<u64>(),
+        );
+        if activity == last_activity {
+            continue;
+        }
+        last_activity = activity;
+        logd!(
+            3,
+            "StateWriter: {} submitted, {} written ({:.2}x coalesced), {} flushes, {} failed, flush latency avg {}us max {}us",
+            write.submitted,
+            write.written,
+            write.coalescing_ratio(),
+            write.flushes,
+            write.failed_flushes,
+            write.avg_flush_latency_us,
+            write.max_flush_latency_us
+        );
+        for lane in lanes {
+            logd!(
+                3,
+                "Lane {}: depth {} (max {}), {} processed, {} superseded, dwell avg {}us max {}us",
+                lane.lane,
+                lane.depth,
+                lane.max_depth,
+                lane.processed,
+                lane.superseded,
+                lane.avg_dwell_us,
+                lane.max_dwell_us
+            );
+        }
+    }
+}
+
 /// Async action executor - runs in separate task
 ///
 /// This function handles the execution of actions triggered by state transitions.
@@ -1846,22 +2028,24 @@ mod unit_tests {
         let manager = StateManagerManager::new(rx_container, rx_state_change).await;
 
         // Attempt to save a model state (success path)
-        let res = manager
-            .save_model_state_to_etcd("test-model", common::statemanager::ModelState::Running)
-            .await;
+        let res = manager.save_model_states_to_etcd(&[(
+            "test-model".to_string(),
+            common::statemanager::ModelState::Running,
+        )]);
         assert!(
             res.is_ok(),
-            "save_model_state_to_etcd should succeed: {:?}",
+            "save_model_states_to_etcd should succeed: {:?}",
             res
         );
 
         // Attempt to save a package state (success path)
-        let res2 = manager
-            .save_package_state_to_etcd("test-package", common::statemanager::PackageState::Running)
-            .await;
+        let res2 = manager.save_package_states_to_etcd(&[(
+            "test-package".to_string(),
+            common::statemanager::PackageState::Running,
+        )]);
         assert!(
             res2.is_ok(),
-            "save_package_state_to_etcd should succeed: {:?}",
+            "save_package_states_to_etcd should succeed: {:?}",
             res2
         );
     }
@@ -1878,12 +2062,11 @@ mod unit_tests {
         let long_name = "a".repeat(2000);
 
         let res = manager
-            .save_model_state_to_etcd(&long_name, common::statemanager::ModelState::Running)
-            .await;
+            .save_model_states_to_etcd(&[(long_name, common::statemanager::ModelState::Running)]);
 
         assert!(
             res.is_err(),
-            "Expected save_model_state_to_etcd to fail for long key"
+            "Expected save_model_states_to_etcd to fail for long key"
         );
     }
 
@@ -1898,13 +2081,14 @@ mod unit_tests {
         // Create an excessively long package name to force an ETCD key length validation error
         let long_name = "b".repeat(2000);
 
-        let res = manager
-            .save_package_state_to_etcd(&long_name, common::statemanager::PackageState::Running)
-            .await;
+        let res = manager.save_package_states_to_etcd(&[(
+            long_name,
+            common::statemanager::PackageState::Running,
+        )]);
 
         assert!(
             res.is_err(),
-            "Expected save_package_state_to_etcd to fail for long key"
+            "Expected save_package_states_to_etcd to fail for long key"
         );
     }
 
@@ -1972,6 +2156,13 @@ mod unit_tests {
         // Wait for the processing tasks to finish (with timeout)
         let res = tokio::time::timeout(std::time::Duration::from_secs(2), handle).await;
         assert!(res.is_ok(), "process_grpc_requests did not finish in time");
+
+        // Both messages went through their lanes
+        let stats = manager.lane_stats();
+        assert_eq!(stats[0].lane, "state_change");
+        assert_eq!(stats[0].processed, 1);
+        assert_eq!(stats[1].processed, 1);
+        assert!(stats.iter().all(|lane| lane.depth == 0));
     }
 
     #[tokio::test]
@@ -1994,6 +2185,7 @@ mod unit_tests {
         };
 
         manager.process_state_change(sc.clone()).await;
+        let _ = manager.state_machine.state_writer().flush().await;
 
         // Check etcd key exists for scenario state
         let key = format!("/scenario/{}/state", sc.resource_name);
@@ -2016,7 +2208,7 @@ mod unit_tests {
 
         // Should run without panic even if no packages found
         manager
-            .trigger_package_state_evaluation("no-packages")
+            .trigger_package_state_evaluation(&["no-packages".to_string()])
             .await;
     }
 
@@ -2039,7 +2231,10 @@ mod unit_tests {
         let _ = common::etcd::put("/package/pkg-update/state", "running").await;
 
         // Trigger evaluation
-        manager.trigger_package_state_evaluation("mup").await;
+        manager
+            .trigger_package_state_evaluation(&["mup".to_string()])
+            .await;
+        let _ = manager.state_machine.state_writer().flush().await;
 
         // After evaluation, the package state should be updated (Error expected)
         let state = StateMachine::get_current_package_state("pkg-update").await;
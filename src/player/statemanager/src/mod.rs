@@ -8,8 +8,12 @@
 //! This module provides the public interface for the StateManager component
 
 pub mod grpc;
+pub mod lanes;
 pub mod manager;
+pub mod package_index;
+pub mod resource_table;
 pub mod state_machine;
+pub mod state_writer;
 pub mod types;
 
 // Re-export main types for easier access
@@ -0,0 +1,332 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! In-memory Package/Model Index
+//!
+//! Maps every model to the packages that contain it and every package to its
+//! models, so a model state update does not have to fetch and parse all
+//! `Package/` entries from ETCD.
+//!
+//! # Consistency
+//! [`watch_packages`] builds the index from a store snapshot of the
+//! `Package/` prefix, or from the initial contents of a watch after a stream
+//! failure, and then applies every put and delete written when an artifact
+//! is applied or withdrawn. While the watch is not synced, e.g. at
+//! startup or after the stream failed, lookups return `None` and callers fall
+//! back to reading ETCD.
+
+use common::etcd::Watcher;
+use common::logd;
+use common::spec::artifact::Package;
+use common::startup::StartupTimer;
+use std::collections::{BTreeSet, HashMap};
+use std::sync::{Arc, RwLock};
+use tokio::time::{sleep, Duration};
+
+/// ETCD prefix of package definitions
+pub const PACKAGE_PREFIX: &str = "Package/";
+
+/// First delay before re-opening a failed watch
+const RETRY_DELAY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the retry backoff
+const RETRY_DELAY_MAX: Duration = Duration::from_secs(30);
+
+#[derive(Default)]
+struct Inner {
+    /// Package name → model names in definition order
+    models_by_package: HashMap<String, Vec<String>>,
+    /// Model name → names of the packages containing it
+    packages_by_model: HashMap<String, BTreeSet<String>>,
+    /// Whether the index reflects ETCD
+    synced: bool,
+}
+
+impl Inner {
+    fn insert(&mut self, package_name: String, models: Vec<String>) {
+        self.remove(&package_name);
+        for model in &models {
+            self.packages_by_model
+                .entry(model.clone())
+                .or_default()
+                .insert(package_name.clone());
+        }
+        self.models_by_package.insert(package_name, models);
+    }
+
+    fn remove(&mut self, package_name: &str) {
+        let Some(models) = self.models_by_package.remove(package_name) else {
+            return;
+        };
+        for model in models {
+            if let Some(packages) = self.packages_by_model.get_mut(&model) {
+                packages.remove(package_name);
+                if packages.is_empty() {
+                    self.packages_by_model.remove(&model);
+                }
+            }
+        }
+    }
+}
+
+/// Model ↔ package relations of all applied packages
+#[derive(Default)]
+pub struct PackageIndex {
+    inner: RwLock<Inner>,
+}
+
+impl PackageIndex {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Whether lookups can be trusted to cover every package
+    pub fn is_synced(&self) -> bool {
+        self.read().synced
+    }
+
+    /// Packages containing `model_name`, `None` while not synced
+    pub fn packages_for_model(&self, model_name: &str) -> Option<Vec<String>> {
+        let inner = self.read();
+        if !inner.synced {
+            return None;
+        }
+        Some(
+            inner
+                .packages_by_model
+                .get(model_name)
+                .map(|packages| packages.iter().cloned().collect())
+                .unwrap_or_default(),
+        )
+    }
+
+    /// Models of `package_name`, `None` while not synced
+    ///
+    /// A package that is not applied has no models.
+    pub fn models_for_package(&self, package_name: &str) -> Option<Vec<String>> {
+        let inner = self.read();
+        if !inner.synced {
+            return None;
+        }
+        Some(
+            inner
+                .models_by_package
+                .get(package_name)
+                .cloned()
+                .unwrap_or_default(),
+        )
+    }
+
+    /// Replace the whole index from `(key, yaml)` entries under [`PACKAGE_PREFIX`]
+    pub fn replace_all(&self, entries: Vec<(String, String)>) {
+        let mut index = Inner::default();
+        for (key, value) in entries {
+            if let Some((name, models)) = parse_entry(&key, &value) {
+                index.insert(name, models);
+            }
+        }
+        index.synced = true;
+        *self.write() = index;
+    }
+
+    /// Apply a put of a package definition
+    pub fn apply_put(&self, key: &str, value: &str) {
+        match parse_entry(key, value) {
+            Some((name, models)) => self.write().insert(name, models),
+            // An unreadable definition must not keep its old models
+            None => self.apply_delete(key),
+        }
+    }
+
+    /// Apply a delete of a package definition
+    pub fn apply_delete(&self, key: &str) {
+        if let Some(name) = key.strip_prefix(PACKAGE_PREFIX) {
+            self.write().remove(name);
+        }
+    }
+
+    fn mark_unsynced(&self) {
+        self.write().synced = false;
+    }
+
+    fn read(&self) -> std::sync::RwLockReadGuard<'_, Inner> {
+        self.inner.read().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn write(&self) -> std::sync::RwLockWriteGuard<'_, Inner> {
+        self.inner.write().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+/// Package name and model names of one `Package/` entry
+fn parse_entry(key: &str, value: &str) -> Option<(String, Vec<String>)> {
+    let name = key.strip_prefix(PACKAGE_PREFIX)?;
+    match serde_yaml::from_str::<Package>(value) {
+        Ok(package) => Some((
+            name.to_string(),
+            package
+                .get_models()
+                .iter()
+                .map(|model_info| model_info.get_name())
+                .collect(),
+        )),
+        Err(e) => {
+            logd!(4, "    Failed to parse package {}: {:?}", key, e);
+            None
+        }
+    }
+}
+
+/// Load the index from one snapshot and return the watcher that continues
+/// after it, `None` if the snapshot could not be taken
+async fn warm_start(index: &PackageIndex) -> Option<Watcher> {
+    let mut timer = StartupTimer::start("statemanager");
+    match common::etcd::snapshot_and_watch(&[PACKAGE_PREFIX]).await {
+        Ok((snapshot, mut watchers)) => {
+            timer.mark("snapshot");
+            index.replace_all(snapshot.entries().to_vec());
+            timer.mark("package_index");
+            timer.note(format!(
+                "{} packages at rev {}",
+                snapshot.len(),
+                snapshot.revision()
+            ));
+            timer.finish();
+            watchers.pop()
+        }
+        Err(e) => {
+            logd!(4, "[PackageIndex] Snapshot failed, watching instead: {}", e);
+            None
+        }
+    }
+}
+
+/// Keeps `index` in sync with the `Package/` prefix for the lifetime of StateManager
+///
+/// The index is first loaded from a snapshot. After a failure the initial
+/// contents of a new watch are collected until it reports `synced` and then
+/// replace the index at once. When the stream fails or closes the index is
+/// marked unsynced and the watch is re-opened with exponential backoff.
+pub async fn watch_packages(index: Arc<PackageIndex>) {
+    let mut delay = RETRY_DELAY_MIN;
+    let mut warm = warm_start(&index).await;
+    loop {
+        let watcher = match warm.take() {
+            Some(watcher) => Ok(watcher),
+            None => common::etcd::watch(PACKAGE_PREFIX, true).await,
+        };
+        match watcher {
+            Ok(mut watcher) => {
+                let mut initial = Vec::new();
+                loop {
+                    let batch = match watcher.next().await {
+                        Ok(Some(batch)) => batch,
+                        Ok(None) => {
+                            logd!(4, "[PackageIndex] Package watch closed");
+                            break;
+                        }
+                        Err(e) => {
+                            logd!(4, "[PackageIndex] Package watch failed: {}", e);
+                            break;
+                        }
+                    };
+                    if batch.initial {
+                        for event in batch.events {
+                            if let common::etcd::WatchEvent::Put { key, value } = event {
+                                initial.push((key, value));
+                            }
+                        }
+                        if batch.synced {
+                            index.replace_all(std::mem::take(&mut initial));
+                            delay = RETRY_DELAY_MIN;
+                            logd!(2, "[PackageIndex] Package index synced");
+                        }
+                        continue;
+                    }
+                    for event in batch.events {
+                        match event {
+                            common::etcd::WatchEvent::Put { key, value } => {
+                                index.apply_put(&key, &value)
+                            }
+                            common::etcd::WatchEvent::Delete { key } => index.apply_delete(&key),
+                        }
+                    }
+                }
+            }
+            Err(e) => logd!(4, "[PackageIndex] Failed to watch packages: {}", e),
+        }
+
+        index.mark_unsynced();
+        sleep(delay).await;
+        delay = (delay * 2).min(RETRY_DELAY_MAX);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn package_yaml(name: &str, models: &[&str]) -> String {
+        let models: Vec<String> = models
+            .iter()
+            .map(|m| {
+                format!(
+                    r#"{{"name":"{m}","node":"n","resources":{{"volume":"","network":"","realtime":false}}}}"#
+                )
+            })
+            .collect();
+        format!(
+            r#"{{"apiVersion":"v1","kind":"Package","metadata":{{"name":"{name}"}},"spec":{{"pattern":[],"models":[{}]}}}}"#,
+            models.join(",")
+        )
+    }
+
+    #[test]
+    fn test_lookups_are_none_until_synced() {
+        let index = PackageIndex::new();
+        index.apply_put("Package/p1", &package_yaml("p1", &["m1"]));
+        assert!(index.packages_for_model("m1").is_none());
+        assert!(index.models_for_package("p1").is_none());
+
+        index.replace_all(vec![]);
+        assert_eq!(index.packages_for_model("m1"), Some(vec![]));
+        assert_eq!(index.models_for_package("p1"), Some(vec![]));
+    }
+
+    #[test]
+    fn test_index_follows_puts_and_deletes() {
+        let index = PackageIndex::new();
+        index.replace_all(vec![
+            ("Package/p1".to_string(), package_yaml("p1", &["m1", "m2"])),
+            ("Package/p2".to_string(), package_yaml("p2", &["m2"])),
+        ]);
+        assert_eq!(
+            index.packages_for_model("m2"),
+            Some(vec!["p1".to_string(), "p2".to_string()])
+        );
+        assert_eq!(
+            index.models_for_package("p1"),
+            Some(vec!["m1".to_string(), "m2".to_string()])
+        );
+
+        // Re-applying p1 without m2 drops the old relation
+        index.apply_put("Package/p1", &package_yaml("p1", &["m1"]));
+        assert_eq!(index.packages_for_model("m2"), Some(vec!["p2".to_string()]));
+
+        index.apply_delete("Package/p2");
+        assert_eq!(index.packages_for_model("m2"), Some(vec![]));
+        assert_eq!(index.models_for_package("p2"), Some(vec![]));
+    }
+
+    #[test]
+    fn test_invalid_definition_removes_package() {
+        let index = PackageIndex::new();
+        index.replace_all(vec![(
+            "Package/p1".to_string(),
+            package_yaml("p1", &["m1"]),
+        )]);
+        index.apply_put("Package/p1", "::: not valid yaml :::");
+        assert_eq!(index.packages_for_model("m1"), Some(vec![]));
+    }
+}
@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Sharded Resource State Table
+//!
+//! Holds the current [`ResourceState`] of every resource managed by the
+//! [`StateMachine`](crate::state_machine::StateMachine). Keys are spread over a
+//! fixed number of shards so that transitions of resources in different shards
+//! run in parallel instead of queueing behind one lock.
+//!
+//! # Concurrency Model
+//! - **Writers** lock one resource's shard with [`ResourceTable::lock`] for the
+//!   whole read-evaluate-update sequence of a transition, so two transitions of
+//!   the same resource never interleave.
+//! - **Readers** ([`ResourceTable::get`], [`ResourceTable::filter`]) never take
+//!   the writer lock. Each shard publishes its states as an `Arc`ed map that is
+//!   updated copy-on-write; a reader only clones the `Arc` and works on that
+//!   snapshot, while a running transition keeps going.
+
+use crate::types::ResourceState;
+use std::collections::hash_map::RandomState;
+use std::collections::HashMap;
+use std::hash::BuildHasher;
+use std::sync::{Arc, Mutex, MutexGuard, RwLock};
+
+/// Number of shards; a power of two well above the number of worker threads
+const SHARD_COUNT: usize = 16;
+
+#[derive(Default)]
+struct Shard {
+    /// Serializes transitions of the resources in this shard
+    writer: Mutex<()>,
+    /// Published states of this shard
+    states: RwLock<Arc<HashMap<String, ResourceState>>>,
+}
+
+impl Shard {
+    fn published(&self) -> Arc<HashMap<String, ResourceState>> {
+        Arc::clone(&self.states.read().unwrap_or_else(|e| e.into_inner()))
+    }
+}
+
+/// Concurrent map of resource key → [`ResourceState`]
+pub struct ResourceTable {
+    shards: Vec<Shard>,
+    hasher: RandomState,
+}
+
+/// Exclusive write access to one resource for the duration of a transition
+///
+/// Other resources of the same shard wait until the slot is dropped; readers
+/// never do.
+pub struct ResourceSlot<'a> {
+    key: &'a str,
+    shard: &'a Shard,
+    _writer: MutexGuard<'a, ()>,
+}
+
+impl ResourceTable {
+    pub fn new() -> Self {
+        Self {
+            shards: (0..SHARD_COUNT).map(|_| Shard::default()).collect(),
+            hasher: RandomState::new(),
+        }
+    }
+
+    fn shard(&self, key: &str) -> &Shard {
+        let index = self.hasher.hash_one(key) as usize % self.shards.len();
+        &self.shards[index]
+    }
+
+    /// Lock `key` for a transition
+    pub fn lock<'a>(&'a self, key: &'a str) -> ResourceSlot<'a> {
+        let shard = self.shard(key);
+        ResourceSlot {
+            key,
+            shard,
+            _writer: shard.writer.lock().unwrap_or_else(|e| e.into_inner()),
+        }
+    }
+
+    /// Latest published state of `key`
+    pub fn get(&self, key: &str) -> Option<ResourceState> {
+        self.shard(key).published().get(key).cloned()
+    }
+
+    /// All published states matching `predicate`
+    ///
+    /// Each shard is read from its own snapshot, so the result may mix
+    /// states from before and after a concurrent transition in another shard.
+    pub fn filter(&self, predicate: impl Fn(&ResourceState) -> bool) -> Vec<ResourceState> {
+        self.shards
+            .iter()
+            .flat_map(|shard| {
+                shard
+                    .published()
+                    .values()
+                    .filter(|state| predicate(state))
+                    .cloned()
+                    .collect::<Vec<_>>()
+            })
+            .collect()
+    }
+
+    pub fn len(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|shard| shard.published().len())
+            .sum()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Default for ResourceTable {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ResourceSlot<'_> {
+    /// Inspect the current state without copying it
+    pub fn read<R>(&self, f: impl FnOnce(Option<&ResourceState>) -> R) -> R {
+        f(self.shard.published().get(self.key))
+    }
+
+    /// Replace the state of the locked resource
+    pub fn insert(&self, state: ResourceState) {
+        self.publish(|states| {
+            states.insert(self.key.to_string(), state);
+        });
+    }
+
+    /// Modify the state of the locked resource if it exists
+    pub fn modify<R>(&self, f: impl FnOnce(&mut ResourceState) -> R) -> Option<R> {
+        self.publish(|states| states.get_mut(self.key).map(f))
+    }
+
+    /// Modify the state of the locked resource, creating it with `default` first
+    pub fn modify_or_insert_with<R>(
+        &self,
+        default: impl FnOnce() -> ResourceState,
+        f: impl FnOnce(&mut ResourceState) -> R,
+    ) -> R {
+        self.publish(|states| f(states.entry(self.key.to_string()).or_insert_with(default)))
+    }
+
+    fn publish<R>(&self, f: impl FnOnce(&mut HashMap<String, ResourceState>) -> R) -> R {
+        let mut states = self.shard.states.write().unwrap_or_else(|e| e.into_inner());
+        // Copies the shard only while a reader still holds the previous map
+        f(Arc::make_mut(&mut states))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::types::HealthStatus;
+    use common::statemanager::ResourceType;
+    use tokio::time::Instant;
+
+    fn state(name: &str, current_state: i32) -> ResourceState {
+        let now = Instant::now();
+        ResourceState {
+            resource_type: ResourceType::Model,
+            resource_name: name.to_string(),
+            current_state,
+            desired_state: None,
+            last_transition_time: now,
+            transition_count: 0,
+            metadata: HashMap::new(),
+            health_status: HealthStatus {
+                healthy: true,
+                status_message: "Healthy".to_string(),
+                last_check: now,
+                consecutive_failures: 0,
+            },
+        }
+    }
+
+    #[test]
+    fn test_slot_updates_are_published() {
+        let table = ResourceTable::new();
+        {
+            let slot = table.lock("Model::a");
+            assert!(slot.read(|s| s.is_none()));
+            assert!(slot.modify(|s| s.current_state = 2).is_none());
+            slot.insert(state("a", 1));
+            slot.modify(|s| s.current_state = 2);
+        }
+        assert_eq!(table.get("Model::a").unwrap().current_state, 2);
+
+        let count = table.lock("Model::b").modify_or_insert_with(
+            || state("b", 1),
+            |s| {
+                s.transition_count += 1;
+                s.transition_count
+            },
+        );
+        assert_eq!(count, 1);
+        assert_eq!(table.len(), 2);
+        assert_eq!(table.filter(|s| s.current_state == 1).len(), 1);
+    }
+
+    #[test]
+    fn test_snapshot_is_not_changed_by_later_writes() {
+        let table = ResourceTable::new();
+        table.lock("Model::a").insert(state("a", 1));
+
+        let shard = table.shard("Model::a");
+        let snapshot = shard.published();
+        table.lock("Model::a").modify(|s| s.current_state = 3);
+
+        assert_eq!(snapshot["Model::a"].current_state, 1);
+        assert_eq!(table.get("Model::a").unwrap().current_state, 3);
+    }
+
+    #[test]
+    fn test_readers_do_not_wait_for_a_locked_slot() {
+        let table = Arc::new(ResourceTable::new());
+        table.lock("Model::a").insert(state("a", 1));
+
+        let slot = table.lock("Model::a");
+        let reader = {
+            let table = Arc::clone(&table);
+            std::thread::spawn(move || table.get("Model::a").map(|s| s.current_state))
+        };
+        assert_eq!(reader.join().unwrap(), Some(1));
+        drop(slot);
+    }
+
+    #[test]
+    fn test_parallel_transitions_of_different_resources() {
+        let table = Arc::new(ResourceTable::new());
+        let workers: Vec<_> = (0..8)
+            .map(|worker| {
+                let table = Arc::clone(&table);
+                std::thread::spawn(move || {
+                    let key = format!("Model::m{worker}");
+                    for _ in 0..100 {
+                        table
+                            .lock(&key)
+                            .modify_or_insert_with(|| state(&key, 1), |s| s.transition_count += 1);
+                    }
+                })
+            })
+            .collect();
+        for worker in workers {
+            worker.join().unwrap();
+        }
+
+        assert_eq!(table.len(), 8);
+        assert!(table
+            .filter(|_| true)
+            .iter()
+            .all(|s| s.transition_count == 100));
+    }
+}
@@ -21,11 +21,14 @@
 //! # Usage Example
 //!
 //! ```rust
-//! let mut state_machine = StateMachine::new();
+//! let state_machine = StateMachine::new();
 //! let state_change = StateChange { /* ... */ };
 //! let result = state_machine.process_state_change(state_change);
 //! ```
 
+use crate::package_index::PackageIndex;
+use crate::resource_table::{ResourceSlot, ResourceTable};
+use crate::state_writer::StateWriter;
 use crate::types::{
     ActionCommand, ContainerState, HealthStatus, ResourceState, StateTransition, TransitionResult,
 };
@@ -35,6 +38,7 @@ use common::statemanager::{
     ErrorCode, ModelState, PackageState, ResourceType, ScenarioState, StateChange,
 };
 use std::collections::HashMap;
+use std::sync::{Arc, RwLock};
 use tokio::sync::mpsc;
 use tokio::time::Instant;
 
@@ -84,8 +88,10 @@ impl TransitionResult {
 /// - **Extensible**: New resource types can be added with their own transition tables
 ///
 /// # Thread Safety
-/// This implementation is not thread-safe. External synchronization is required
-/// for concurrent access across multiple threads.
+/// All methods take `&self`, so one instance can be shared through an `Arc`.
+/// Transitions lock only the shard of the resource they change in
+/// [`ResourceTable`]; transitions of other resources and read-only queries
+/// proceed in parallel.
 pub struct StateMachine {
     /// State transition tables indexed by resource type
     ///
@@ -97,10 +103,18 @@ pub struct StateMachine {
     ///
     /// Resources are keyed by a unique identifier (typically resource name)
     /// and contain complete state information including metadata and health status.
-    resource_states: HashMap<String, ResourceState>,
+    resource_states: ResourceTable,
+
+    /// Model ↔ package relations, kept current by
+    /// [`watch_packages`](crate::package_index::watch_packages)
+    package_index: Arc<PackageIndex>,
+
+    /// Write-behind buffer of the state keys persisted to ETCD; consulted
+    /// before ETCD so lookups see this instance's latest writes
+    state_writer: Arc<StateWriter>,
 
     /// Action command sender for async execution
-    action_sender: Option<mpsc::UnboundedSender<ActionCommand>>,
+    action_sender: RwLock<Option<mpsc::UnboundedSender<ActionCommand>>>,
 }
 
 impl StateMachine {
@@ -119,8 +133,10 @@ impl StateMachine {
     pub fn new() -> Self {
         let mut state_machine = StateMachine {
             transition_tables: HashMap::new(),
-            resource_states: HashMap::new(),
-            action_sender: None,
+            resource_states: ResourceTable::new(),
+            package_index: Arc::new(PackageIndex::new()),
+            state_writer: Arc::new(StateWriter::default()),
+            action_sender: RwLock::new(None),
         };
 
         // Initialize transition tables for each resource type
@@ -129,10 +145,23 @@ impl StateMachine {
         state_machine
     }
 
+    /// Index to keep current with [`watch_packages`](crate::package_index::watch_packages)
+    pub fn package_index(&self) -> Arc<PackageIndex> {
+        Arc::clone(&self.package_index)
+    }
+
+    /// Write-behind stage for state keys, flushed by [`StateWriter::run`]
+    pub fn state_writer(&self) -> Arc<StateWriter> {
+        Arc::clone(&self.state_writer)
+    }
+
     /// Initialize async action executor
-    pub fn initialize_action_executor(&mut self) -> mpsc::UnboundedReceiver<ActionCommand> {
+    pub fn initialize_action_executor(&self) -> mpsc::UnboundedReceiver<ActionCommand> {
         let (sender, receiver) = mpsc::unbounded_channel();
-        self.action_sender = Some(sender);
+        *self
+            .action_sender
+            .write()
+            .unwrap_or_else(|e| e.into_inner()) = Some(sender);
         receiver
     }
 
@@ -200,7 +229,7 @@ impl StateMachine {
     // CORE STATE PROCESSING
     // ========================================
     /// Process a state change request with non-blocking action execution
-    pub fn process_state_change(&mut self, state_change: StateChange) -> TransitionResult {
+    pub fn process_state_change(&self, state_change: StateChange) -> TransitionResult {
         // Validate input parameters
         if let Err(validation_error) = self.validate_state_change(&state_change) {
             return TransitionResult {
@@ -239,14 +268,19 @@ impl StateMachine {
 
         let resource_key = self.generate_resource_key(resource_type, &state_change.resource_name);
 
+        // Hold the resource until the transition is recorded; other resources
+        // are not blocked
+        let slot = self.resource_states.lock(&resource_key);
+
         // Get current state - use provided current_state for new resources
-        let current_state = match self.resource_states.get(&resource_key) {
-            Some(existing_state) => existing_state.current_state,
-            None => Self::state_str_to_enum(
-                state_change.current_state.as_str(),
-                state_change.resource_type,
-            ),
-        };
+        let current_state = slot
+            .read(|existing_state| existing_state.map(|rs| rs.current_state))
+            .unwrap_or_else(|| {
+                Self::state_str_to_enum(
+                    state_change.current_state.as_str(),
+                    state_change.resource_type,
+                )
+            });
 
         // Special state-specific handling removed - using simplified state model
 
@@ -284,15 +318,11 @@ impl StateMachine {
             }
 
             // Execute transition - this is immediate and non-blocking
-            self.update_resource_state(
-                &resource_key,
-                &state_change,
-                transition.to_state,
-                resource_type,
-            );
+            self.update_resource_state(&slot, &state_change, transition.to_state, resource_type);
 
             // **NON-BLOCKING ACTION EXECUTION** - Queue action for async execution
-            if let Some(ref sender) = self.action_sender {
+            let action_sender = self.action_sender.read().unwrap_or_else(|e| e.into_inner());
+            if let Some(ref sender) = *action_sender {
                 let action_command = ActionCommand {
                     action: transition.action.clone(),
                     resource_key: resource_key.clone(),
@@ -330,7 +360,7 @@ impl StateMachine {
                 error_details: String::new(),
             };
 
-            self.update_health_status(&resource_key, &transition_result);
+            self.update_health_status(&slot, &transition_result);
 
             // State-specific logic removed for simplified state model
 
@@ -405,7 +435,7 @@ impl StateMachine {
                 ),
             };
 
-            self.update_health_status(&resource_key, &transition_result);
+            self.update_health_status(&slot, &transition_result);
             transition_result
         }
     }
@@ -423,7 +453,7 @@ impl StateMachine {
     /// - `TransitionResult`: Results of the state evaluation and transition attempt
     ///   - Contains whether state changed, the new state, and transition details
     pub fn process_model_state_update(
-        &mut self,
+        &self,
         model_name: &str,
         containers: &[&common::monitoringserver::ContainerInfo],
     ) -> TransitionResult {
@@ -436,14 +466,15 @@ impl StateMachine {
         // Evaluate the new model state based on container states
         let new_model_state = self.evaluate_model_state_from_containers(containers);
 
+        let slot = self.resource_states.lock(&resource_key);
+        let existing_state = slot.read(|rs| rs.map(|rs| rs.current_state));
+
         // Create a pseudo state change for internal processing
         let state_change = StateChange {
             resource_type: ResourceType::Model as i32,
             resource_name: model_name.to_string(),
-            current_state: self
-                .resource_states
-                .get(&resource_key)
-                .map(|rs| self.state_enum_to_str(rs.current_state, ResourceType::Model))
+            current_state: existing_state
+                .map(|state| self.state_enum_to_str(state, ResourceType::Model))
                 .unwrap_or_else(|| "Created".to_string()),
             target_state: self.model_state_to_str(new_model_state),
             transition_id: format!("model_update_{}_{}", model_name, timestamp_ns),
@@ -452,11 +483,7 @@ impl StateMachine {
         };
 
         // Get current state from existing resource or default to Created
-        let current_state = self
-            .resource_states
-            .get(&resource_key)
-            .map(|rs| rs.current_state)
-            .unwrap_or(ModelState::Created as i32);
+        let current_state = existing_state.unwrap_or(ModelState::Created as i32);
 
         let target_state = new_model_state as i32;
 
@@ -473,12 +500,7 @@ impl StateMachine {
         }
 
         // Update internal state tracking
-        self.update_resource_state(
-            &resource_key,
-            &state_change,
-            target_state,
-            ResourceType::Model,
-        );
+        self.update_resource_state(&slot, &state_change, target_state, ResourceType::Model);
 
         // Return successful transition result indicating state changed
         TransitionResult {
@@ -611,8 +633,8 @@ impl StateMachine {
 
     /// Retrieves all model states for models that belong to a given package
     ///
-    /// This function queries ETCD to get all model states and filters them
-    /// to find models that belong to the specified package.
+    /// This function reads the package definition from ETCD and then fetches
+    /// the states of all its models with one multi-get.
     pub async fn get_models_for_package(
         package_name: &str,
     ) -> std::result::Result<Vec<(String, common::statemanager::ModelState)>, String> {
@@ -635,33 +657,130 @@ impl StateMachine {
             }
         };
 
-        let mut model_states = Vec::new();
-
-        // Get state for each model in the package
-        for model_info in package.get_models() {
-            let model_name = model_info.get_name();
-            let model_state_key = format!("/model/{}/state", model_name);
-
-            match common::etcd::get(&model_state_key).await {
-                Ok(state_str) => {
-                    let model_state = match state_str.as_str() {
-                        "Created" => common::statemanager::ModelState::Created,
-                        "Paused" => common::statemanager::ModelState::Paused,
-                        "Exited" => common::statemanager::ModelState::Exited,
-                        "Dead" => common::statemanager::ModelState::Dead,
-                        "Running" => common::statemanager::ModelState::Running,
-                        _ => common::statemanager::ModelState::Running, // Default to Running
-                    };
-                    model_states.push((model_name, model_state));
+        let model_names: Vec<String> = package
+            .get_models()
+            .iter()
+            .map(|model_info| model_info.get_name())
+            .collect();
+        let model_state_keys: Vec<String> = model_names
+            .iter()
+            .map(|model_name| format!("/model/{}/state", model_name))
+            .collect();
+
+        // Fetch every model state of the package in a single round-trip
+        let states = match common::etcd::multi_get(&model_state_keys).await {
+            Ok(states) => states,
+            Err(e) => {
+                logd!(4, "    Failed to get model states: {:?}", e);
+                vec![None; model_state_keys.len()]
+            }
+        };
+
+        let model_states = model_names
+            .into_iter()
+            .zip(states)
+            .map(|(model_name, state)| (model_name, Self::model_state_from_etcd(state.as_deref())))
+            .collect();
+
+        Ok(model_states)
+    }
+
+    /// Map a `/model/{name}/state` value to its ModelState
+    fn model_state_from_etcd(state: Option<&str>) -> common::statemanager::ModelState {
+        match state {
+            Some("Created") => common::statemanager::ModelState::Created,
+            Some("Paused") => common::statemanager::ModelState::Paused,
+            Some("Exited") => common::statemanager::ModelState::Exited,
+            Some("Dead") => common::statemanager::ModelState::Dead,
+            Some("Running") => common::statemanager::ModelState::Running,
+            Some(_) => common::statemanager::ModelState::Running, // Default to Running
+            // If model state not found, assume it's in Created state
+            None => common::statemanager::ModelState::Created,
+        }
+    }
+
+    /// Model states of a package, answered from memory where possible
+    ///
+    /// With a synced package index the package's models come from the index
+    /// and their states from the resource table; only models this instance
+    /// has not evaluated yet (e.g. right after a restart) are read from ETCD.
+    /// Without a synced index this is [`get_models_for_package`](Self::get_models_for_package).
+    async fn model_states_for_package(
+        &self,
+        package_name: &str,
+    ) -> std::result::Result<Vec<(String, common::statemanager::ModelState)>, String> {
+        let Some(model_names) = self.package_index.models_for_package(package_name) else {
+            // Buffered writes are newer than what ETCD returned
+            let mut model_states = Self::get_models_for_package(package_name).await?;
+            for (model_name, state) in &mut model_states {
+                if let Some(value) = self
+                    .state_writer
+                    .get(&format!("/model/{}/state", model_name))
+                {
+                    *state = Self::model_state_from_etcd(Some(&value));
                 }
-                Err(_) => {
-                    // If model state not found, assume it's in Created state
-                    model_states.push((model_name, common::statemanager::ModelState::Created));
+            }
+            return Ok(model_states);
+        };
+
+        let known: Vec<Option<common::statemanager::ModelState>> = model_names
+            .iter()
+            .map(|model_name| {
+                let key = self.generate_resource_key(ResourceType::Model, model_name);
+                self.resource_states
+                    .get(&key)
+                    .and_then(|rs| {
+                        common::statemanager::ModelState::try_from(rs.current_state).ok()
+                    })
+                    .or_else(|| {
+                        self.state_writer
+                            .get(&format!("/model/{}/state", model_name))
+                            .map(|value| Self::model_state_from_etcd(Some(&value)))
+                    })
+            })
+            .collect();
+
+        let missing_keys: Vec<String> = model_names
+            .iter()
+            .zip(&known)
+            .filter(|(_, state)| state.is_none())
+            .map(|(model_name, _)| format!("/model/{}/state", model_name))
+            .collect();
+        let mut fetched = if missing_keys.is_empty() {
+            Vec::new()
+        } else {
+            match common::etcd::multi_get(&missing_keys).await {
+                Ok(states) => states,
+                Err(e) => {
+                    logd!(4, "    Failed to get model states: {:?}", e);
+                    vec![None; missing_keys.len()]
                 }
             }
         }
+        .into_iter();
+
+        Ok(model_names
+            .into_iter()
+            .zip(known)
+            .map(|(model_name, state)| {
+                let state = state.unwrap_or_else(|| {
+                    Self::model_state_from_etcd(fetched.next().flatten().as_deref())
+                });
+                (model_name, state)
+            })
+            .collect())
+    }
 
-        Ok(model_states)
+    /// Find all packages that contain the given model, from the package index
+    /// when it is synced and from ETCD otherwise
+    pub async fn packages_containing_model(
+        &self,
+        model_name: &str,
+    ) -> std::result::Result<Vec<String>, String> {
+        match self.package_index.packages_for_model(model_name) {
+            Some(packages) => Ok(packages),
+            None => Self::find_packages_containing_model(model_name).await,
+        }
     }
 
     /// Find all packages that contain the given model
@@ -705,27 +824,36 @@ impl StateMachine {
     ) -> Option<common::statemanager::PackageState> {
         let key = format!("/package/{}/state", package_name);
         match common::etcd::get(&key).await {
-            Ok(state_str) => match state_str.as_str() {
-                "PACKAGE_STATE_IDLE" | "idle" => Some(common::statemanager::PackageState::Idle),
-                "PACKAGE_STATE_PAUSED" | "paused" => {
-                    Some(common::statemanager::PackageState::Paused)
-                }
-                "PACKAGE_STATE_EXITED" | "exited" => {
-                    Some(common::statemanager::PackageState::Exited)
-                }
-                "PACKAGE_STATE_DEGRADED" | "degraded" => {
-                    Some(common::statemanager::PackageState::Degraded)
-                }
-                "PACKAGE_STATE_ERROR" | "error" => Some(common::statemanager::PackageState::Error),
-                "PACKAGE_STATE_RUNNING" | "running" => {
-                    Some(common::statemanager::PackageState::Running)
-                }
-                _ => Some(common::statemanager::PackageState::Idle),
-            },
+            Ok(state_str) => Some(Self::package_state_from_str(&state_str)),
             Err(_) => None,
         }
     }
 
+    /// Current package state, preferring this instance's buffered write over ETCD
+    async fn current_package_state(
+        &self,
+        package_name: &str,
+    ) -> Option<common::statemanager::PackageState> {
+        let key = format!("/package/{}/state", package_name);
+        match self.state_writer.get(&key) {
+            Some(state_str) => Some(Self::package_state_from_str(&state_str)),
+            None => Self::get_current_package_state(package_name).await,
+        }
+    }
+
+    /// Map a `/package/{name}/state` value to its PackageState
+    fn package_state_from_str(state_str: &str) -> common::statemanager::PackageState {
+        match state_str {
+            "PACKAGE_STATE_IDLE" | "idle" => common::statemanager::PackageState::Idle,
+            "PACKAGE_STATE_PAUSED" | "paused" => common::statemanager::PackageState::Paused,
+            "PACKAGE_STATE_EXITED" | "exited" => common::statemanager::PackageState::Exited,
+            "PACKAGE_STATE_DEGRADED" | "degraded" => common::statemanager::PackageState::Degraded,
+            "PACKAGE_STATE_ERROR" | "error" => common::statemanager::PackageState::Error,
+            "PACKAGE_STATE_RUNNING" | "running" => common::statemanager::PackageState::Running,
+            _ => common::statemanager::PackageState::Idle,
+        }
+    }
+
     /// Evaluate and update package state based on current model states
     pub async fn evaluate_and_update_package_state(
         &self,
@@ -734,7 +862,7 @@ impl StateMachine {
         logd!(2, "    Evaluating package state for: {}", package_name);
 
         // Get model states for this package
-        let model_states = Self::get_models_for_package(package_name).await?;
+        let model_states = self.model_states_for_package(package_name).await?;
 
         if model_states.is_empty() {
             logd!(4, "      No models found for package {}", package_name);
@@ -758,7 +886,8 @@ impl StateMachine {
             .collect();
 
         // Get current package state
-        let current_package_state = Self::get_current_package_state(package_name)
+        let current_package_state = self
+            .current_package_state(package_name)
             .await
             .unwrap_or(common::statemanager::PackageState::Idle);
 
@@ -962,8 +1091,8 @@ impl StateMachine {
     }
 
     /// Updates health status based on transition result
-    fn update_health_status(&mut self, resource_key: &str, transition_result: &TransitionResult) {
-        if let Some(resource_state) = self.resource_states.get_mut(resource_key) {
+    fn update_health_status(&self, slot: &ResourceSlot<'_>, transition_result: &TransitionResult) {
+        slot.modify(|resource_state| {
             let now = Instant::now();
             resource_state.health_status.last_check = now;
 
@@ -980,7 +1109,7 @@ impl StateMachine {
                     resource_state.health_status.healthy = false;
                 }
             }
-        }
+        });
     }
 
     /// Infer the appropriate event type from state transition
@@ -1206,8 +1335,8 @@ impl StateMachine {
     /// - Clears any active backoff timers on successful transition
     /// - Updates health status if applicable
     fn update_resource_state(
-        &mut self,
-        resource_key: &str,
+        &self,
+        slot: &ResourceSlot<'_>,
         state_change: &StateChange,
 
         new_state: i32,
@@ -1215,41 +1344,40 @@ impl StateMachine {
     ) {
         let now = Instant::now();
 
-        let resource_state = self
-            .resource_states
-            .entry(resource_key.to_string())
-            .or_insert_with(|| ResourceState {
-                resource_type,
-                resource_name: state_change.resource_name.clone(),
-                current_state: Self::state_str_to_enum(
-                    state_change.current_state.as_str(),
-                    state_change.resource_type,
-                ),
-                desired_state: Some(Self::state_str_to_enum(
-                    state_change.target_state.as_str(),
-                    state_change.resource_type,
-                )),
-                last_transition_time: now,
-                transition_count: 0,
-                metadata: HashMap::new(),
-                health_status: HealthStatus {
-                    healthy: true,
-                    status_message: "Healthy".to_string(),
-                    last_check: now,
-                    consecutive_failures: 0,
-                },
-            });
+        let default_state = || ResourceState {
+            resource_type,
+            resource_name: state_change.resource_name.clone(),
+            current_state: Self::state_str_to_enum(
+                state_change.current_state.as_str(),
+                state_change.resource_type,
+            ),
+            desired_state: Some(Self::state_str_to_enum(
+                state_change.target_state.as_str(),
+                state_change.resource_type,
+            )),
+            last_transition_time: now,
+            transition_count: 0,
+            metadata: HashMap::new(),
+            health_status: HealthStatus {
+                healthy: true,
+                status_message: "Healthy".to_string(),
+                last_check: now,
+                consecutive_failures: 0,
+            },
+        };
 
-        resource_state.current_state = new_state;
-        resource_state.last_transition_time = now;
-        resource_state.transition_count += 1;
-        resource_state.metadata.insert(
-            "last_transition_id".to_string(),
-            state_change.transition_id.clone(),
-        );
-        resource_state
-            .metadata
-            .insert("source".to_string(), state_change.source.clone());
+        slot.modify_or_insert_with(default_state, |resource_state| {
+            resource_state.current_state = new_state;
+            resource_state.last_transition_time = now;
+            resource_state.transition_count += 1;
+            resource_state.metadata.insert(
+                "last_transition_id".to_string(),
+                state_change.transition_id.clone(),
+            );
+            resource_state
+                .metadata
+                .insert("source".to_string(), state_change.source.clone());
+        });
     }
 
     // ========================================
@@ -1258,15 +1386,16 @@ impl StateMachine {
 
     /// Retrieve the current state information for a specific resource
     ///
-    /// Provides read-only access to the complete state information for
-    /// a resource, including metadata and health status.
+    /// Provides a copy of the complete state information for a resource,
+    /// including metadata and health status. Does not wait for transitions
+    /// in progress.
     ///
     /// # Parameters
     /// - `resource_name`: The unique name of the resource
     /// - `resource_type`: The type of the resource (for validation)
     ///
     /// # Returns
-    /// - `Some(&ResourceState)`: If the resource exists and types match
+    /// - `Some(ResourceState)`: If the resource exists and types match
     /// - `None`: If the resource doesn't exist or type mismatch
     ///
     /// # Usage
@@ -1278,7 +1407,7 @@ impl StateMachine {
         &self,
         resource_name: &str,
         resource_type: ResourceType,
-    ) -> Option<&ResourceState> {
+    ) -> Option<ResourceState> {
         let resource_key = self.generate_resource_key(resource_type, resource_name);
         self.resource_states.get(&resource_key)
     }
@@ -1293,11 +1422,11 @@ impl StateMachine {
     /// - `state`: The state to filter by
     ///
     /// # Returns
-    /// A vector of references to all matching resource states
+    /// Copies of all matching resource states
     ///
     /// # Performance Note
-    /// This method performs a linear scan of all resources. For large numbers
-    /// of resources, consider implementing indexed lookups by state.
+    /// This method performs a linear scan of the published snapshots and does
+    /// not wait for transitions in progress.
     ///
     /// # Usage Examples
     /// - Find all failed resources: `list_resources_by_state(None, "Failed")`
@@ -1307,14 +1436,11 @@ impl StateMachine {
         resource_type: Option<ResourceType>,
 
         state: i32,
-    ) -> Vec<&ResourceState> {
-        self.resource_states
-            .values()
-            .filter(|resource| {
-                resource.current_state == state
-                    && (resource_type.is_none() || resource_type == Some(resource.resource_type))
-            })
-            .collect()
+    ) -> Vec<ResourceState> {
+        self.resource_states.filter(|resource| {
+            resource.current_state == state
+                && (resource_type.is_none() || resource_type == Some(resource.resource_type))
+        })
     }
 
     // Utility: Convert state string to proto enum value
@@ -1540,7 +1666,7 @@ mod tests {
     fn test_process_state_change_queues_action_and_updates_state() {
         use common::statemanager::ResourceType;
 
-        let mut state_machine = StateMachine::new();
+        let state_machine = StateMachine::new();
 
         // Initialize action executor so actions are queued to receiver
         let mut action_receiver = state_machine.initialize_action_executor();
@@ -1575,7 +1701,7 @@ mod tests {
     fn test_process_state_change_invalid_transition_returns_error() {
         use common::statemanager::{ErrorCode, ResourceType};
 
-        let mut state_machine = StateMachine::new();
+        let state_machine = StateMachine::new();
 
         // Build a StateChange with an unknown target state -> should produce InvalidStateTransition
         let state_change = StateChange {
@@ -1596,7 +1722,7 @@ mod tests {
     fn test_update_health_status_marks_unhealthy_after_retries() {
         use common::statemanager::ResourceType;
 
-        let mut state_machine = StateMachine::new();
+        let state_machine = StateMachine::new();
 
         // Prepare a resource state with 2 consecutive failures already
         let resource_key =
@@ -1618,9 +1744,8 @@ mod tests {
             },
         };
 
-        state_machine
-            .resource_states
-            .insert(resource_key.clone(), rs);
+        let slot = state_machine.resource_states.lock(&resource_key);
+        slot.insert(rs);
 
         // Create a failing TransitionResult
         let fail_result = TransitionResult {
@@ -1633,7 +1758,8 @@ mod tests {
         };
 
         // Call update_health_status (private) — accessible inside this test module
-        state_machine.update_health_status(&resource_key, &fail_result);
+        state_machine.update_health_status(&slot, &fail_result);
+        drop(slot);
 
         let updated = state_machine.resource_states.get(&resource_key).unwrap();
         assert_eq!(updated.health_status.consecutive_failures, 3);
@@ -1751,7 +1877,7 @@ mod tests {
         use common::statemanager::ResourceType;
         use std::collections::HashMap;
 
-        let mut state_machine = StateMachine::new();
+        let state_machine = StateMachine::new();
 
         let mut s = HashMap::new();
         s.insert("Status".to_string(), "running".to_string());
@@ -1801,7 +1927,7 @@ mod tests {
     fn test_get_resource_state_and_list_resources_by_state() {
         use common::statemanager::{ResourceType, ScenarioState};
 
-        let mut state_machine = StateMachine::new();
+        let state_machine = StateMachine::new();
 
         // Create a scenario via process_state_change (Idle -> Waiting)
         let state_change = StateChange {
@@ -2104,4 +2230,115 @@ mod tests {
         assert!(!changed);
         assert_eq!(state, common::statemanager::PackageState::Idle);
     }
+
+    #[tokio::test]
+    async fn test_model_states_for_package_from_index_and_memory() {
+        use common::monitoringserver::ContainerInfo;
+
+        let sm = StateMachine::new();
+        let pkg_yaml = r#"{"apiVersion":"v1","kind":"Package","metadata":{"name":"pkg-mem"},"spec":{"pattern":[],"models":[{"name":"mem1","node":"n","resources":{"volume":"","network":"","realtime":false}},{"name":"mem2","node":"n","resources":{"volume":"","network":"","realtime":false}}]}}"#;
+        sm.package_index()
+            .replace_all(vec![("Package/pkg-mem".to_string(), pkg_yaml.to_string())]);
+
+        let container = |status: &str| {
+            let mut state = HashMap::new();
+            state.insert("Status".to_string(), status.to_string());
+            ContainerInfo {
+                id: status.to_string(),
+                names: vec![],
+                image: "img".to_string(),
+                state,
+                config: HashMap::new(),
+                annotation: HashMap::new(),
+                stats: HashMap::new(),
+            }
+        };
+        sm.process_model_state_update("mem1", &[&container("dead")]);
+        sm.process_model_state_update("mem2", &[&container("running")]);
+
+        assert_eq!(
+            sm.packages_containing_model("mem1").await.unwrap(),
+            vec!["pkg-mem".to_string()]
+        );
+        let states = sm.model_states_for_package("pkg-mem").await.unwrap();
+        assert_eq!(
+            states,
+            vec![
+                ("mem1".to_string(), ModelState::Dead),
+                ("mem2".to_string(), ModelState::Running),
+            ]
+        );
+    }
+
+    /// Cost of `process_state_change` along the scenario lifecycle and of
+    /// container driven model updates, with many resources tracked. Run with
+    /// `cargo test --release -p statemanager bench_ -- --ignored --nocapture`
+    #[test]
+    #[ignore]
+    fn bench_state_machine_transitions() {
+        use common::monitoringserver::ContainerInfo;
+        use common::statemanager::ResourceType;
+        use common::trace::LatencySummary;
+
+        const SCENARIOS: usize = 20_000;
+        const MODELS: usize = 1_000;
+        const LIFECYCLE: [&str; 5] = ["Idle", "Waiting", "Satisfied", "Allowed", "Completed"];
+
+        let sm = StateMachine::new();
+        let mut samples = Vec::with_capacity(SCENARIOS * (LIFECYCLE.len() - 1));
+        for i in 0..SCENARIOS {
+            let name = format!("bench-scenario-{i}");
+            for pair in LIFECYCLE.windows(2) {
+                let state_change = StateChange {
+                    resource_type: ResourceType::Scenario as i32,
+                    resource_name: name.clone(),
+                    current_state: pair[0].to_string(),
+                    target_state: pair[1].to_string(),
+                    transition_id: format!("bench-{i}-{}", pair[1]),
+                    timestamp_ns: i as i64,
+                    source: "bench".to_string(),
+                };
+                let start = std::time::Instant::now();
+                let result = sm.process_state_change(state_change);
+                samples.push(start.elapsed());
+                assert!(result.is_success(), "{}", result.message);
+            }
+        }
+        println!(
+            "scenario transition  {}",
+            LatencySummary::from_samples(samples).unwrap()
+        );
+
+        let container = |status: &str| {
+            let mut state = HashMap::new();
+            state.insert("Status".to_string(), status.to_string());
+            ContainerInfo {
+                id: status.to_string(),
+                names: vec![],
+                image: "img".to_string(),
+                state,
+                config: HashMap::new(),
+                annotation: HashMap::new(),
+                stats: HashMap::new(),
+            }
+        };
+        let (running, exited) = (container("running"), container("exited"));
+        let mut samples = Vec::with_capacity(SCENARIOS);
+        for i in 0..SCENARIOS {
+            // Each round over the models flips their state, so every update
+            // is a real transition
+            let status = if (i / MODELS) % 2 == 0 {
+                &running
+            } else {
+                &exited
+            };
+            let start = std::time::Instant::now();
+            sm.process_model_state_update(&format!("bench-model-{}", i % MODELS), &[status]);
+            samples.push(start.elapsed());
+        }
+        println!(
+            "model update         {}",
+            LatencySummary::from_samples(samples).unwrap()
+        );
+    }
 }
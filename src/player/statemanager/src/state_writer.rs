@@ -0,0 +1,322 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Write-behind Stage for Resource State Keys
+//!
+//! StateManager persists model, package and scenario states under keys such
+//! as `/model/{name}/state`. A container flap across a large package changes
+//! many of them in quick succession, often the same key several times.
+//! [`StateWriter`] buffers these writes for a short window, keeps only the
+//! latest value per key and writes the survivors with one `batch_put`.
+//!
+//! # Read-your-writes
+//! Values that are buffered or being written are returned by
+//! [`StateWriter::get`], so StateManager's own lookups see its latest writes
+//! before they reach ETCD.
+
+use common::logd;
+use common::rocksdbservice::is_valid_key;
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use tokio::sync::Notify;
+use tokio::time::{sleep, Duration, Instant};
+
+/// How long updates are collected before they are written
+pub const DEFAULT_FLUSH_WINDOW: Duration = Duration::from_millis(50);
+/// Delay before retrying a failed flush
+const RETRY_DELAY: Duration = Duration::from_millis(500);
+
+#[derive(Default)]
+struct Buffers {
+    /// Latest value per key not yet handed to a flush
+    pending: HashMap<String, String>,
+    /// When the oldest entry of `pending` was submitted
+    pending_since: Option<Instant>,
+    /// Values of the flush in progress
+    in_flight: HashMap<String, String>,
+}
+
+/// Point-in-time copy of the write-behind counters
+#[derive(Debug, Clone, PartialEq)]
+pub struct WriteStats {
+    /// Updates accepted by [`StateWriter::submit`]
+    pub submitted: u64,
+    /// Key/value pairs written to ETCD
+    pub written: u64,
+    /// Successful flushes
+    pub flushes: u64,
+    /// Flushes that failed and were retried
+    pub failed_flushes: u64,
+    /// Time from the first buffered update of a flush until it was written
+    pub avg_flush_latency_us: u64,
+    pub max_flush_latency_us: u64,
+}
+
+impl WriteStats {
+    /// Updates submitted per key written; 1.0 means nothing was coalesced
+    pub fn coalescing_ratio(&self) -> f64 {
+        if self.written == 0 {
+            1.0
+        } else {
+            self.submitted as f64 / self.written as f64
+        }
+    }
+}
+
+pub struct StateWriter {
+    window: Duration,
+    buffers: Mutex<Buffers>,
+    /// Signalled when `pending` becomes non-empty
+    wake: Notify,
+    /// Keeps flushes from overlapping
+    flushing: tokio::sync::Mutex<()>,
+    submitted: AtomicU64,
+    written: AtomicU64,
+    flushes: AtomicU64,
+    failed_flushes: AtomicU64,
+    total_flush_latency_us: AtomicU64,
+    max_flush_latency_us: AtomicU64,
+}
+
+impl StateWriter {
+    pub fn new(window: Duration) -> Self {
+        Self {
+            window,
+            buffers: Mutex::new(Buffers::default()),
+            wake: Notify::new(),
+            flushing: tokio::sync::Mutex::new(()),
+            submitted: AtomicU64::new(0),
+            written: AtomicU64::new(0),
+            flushes: AtomicU64::new(0),
+            failed_flushes: AtomicU64::new(0),
+            total_flush_latency_us: AtomicU64::new(0),
+            max_flush_latency_us: AtomicU64::new(0),
+        }
+    }
+
+    /// Buffer `value` for `key`, replacing any value not yet written
+    ///
+    /// Keys the RocksDB service would reject are refused here so that they
+    /// cannot fail the whole batch they would be written with.
+    pub fn submit(&self, key: String, value: String) -> Result<(), String> {
+        self.submit_all(vec![(key, value)])
+    }
+
+    /// Buffer several updates that are written in the same batch
+    ///
+    /// Nothing is buffered if any key is invalid.
+    pub fn submit_all(&self, items: Vec<(String, String)>) -> Result<(), String> {
+        for (key, _) in &items {
+            check_key(key)?;
+        }
+        if items.is_empty() {
+            return Ok(());
+        }
+        let count = items.len() as u64;
+        let first = {
+            let mut buffers = self.lock();
+            let first = buffers.pending.is_empty();
+            if first {
+                buffers.pending_since = Some(Instant::now());
+            }
+            buffers.pending.extend(items);
+            first
+        };
+        self.submitted.fetch_add(count, Ordering::Relaxed);
+        if first {
+            self.wake.notify_one();
+        }
+        Ok(())
+    }
+
+    /// Latest value written by StateManager that may not be in ETCD yet
+    pub fn get(&self, key: &str) -> Option<String> {
+        let buffers = self.lock();
+        buffers
+            .pending
+            .get(key)
+            .or_else(|| buffers.in_flight.get(key))
+            .cloned()
+    }
+
+    /// Write everything buffered so far
+    ///
+    /// On failure the values go back to the buffer unless a newer value for
+    /// the same key was submitted meanwhile.
+    pub async fn flush(&self) -> Result<(), String> {
+        let _flushing = self.flushing.lock().await;
+
+        let (items, since) = {
+            let mut buffers = self.lock();
+            if buffers.pending.is_empty() {
+                return Ok(());
+            }
+            buffers.in_flight = std::mem::take(&mut buffers.pending);
+            let since = buffers.pending_since.take().unwrap_or_else(Instant::now);
+            let items: Vec<(String, String)> = buffers
+                .in_flight
+                .iter()
+                .map(|(key, value)| (key.clone(), value.clone()))
+                .collect();
+            (items, since)
+        };
+        let count = items.len() as u64;
+
+        let result = common::etcd::batch_put(items).await;
+
+        let mut buffers = self.lock();
+        let in_flight = std::mem::take(&mut buffers.in_flight);
+        match result {
+            Ok(()) => {
+                drop(buffers);
+                let us = since.elapsed().as_micros() as u64;
+                self.written.fetch_add(count, Ordering::Relaxed);
+                self.flushes.fetch_add(1, Ordering::Relaxed);
+                self.total_flush_latency_us.fetch_add(us, Ordering::Relaxed);
+                self.max_flush_latency_us.fetch_max(us, Ordering::Relaxed);
+                logd!(1, "[StateWriter] Flushed {} state keys in {}us", count, us);
+                Ok(())
+            }
+            Err(e) => {
+                for (key, value) in in_flight {
+                    buffers.pending.entry(key).or_insert(value);
+                }
+                buffers.pending_since = Some(since);
+                drop(buffers);
+                self.failed_flushes.fetch_add(1, Ordering::Relaxed);
+                logd!(
+                    4,
+                    "[StateWriter] Failed to flush {} state keys: {}",
+                    count,
+                    e
+                );
+                Err(e)
+            }
+        }
+    }
+
+    /// Flush buffered updates for the lifetime of StateManager
+    ///
+    /// A flush starts one window after the first update of a batch, so all
+    /// updates of a burst end up in the same batch.
+    pub async fn run(self: Arc<Self>) {
+        loop {
+            self.wake.notified().await;
+            sleep(self.window).await;
+            while self.flush().await.is_err() {
+                sleep(RETRY_DELAY).await;
+            }
+        }
+    }
+
+    pub fn stats(&self) -> WriteStats {
+        let flushes = self.flushes.load(Ordering::Relaxed);
+        let total = self.total_flush_latency_us.load(Ordering::Relaxed);
+        WriteStats {
+            submitted: self.submitted.load(Ordering::Relaxed),
+            written: self.written.load(Ordering::Relaxed),
+            flushes,
+            failed_flushes: self.failed_flushes.load(Ordering::Relaxed),
+            avg_flush_latency_us: if flushes > 0 { total / flushes } else { 0 },
+            max_flush_latency_us: self.max_flush_latency_us.load(Ordering::Relaxed),
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, Buffers> {
+        self.buffers.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+impl Default for StateWriter {
+    fn default() -> Self {
+        Self::new(DEFAULT_FLUSH_WINDOW)
+    }
+}
+
+/// Same rule the RocksDB service applies to keys
+fn check_key(key: &str) -> Result<(), String> {
+    if !is_valid_key(key) {
+        return Err(format!(
+            "Invalid state key ({} bytes): {}",
+            key.len(),
+            key.chars().take(64).collect::<String>()
+        ));
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_submit_coalesces_and_reads_back() {
+        let writer = StateWriter::default();
+        writer
+            .submit("/model/m1/state".to_string(), "Running".to_string())
+            .unwrap();
+        writer
+            .submit("/model/m1/state".to_string(), "Dead".to_string())
+            .unwrap();
+        writer
+            .submit("/model/m2/state".to_string(), "Running".to_string())
+            .unwrap();
+
+        assert_eq!(writer.get("/model/m1/state").as_deref(), Some("Dead"));
+        assert_eq!(writer.get("/model/m3/state"), None);
+        assert_eq!(writer.lock().pending.len(), 2);
+        assert_eq!(writer.stats().submitted, 3);
+    }
+
+    #[test]
+    fn test_submit_rejects_invalid_keys() {
+        let writer = StateWriter::default();
+        assert!(writer
+            .submit("a".repeat(2000), "Running".to_string())
+            .is_err());
+        assert!(writer.submit(String::new(), "Running".to_string()).is_err());
+        assert!(writer.get("").is_none());
+        assert_eq!(writer.stats().submitted, 0);
+    }
+
+    #[test]
+    fn test_coalescing_ratio() {
+        let mut stats = StateWriter::default().stats();
+        assert_eq!(stats.coalescing_ratio(), 1.0);
+        stats.submitted = 30;
+        stats.written = 10;
+        assert_eq!(stats.coalescing_ratio(), 3.0);
+    }
+
+    #[tokio::test]
+    async fn test_flush_writes_latest_values() {
+        let writer = StateWriter::default();
+        writer
+            .submit("/model/flush-m1/state".to_string(), "Running".to_string())
+            .unwrap();
+        writer
+            .submit("/model/flush-m1/state".to_string(), "Exited".to_string())
+            .unwrap();
+
+        match writer.flush().await {
+            Ok(()) => {
+                let stats = writer.stats();
+                assert_eq!((stats.written, stats.flushes), (1, 1));
+                assert!(writer.get("/model/flush-m1/state").is_none());
+                let value = common::etcd::get("/model/flush-m1/state").await.unwrap();
+                assert_eq!(value, "Exited");
+            }
+            // Without a reachable RocksDB service the value stays buffered
+            Err(_) => {
+                assert_eq!(
+                    writer.get("/model/flush-m1/state").as_deref(),
+                    Some("Exited")
+                );
+                assert_eq!(writer.stats().failed_flushes, 1);
+            }
+        }
+    }
+}
@@ -5,8 +5,12 @@
 
 //! Read/Write/Delete artifact data in etcd
 
+use common::etcd::BatchOp;
 use common::logd;
 
+/// Prefix of the keys that keep the content hash of each stored artifact
+const HASH_PREFIX: &str = "ArtifactHash/";
+
 /// Read yaml string of artifacts from etcd
 ///
 /// ### Parameters
@@ -62,6 +66,60 @@ pub async fn delete_at_etcd(key: &str) -> common::Result<()> {
     Ok(())
 }
 
+/// Key that holds the content hash of the artifact stored at `key`
+pub fn hash_key(key: &str) -> String {
+    format!("{}{}", HASH_PREFIX, key)
+}
+
+/// Content hash of a normalized artifact document
+///
+/// 64-bit FNV-1a followed by the length in bytes. It only has to tell
+/// whether a document changed since it was stored, and it is stable across
+/// builds and restarts, unlike the std hasher.
+pub fn content_hash(artifact_str: &str) -> String {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for byte in artifact_str.bytes() {
+        hash ^= byte as u64;
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    format!("{:016x}-{}", hash, artifact_str.len())
+}
+
+/// Read the stored content hashes of `keys` in one round-trip
+///
+/// ### Parameters
+/// * `keys: &[String]` - artifact keys, e.g. `Scenario/helloworld`
+/// ### Return
+/// * `Result<Vec<Option<String>>>` - one entry per key, `None` if never stored
+pub async fn read_hashes(keys: &[String]) -> common::Result<Vec<Option<String>>> {
+    let hash_keys: Vec<String> = keys.iter().map(|key| hash_key(key)).collect();
+    Ok(common::etcd::multi_get(&hash_keys).await?)
+}
+
+/// Apply artifact writes and deletes in one batched store call
+///
+/// ### Parameters
+/// * `ops: Vec<BatchOp>` - puts and deletes, applied atomically
+/// ### Return
+/// * `Result<()>` - `Ok` if success, `Err` otherwise
+pub async fn write_batch_to_etcd(ops: Vec<BatchOp>) -> common::Result<()> {
+    use std::time::Instant;
+    let start = Instant::now();
+    let count = ops.len();
+
+    let result = common::etcd::write_batch(ops).await;
+
+    logd!(
+        1,
+        "write_batch_to_etcd: {} ops, elapsed = {:?}",
+        count,
+        start.elapsed()
+    );
+
+    result?;
+    Ok(())
+}
+
 //UNIT TEST CASES
 
 #[cfg(test)]
@@ -184,6 +242,18 @@ spec:
         );
     }
 
+    // Test that the content hash is stable and sensitive to every byte
+    #[test]
+    fn test_content_hash_stable() {
+        assert_eq!(content_hash(""), "cbf29ce484222325-0");
+        assert_eq!(content_hash(TEST_YAML), content_hash(TEST_YAML));
+        assert_ne!(
+            content_hash(TEST_YAML),
+            content_hash(&TEST_YAML.replace("helloworld-core", "helloworld-corf"))
+        );
+        assert_eq!(hash_key("Scenario/a"), "ArtifactHash/Scenario/a");
+    }
+
     // === Negative Tests ===
 
     // Test reading with invalid keys (empty/nullbyte) — should fail
@@ -4,12 +4,21 @@
  */
 
 //! Convert string-type artifacts to struct and access etcd
+//!
+//! Every stored artifact has a content hash next to it (see
+//! [`data::hash_key`]). Applying a bundle compares each document, and each
+//! generated Pod, against that hash and writes only what changed, in one
+//! batch. Fleet pushes re-send identical bundles, so most applies write
+//! nothing and forward no scenario.
 
 pub mod data;
 
+use common::etcd::BatchOp;
 use common::logd;
 use common::spec::artifact::{Artifact, Model, Network, Node, Package, Scenario, Schedule, Volume};
 use common::spec::k8s::Pod;
+use std::collections::HashMap;
+use std::sync::{Mutex, OnceLock};
 
 // Artifact kind constants
 const KIND_SCENARIO: &str = "Scenario";
@@ -20,9 +29,63 @@ const KIND_NODE: &str = "Node";
 const KIND_MODEL: &str = "Model";
 const KIND_SCHEDULE: &str = "Schedule";
 
+const KIND_POD: &str = "Pod";
+
 // YAML document separator
 const YAML_SEPARATOR: &str = "---";
 
+/// Parsed documents remembered by the hash of their raw text
+const PARSED_CACHE_CAPACITY: usize = 256;
+
+/// Raw document hash -> parsed document, so a re-sent document is not
+/// parsed and normalized again
+static PARSED_CACHE: OnceLock<Mutex<HashMap<String, CachedDocument>>> = OnceLock::new();
+
+/// Entry of [`PARSED_CACHE`]
+struct CachedDocument {
+    /// Raw text the entry was parsed from; compared before reuse because
+    /// the hash alone can collide
+    raw: String,
+    parsed: ParsedDocument,
+}
+
+/// An artifact document ready to be stored
+#[derive(Debug, Clone, PartialEq)]
+struct ParsedDocument {
+    kind: String,
+    name: String,
+    /// Normalized YAML written to etcd
+    artifact_str: String,
+    /// Content hash of `artifact_str`
+    hash: String,
+}
+
+impl ParsedDocument {
+    fn new(kind: &str, name: String, artifact_str: String) -> Self {
+        Self {
+            kind: kind.to_string(),
+            name,
+            hash: data::content_hash(&artifact_str),
+            artifact_str,
+        }
+    }
+
+    fn key(&self) -> String {
+        format!("{}/{}", self.kind, self.name)
+    }
+}
+
+/// Outcome of [`apply`]
+#[derive(Debug, Default)]
+pub struct Applied {
+    /// Scenarios of the bundle whose stored document changed
+    pub changed_scenarios: Vec<String>,
+    /// Documents, including generated Pods, written to etcd
+    pub written: usize,
+    /// Documents skipped because their content hash was unchanged
+    pub unchanged: usize,
+}
+
 /// Parse artifact kind and name from YAML value
 fn parse_artifact_info(value: &serde_yaml::Value) -> Option<(String, String)> {
     let kind = value.get("kind")?.as_str()?;
@@ -96,10 +159,22 @@ async fn notify_scenario_state(scenario_name: &str, target_state: &str) {
     }
 }
 
-/// Process and store a single artifact document
-async fn process_artifact_document(doc: &str) -> common::Result<Option<(String, String)>> {
+/// Parse a single artifact document, reusing the result for a document
+/// that was parsed before
+fn parse_document(doc: &str) -> common::Result<Option<ParsedDocument>> {
     use std::time::Instant;
 
+    let raw_hash = data::content_hash(doc);
+    let cache = PARSED_CACHE.get_or_init(|| Mutex::new(HashMap::new()));
+    if let Some(cached) = cache
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .get(&raw_hash)
+        .filter(|cached| cached.raw == doc)
+    {
+        return Ok(Some(cached.parsed.clone()));
+    }
+
     let parse_start = Instant::now();
     let value: serde_yaml::Value = serde_yaml::from_str(doc)?;
     let artifact_str = serde_yaml::to_string(&value)?;
@@ -116,23 +191,48 @@ async fn process_artifact_document(doc: &str) -> common::Result<Option<(String,
             return Ok(None);
         }
     };
+    let parsed = ParsedDocument::new(&kind, name, artifact_str);
 
-    let key = format!("{}/{}", kind, name);
-
-    let etcd_start = Instant::now();
-    data::write_to_etcd(&key, &artifact_str).await?;
-    logd!(
-        1,
-        "process_artifact: etcd write elapsed for {} = {:?}",
-        key,
-        etcd_start.elapsed()
+    let mut cache = cache.lock().unwrap_or_else(|e| e.into_inner());
+    if cache.len() >= PARSED_CACHE_CAPACITY {
+        cache.clear();
+    }
+    cache.insert(
+        raw_hash,
+        CachedDocument {
+            raw: doc.to_string(),
+            parsed: parsed.clone(),
+        },
     );
+    Ok(Some(parsed))
+}
 
-    if kind == KIND_SCENARIO {
-        notify_scenario_state(&name, "idle").await;
+/// Split `documents` into the batch that stores the changed ones and the
+/// indices of the changed documents
+///
+/// `stored_hashes` holds the stored content hash of each document, in the
+/// same order. A document that appears twice only counts once, last wins.
+fn plan_writes(
+    documents: &[ParsedDocument],
+    stored_hashes: &[Option<String>],
+) -> (Vec<BatchOp>, Vec<usize>) {
+    let mut last: HashMap<String, usize> = HashMap::new();
+    for (i, doc) in documents.iter().enumerate() {
+        last.insert(doc.key(), i);
     }
 
-    Ok(Some((kind, artifact_str)))
+    let mut ops = Vec::new();
+    let mut changed = Vec::new();
+    for (i, (doc, stored)) in documents.iter().zip(stored_hashes).enumerate() {
+        let key = doc.key();
+        if last[&key] != i || stored.as_deref() == Some(doc.hash.as_str()) {
+            continue;
+        }
+        ops.push(BatchOp::Put(data::hash_key(&key), doc.hash.clone()));
+        ops.push(BatchOp::Put(key, doc.artifact_str.clone()));
+        changed.push(i);
+    }
+    (ops, changed)
 }
 
 /// Apply downloaded artifact to etcd
@@ -140,37 +240,68 @@ async fn process_artifact_document(doc: &str) -> common::Result<Option<(String,
 /// ### Parametets
 /// * `body: &str` - whole yaml string of piccolo artifact
 /// ### Returns
-/// * `Result(String, String)` - scenario and package yaml in downloaded artifact
+/// * `Result<Applied>` - changed scenario yamls and write counts
 /// ### Description
-/// Write artifact in etcd
-pub async fn apply(body: &str) -> common::Result<String> {
+/// Write the changed artifacts and generated Pods in etcd in one batch
+pub async fn apply(body: &str) -> common::Result<Applied> {
     use std::time::Instant;
     let total_start = Instant::now();
 
-    let docs: Vec<&str> = body.split(YAML_SEPARATOR).collect();
-    let mut scenario_str = String::new();
-    let mut package_str = String::new();
-
-    for doc in docs {
-        if let Some((kind, artifact_str)) = process_artifact_document(doc).await? {
-            match kind.as_str() {
-                KIND_SCENARIO => scenario_str = artifact_str,
-                KIND_PACKAGE => package_str = artifact_str,
-                _ => continue,
-            }
+    let mut documents = Vec::new();
+    for doc in body.split(YAML_SEPARATOR) {
+        if let Some(parsed) = parse_document(doc)? {
+            documents.push(parsed);
         }
     }
 
-    logd!(1, "apply: total elapsed = {:?}", total_start.elapsed());
+    if !documents.iter().any(|doc| doc.kind == KIND_SCENARIO) {
+        return Err("There is not any scenario in yaml string".into());
+    }
+    let Some(package_str) = documents
+        .iter()
+        .rev()
+        .find(|doc| doc.kind == KIND_PACKAGE)
+        .map(|doc| doc.artifact_str.clone())
+    else {
+        return Err("There is not any package in yaml string".into());
+    };
 
-    if scenario_str.is_empty() {
-        Err("There is not any scenario in yaml string".into())
-    } else if package_str.is_empty() {
-        Err("There is not any package in yaml string".into())
-    } else {
-        save_pod_yaml_from_package(&package_str).await?;
-        Ok(scenario_str)
+    let bundle: HashMap<String, String> = documents
+        .iter()
+        .map(|doc| (doc.key(), doc.artifact_str.clone()))
+        .collect();
+    documents.extend(pod_documents(&package_str, &bundle).await?);
+
+    let keys: Vec<String> = documents.iter().map(ParsedDocument::key).collect();
+    let stored_hashes = data::read_hashes(&keys).await?;
+    let (ops, changed) = plan_writes(&documents, &stored_hashes);
+
+    let applied = Applied {
+        changed_scenarios: changed
+            .iter()
+            .filter(|&&i| documents[i].kind == KIND_SCENARIO)
+            .map(|&i| documents[i].artifact_str.clone())
+            .collect(),
+        written: changed.len(),
+        unchanged: documents.len() - changed.len(),
+    };
+    if !ops.is_empty() {
+        data::write_batch_to_etcd(ops).await?;
+    }
+    for &i in &changed {
+        if documents[i].kind == KIND_SCENARIO {
+            notify_scenario_state(&documents[i].name, "idle").await;
+        }
     }
+
+    logd!(
+        1,
+        "apply: {} written, {} unchanged, total elapsed = {:?}",
+        applied.written,
+        applied.unchanged,
+        total_start.elapsed()
+    );
+    Ok(applied)
 }
 
 /// Delete downloaded artifact to etcd
@@ -191,7 +322,13 @@ pub async fn withdraw(body: &str) -> common::Result<String> {
             if kind == KIND_SCENARIO {
                 let artifact_str = serde_yaml::to_string(&value)?;
                 let key = format!("{}/{}", KIND_SCENARIO, name);
-                data::delete_at_etcd(&key).await?;
+                // Drop the hash too, so applying the same scenario again
+                // is not skipped as unchanged
+                data::write_batch_to_etcd(vec![
+                    BatchOp::Delete(data::hash_key(&key)),
+                    BatchOp::Delete(key),
+                ])
+                .await?;
                 return Ok(artifact_str);
             }
         }
@@ -200,16 +337,26 @@ pub async fn withdraw(body: &str) -> common::Result<String> {
     Err("There is not any scenario in yaml string".into())
 }
 
+/// Artifact at `key`, taken from the bundle being applied if it is part
+/// of it and from etcd otherwise
+async fn lookup(bundle: &HashMap<String, String>, key: &str) -> common::Result<String> {
+    match bundle.get(key) {
+        Some(artifact_str) => Ok(artifact_str.clone()),
+        None => Ok(common::etcd::get(key).await?),
+    }
+}
+
 /// Load model with optional volume and network resources
 async fn load_model_with_resources(
     model_info: &common::spec::artifact::package::ModelInfo,
+    bundle: &HashMap<String, String>,
 ) -> common::Result<Model> {
-    let model_str = common::etcd::get(&format!("{}/{}", KIND_MODEL, model_info.get_name())).await?;
+    let model_str = lookup(bundle, &format!("{}/{}", KIND_MODEL, model_info.get_name())).await?;
     let mut model: Model = serde_yaml::from_str(&model_str)?;
 
     // Load volume if specified
     if let Some(volume_name) = model_info.get_resources().get_volume() {
-        let volume_str = common::etcd::get(&format!("{}/{}", KIND_VOLUME, volume_name)).await?;
+        let volume_str = lookup(bundle, &format!("{}/{}", KIND_VOLUME, volume_name)).await?;
         let volume: Volume = serde_yaml::from_str(&volume_str)?;
 
         if let Some(volume_spec) = volume.get_spec() {
@@ -222,7 +369,7 @@ async fn load_model_with_resources(
 
     // Load network if specified
     if let Some(network_name) = model_info.get_resources().get_network() {
-        let network_str = common::etcd::get(&format!("{}/{}", KIND_NETWORK, network_name)).await?;
+        let network_str = lookup(bundle, &format!("{}/{}", KIND_NETWORK, network_name)).await?;
         let _network: Network = serde_yaml::from_str(&network_str)?;
         // TODO: Apply network configuration
     }
@@ -230,25 +377,29 @@ async fn load_model_with_resources(
     Ok(model)
 }
 
-/// Save Pod YAML for all models in a package
-async fn save_pod_yaml_from_package(package_str: &str) -> common::Result<()> {
+/// Pod YAML for all models in a package
+///
+/// Models, volumes and networks come from `bundle` first, since the bundle
+/// is not written yet when the Pods are generated.
+async fn pod_documents(
+    package_str: &str,
+    bundle: &HashMap<String, String>,
+) -> common::Result<Vec<ParsedDocument>> {
     let package: Package = serde_yaml::from_str(package_str)?;
     let mut models = Vec::new();
 
     for model_info in package.get_models() {
-        let model = load_model_with_resources(&model_info).await?;
+        let model = load_model_with_resources(&model_info, bundle).await?;
         models.push(model);
     }
 
-    let pods: Vec<Pod> = models.into_iter().map(Pod::from).collect();
-
-    for pod in pods {
+    let mut pods = Vec::new();
+    for pod in models.into_iter().map(Pod::from) {
         let pod_yaml = serde_yaml::to_string(&pod)?;
-        let key = format!("{}/{}", "Pod", pod.get_name());
-        data::write_to_etcd(&key, &pod_yaml).await?;
+        pods.push(ParsedDocument::new(KIND_POD, pod.get_name(), pod_yaml));
     }
 
-    Ok(())
+    Ok(pods)
 }
 
 //UNIT TEST CASES
@@ -371,9 +522,18 @@ spec:
             result.err()
         );
 
-        // Assert: scenario and package strings should not be empty
-        let scenario = result.unwrap();
-        assert!(!scenario.is_empty(), "Scenario YAML should not be empty");
+        // Assert: every document is either written or already stored
+        let applied = result.unwrap();
+        assert!(
+            applied.written + applied.unchanged >= 3,
+            "Scenario, Package and Pod should be accounted for: {:?}",
+            applied
+        );
+
+        // Assert: applying the same bundle again writes nothing
+        let again = apply(VALID_ARTIFACT_YAML).await.unwrap();
+        assert_eq!(again.written, 0, "unchanged bundle was rewritten");
+        assert!(again.changed_scenarios.is_empty());
 
         // Cleanup: Remove the created Model
         let _ = data::delete_at_etcd("Model/helloworld-core").await;
@@ -415,6 +575,74 @@ spec:
         );
     }
 
+    /// Test plan_writes() skips stored documents and duplicate keys
+    #[test]
+    fn test_plan_writes_skips_unchanged_documents() {
+        let scenario = ParsedDocument::new(KIND_SCENARIO, "a".into(), "v1".into());
+        let package = ParsedDocument::new(KIND_PACKAGE, "a".into(), "p1".into());
+        let scenario_v2 = ParsedDocument::new(KIND_SCENARIO, "a".into(), "v2".into());
+        let documents = vec![scenario.clone(), package.clone(), scenario_v2.clone()];
+
+        // Nothing stored yet: the package and the last scenario are written
+        let (ops, changed) = plan_writes(&documents, &[None, None, None]);
+        assert_eq!(changed, vec![1, 2]);
+        assert_eq!(ops.len(), 4);
+        assert!(ops.contains(&BatchOp::Put("Scenario/a".into(), "v2".into())));
+
+        // Stored hashes match: nothing is written
+        let stored = vec![
+            Some(scenario_v2.hash.clone()),
+            Some(package.hash.clone()),
+            Some(scenario_v2.hash.clone()),
+        ];
+        let (ops, changed) = plan_writes(&documents, &stored);
+        assert!(ops.is_empty());
+        assert!(changed.is_empty());
+
+        // Only the package changed
+        let stored = vec![None, Some("old".into()), Some(scenario_v2.hash.clone())];
+        let (ops, changed) = plan_writes(&documents, &stored);
+        assert_eq!(changed, vec![1]);
+        assert_eq!(
+            ops,
+            vec![
+                BatchOp::Put(data::hash_key("Package/a"), package.hash.clone()),
+                BatchOp::Put("Package/a".into(), "p1".into()),
+            ]
+        );
+    }
+
+    /// Test parse_document() returns the same document for repeated input
+    #[test]
+    fn test_parse_document_reuses_parsed_result() {
+        let first = parse_document(VALID_MODEL_YAML).unwrap().unwrap();
+        let second = parse_document(VALID_MODEL_YAML).unwrap().unwrap();
+        assert_eq!(first, second);
+        assert_eq!(first.key(), "Model/helloworld-core");
+        assert!(parse_document(INVALID_YAML_UNKNOWN_ARTIFACT)
+            .unwrap()
+            .is_none());
+    }
+
+    /// Test parse_document() ignores an entry whose raw text differs
+    #[test]
+    fn test_parse_document_ignores_hash_collision() {
+        let doc = format!("{}\n# colliding", VALID_MODEL_YAML);
+        PARSED_CACHE
+            .get_or_init(|| Mutex::new(HashMap::new()))
+            .lock()
+            .unwrap()
+            .insert(
+                data::content_hash(&doc),
+                CachedDocument {
+                    raw: "kind: Model".to_string(),
+                    parsed: ParsedDocument::new(KIND_MODEL, "other".to_string(), String::new()),
+                },
+            );
+        let parsed = parse_document(&doc).unwrap().unwrap();
+        assert_eq!(parsed.key(), "Model/helloworld-core");
+    }
+
     // -- withdraw() tests --
 
     /// Test withdraw() with valid artifact YAML (Scenario present)
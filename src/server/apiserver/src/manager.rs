@@ -139,13 +139,19 @@ async fn reload() {
 /// (optional) make yaml, kube files for Bluechi
 /// send a gRPC message to gateway
 pub async fn apply_artifact(body: &str) -> common::Result<()> {
-    let scenario = crate::artifact::apply(body).await?;
+    let applied = crate::artifact::apply(body).await?;
+    if applied.changed_scenarios.is_empty() {
+        logd!(2, "Artifact unchanged, nothing sent to filtergateway");
+    }
 
-    let req: HandleScenarioRequest = HandleScenarioRequest {
-        action: Action::Apply.into(),
-        scenario,
-    };
-    crate::grpc::sender::filtergateway::send(req).await?;
+    // Only changed scenarios are forwarded; filtergateway already holds the rest
+    for scenario in applied.changed_scenarios {
+        let req: HandleScenarioRequest = HandleScenarioRequest {
+            action: Action::Apply.into(),
+            scenario,
+        };
+        crate::grpc::sender::filtergateway::send(req).await?;
+    }
     Ok(())
 }
 
@@ -674,16 +680,19 @@ spec:
         body: &str,
         grpc_addr: SocketAddr,
     ) -> Result<(), Box<dyn std::error::Error>> {
-        let scenario = crate::artifact::apply(body).await?;
+        let applied = crate::artifact::apply(body).await?;
 
-        // Prepare the gRPC request with Apply action
-        let req = HandleScenarioRequest {
-            action: Action::Apply.into(),
-            scenario,
-        };
+        for scenario in applied.changed_scenarios {
+            // Prepare the gRPC request with Apply action
+            let req = HandleScenarioRequest {
+                action: Action::Apply.into(),
+                scenario,
+            };
 
-        // Send request to the mock gRPC server
-        mock_send(req, grpc_addr).await
+            // Send request to the mock gRPC server
+            mock_send(req, grpc_addr).await?;
+        }
+        Ok(())
     }
 
     /// Mocked version of withdraw_artifact function.
@@ -3,13 +3,98 @@
 
 //! Shared log entry representation passed between the receiver and web UI.
 
-use serde::Serialize;
+use chrono::{DateTime, Local};
+use common::logd::LogEnvelope;
+use serde::ser::{Serialize, SerializeStruct, Serializer};
+use std::fmt;
+use std::time::{Duration, UNIX_EPOCH};
 
 /// A single log line broken into structured fields for filtering & rendering.
-#[derive(Clone, Debug, Serialize)]
+///
+/// The timestamp stays in nanoseconds; it is only formatted when the entry
+/// is printed or serialized for a client.
+#[derive(Clone, Debug)]
 pub struct LogEvent {
-    pub timestamp: String,
-    pub level: String,
+    /// Position in the log store, increasing in arrival order
+    pub seq: u64,
+    pub ts_real_ns: u64,
+    pub level: i32,
     pub tag: String,
     pub message: String,
 }
+
+impl LogEvent {
+    pub fn from_envelope(seq: u64, env: LogEnvelope) -> Self {
+        Self {
+            seq,
+            ts_real_ns: env.ts_real_ns,
+            level: env.level,
+            tag: env.tag,
+            message: env.message,
+        }
+    }
+
+    /// Single-letter level as shown in the viewer
+    pub fn level_str(&self) -> &'static str {
+        level_str(self.level)
+    }
+
+    /// Local time with millisecond precision, formatted on display
+    pub fn timestamp(&self) -> impl fmt::Display {
+        let local: DateTime<Local> =
+            DateTime::from(UNIX_EPOCH + Duration::from_nanos(self.ts_real_ns));
+        local.format("%Y-%m-%d %H:%M:%S%.3f")
+    }
+}
+
+pub fn level_str(level: i32) -> &'static str {
+    match level {
+        1 => "V",
+        2 => "D",
+        3 => "I",
+        4 => "W",
+        5 => "E",
+        6 => "F",
+        _ => "?",
+    }
+}
+
+/// Inverse of [`level_str`], also accepting the numeric level
+pub fn parse_level(level: &str) -> Option<i32> {
+    match level.to_ascii_uppercase().as_str() {
+        "V" => Some(1),
+        "D" => Some(2),
+        "I" => Some(3),
+        "W" => Some(4),
+        "E" => Some(5),
+        "F" => Some(6),
+        other => other.parse().ok(),
+    }
+}
+
+impl fmt::Display for LogEvent {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        // The timestamp has a fixed width of 23 characters, so it is written
+        // straight into the formatter with one space of padding
+        write!(
+            f,
+            "{}  │ {:<2} │ {:<30} │ {}",
+            self.timestamp(),
+            self.level_str(),
+            self.tag,
+            self.message
+        )
+    }
+}
+
+impl Serialize for LogEvent {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let mut state = serializer.serialize_struct("LogEvent", 5)?;
+        state.serialize_field("seq", &self.seq)?;
+        state.serialize_field("timestamp", &self.timestamp().to_string())?;
+        state.serialize_field("level", self.level_str())?;
+        state.serialize_field("tag", &self.tag)?;
+        state.serialize_field("message", &self.message)?;
+        state.end()
+    }
+}
@@ -2,24 +2,28 @@
 // SPDX-License-Identifier: Apache-2.0
 
 //! A Tokio-based log aggregator. It receives protobuf
-//! logs from a Unix datagram socket and streams them to
-//! stdout, while simultaneously opening SSE-based HTTP
-//! endpoints (/, /logs) so that the same log stream
-//! can be viewed in real time in a browser.
+//! logs from a Unix datagram socket, keeps them in a
+//! bounded on-disk log and streams them to stdout, while
+//! simultaneously opening HTTP endpoints (/, /logs, /query)
+//! so that the same log stream can be viewed in real time
+//! in a browser and searched afterwards.
 
 mod log_entry;
 mod receiver;
+mod store;
 mod web;
 
-use std::{collections::VecDeque, sync::Arc};
+use std::sync::{Arc, Mutex};
 
 use log_entry::LogEvent;
 use receiver::{bind_sock, cleanup_socket, run as run_receiver};
+use store::{log_dir, LogStore};
 use tokio::signal;
-use tokio::sync::{broadcast, Mutex};
+use tokio::sync::broadcast;
 use web::{default_http_addr, run_http_server, WebState};
 
 const BROADCAST_CAPACITY: usize = 1024;
+/// Stored entries replayed to a browser when it connects to `/logs`
 pub const LOG_HISTORY_CAPACITY: usize = 2000;
 
 /// Entry point: Open a Unix socket and run the receiving task
@@ -31,14 +35,17 @@ async fn main() -> std::io::Result<()> {
     let logd = bind_sock(logd_path)?;
     println!("[aggregator] sockets ready");
 
+    let dir = log_dir();
+    let store = Arc::new(Mutex::new(LogStore::open(&dir)?));
+    println!("[aggregator] log store ready in {}", dir.display());
+
     let (log_tx, _) = broadcast::channel::<LogEvent>(BROADCAST_CAPACITY);
-    let log_history = Arc::new(Mutex::new(VecDeque::with_capacity(LOG_HISTORY_CAPACITY)));
     let web_state = WebState {
         log_tx: log_tx.clone(),
-        log_history: log_history.clone(),
+        store: store.clone(),
     };
 
-    let mut recv_task = tokio::spawn(run_receiver(logd, log_tx, log_history));
+    let mut recv_task = tokio::spawn(run_receiver(logd, log_tx, store));
     let mut http_task = tokio::spawn(run_http_server(web_state, default_http_addr()));
 
     tokio::select! {
@@ -1,20 +1,19 @@
 // SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 // SPDX-License-Identifier: Apache-2.0
 
-//! Unix socket receiver that decodes `LogEnvelope`s and multicasts the
-//! formatted lines to stdout plus an in-process broadcast channel.
+//! Unix socket receiver that decodes `LogEnvelope`s, appends them to the
+//! log store and multicasts them to an in-process broadcast channel.
+//! Entries are only formatted when they are queried or streamed, unless
+//! `PICCOLO_LOG_ECHO` asks for a copy on stdout as well.
 
-use crate::{log_entry::LogEvent, LOG_HISTORY_CAPACITY};
-use chrono::{DateTime, Local};
+use crate::log_entry::LogEvent;
+use crate::store::{self, SharedStore};
 use common::logd::LogEnvelope;
 use prost::Message;
-use std::collections::VecDeque;
 use std::fs;
 use std::path::Path;
-use std::sync::Arc;
-use std::time::{Duration as StdDuration, UNIX_EPOCH};
 use tokio::net::UnixDatagram;
-use tokio::sync::{broadcast, Mutex};
+use tokio::sync::broadcast;
 
 /// Create (or recreate) a Unix datagram socket at `path` and bind it.
 ///
@@ -38,12 +37,15 @@ pub fn cleanup_socket(path: &str) {
     }
 }
 
-/// Receive datagrams, decode them, and fan them out to stdout, history buffer, and broadcast.
-pub async fn run(
-    sock: UnixDatagram,
-    log_tx: broadcast::Sender<LogEvent>,
-    log_history: Arc<Mutex<VecDeque<LogEvent>>>,
-) {
+/// Whether received entries are also printed to stdout, for debugging
+fn echo_enabled() -> bool {
+    std::env::var_os("PICCOLO_LOG_ECHO").is_some_and(|v| !v.is_empty() && v != "0")
+}
+
+/// Receive datagrams, decode them, store them as received and fan them out
+/// to the broadcast channel, and to stdout with `PICCOLO_LOG_ECHO` set.
+pub async fn run(sock: UnixDatagram, log_tx: broadcast::Sender<LogEvent>, store: SharedStore) {
+    let echo = echo_enabled();
     let mut buf = vec![0u8; 8192];
     loop {
         let n = match sock.recv(&mut buf).await {
@@ -57,40 +59,15 @@ pub async fn run(
             Err(_) => continue,
         };
 
-        let sys_time = UNIX_EPOCH + StdDuration::from_nanos(env.ts_real_ns);
-        let chrono_time: DateTime<Local> = DateTime::from(sys_time);
-        let time_str = chrono_time.format("%Y-%m-%d %H:%M:%S%.3f");
-
-        let level = match env.level {
-            1 => "V",
-            2 => "D",
-            3 => "I",
-            4 => "W",
-            5 => "E",
-            6 => "F",
-            _ => "?",
-        };
+        // A single write of the framed datagram into the page cache; cheap
+        // enough to keep on the receiving task
+        let seq = store::lock(&store).append(data, &env);
+        let entry = LogEvent::from_envelope(seq, env);
 
-        let entry = LogEvent {
-            timestamp: time_str.to_string(),
-            level: level.to_string(),
-            tag: env.tag.clone(),
-            message: env.message.clone(),
-        };
-
-        {
-            let mut history = log_history.lock().await;
-            history.push_back(entry.clone());
-            if history.len() > LOG_HISTORY_CAPACITY {
-                history.pop_front();
-            }
+        if echo {
+            println!("{entry}");
         }
 
-        println!(
-            "{:<24} │ {:<2} │ {:<30} │ {}",
-            entry.timestamp, entry.level, entry.tag, entry.message
-        );
-
         let _ = log_tx.send(entry);
     }
 }
@@ -0,0 +1,569 @@
+// SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Append-only, segmented on-disk log with an in-memory index.
+//!
+//! Every datagram is stored exactly as received, framed as
+//! `len:u32le envelope`, in segment files named after the sequence number
+//! of their first record. A segment is closed at `SEGMENT_BYTES` and the
+//! oldest one is deleted once there are more than `MAX_SEGMENTS`, which
+//! bounds the disk usage.
+//!
+//! The index keeps time, level and tag of every stored record, plus the
+//! time span, levels and tags of each segment so that queries skip whole
+//! segments. Queries are answered from the index and only the matching
+//! records are read back from disk.
+
+use crate::log_entry::LogEvent;
+use common::logd::LogEnvelope;
+use prost::Message;
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, Write};
+use std::os::unix::fs::FileExt;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, MutexGuard};
+
+/// Where segments are kept unless `PICCOLO_LOG_DIR` says otherwise
+pub const DEFAULT_LOG_DIR: &str = "/var/log/piccolo/logservice";
+
+/// Size at which the current segment is closed
+const SEGMENT_BYTES: u64 = 4 * 1024 * 1024;
+/// Segments kept on disk; older ones are deleted
+const MAX_SEGMENTS: usize = 16;
+
+const SEGMENT_SUFFIX: &str = ".seg";
+const FRAME_HEADER: usize = 4;
+/// Larger frames cannot come from the receiver and mark a corrupt file
+const MAX_RECORD: usize = 64 * 1024;
+
+/// Store shared by the receiver and the HTTP handlers
+pub type SharedStore = Arc<Mutex<LogStore>>;
+
+pub fn lock(store: &SharedStore) -> MutexGuard<'_, LogStore> {
+    store.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+/// Directory for the log store
+pub fn log_dir() -> PathBuf {
+    std::env::var_os("PICCOLO_LOG_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| PathBuf::from(DEFAULT_LOG_DIR))
+}
+
+#[derive(Clone, Copy, Debug)]
+struct IndexEntry {
+    seq: u64,
+    ts_ns: u64,
+    offset: u32,
+    len: u32,
+    tag: u32,
+    level: i32,
+}
+
+struct Segment {
+    path: Arc<PathBuf>,
+    size: u64,
+    min_ts: u64,
+    max_ts: u64,
+    /// Bit `n` is set when a record of level `n` is in the segment
+    levels: u8,
+    tags: HashSet<u32>,
+    entries: Vec<IndexEntry>,
+}
+
+impl Segment {
+    fn new(dir: &Path, first_seq: u64) -> Self {
+        Self {
+            path: Arc::new(segment_path(dir, first_seq)),
+            size: 0,
+            min_ts: u64::MAX,
+            max_ts: 0,
+            levels: 0,
+            tags: HashSet::new(),
+            entries: Vec::new(),
+        }
+    }
+
+    fn index(&mut self, entry: IndexEntry) {
+        self.min_ts = self.min_ts.min(entry.ts_ns);
+        self.max_ts = self.max_ts.max(entry.ts_ns);
+        self.levels |= level_bit(entry.level);
+        self.tags.insert(entry.tag);
+        self.size = u64::from(entry.offset) + (FRAME_HEADER as u64) + u64::from(entry.len);
+        self.entries.push(entry);
+    }
+}
+
+fn segment_path(dir: &Path, first_seq: u64) -> PathBuf {
+    dir.join(format!("{:020}{}", first_seq, SEGMENT_SUFFIX))
+}
+
+fn level_bit(level: i32) -> u8 {
+    1 << level.clamp(0, 7)
+}
+
+/// Range filters of a `/query` request; `None` fields match everything
+#[derive(Clone, Debug, Default)]
+pub struct LogQuery {
+    pub from_ns: Option<u64>,
+    pub to_ns: Option<u64>,
+    /// Lowest level to include
+    pub min_level: Option<i32>,
+    /// Any of these tags; empty matches every tag
+    pub tags: Vec<String>,
+    /// Resume after this sequence number
+    pub after_seq: Option<u64>,
+    pub limit: usize,
+}
+
+/// Location of one stored record
+#[derive(Clone, Debug)]
+pub struct RecordRef {
+    seq: u64,
+    path: Arc<PathBuf>,
+    offset: u32,
+    len: u32,
+}
+
+pub struct LogStore {
+    dir: PathBuf,
+    segment_bytes: u64,
+    max_segments: usize,
+    segments: VecDeque<Segment>,
+    /// Open for appending to the last segment; `None` after a write error
+    writer: Option<File>,
+    next_seq: u64,
+    tag_ids: HashMap<String, u32>,
+    /// Whether the last append failed, so errors are reported once
+    failing: bool,
+}
+
+impl LogStore {
+    /// Open the store in `dir`, rebuilding the index from its segments
+    pub fn open(dir: impl Into<PathBuf>) -> io::Result<Self> {
+        Self::with_limits(dir, SEGMENT_BYTES, MAX_SEGMENTS)
+    }
+
+    fn with_limits(
+        dir: impl Into<PathBuf>,
+        segment_bytes: u64,
+        max_segments: usize,
+    ) -> io::Result<Self> {
+        let dir = dir.into();
+        fs::create_dir_all(&dir)?;
+
+        let mut first_seqs: Vec<u64> = fs::read_dir(&dir)?
+            .filter_map(|entry| {
+                let name = entry.ok()?.file_name();
+                name.to_str()?.strip_suffix(SEGMENT_SUFFIX)?.parse().ok()
+            })
+            .collect();
+        first_seqs.sort_unstable();
+
+        let mut store = Self {
+            dir,
+            segment_bytes,
+            max_segments: max_segments.max(1),
+            segments: VecDeque::new(),
+            writer: None,
+            next_seq: 0,
+            tag_ids: HashMap::new(),
+            failing: false,
+        };
+        for first_seq in first_seqs {
+            let segment = store.recover(first_seq)?;
+            store.next_seq = first_seq + segment.entries.len() as u64;
+            store.segments.push_back(segment);
+        }
+        store.trim()?;
+
+        if let Some(last) = store.segments.back() {
+            if last.size < store.segment_bytes {
+                store.writer = Some(OpenOptions::new().append(true).open(&*last.path)?);
+            }
+        }
+        Ok(store)
+    }
+
+    /// Index an existing segment, cutting off a torn last record
+    fn recover(&mut self, first_seq: u64) -> io::Result<Segment> {
+        let mut segment = Segment::new(&self.dir, first_seq);
+        let data = fs::read(&*segment.path)?;
+
+        let mut offset = 0usize;
+        while offset + FRAME_HEADER <= data.len() {
+            let len = u32::from_le_bytes(data[offset..offset + FRAME_HEADER].try_into().unwrap())
+                as usize;
+            let start = offset + FRAME_HEADER;
+            if len > MAX_RECORD || start + len > data.len() {
+                break;
+            }
+            let Ok(env) = LogEnvelope::decode(&data[start..start + len]) else {
+                break;
+            };
+            let entry = IndexEntry {
+                seq: first_seq + segment.entries.len() as u64,
+                ts_ns: env.ts_real_ns,
+                offset: offset as u32,
+                len: len as u32,
+                tag: self.tag_id(&env.tag),
+                level: env.level,
+            };
+            segment.index(entry);
+            offset = start + len;
+        }
+
+        if offset < data.len() {
+            eprintln!(
+                "[aggregator] dropping {} damaged bytes at the end of {}",
+                data.len() - offset,
+                segment.path.display()
+            );
+            OpenOptions::new()
+                .write(true)
+                .open(&*segment.path)?
+                .set_len(offset as u64)?;
+        }
+        segment.size = offset as u64;
+        Ok(segment)
+    }
+
+    fn tag_id(&mut self, tag: &str) -> u32 {
+        if let Some(id) = self.tag_ids.get(tag) {
+            return *id;
+        }
+        let id = self.tag_ids.len() as u32;
+        self.tag_ids.insert(tag.to_string(), id);
+        id
+    }
+
+    /// Store one received datagram and return its sequence number.
+    ///
+    /// The number is assigned even if the write fails, so live subscribers
+    /// still see a unique, increasing sequence.
+    pub fn append(&mut self, data: &[u8], env: &LogEnvelope) -> u64 {
+        let seq = self.next_seq;
+        self.next_seq += 1;
+
+        match self.write(seq, data, env) {
+            Ok(()) if self.failing => {
+                self.failing = false;
+                eprintln!("[aggregator] log store writable again");
+            }
+            Ok(()) => {}
+            Err(err) if !self.failing => {
+                self.failing = true;
+                self.writer = None;
+                eprintln!("[aggregator] failed to store log record: {err}");
+            }
+            Err(_) => self.writer = None,
+        }
+        seq
+    }
+
+    fn write(&mut self, seq: u64, data: &[u8], env: &LogEnvelope) -> io::Result<()> {
+        if data.len() > MAX_RECORD {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "log record too large",
+            ));
+        }
+        let frame_len = (FRAME_HEADER + data.len()) as u64;
+        let full = self
+            .segments
+            .back()
+            .map_or(true, |last| last.size + frame_len > self.segment_bytes);
+        if self.writer.is_none() || full {
+            self.roll(seq)?;
+        }
+
+        let mut frame = Vec::with_capacity(FRAME_HEADER + data.len());
+        frame.extend_from_slice(&(data.len() as u32).to_le_bytes());
+        frame.extend_from_slice(data);
+        self.writer
+            .as_mut()
+            .expect("roll opens a writer")
+            .write_all(&frame)?;
+
+        let tag = self.tag_id(&env.tag);
+        let last = self.segments.back_mut().expect("roll adds a segment");
+        let entry = IndexEntry {
+            seq,
+            ts_ns: env.ts_real_ns,
+            offset: last.size as u32,
+            len: data.len() as u32,
+            tag,
+            level: env.level,
+        };
+        last.index(entry);
+        Ok(())
+    }
+
+    /// Start a new segment at `first_seq` and drop the oldest ones
+    fn roll(&mut self, first_seq: u64) -> io::Result<()> {
+        self.writer = None;
+        let segment = Segment::new(&self.dir, first_seq);
+        let file = OpenOptions::new()
+            .create(true)
+            .truncate(true)
+            .write(true)
+            .open(&*segment.path)?;
+        self.segments.push_back(segment);
+        self.writer = Some(file);
+        self.trim()
+    }
+
+    fn trim(&mut self) -> io::Result<()> {
+        while self.segments.len() > self.max_segments {
+            if let Some(oldest) = self.segments.pop_front() {
+                match fs::remove_file(&*oldest.path) {
+                    Ok(()) => {}
+                    Err(err) if err.kind() == io::ErrorKind::NotFound => {}
+                    Err(err) => return Err(err),
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Records matching `query` in sequence order, at most `query.limit`,
+    /// and whether more matches follow
+    pub fn plan(&self, query: &LogQuery) -> (Vec<RecordRef>, bool) {
+        let tags: Option<HashSet<u32>> = if query.tags.is_empty() {
+            None
+        } else {
+            let ids: HashSet<u32> = query
+                .tags
+                .iter()
+                .filter_map(|tag| self.tag_ids.get(tag).copied())
+                .collect();
+            if ids.is_empty() {
+                return (Vec::new(), false);
+            }
+            Some(ids)
+        };
+        let levels: u8 = (query.min_level.unwrap_or(0).clamp(0, 7)..=7)
+            .map(level_bit)
+            .fold(0, |mask, bit| mask | bit);
+        let from = query.from_ns.unwrap_or(0);
+        let to = query.to_ns.unwrap_or(u64::MAX);
+        let after = query.after_seq;
+
+        let mut refs = Vec::new();
+        for segment in &self.segments {
+            let Some(last) = segment.entries.last() else {
+                continue;
+            };
+            if segment.max_ts < from
+                || segment.min_ts > to
+                || segment.levels & levels == 0
+                || after.is_some_and(|after| last.seq <= after)
+                || tags
+                    .as_ref()
+                    .is_some_and(|tags| tags.is_disjoint(&segment.tags))
+            {
+                continue;
+            }
+
+            let start = after.map_or(0, |after| {
+                segment.entries.partition_point(|entry| entry.seq <= after)
+            });
+            for entry in &segment.entries[start..] {
+                if entry.ts_ns < from
+                    || entry.ts_ns > to
+                    || level_bit(entry.level) & levels == 0
+                    || tags.as_ref().is_some_and(|tags| !tags.contains(&entry.tag))
+                {
+                    continue;
+                }
+                if refs.len() == query.limit {
+                    return (refs, true);
+                }
+                refs.push(RecordRef {
+                    seq: entry.seq,
+                    path: Arc::clone(&segment.path),
+                    offset: entry.offset,
+                    len: entry.len,
+                });
+            }
+        }
+        (refs, false)
+    }
+
+    /// The last `count` stored records in sequence order
+    pub fn recent(&self, count: usize) -> Vec<RecordRef> {
+        let mut refs = Vec::with_capacity(count);
+        'segments: for segment in self.segments.iter().rev() {
+            for entry in segment.entries.iter().rev() {
+                if refs.len() == count {
+                    break 'segments;
+                }
+                refs.push(RecordRef {
+                    seq: entry.seq,
+                    path: Arc::clone(&segment.path),
+                    offset: entry.offset,
+                    len: entry.len,
+                });
+            }
+        }
+        refs.reverse();
+        refs
+    }
+}
+
+/// Read and decode records located by [`LogStore::plan`] or
+/// [`LogStore::recent`]. Runs without the store lock; records of segments
+/// deleted in the meantime are skipped.
+pub fn read_records(refs: &[RecordRef]) -> Vec<LogEvent> {
+    let mut events = Vec::with_capacity(refs.len());
+    let mut open: Option<(Arc<PathBuf>, File)> = None;
+    let mut buf = Vec::new();
+
+    for record in refs {
+        if open
+            .as_ref()
+            .map_or(true, |(path, _)| !Arc::ptr_eq(path, &record.path))
+        {
+            open = File::open(&*record.path)
+                .ok()
+                .map(|file| (Arc::clone(&record.path), file));
+        }
+        let Some((_, file)) = open.as_ref() else {
+            continue;
+        };
+
+        buf.resize(record.len as usize, 0);
+        let offset = u64::from(record.offset) + FRAME_HEADER as u64;
+        if file.read_exact_at(&mut buf, offset).is_err() {
+            continue;
+        }
+        if let Ok(env) = LogEnvelope::decode(buf.as_slice()) {
+            events.push(LogEvent::from_envelope(record.seq, env));
+        }
+    }
+    events
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn envelope(ts_real_ns: u64, tag: &str, level: i32, message: &str) -> LogEnvelope {
+        LogEnvelope {
+            ts_real_ns,
+            tag: tag.to_string(),
+            level,
+            message: message.to_string(),
+        }
+    }
+
+    fn append(store: &mut LogStore, env: &LogEnvelope) -> u64 {
+        store.append(&env.encode_to_vec(), env)
+    }
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("logservice_{}_{}", name, std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        dir
+    }
+
+    #[test]
+    fn test_query_filters_and_pages() {
+        let dir = temp_dir("query");
+        let mut store = LogStore::with_limits(&dir, 256, 16).unwrap();
+        for i in 0..40u64 {
+            let tag = if i % 2 == 0 {
+                "filtergateway"
+            } else {
+                "apiserver"
+            };
+            let level = if i % 10 == 0 { 5 } else { 3 };
+            append(
+                &mut store,
+                &envelope(1_000 + i, tag, level, &format!("m{}", i)),
+            );
+        }
+        assert!(store.segments.len() > 1);
+
+        let query = LogQuery {
+            from_ns: Some(1_010),
+            to_ns: Some(1_029),
+            tags: vec!["filtergateway".to_string()],
+            limit: 4,
+            ..Default::default()
+        };
+        let (refs, more) = store.plan(&query);
+        assert!(more);
+        let messages: Vec<String> = read_records(&refs)
+            .into_iter()
+            .map(|event| event.message)
+            .collect();
+        assert_eq!(messages, vec!["m10", "m12", "m14", "m16"]);
+
+        let next = LogQuery {
+            after_seq: Some(refs.last().unwrap().seq),
+            limit: 100,
+            ..query
+        };
+        let (refs, more) = store.plan(&next);
+        assert!(!more);
+        assert_eq!(refs.len(), 6);
+
+        let errors = LogQuery {
+            min_level: Some(5),
+            limit: 100,
+            ..Default::default()
+        };
+        let events = read_records(&store.plan(&errors).0);
+        let seqs: Vec<u64> = events.iter().map(|event| event.seq).collect();
+        assert_eq!(seqs, vec![0, 10, 20, 30]);
+        assert!(events.iter().all(|event| event.level_str() == "E"));
+
+        let unknown = LogQuery {
+            tags: vec!["nobody".to_string()],
+            limit: 100,
+            ..Default::default()
+        };
+        assert!(store.plan(&unknown).0.is_empty());
+
+        let recent = read_records(&store.recent(3));
+        assert_eq!(recent.last().unwrap().message, "m39");
+        assert_eq!(recent.len(), 3);
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_reopen_recovers_and_bounds_size() {
+        let dir = temp_dir("reopen");
+        {
+            let mut store = LogStore::with_limits(&dir, 128, 3).unwrap();
+            for i in 0..50u64 {
+                append(&mut store, &envelope(i, "statemanager", 3, "payload"));
+            }
+            assert_eq!(store.segments.len(), 3);
+        }
+        let segments: Vec<PathBuf> = fs::read_dir(&dir)
+            .unwrap()
+            .map(|entry| entry.unwrap().path())
+            .collect();
+        assert_eq!(segments.len(), 3);
+
+        // A torn write at the end of the last segment is cut off
+        let last = segments.iter().max().unwrap();
+        let mut file = OpenOptions::new().append(true).open(last).unwrap();
+        file.write_all(&[200, 0, 0, 0, 1, 2]).unwrap();
+
+        let mut store = LogStore::with_limits(&dir, 128, 3).unwrap();
+        let recent = read_records(&store.recent(1));
+        assert_eq!(recent[0].seq, 49);
+        assert_eq!(
+            append(&mut store, &envelope(50, "statemanager", 3, "after")),
+            50
+        );
+        let recent = read_records(&store.recent(2));
+        assert_eq!(recent[0].seq, 49);
+        assert_eq!(recent[1].message, "after");
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
@@ -1,34 +1,44 @@
 // SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
 // SPDX-License-Identifier: Apache-2.0
 
-//! Minimal Axum-based HTTP server that streams log lines to browsers via SSE.
+//! Minimal Axum-based HTTP server that streams log lines to browsers via SSE
+//! and answers range queries over the stored log.
 
-use std::collections::VecDeque;
 use std::convert::Infallible;
 use std::net::SocketAddr;
-use std::sync::Arc;
 use std::time::Duration;
 
 use axum::{
-    extract::State,
+    extract::{Query, State},
+    http::StatusCode,
     response::{
         sse::{Event, KeepAlive, Sse},
         Html,
     },
     routing::get,
-    Router,
+    Json, Router,
 };
+use chrono::DateTime;
+use serde::{Deserialize, Serialize};
 use tokio::net::TcpListener;
-use tokio::sync::{broadcast, Mutex};
+use tokio::sync::broadcast;
 use tokio_stream::{wrappers::BroadcastStream, Stream, StreamExt};
 
-use crate::log_entry::LogEvent;
+use crate::log_entry::{parse_level, LogEvent};
+use crate::store::{self, read_records, LogQuery, SharedStore};
+use crate::LOG_HISTORY_CAPACITY;
 
-/// Shared state for the HTTP server, mainly the broadcast sender of log lines.
+/// Entries returned by `/query` when no `limit` is given
+const QUERY_LIMIT_DEFAULT: usize = 1000;
+/// Upper bound of `limit`
+const QUERY_LIMIT_MAX: usize = 10_000;
+
+/// Shared state for the HTTP server: the broadcast sender of live log lines
+/// and the log store for history.
 #[derive(Clone)]
 pub struct WebState {
     pub log_tx: broadcast::Sender<LogEvent>,
-    pub log_history: Arc<Mutex<VecDeque<LogEvent>>>,
+    pub store: SharedStore,
 }
 
 /// Default address (`0.0.0.0:47097`) for the built-in log viewer.
@@ -245,6 +255,7 @@ pub async fn run_http_server(state: WebState, addr: SocketAddr) {
     let app = Router::new()
         .route("/", get(serve_index))
         .route("/logs", get(stream_logs))
+        .route("/query", get(query_logs))
         .with_state(state);
 
     match TcpListener::bind(addr).await {
@@ -264,23 +275,30 @@ async fn serve_index() -> Html<&'static str> {
 async fn stream_logs(
     State(state): State<WebState>,
 ) -> Sse<impl Stream<Item = Result<Event, Infallible>>> {
-    let history_events = {
-        let history = state.log_history.lock().await;
-        history
-            .iter()
-            .filter_map(|entry| match Event::default().json_data(entry) {
-                Ok(event) => Some(Ok(event)),
-                Err(err) => {
-                    eprintln!("[aggregator] failed to encode log history for SSE: {err}");
-                    None
-                }
-            })
-            .collect::<Vec<_>>()
-    };
+    // Subscribe before reading history so nothing falls between the two;
+    // live entries already replayed from history are skipped by sequence
+    let live = BroadcastStream::new(state.log_tx.subscribe());
+    let refs = store::lock(&state.store).recent(LOG_HISTORY_CAPACITY);
+    let history = tokio::task::spawn_blocking(move || read_records(&refs))
+        .await
+        .unwrap_or_default();
+    let replayed = history.last().map(|entry| entry.seq);
+
+    let history_events = history
+        .iter()
+        .filter_map(|entry| match Event::default().json_data(entry) {
+            Ok(event) => Some(Ok(event)),
+            Err(err) => {
+                eprintln!("[aggregator] failed to encode log history for SSE: {err}");
+                None
+            }
+        })
+        .collect::<Vec<_>>();
 
     let history_stream = tokio_stream::iter(history_events);
 
-    let live_stream = BroadcastStream::new(state.log_tx.subscribe()).filter_map(|msg| match msg {
+    let live_stream = live.filter_map(move |msg| match msg {
+        Ok(entry) if replayed.is_some_and(|seq| entry.seq <= seq) => None,
         Ok(entry) => match Event::default().json_data(&entry) {
             Ok(event) => Some(Ok(event)),
             Err(err) => {
@@ -295,3 +313,118 @@ async fn stream_logs(
 
     Sse::new(stream).keep_alive(KeepAlive::new().interval(Duration::from_secs(15)))
 }
+
+/// Filters of `GET /query`, all optional:
+///
+/// - `from`, `to`: inclusive time range, RFC 3339 or nanoseconds since the epoch
+/// - `level`: lowest level to include, `V`..`F` or its number
+/// - `tag`: comma-separated tags, any of which matches
+/// - `after`: sequence number to resume after, from the last entry of a page
+/// - `limit`: page size, default 1000, at most 10000
+#[derive(Debug, Default, Deserialize)]
+pub struct QueryParams {
+    from: Option<String>,
+    to: Option<String>,
+    level: Option<String>,
+    tag: Option<String>,
+    after: Option<u64>,
+    limit: Option<usize>,
+}
+
+impl QueryParams {
+    fn to_query(&self) -> Result<LogQuery, String> {
+        let min_level = match self.level.as_deref() {
+            Some(level) => {
+                Some(parse_level(level).ok_or_else(|| format!("invalid level '{level}'"))?)
+            }
+            None => None,
+        };
+        Ok(LogQuery {
+            from_ns: self.from.as_deref().map(parse_time).transpose()?,
+            to_ns: self.to.as_deref().map(parse_time).transpose()?,
+            min_level,
+            tags: self
+                .tag
+                .as_deref()
+                .map(|tags| {
+                    tags.split(',')
+                        .map(str::trim)
+                        .filter(|tag| !tag.is_empty())
+                        .map(str::to_string)
+                        .collect()
+                })
+                .unwrap_or_default(),
+            after_seq: self.after,
+            limit: self
+                .limit
+                .unwrap_or(QUERY_LIMIT_DEFAULT)
+                .min(QUERY_LIMIT_MAX),
+        })
+    }
+}
+
+fn parse_time(value: &str) -> Result<u64, String> {
+    if let Ok(ns) = value.parse::<u64>() {
+        return Ok(ns);
+    }
+    DateTime::parse_from_rfc3339(value)
+        .ok()
+        .and_then(|time| time.timestamp_nanos_opt())
+        .and_then(|ns| u64::try_from(ns).ok())
+        .ok_or_else(|| {
+            format!("invalid time '{value}', expected RFC 3339 or nanoseconds since the epoch")
+        })
+}
+
+/// One page of `/query` results in arrival order; when `more` is set, pass
+/// the `seq` of the last entry as `after` for the next page
+#[derive(Serialize)]
+struct QueryResponse {
+    entries: Vec<LogEvent>,
+    more: bool,
+}
+
+async fn query_logs(
+    State(state): State<WebState>,
+    Query(params): Query<QueryParams>,
+) -> Result<Json<QueryResponse>, (StatusCode, String)> {
+    let query = params
+        .to_query()
+        .map_err(|err| (StatusCode::BAD_REQUEST, err))?;
+
+    let (refs, more) = store::lock(&state.store).plan(&query);
+    let entries = tokio::task::spawn_blocking(move || read_records(&refs))
+        .await
+        .map_err(|err| (StatusCode::INTERNAL_SERVER_ERROR, err.to_string()))?;
+
+    Ok(Json(QueryResponse { entries, more }))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_query_params_parse() {
+        let params = QueryParams {
+            from: Some("2024-05-01T10:00:00Z".to_string()),
+            to: Some("1714557601000000000".to_string()),
+            level: Some("w".to_string()),
+            tag: Some("filtergateway, apiserver,".to_string()),
+            limit: Some(50_000),
+            ..Default::default()
+        };
+        let query = params.to_query().unwrap();
+        assert_eq!(query.from_ns, Some(1_714_557_600_000_000_000));
+        assert_eq!(query.to_ns, Some(1_714_557_601_000_000_000));
+        assert_eq!(query.min_level, Some(4));
+        assert_eq!(query.tags, vec!["filtergateway", "apiserver"]);
+        assert_eq!(query.limit, QUERY_LIMIT_MAX);
+
+        let bad = QueryParams {
+            from: Some("yesterday".to_string()),
+            ..Default::default()
+        };
+        assert!(bad.to_query().is_err());
+    }
+}
@@ -6,7 +6,7 @@
 use common::monitoringserver::ContainerInfo;
 use common::monitoringserver::NodeInfo;
 use serde::{Deserialize, Serialize};
-use std::collections::HashMap;
+use std::collections::{BTreeSet, HashMap, HashSet};
 use std::net::Ipv4Addr;
 use std::str::FromStr;
 
@@ -49,14 +49,93 @@ pub struct BoardInfo {
     pub last_updated: std::time::SystemTime,
 }
 
+/// Kind of entity persisted under `/piccolo/metrics/{kind}/{id}`
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+enum Entity {
+    Node,
+    Soc,
+    Board,
+    Container,
+}
+
+impl Entity {
+    fn resource_type(self) -> &'static str {
+        match self {
+            Entity::Node => "nodes",
+            Entity::Soc => "socs",
+            Entity::Board => "boards",
+            Entity::Container => "containers",
+        }
+    }
+}
+
+/// Entities changed or removed in memory since the last flush to etcd
+#[derive(Debug, Default)]
+struct DirtySet {
+    changed: HashSet<(Entity, String)>,
+    removed: HashSet<(Entity, String)>,
+}
+
+impl DirtySet {
+    fn mark_changed(&mut self, entity: Entity, id: &str) {
+        let key = (entity, id.to_string());
+        self.removed.remove(&key);
+        self.changed.insert(key);
+    }
+
+    fn mark_removed(&mut self, entity: Entity, id: &str) {
+        let key = (entity, id.to_string());
+        self.changed.remove(&key);
+        self.removed.insert(key);
+    }
+
+    fn len(&self) -> usize {
+        self.changed.len() + self.removed.len()
+    }
+
+    fn is_empty(&self) -> bool {
+        self.changed.is_empty() && self.removed.is_empty()
+    }
+}
+
+/// SoC and board a node was last aggregated into
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct NodeGroup {
+    soc_id: String,
+    board_id: String,
+}
+
+/// What a container list changed for one node
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct ContainerChanges {
+    pub added: usize,
+    pub updated: usize,
+    pub unchanged: usize,
+    pub removed: usize,
+}
+
 /// Data store for managing NodeInfo, SocInfo, and BoardInfo
+///
+/// Next to the entity maps the store keeps the relations between them
+/// (node → containers, node → SoC/board, board → SoCs) up to date on every
+/// change, so an update only touches the entities it concerns instead of
+/// scanning the whole fleet. Changed entities are collected and written to
+/// etcd together by [`DataStore::flush_dirty`].
 #[derive(Debug)]
 pub struct DataStore {
     pub nodes: HashMap<String, NodeInfo>,
     pub socs: HashMap<String, SocInfo>,
     pub boards: HashMap<String, BoardInfo>,
     pub containers: HashMap<String, ContainerInfo>,
-    pub container_node_mapping: HashMap<String, String>, // ADD THIS LINE
+    /// Container ID → name of the node running it
+    pub container_node_mapping: HashMap<String, String>,
+    /// Node name → IDs of its containers
+    node_containers: HashMap<String, HashSet<String>>,
+    /// Node name → SoC and board it belongs to
+    node_groups: HashMap<String, NodeGroup>,
+    /// Board ID → IDs of its SoCs
+    board_socs: HashMap<String, BTreeSet<String>>,
+    dirty: DirtySet,
 }
 
 impl Default for DataStore {
@@ -72,12 +151,32 @@ impl DataStore {
             socs: HashMap::new(),
             boards: HashMap::new(),
             containers: HashMap::new(),
-            container_node_mapping: HashMap::new(), // ADD THIS LINE
+            container_node_mapping: HashMap::new(),
+            node_containers: HashMap::new(),
+            node_groups: HashMap::new(),
+            board_socs: HashMap::new(),
+            dirty: DirtySet::default(),
         }
     }
 
     /// Stores NodeInfo and updates corresponding SocInfo and BoardInfo, then saves to etcd
     pub async fn store_node_info(&mut self, node_info: NodeInfo) -> Result<(), String> {
+        self.apply_node_info(node_info)?;
+
+        // etcd failures don't fail the entire operation; the entities stay
+        // dirty and are written with the next flush
+        if let Err(e) = self.flush_dirty().await {
+            eprintln!(
+                "[ETCD] Warning: Failed to store node metrics to etcd: {}",
+                e
+            );
+        }
+
+        Ok(())
+    }
+
+    /// Updates NodeInfo and its SoC and board in memory and marks them dirty
+    pub fn apply_node_info(&mut self, node_info: NodeInfo) -> Result<(), String> {
         let node_name = node_info.node_name.clone();
         let ip = node_info.ip.clone();
 
@@ -86,48 +185,58 @@ impl DataStore {
             Ipv4Addr::from_str(&ip).map_err(|_| format!("Invalid IP address format: {}", ip))?;
 
         // Generate IDs based on IP grouping rules
-        let soc_id = Self::generate_soc_id(&ip)?;
-        let board_id = Self::generate_board_id(&ip)?;
+        let group = NodeGroup {
+            soc_id: Self::generate_soc_id(&ip)?,
+            board_id: Self::generate_board_id(&ip)?,
+        };
+
+        // A node whose IP moved to another group leaves its old SoC and board
+        if let Some(old_group) = self.node_groups.get(&node_name).cloned() {
+            if old_group != group {
+                self.detach_node(&node_name, &old_group);
+            }
+        }
 
         // Store node and update aggregations
         self.nodes.insert(node_name.clone(), node_info.clone());
-        self.update_soc_info(soc_id.clone(), node_info.clone())?;
-        self.update_board_info(board_id.clone(), node_info.clone())?;
-
-        // Store to etcd with better error handling
-        let mut etcd_errors = Vec::new();
+        self.update_soc_info(group.soc_id.clone(), node_info.clone())?;
+        self.update_board_info(group.board_id.clone(), node_info)?;
 
-        if let Err(e) = crate::etcd_storage::store_node_info(&node_info).await {
-            let error_msg = format!("Failed to store NodeInfo to etcd: {}", e);
-            eprintln!("[ETCD] {}", error_msg);
-            etcd_errors.push(error_msg);
-        }
+        self.dirty.mark_changed(Entity::Node, &node_name);
+        self.dirty.mark_changed(Entity::Soc, &group.soc_id);
+        self.dirty.mark_changed(Entity::Board, &group.board_id);
+        self.node_groups.insert(node_name, group);
+        Ok(())
+    }
 
-        if let Some(soc_info) = self.socs.get(&soc_id) {
-            if let Err(e) = crate::etcd_storage::store_soc_info(soc_info).await {
-                let error_msg = format!("Failed to store SocInfo to etcd: {}", e);
-                eprintln!("[ETCD] {}", error_msg);
-                etcd_errors.push(error_msg);
+    /// Removes a node from the SoC and board of `group`, dropping them once empty
+    fn detach_node(&mut self, node_name: &str, group: &NodeGroup) {
+        if let Some(soc_info) = self.socs.get_mut(&group.soc_id) {
+            soc_info.nodes.retain(|n| n.node_name != node_name);
+            if soc_info.nodes.is_empty() {
+                self.socs.remove(&group.soc_id);
+                if let Some(socs) = self.board_socs.get_mut(&group.board_id) {
+                    socs.remove(&group.soc_id);
+                }
+                self.dirty.mark_removed(Entity::Soc, &group.soc_id);
+            } else {
+                soc_info.recalculate_totals();
+                self.dirty.mark_changed(Entity::Soc, &group.soc_id);
             }
         }
 
-        if let Some(board_info) = self.boards.get(&board_id) {
-            if let Err(e) = crate::etcd_storage::store_board_info(board_info).await {
-                let error_msg = format!("Failed to store BoardInfo to etcd: {}", e);
-                eprintln!("[ETCD] {}", error_msg);
-                etcd_errors.push(error_msg);
+        if let Some(board_info) = self.boards.get_mut(&group.board_id) {
+            board_info.nodes.retain(|n| n.node_name != node_name);
+            if board_info.nodes.is_empty() {
+                self.boards.remove(&group.board_id);
+                self.board_socs.remove(&group.board_id);
+                self.dirty.mark_removed(Entity::Board, &group.board_id);
+            } else {
+                board_info.recalculate_totals();
+                let _ = self.update_board_socs(&group.board_id);
+                self.dirty.mark_changed(Entity::Board, &group.board_id);
             }
         }
-
-        // Log warning if etcd operations failed but don't fail the entire operation
-        if !etcd_errors.is_empty() {
-            eprintln!(
-                "[ETCD] Warning: {} etcd operations failed",
-                etcd_errors.len()
-            );
-        }
-
-        Ok(())
     }
 
     /// Generates SoC ID: same first 3 octets + same tens place of last octet
@@ -170,6 +279,12 @@ impl DataStore {
             soc_info.update_with_node(node_info);
             soc_info.last_updated = current_time;
         } else {
+            // A SoC ID is an address inside its board's range
+            let board_id = Self::generate_board_id(&soc_id)?;
+            self.board_socs
+                .entry(board_id)
+                .or_default()
+                .insert(soc_id.clone());
             let soc_info = SocInfo::new(soc_id.clone(), node_info);
             self.socs.insert(soc_id, soc_info);
         }
@@ -195,21 +310,19 @@ impl DataStore {
         Ok(())
     }
 
-    /// Updates the SoCs list in a BoardInfo based on current SoCs
+    /// Updates the SoCs list in a BoardInfo from the SoCs indexed for that board
     fn update_board_socs(&mut self, board_id: &str) -> Result<(), String> {
         let board_socs: Vec<SocInfo> = self
-            .socs
-            .values()
-            .filter(|soc| {
-                // Directly use generate_board_id instead of separate function
-                if let Ok(soc_board_id) = Self::generate_board_id(&soc.soc_id) {
-                    soc_board_id == board_id
-                } else {
-                    false
-                }
+            .board_socs
+            .get(board_id)
+            .map(|soc_ids| {
+                soc_ids
+                    .iter()
+                    .filter_map(|soc_id| self.socs.get(soc_id))
+                    .cloned()
+                    .collect()
             })
-            .cloned()
-            .collect();
+            .unwrap_or_default();
 
         // Update the board's SoCs list
         if let Some(board_info) = self.boards.get_mut(board_id) {
@@ -227,11 +340,14 @@ impl DataStore {
         let container_id = container_info.id.clone();
 
         // Store container in memory
-        self.containers
-            .insert(container_id.clone(), container_info.clone());
+        if self.containers.get(&container_id) != Some(&container_info) {
+            self.containers
+                .insert(container_id.clone(), container_info.clone());
+            self.dirty.mark_changed(Entity::Container, &container_id);
+        }
 
         // Store to etcd with error handling
-        if let Err(e) = crate::etcd_storage::store_container_info(&container_info).await {
+        if let Err(e) = self.flush_dirty().await {
             eprintln!(
                 "[ETCD] Warning: Failed to store ContainerInfo to etcd: {}",
                 e
@@ -258,16 +374,10 @@ impl DataStore {
     ) -> Result<(), String> {
         let container_id = container_info.id.clone();
 
-        // Store container in memory
-        self.containers
-            .insert(container_id.clone(), container_info.clone());
-
-        // Store the node association
-        self.container_node_mapping
-            .insert(container_id.clone(), node_name.clone());
+        self.insert_container(container_info, &node_name);
 
         // Store to etcd
-        if let Err(e) = crate::etcd_storage::store_container_info(&container_info).await {
+        if let Err(e) = self.flush_dirty().await {
             eprintln!(
                 "[ETCD] Warning: Failed to store ContainerInfo to etcd: {}",
                 e
@@ -281,6 +391,168 @@ impl DataStore {
         Ok(())
     }
 
+    /// Stores a container of `node_name` in memory, marking it dirty if it changed
+    ///
+    /// # Returns
+    ///
+    /// * `Option<bool>` - `None` if the container is unchanged, otherwise
+    ///   whether it is new
+    pub fn insert_container(
+        &mut self,
+        container_info: ContainerInfo,
+        node_name: &str,
+    ) -> Option<bool> {
+        let container_id = container_info.id.clone();
+
+        // A container reported by another node moves to that node
+        let previous_node = self
+            .container_node_mapping
+            .insert(container_id.clone(), node_name.to_string());
+        if let Some(previous_node) = previous_node.as_deref() {
+            if previous_node != node_name {
+                self.unlink_container(previous_node, &container_id);
+            }
+        }
+        self.node_containers
+            .entry(node_name.to_string())
+            .or_default()
+            .insert(container_id.clone());
+
+        match self.containers.get(&container_id) {
+            Some(existing) if *existing == container_info => None,
+            existing => {
+                let is_new = existing.is_none();
+                self.containers.insert(container_id.clone(), container_info);
+                self.dirty.mark_changed(Entity::Container, &container_id);
+                Some(is_new)
+            }
+        }
+    }
+
+    /// Makes the containers of `node_name` exactly `containers`
+    ///
+    /// Containers the node no longer reports are removed; only new and
+    /// changed containers are marked dirty.
+    pub fn replace_node_containers(
+        &mut self,
+        node_name: &str,
+        containers: &[ContainerInfo],
+    ) -> ContainerChanges {
+        let current: HashSet<&str> = containers.iter().map(|c| c.id.as_str()).collect();
+        let mut changes = ContainerChanges {
+            removed: self.remove_node_containers_except(node_name, &current),
+            ..Default::default()
+        };
+
+        for container in containers {
+            match self.insert_container(container.clone(), node_name) {
+                Some(true) => changes.added += 1,
+                Some(false) => changes.updated += 1,
+                None => changes.unchanged += 1,
+            }
+        }
+        changes
+    }
+
+    /// Removes the containers of `node_name` whose ID is not in `keep`
+    fn remove_node_containers_except(&mut self, node_name: &str, keep: &HashSet<&str>) -> usize {
+        let obsolete: Vec<String> = self
+            .node_containers
+            .get(node_name)
+            .map(|ids| {
+                ids.iter()
+                    .filter(|id| !keep.contains(id.as_str()))
+                    .cloned()
+                    .collect()
+            })
+            .unwrap_or_default();
+
+        for container_id in &obsolete {
+            self.remove_container_entry(container_id);
+            println!(
+                "[DataStore] Removed obsolete container {} from node {}",
+                container_id, node_name
+            );
+        }
+        obsolete.len()
+    }
+
+    /// Removes a container and its node association from memory, marking it for deletion
+    fn remove_container_entry(&mut self, container_id: &str) {
+        self.containers.remove(container_id);
+        if let Some(node_name) = self.container_node_mapping.remove(container_id) {
+            self.unlink_container(&node_name, container_id);
+        }
+        self.dirty.mark_removed(Entity::Container, container_id);
+    }
+
+    fn unlink_container(&mut self, node_name: &str, container_id: &str) {
+        if let Some(ids) = self.node_containers.get_mut(node_name) {
+            ids.remove(container_id);
+            if ids.is_empty() {
+                self.node_containers.remove(node_name);
+            }
+        }
+    }
+
+    /// Writes every dirty entity to etcd in one batch
+    ///
+    /// If the write fails the entities stay dirty and are written with the
+    /// next flush.
+    ///
+    /// # Returns
+    ///
+    /// * `Result<usize, String>` - number of entries written
+    pub async fn flush_dirty(&mut self) -> Result<usize, String> {
+        if self.dirty.is_empty() {
+            return Ok(0);
+        }
+
+        let mut ops = Vec::with_capacity(self.dirty.len());
+        for (entity, id) in &self.dirty.changed {
+            let op = match entity {
+                Entity::Node => self
+                    .nodes
+                    .get(id)
+                    .map(|info| crate::etcd_storage::put_op(entity.resource_type(), id, info)),
+                Entity::Soc => self
+                    .socs
+                    .get(id)
+                    .map(|info| crate::etcd_storage::put_op(entity.resource_type(), id, info)),
+                Entity::Board => self
+                    .boards
+                    .get(id)
+                    .map(|info| crate::etcd_storage::put_op(entity.resource_type(), id, info)),
+                Entity::Container => self
+                    .containers
+                    .get(id)
+                    .map(crate::etcd_storage::container_put_op),
+            };
+            match op {
+                Some(Ok(op)) => ops.push(op),
+                Some(Err(e)) => {
+                    eprintln!("[ETCD] Skipping {} {}: {}", entity.resource_type(), id, e)
+                }
+                None => {}
+            }
+        }
+        for (entity, id) in &self.dirty.removed {
+            ops.push(crate::etcd_storage::delete_op(entity.resource_type(), id));
+        }
+
+        let count = ops.len();
+        crate::etcd_storage::write_ops(ops)
+            .await
+            .map_err(|e| e.to_string())?;
+        self.dirty = DirtySet::default();
+        Ok(count)
+    }
+
+    /// Number of entities waiting to be written to etcd
+    pub fn dirty_count(&self) -> usize {
+        self.dirty.len()
+    }
+
     /// Retrieves ContainerInfo from memory, fallback to etcd
     pub async fn get_container_info(&self, container_id: &str) -> Result<ContainerInfo, String> {
         // Try memory first
@@ -302,20 +574,49 @@ impl DataStore {
 
     /// Gets all containers for a specific node
     pub fn get_containers_by_node(&self, node_name: &str) -> Vec<&ContainerInfo> {
-        self.container_node_mapping
-            .iter()
-            .filter(|(_, mapped_node)| *mapped_node == node_name)
-            .filter_map(|(container_id, _)| self.containers.get(container_id))
-            .collect()
+        self.node_containers
+            .get(node_name)
+            .map(|ids| {
+                ids.iter()
+                    .filter_map(|container_id| self.containers.get(container_id))
+                    .collect()
+            })
+            .unwrap_or_default()
+    }
+
+    /// Gets all nodes aggregated into a specific SoC
+    pub fn get_nodes_by_soc(&self, soc_id: &str) -> Vec<&NodeInfo> {
+        self.socs
+            .get(soc_id)
+            .map(|soc| {
+                soc.nodes
+                    .iter()
+                    .filter_map(|n| self.nodes.get(&n.node_name))
+                    .collect()
+            })
+            .unwrap_or_default()
+    }
+
+    /// Gets all SoCs of a specific board
+    pub fn get_socs_by_board(&self, board_id: &str) -> Vec<&SocInfo> {
+        self.board_socs
+            .get(board_id)
+            .map(|soc_ids| {
+                soc_ids
+                    .iter()
+                    .filter_map(|soc_id| self.socs.get(soc_id))
+                    .collect()
+            })
+            .unwrap_or_default()
     }
 
     /// Removes container from memory and etcd
     pub async fn remove_container_info(&mut self, container_id: &str) -> Result<(), String> {
         // Remove from memory
-        self.containers.remove(container_id);
+        self.remove_container_entry(container_id);
 
         // Remove from etcd
-        if let Err(e) = crate::etcd_storage::delete_container_info(container_id).await {
+        if let Err(e) = self.flush_dirty().await {
             eprintln!(
                 "[ETCD] Warning: Failed to delete ContainerInfo from etcd: {}",
                 e
@@ -370,36 +671,21 @@ impl DataStore {
         &self.boards
     }
 
-    /// ADD THIS METHOD for cleanup with etcd deletion
+    /// Removes containers of a node that are not in `current_containers`, also from etcd
     pub async fn cleanup_node_containers(
         &mut self,
         node_name: &str,
         current_containers: &[String],
     ) {
-        let containers_to_remove: Vec<String> = self
-            .container_node_mapping
-            .iter()
-            .filter(|(_, mapped_node)| *mapped_node == node_name)
-            .filter(|(container_id, _)| !current_containers.contains(container_id))
-            .map(|(container_id, _)| container_id.clone())
-            .collect();
-
-        for container_id in containers_to_remove {
-            // Remove from memory
-            self.containers.remove(&container_id);
-            self.container_node_mapping.remove(&container_id);
-
-            // Remove from etcd
-            if let Err(e) = crate::etcd_storage::delete_container_info(&container_id).await {
-                eprintln!(
-                    "[ETCD] Warning: Failed to delete container {} from etcd: {}",
-                    container_id, e
-                );
-            }
+        let keep: HashSet<&str> = current_containers.iter().map(String::as_str).collect();
+        if self.remove_node_containers_except(node_name, &keep) == 0 {
+            return;
+        }
 
-            println!(
-                "[DataStore] Removed obsolete container {} from node {}",
-                container_id, node_name
+        if let Err(e) = self.flush_dirty().await {
+            eprintln!(
+                "[ETCD] Warning: Failed to delete containers of node {} from etcd: {}",
+                node_name, e
             );
         }
     }
@@ -728,9 +1014,7 @@ mod tests {
     fn test_get_containers_by_node() {
         let mut ds = DataStore::new();
         let container = sample_container("c1", "container1");
-        ds.containers.insert("c1".to_string(), container.clone());
-        ds.container_node_mapping
-            .insert("c1".to_string(), "node1".to_string());
+        ds.insert_container(container.clone(), "node1");
 
         let containers = ds.get_containers_by_node("node1");
         assert_eq!(containers.len(), 1);
@@ -810,8 +1094,8 @@ mod tests {
     fn test_update_board_socs() {
         let mut ds = DataStore::new();
         let node = sample_node("node1", "192.168.10.201");
-        let soc = SocInfo::new("192.168.10.200".to_string(), node.clone());
-        ds.socs.insert("192.168.10.200".to_string(), soc.clone());
+        ds.update_soc_info("192.168.10.200".to_string(), node.clone())
+            .unwrap();
         let board = BoardInfo::new("192.168.10.200".to_string(), node.clone());
         ds.boards
             .insert("192.168.10.200".to_string(), board.clone());
@@ -868,12 +1152,8 @@ mod tests {
         let mut ds = DataStore::new();
         let container1 = sample_container("c1", "container1");
         let container2 = sample_container("c2", "container2");
-        ds.containers.insert("c1".to_string(), container1.clone());
-        ds.containers.insert("c2".to_string(), container2.clone());
-        ds.container_node_mapping
-            .insert("c1".to_string(), "node1".to_string());
-        ds.container_node_mapping
-            .insert("c2".to_string(), "node1".to_string());
+        ds.insert_container(container1.clone(), "node1");
+        ds.insert_container(container2.clone(), "node1");
 
         // Only c1 should remain after cleanup
         let rt = tokio::runtime::Runtime::new().unwrap();
@@ -930,9 +1210,8 @@ mod tests {
         let node = sample_node("node1", "192.168.10.201");
         let soc_id = "192.168.10.200".to_string();
         let board_id = "192.168.10.200".to_string();
-        let soc = SocInfo::new(soc_id.clone(), node.clone());
         let board = BoardInfo::new(board_id.clone(), node.clone());
-        ds.socs.insert(soc_id.clone(), soc);
+        ds.update_soc_info(soc_id.clone(), node.clone()).unwrap();
         ds.boards.insert(board_id.clone(), board);
 
         assert!(ds.update_board_socs(&board_id).is_ok());
@@ -1002,9 +1281,7 @@ mod tests {
 
         // Non-empty
         let container = sample_container("c1", "container1");
-        ds.containers.insert("c1".to_string(), container.clone());
-        ds.container_node_mapping
-            .insert("c1".to_string(), "node1".to_string());
+        ds.insert_container(container.clone(), "node1");
         let containers = ds.get_containers_by_node("node1");
         assert_eq!(containers.len(), 1);
         assert_eq!(containers[0].id, "c1");
@@ -1015,12 +1292,8 @@ mod tests {
         let mut ds = DataStore::new();
         let container1 = sample_container("c1", "container1");
         let container2 = sample_container("c2", "container2");
-        ds.containers.insert("c1".to_string(), container1.clone());
-        ds.containers.insert("c2".to_string(), container2.clone());
-        ds.container_node_mapping
-            .insert("c1".to_string(), "node1".to_string());
-        ds.container_node_mapping
-            .insert("c2".to_string(), "node1".to_string());
+        ds.insert_container(container1.clone(), "node1");
+        ds.insert_container(container2.clone(), "node1");
 
         let rt = tokio::runtime::Runtime::new().unwrap();
         rt.block_on(ds.cleanup_node_containers("node1", &vec!["c1".to_string()]));
@@ -1097,9 +1370,8 @@ mod tests {
         let node = sample_node("node1", "192.168.10.201");
         let soc_id = "192.168.10.200".to_string();
         let board_id = "192.168.10.200".to_string();
-        let soc = SocInfo::new(soc_id.clone(), node.clone());
         let board = BoardInfo::new(board_id.clone(), node.clone());
-        ds.socs.insert(soc_id.clone(), soc);
+        ds.update_soc_info(soc_id.clone(), node.clone()).unwrap();
         ds.boards.insert(board_id.clone(), board);
 
         assert!(ds.update_board_socs(&board_id).is_ok());
@@ -1194,4 +1466,90 @@ mod tests {
         board.recalculate_totals();
         assert_eq!(board.total_cpu_usage, 50.0);
     }
+
+    #[test]
+    fn test_replace_node_containers_tracks_changes() {
+        let mut ds = DataStore::new();
+        let c1 = sample_container("c1", "container1");
+        let c2 = sample_container("c2", "container2");
+
+        let changes = ds.replace_node_containers("node1", &[c1.clone(), c2.clone()]);
+        assert_eq!((changes.added, changes.updated, changes.removed), (2, 0, 0));
+        assert_eq!(ds.dirty_count(), 2);
+
+        // Unchanged containers are not written again
+        ds.dirty = DirtySet::default();
+        let mut c1_updated = c1.clone();
+        c1_updated.image = "newimg".to_string();
+        let changes = ds.replace_node_containers("node1", &[c1_updated]);
+        assert_eq!(
+            changes,
+            ContainerChanges {
+                added: 0,
+                updated: 1,
+                unchanged: 0,
+                removed: 1,
+            }
+        );
+        assert_eq!(ds.get_containers_by_node("node1").len(), 1);
+        assert!(!ds.containers.contains_key("c2"));
+        assert!(ds
+            .dirty
+            .removed
+            .contains(&(Entity::Container, "c2".to_string())));
+        assert_eq!(ds.dirty_count(), 2);
+
+        // A container reported by another node moves there
+        ds.replace_node_containers("node2", &[c1]);
+        assert!(ds.get_containers_by_node("node1").is_empty());
+        assert_eq!(ds.get_containers_by_node("node2").len(), 1);
+        assert_eq!(ds.container_node_mapping.get("c1").unwrap(), "node2");
+    }
+
+    #[test]
+    fn test_apply_node_info_maintains_group_indexes() {
+        let mut ds = DataStore::new();
+        ds.apply_node_info(sample_node("node1", "192.168.10.201"))
+            .unwrap();
+        ds.apply_node_info(sample_node("node2", "192.168.10.212"))
+            .unwrap();
+
+        let board_socs: Vec<&str> = ds
+            .get_socs_by_board("192.168.10.200")
+            .iter()
+            .map(|soc| soc.soc_id.as_str())
+            .collect();
+        assert_eq!(board_socs, vec!["192.168.10.200", "192.168.10.210"]);
+        assert_eq!(ds.boards["192.168.10.200"].socs.len(), 2);
+        assert_eq!(ds.get_nodes_by_soc("192.168.10.210").len(), 1);
+        // Node, SoC and board of each update
+        assert_eq!(ds.dirty_count(), 5);
+
+        // node2 moves into node1's SoC; its old SoC is dropped
+        ds.apply_node_info(sample_node("node2", "192.168.10.203"))
+            .unwrap();
+        assert!(!ds.socs.contains_key("192.168.10.210"));
+        assert_eq!(ds.get_nodes_by_soc("192.168.10.200").len(), 2);
+        assert_eq!(ds.get_socs_by_board("192.168.10.200").len(), 1);
+        assert_eq!(ds.boards["192.168.10.200"].nodes.len(), 2);
+        assert!(ds
+            .dirty
+            .removed
+            .contains(&(Entity::Soc, "192.168.10.210".to_string())));
+    }
+
+    #[tokio::test]
+    async fn test_flush_dirty_keeps_entities_on_failure() {
+        let mut ds = DataStore::new();
+        ds.insert_container(sample_container("flush-c1", "container1"), "node1");
+
+        match ds.flush_dirty().await {
+            Ok(written) => {
+                assert_eq!(written, 1);
+                assert_eq!(ds.dirty_count(), 0);
+            }
+            // Without a reachable RocksDB service the container stays dirty
+            Err(_) => assert_eq!(ds.dirty_count(), 1),
+        }
+    }
 }
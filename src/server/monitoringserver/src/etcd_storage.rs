@@ -6,17 +6,23 @@
 //! Store and retrieve monitoring data in etcd
 
 use crate::data_structures::{BoardInfo, SocInfo};
+use common::etcd::BatchOp;
 use common::monitoringserver::{ContainerInfo, NodeInfo}; // Use protobuf types
 use serde::{de::DeserializeOwned, Serialize};
 use serde_json::Value;
 
+/// Key under which the metrics of a resource are stored
+fn metrics_key(resource_type: &str, resource_id: &str) -> String {
+    format!("/piccolo/metrics/{}/{}", resource_type, resource_id)
+}
+
 /// Generic function to store info in etcd
 async fn store_info<T: Serialize>(
     resource_type: &str,
     resource_id: &str,
     info: &T,
 ) -> common::Result<()> {
-    let key = format!("/piccolo/metrics/{}/{}", resource_type, resource_id);
+    let key = metrics_key(resource_type, resource_id);
     let json_data = serde_json::to_string(info)
         .map_err(|e| format!("Failed to serialize {}: {}", resource_type, e))?;
 
@@ -33,7 +39,7 @@ async fn get_info<T: DeserializeOwned>(
     resource_type: &str,
     resource_id: &str,
 ) -> common::Result<T> {
-    let key = format!("/piccolo/metrics/{}/{}", resource_type, resource_id);
+    let key = metrics_key(resource_type, resource_id);
     let json_data = common::etcd::get(&key).await?;
 
     let info: T = serde_json::from_str(&json_data)
@@ -44,7 +50,7 @@ async fn get_info<T: DeserializeOwned>(
 
 /// Generic function to delete info from etcd
 async fn delete_info(resource_type: &str, resource_id: &str) -> common::Result<()> {
-    let key = format!("/piccolo/metrics/{}/{}", resource_type, resource_id);
+    let key = metrics_key(resource_type, resource_id);
     common::etcd::delete(&key).await?;
     println!(
         "[ETCD] Deleted the metrics for {}: {}",
@@ -72,6 +78,58 @@ async fn get_all_info<T: DeserializeOwned>(resource_type: &str) -> common::Resul
     Ok(items)
 }
 
+/// Batch operation storing `info` under its metrics key
+pub fn put_op<T: Serialize>(
+    resource_type: &str,
+    resource_id: &str,
+    info: &T,
+) -> common::Result<BatchOp> {
+    let json_data = serde_json::to_string(info)
+        .map_err(|e| format!("Failed to serialize {}: {}", resource_type, e))?;
+    Ok(BatchOp::Put(
+        metrics_key(resource_type, resource_id),
+        json_data,
+    ))
+}
+
+/// Batch operation deleting the metrics of a resource
+pub fn delete_op(resource_type: &str, resource_id: &str) -> BatchOp {
+    BatchOp::Delete(metrics_key(resource_type, resource_id))
+}
+
+/// Applies operations built with [`put_op`] and [`delete_op`] in one write
+pub async fn write_ops(ops: Vec<BatchOp>) -> common::Result<()> {
+    if ops.is_empty() {
+        return Ok(());
+    }
+    let count = ops.len();
+    common::etcd::write_batch(ops).await?;
+    println!("[ETCD] Wrote {} metrics entries in one batch", count);
+    Ok(())
+}
+
+/// JSON layout of ContainerInfo read back by [`get_container_info`]
+fn container_json(container_info: &ContainerInfo) -> Value {
+    serde_json::json!({
+        "id": container_info.id,
+        "names": container_info.names,
+        "image": container_info.image,
+        "state": container_info.state,
+        "config": container_info.config,
+        "annotation": container_info.annotation,
+        "stats": container_info.stats,
+    })
+}
+
+/// Batch operation storing ContainerInfo
+pub fn container_put_op(container_info: &ContainerInfo) -> common::Result<BatchOp> {
+    put_op(
+        "containers",
+        &container_info.id,
+        &container_json(container_info),
+    )
+}
+
 // Public API functions using the generic implementations
 
 /// Store NodeInfo in etcd
@@ -92,17 +150,12 @@ pub async fn store_board_info(board_info: &BoardInfo) -> common::Result<()> {
 /// Store ContainerInfo in etcd - Using same pattern as others
 pub async fn store_container_info(container_info: &ContainerInfo) -> common::Result<()> {
     // Convert protobuf ContainerInfo to JSON for storage using the same pattern
-    let json_value = serde_json::json!({
-        "id": container_info.id,
-        "names": container_info.names,
-        "image": container_info.image,
-        "state": container_info.state,
-        "config": container_info.config,
-        "annotation": container_info.annotation,
-        "stats": container_info.stats,
-    });
-
-    store_info("containers", &container_info.id, &json_value).await
+    store_info(
+        "containers",
+        &container_info.id,
+        &container_json(container_info),
+    )
+    .await
 }
 
 /// Retrieve NodeInfo from etcd
@@ -275,22 +328,20 @@ pub async fn delete_all_containers() -> common::Result<()> {
         }
     };
 
-    let mut deleted_count = 0;
-    for (key, _) in kv_pairs {
-        if let Err(e) = common::etcd::delete(&key).await {
-            eprintln!(
-                "[ETCD] Warning: Failed to delete container key {}: {}",
-                key, e
-            );
-        } else {
-            deleted_count += 1;
-        }
+    let ops: Vec<BatchOp> = kv_pairs
+        .into_iter()
+        .map(|(key, _)| BatchOp::Delete(key))
+        .collect();
+    let count = ops.len();
+    if let Err(e) = common::etcd::write_batch(ops).await {
+        eprintln!(
+            "[ETCD] Warning: Failed to delete {} container keys: {}",
+            count, e
+        );
+        return Ok(());
     }
 
-    println!(
-        "[ETCD] Cleared {} containers from etcd on startup",
-        deleted_count
-    );
+    println!("[ETCD] Cleared {} containers from etcd on startup", count);
     Ok(())
 }
 
@@ -509,6 +560,31 @@ mod tests {
         assert!(del_result.is_ok() || del_result.is_err());
     }
 
+    #[test]
+    fn test_batch_ops_use_metrics_keys() {
+        let node = sample_node("node1", "192.168.10.201");
+        match put_op("nodes", "node1", &node).unwrap() {
+            BatchOp::Put(key, value) => {
+                assert_eq!(key, "/piccolo/metrics/nodes/node1");
+                let stored: NodeInfo = serde_json::from_str(&value).unwrap();
+                assert_eq!(stored.ip, "192.168.10.201");
+            }
+            BatchOp::Delete(_) => panic!("expected a put"),
+        }
+        match container_put_op(&sample_container("c1", "container1")).unwrap() {
+            BatchOp::Put(key, value) => {
+                assert_eq!(key, "/piccolo/metrics/containers/c1");
+                let stored: Value = serde_json::from_str(&value).unwrap();
+                assert_eq!(stored["names"][0], "container1");
+            }
+            BatchOp::Delete(_) => panic!("expected a put"),
+        }
+        assert!(matches!(
+            delete_op("containers", "c1"),
+            BatchOp::Delete(key) if key == "/piccolo/metrics/containers/c1"
+        ));
+    }
+
     #[tokio::test]
     async fn test_get_all_info_generic() {
         let all_nodes: Result<Vec<NodeInfo>, _> = super::get_all_info("nodes").await;
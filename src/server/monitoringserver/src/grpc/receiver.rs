@@ -3,17 +3,25 @@
 * SPDX-License-Identifier: Apache-2.0
 */
 use common::monitoringserver::monitoring_server_connection_server::MonitoringServerConnection;
+use common::monitoringserver::telemetry::TelemetryDecoder;
 use common::monitoringserver::{
-    ContainerList, NodeInfo, SendContainerListResponse, SendNodeInfoResponse,
-    StressMonitoringMetric, StressMonitoringMetricResponse,
+    ContainerList, MetricPoint, MetricRangeRequest, MetricRangeResponse, MetricSeries, NodeInfo,
+    SendContainerListResponse, SendNodeInfoResponse, StreamTelemetryResponse,
+    StressMonitoringMetric, StressMonitoringMetricResponse, TelemetryFrame,
 };
+use std::sync::Arc;
 use tokio::sync::mpsc;
-use tonic::{Request, Response, Status};
+use tonic::{Request, Response, Status, Streaming};
 
 use serde::Deserialize;
 use serde_json;
 use std::fmt;
 
+use crate::timeseries::TimeSeriesStore;
+
+/// Most series returned by one QueryMetricRange call
+const MAX_QUERY_SERIES: usize = 256;
+
 /// JSON types for StressMonitoringMetric payload
 #[derive(Debug, Deserialize)]
 pub struct CpuLoad {
@@ -74,6 +82,8 @@ pub struct MonitoringServerReceiver {
     pub tx_container: mpsc::Sender<ContainerList>,
     pub tx_node: mpsc::Sender<NodeInfo>,
     pub tx_stress: mpsc::Sender<String>,
+    /// History of the received metrics, recorded by the manager
+    pub metrics: Arc<TimeSeriesStore>,
 }
 
 #[tonic::async_trait]
@@ -118,6 +128,90 @@ impl MonitoringServerConnection for MonitoringServerReceiver {
         }
     }
 
+    /// Handle the telemetry stream of a nodeagent
+    ///
+    /// Rebuilds the node's container view from the delta frames and forwards it to the
+    /// MonitoringServer manager like a ContainerList, but only for frames that changed it.
+    /// Node info is forwarded whenever a frame carries it.
+    async fn stream_telemetry<'life>(
+        &'life self,
+        request: Request<Streaming<TelemetryFrame>>,
+    ) -> Result<Response<StreamTelemetryResponse>, Status> {
+        let mut stream = request.into_inner();
+        let mut decoder = TelemetryDecoder::new();
+        let mut frames = 0;
+
+        while let Some(frame) = stream.message().await? {
+            decoder.apply(&frame).map_err(Status::invalid_argument)?;
+            frames += 1;
+
+            if frame.keyframe || !frame.containers.is_empty() || !frame.removed.is_empty() {
+                self.tx_container
+                    .send(decoder.container_list())
+                    .await
+                    .map_err(|e| {
+                        Status::unavailable(format!("cannot send container list: {}", e))
+                    })?;
+            }
+            if let Some(node) = frame.node {
+                self.tx_node
+                    .send(node)
+                    .await
+                    .map_err(|e| Status::unavailable(format!("cannot send node info: {}", e)))?;
+            }
+        }
+
+        Ok(Response::new(StreamTelemetryResponse { frames }))
+    }
+
+    /// Return the recorded history of the series matching the request's prefix
+    async fn query_metric_range<'life>(
+        &'life self,
+        request: Request<MetricRangeRequest>,
+    ) -> Result<Response<MetricRangeResponse>, Status> {
+        let req = request.into_inner();
+        let end_ms = if req.end_ms == 0 {
+            crate::timeseries::now_ms()
+        } else {
+            req.end_ms
+        };
+        if req.start_ms > end_ms {
+            return Err(Status::invalid_argument("start_ms is after end_ms"));
+        }
+
+        // One more than the limit tells whether the result was cut off
+        let mut series = self.metrics.query(
+            &req.prefix,
+            req.start_ms,
+            end_ms,
+            req.step_seconds as i64 * 1000,
+            MAX_QUERY_SERIES + 1,
+        );
+        let truncated = series.len() > MAX_QUERY_SERIES;
+        series.truncate(MAX_QUERY_SERIES);
+
+        Ok(Response::new(MetricRangeResponse {
+            series: series
+                .into_iter()
+                .map(|range| MetricSeries {
+                    name: range.name,
+                    step_seconds: (range.step_ms / 1000) as u32,
+                    points: range
+                        .points
+                        .into_iter()
+                        .map(|p| MetricPoint {
+                            timestamp_ms: p.timestamp_ms,
+                            avg: p.avg,
+                            min: p.min,
+                            max: p.max,
+                        })
+                        .collect(),
+                })
+                .collect(),
+            truncated,
+        }))
+    }
+
     /// Handle a StressMonitoringMetric message (single JSON string) from App Data Provider
     ///
     /// Parses the JSON payload to validate format, then forwards the original JSON string to the manager via channel.
@@ -202,6 +296,7 @@ mod tests {
             tx_container: tx,
             tx_node: dummy_tx_node,
             tx_stress: dummy_stress,
+            metrics: Arc::new(TimeSeriesStore::default()),
         };
         let req = Request::new(sample_container_list("node1"));
         let resp = receiver.send_container_list(req).await.unwrap();
@@ -222,6 +317,7 @@ mod tests {
             tx_container: tx,
             tx_node: dummy_tx,
             tx_stress: dummy_stress,
+            metrics: Arc::new(TimeSeriesStore::default()),
         };
         let req = Request::new(sample_container_list("node1"));
         let resp = receiver.send_container_list(req).await;
@@ -239,6 +335,7 @@ mod tests {
             tx_container: dummy_tx_container,
             tx_node: tx,
             tx_stress: dummy_stress,
+            metrics: Arc::new(TimeSeriesStore::default()),
         };
         let req = Request::new(sample_node("node1", "192.168.10.201"));
         let resp = receiver.send_node_info(req).await.unwrap();
@@ -259,6 +356,7 @@ mod tests {
             tx_container: dummy_tx,
             tx_node: tx,
             tx_stress: dummy_stress,
+            metrics: Arc::new(TimeSeriesStore::default()),
         };
         let req = Request::new(sample_node("node1", "192.168.10.201"));
         let resp = receiver.send_node_info(req).await;
@@ -276,6 +374,7 @@ mod tests {
             tx_container: dummy_tx_container,
             tx_node: dummy_tx_node,
             tx_stress: tx,
+            metrics: Arc::new(TimeSeriesStore::default()),
         };
         let req = Request::new(StressMonitoringMetric {
             json: sample_stress_json(),
@@ -300,7 +399,14 @@ mod tests {
         let (tx_stress, rx_stress) = mpsc::channel::<String>(8);
 
         // create and spawn the real manager (it will consume rx_stress and call etcd)
-        let mgr = manager::MonitoringServerManager::new(rx_container, rx_node, rx_stress).await;
+        let metrics = Arc::new(TimeSeriesStore::default());
+        let mgr = manager::MonitoringServerManager::new(
+            rx_container,
+            rx_node,
+            rx_stress,
+            Arc::clone(&metrics),
+        )
+        .await;
         let mgr_handle = tokio::spawn(async move {
             // run will spawn internal tasks and block until channels are closed
             let _ = mgr.run().await;
@@ -311,6 +417,7 @@ mod tests {
             tx_container: tx_container.clone(),
             tx_node: tx_node.clone(),
             tx_stress: tx_stress.clone(),
+            metrics,
         };
 
         // send the stress metric via gRPC handler (synchronous call)
@@ -353,4 +460,43 @@ mod tests {
         // give manager a moment to finish
         let _ = tokio::time::timeout(Duration::from_secs(1), mgr_handle).await;
     }
+
+    #[tokio::test]
+    async fn test_query_metric_range() {
+        let metrics = Arc::new(TimeSeriesStore::default());
+        let now = crate::timeseries::now_ms();
+        metrics.record_node(&sample_node("node1", "192.168.10.201"), now);
+        let receiver = MonitoringServerReceiver {
+            tx_container: mpsc::channel::<ContainerList>(1).0,
+            tx_node: mpsc::channel::<NodeInfo>(1).0,
+            tx_stress: mpsc::channel::<String>(1).0,
+            metrics,
+        };
+
+        let resp = receiver
+            .query_metric_range(Request::new(MetricRangeRequest {
+                prefix: "node/node1/cpu_usage".to_string(),
+                start_ms: now - 60_000,
+                end_ms: 0,
+                step_seconds: 0,
+            }))
+            .await
+            .unwrap()
+            .into_inner();
+        assert!(!resp.truncated);
+        assert_eq!(resp.series.len(), 1);
+        assert_eq!(resp.series[0].step_seconds, 1);
+        assert_eq!(resp.series[0].points[0].avg, 42.0);
+
+        let err = receiver
+            .query_metric_range(Request::new(MetricRangeRequest {
+                prefix: String::new(),
+                start_ms: now,
+                end_ms: now - 1,
+                step_seconds: 0,
+            }))
+            .await
+            .unwrap_err();
+        assert_eq!(err.code(), Code::InvalidArgument);
+    }
 }
@@ -12,10 +12,13 @@ pub mod data_structures;
 pub mod etcd_storage;
 pub mod grpc;
 pub mod manager;
+pub mod timeseries;
 
 use common::logd;
 use common::logd::logger;
 use common::monitoringserver::monitoring_server_connection_server::MonitoringServerConnectionServer;
+use std::sync::Arc;
+use timeseries::TimeSeriesStore;
 use tokio::sync::mpsc::{channel, Receiver, Sender};
 
 /// Launches the MonitoringServerManager in an asynchronous task.
@@ -26,8 +29,10 @@ async fn launch_manager(
     rx_container: Receiver<ContainerList>,
     rx_node: Receiver<NodeInfo>,
     rx_stress: Receiver<String>,
+    metrics: Arc<TimeSeriesStore>,
 ) {
-    let mut manager = manager::MonitoringServerManager::new(rx_container, rx_node, rx_stress).await;
+    let mut manager =
+        manager::MonitoringServerManager::new(rx_container, rx_node, rx_stress, metrics).await;
 
     match manager.initialize().await {
         Ok(_) => {
@@ -49,6 +54,7 @@ async fn initialize(
     tx_container: Sender<ContainerList>,
     tx_node: Sender<NodeInfo>,
     tx_stress: Sender<String>,
+    metrics: Arc<TimeSeriesStore>,
 ) {
     use tonic::transport::Server;
 
@@ -56,6 +62,7 @@ async fn initialize(
         tx_container,
         tx_node,
         tx_stress,
+        metrics,
     };
 
     let addr = common::monitoringserver::open_server()
@@ -83,8 +90,11 @@ async fn main() {
     // Add stress channel and a simple consumer
     let (tx_stress, rx_stress) = channel::<String>(16);
 
-    let mgr = launch_manager(rx_container, rx_node, rx_stress);
-    let grpc = initialize(tx_container, tx_node, tx_stress);
+    // Metric history written by the manager and queried through gRPC
+    let metrics = Arc::new(TimeSeriesStore::default());
+
+    let mgr = launch_manager(rx_container, rx_node, rx_stress, Arc::clone(&metrics));
+    let grpc = initialize(tx_container, tx_node, tx_stress, metrics);
 
     tokio::join!(mgr, grpc);
 }
@@ -100,7 +110,11 @@ mod tests {
         let (_tx_n, rx_n) = tokio::sync::mpsc::channel(1);
         let (_tx_s, rx_s) = tokio::sync::mpsc::channel::<String>(1);
         // Use a timeout to ensure the test does not hang
-        let _result = timeout(Duration::from_secs(2), launch_manager(rx_c, rx_n, rx_s)).await;
+        let _result = timeout(
+            Duration::from_secs(2),
+            launch_manager(rx_c, rx_n, rx_s, Arc::default()),
+        )
+        .await;
         //assert!(result.is_ok(), "launch_manager did not complete in time");
     }
 
@@ -112,7 +126,11 @@ mod tests {
         // Spawn initialize in a background task and cancel after a short delay
         let handle = tokio::spawn(async move {
             // Use a short timeout to avoid hanging on .serve()
-            let _ = timeout(Duration::from_millis(500), initialize(tx_c, tx_n, tx_s)).await;
+            let _ = timeout(
+                Duration::from_millis(500),
+                initialize(tx_c, tx_n, tx_s, Arc::default()),
+            )
+            .await;
         });
 
         // Wait for the task to finish or timeout
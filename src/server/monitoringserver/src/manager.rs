@@ -8,6 +8,7 @@
 //! a gRPC sender for communicating with the nodeagent or other services.
 //! It is designed to be thread-safe and run in an async context.
 use crate::data_structures::{BoardInfo, DataStore, SocInfo};
+use crate::timeseries::TimeSeriesStore;
 use common::monitoringserver::{ContainerList, NodeInfo}; // Use protobuf types
 use common::Result;
 use std::str::FromStr;
@@ -26,6 +27,8 @@ pub struct MonitoringServerManager {
     rx_stress: Arc<Mutex<mpsc::Receiver<String>>>,
     /// Data store for managing NodeInfo, SocInfo, and BoardInfo
     data_store: Arc<Mutex<DataStore>>,
+    /// History of the received metrics, shared with the gRPC receiver
+    metrics: Arc<TimeSeriesStore>,
 }
 
 impl MonitoringServerManager {
@@ -34,12 +37,14 @@ impl MonitoringServerManager {
         rx_container: mpsc::Receiver<ContainerList>,
         rx_node: mpsc::Receiver<NodeInfo>,
         rx_stress: mpsc::Receiver<String>,
+        metrics: Arc<TimeSeriesStore>,
     ) -> Self {
         Self {
             rx_container: Arc::new(Mutex::new(rx_container)),
             rx_node: Arc::new(Mutex::new(rx_node)),
             rx_stress: Arc::new(Mutex::new(rx_stress)),
             data_store: Arc::new(Mutex::new(DataStore::new())),
+            metrics,
         }
     }
 
@@ -68,35 +73,31 @@ impl MonitoringServerManager {
             container_list.containers.len()
         );
 
-        let current_container_ids: Vec<String> = container_list
-            .containers
-            .iter()
-            .map(|c| c.id.clone())
-            .collect();
+        let now_ms = crate::timeseries::now_ms();
+        for container in &container_list.containers {
+            self.metrics.record_container(container, now_ms);
+        }
 
-        let mut data_store = self.data_store.lock().await;
+        {
+            let mut data_store = self.data_store.lock().await;
 
-        // Clean up containers that are no longer present on this node
-        data_store
-            .cleanup_node_containers(&container_list.node_name, &current_container_ids)
-            .await;
+            // Only containers that appeared, changed or disappeared are written
+            let changes = data_store
+                .replace_node_containers(&container_list.node_name, &container_list.containers);
+            println!(
+                "[MonitoringServer] Node {}: {} added, {} updated, {} removed, {} unchanged",
+                container_list.node_name,
+                changes.added,
+                changes.updated,
+                changes.removed,
+                changes.unchanged
+            );
 
-        // Store current containers with node association
-        for container in &container_list.containers {
-            match data_store
-                .store_container_info_with_node(container.clone(), container_list.node_name.clone())
-                .await
-            {
-                Ok(_) => {
-                    println!(
-                        "[MonitoringServer] SUCCESS: Stored container {} on node {}",
-                        container.id, container_list.node_name
-                    );
-                }
-                Err(e) => eprintln!(
-                    "[MonitoringServer] ERROR: Failed to store container {}: {}",
-                    container.id, e
-                ),
+            if let Err(e) = data_store.flush_dirty().await {
+                eprintln!(
+                    "[MonitoringServer] ERROR: Failed to store containers of node {}: {}",
+                    container_list.node_name, e
+                );
             }
         }
 
@@ -265,6 +266,8 @@ impl MonitoringServerManager {
     async fn handle_node_info(&self, node_info: NodeInfo) {
         // Print detailed NodeInfo first
         self.print_node_info(&node_info);
+        self.metrics
+            .record_node(&node_info, crate::timeseries::now_ms());
 
         // Store NodeInfo and update SocInfo/BoardInfo with etcd storage
         {
@@ -844,7 +847,7 @@ mod tests {
         let (_tx_c, rx_c) = mpsc::channel(1);
         let (_tx_n, rx_n) = mpsc::channel(1);
         let (_tx_s, rx_s) = mpsc::channel::<String>(1);
-        MonitoringServerManager::new(rx_c, rx_n, rx_s).await
+        MonitoringServerManager::new(rx_c, rx_n, rx_s, Arc::new(TimeSeriesStore::default())).await
     }
 
     fn sample_node(name: &str, ip: &str) -> NodeInfo {
@@ -933,9 +936,7 @@ mod tests {
             let node = sample_node("node1", "192.168.10.201");
             ds.nodes.insert("node1".to_string(), node);
             let container = sample_container("c1", "cont1", "running");
-            ds.containers.insert("c1".to_string(), container);
-            ds.container_node_mapping
-                .insert("c1".to_string(), "node1".to_string());
+            ds.insert_container(container, "node1");
         }
         mgr.print_all_nodes().await;
         mgr.print_all_containers().await;
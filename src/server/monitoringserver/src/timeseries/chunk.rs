@@ -0,0 +1,360 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Compressed columnar chunks of rollup points
+//!
+//! A chunk stores its timestamps and each value column in a separate bit
+//! stream. Timestamps are encoded as delta-of-delta, values as the XOR with
+//! the previous value of the same column (Gorilla encoding). Points of a
+//! rollup tier are evenly spaced and metrics change slowly, so most
+//! timestamps take one bit and most values a few bits.
+
+use super::Point;
+
+/// Append-only bit stream, most significant bit first
+#[derive(Debug, Default, Clone)]
+struct BitWriter {
+    bytes: Vec<u8>,
+    bit_len: usize,
+}
+
+impl BitWriter {
+    fn write_bit(&mut self, bit: bool) {
+        if self.bit_len % 8 == 0 {
+            self.bytes.push(0);
+        }
+        if bit {
+            let last = self.bytes.len() - 1;
+            self.bytes[last] |= 0x80 >> (self.bit_len % 8);
+        }
+        self.bit_len += 1;
+    }
+
+    /// Write the lowest `count` bits of `value`
+    fn write_bits(&mut self, value: u64, count: u32) {
+        for shift in (0..count).rev() {
+            self.write_bit((value >> shift) & 1 == 1);
+        }
+    }
+
+    fn reader(&self) -> BitReader<'_> {
+        BitReader {
+            bytes: &self.bytes,
+            bit_len: self.bit_len,
+            pos: 0,
+        }
+    }
+}
+
+struct BitReader<'a> {
+    bytes: &'a [u8],
+    bit_len: usize,
+    pos: usize,
+}
+
+impl BitReader<'_> {
+    fn read_bit(&mut self) -> Option<bool> {
+        if self.pos >= self.bit_len {
+            return None;
+        }
+        let bit = self.bytes[self.pos / 8] & (0x80 >> (self.pos % 8)) != 0;
+        self.pos += 1;
+        Some(bit)
+    }
+
+    fn read_bits(&mut self, count: u32) -> Option<u64> {
+        let mut value = 0u64;
+        for _ in 0..count {
+            value = (value << 1) | self.read_bit()? as u64;
+        }
+        Some(value)
+    }
+}
+
+fn zigzag(n: i64) -> u64 {
+    ((n << 1) ^ (n >> 63)) as u64
+}
+
+fn unzigzag(z: u64) -> i64 {
+    (z >> 1) as i64 ^ -((z & 1) as i64)
+}
+
+/// Delta-of-delta ranges: control bit prefix length and payload width
+const DOD_CLASSES: [(u32, u32); 3] = [(2, 7), (3, 9), (4, 12)];
+
+#[derive(Debug, Default, Clone)]
+struct TimestampColumn {
+    bits: BitWriter,
+    prev: i64,
+    prev_delta: i64,
+}
+
+impl TimestampColumn {
+    fn push(&mut self, timestamp_ms: i64, first: bool) {
+        if first {
+            self.bits.write_bits(timestamp_ms as u64, 64);
+        } else {
+            let delta = timestamp_ms.wrapping_sub(self.prev);
+            let dod = zigzag(delta.wrapping_sub(self.prev_delta));
+            if dod == 0 {
+                self.bits.write_bit(false);
+            } else if let Some(&(prefix, width)) =
+                DOD_CLASSES.iter().find(|(_, width)| dod < 1u64 << *width)
+            {
+                // `prefix - 1` ones followed by a zero
+                self.bits.write_bits((1 << prefix) - 2, prefix);
+                self.bits.write_bits(dod, width);
+            } else {
+                self.bits.write_bits(0b1111, 4);
+                self.bits.write_bits(dod, 64);
+            }
+            self.prev_delta = delta;
+        }
+        self.prev = timestamp_ms;
+    }
+}
+
+#[derive(Debug, Default, Clone)]
+struct ValueColumn {
+    bits: BitWriter,
+    prev: u64,
+    /// Leading and trailing zeros of the last stored XOR window
+    window: Option<(u32, u32)>,
+}
+
+impl ValueColumn {
+    fn push(&mut self, value: f64, first: bool) {
+        let bits = value.to_bits();
+        if first {
+            self.bits.write_bits(bits, 64);
+            self.prev = bits;
+            return;
+        }
+
+        let xor = bits ^ self.prev;
+        self.prev = bits;
+        if xor == 0 {
+            self.bits.write_bit(false);
+            return;
+        }
+        self.bits.write_bit(true);
+
+        // The leading zero count is stored in 5 bits
+        let leading = xor.leading_zeros().min(31);
+        let trailing = xor.trailing_zeros();
+        match self.window {
+            Some((prev_leading, prev_trailing))
+                if leading >= prev_leading && trailing >= prev_trailing =>
+            {
+                // Meaningful bits fit in the previous window
+                self.bits.write_bit(false);
+                self.bits
+                    .write_bits(xor >> prev_trailing, 64 - prev_leading - prev_trailing);
+            }
+            _ => {
+                let meaningful = 64 - leading - trailing;
+                self.bits.write_bit(true);
+                self.bits.write_bits(leading as u64, 5);
+                self.bits.write_bits((meaningful - 1) as u64, 6);
+                self.bits.write_bits(xor >> trailing, meaningful);
+                self.window = Some((leading, trailing));
+            }
+        }
+    }
+}
+
+fn decode_timestamps(bits: &BitWriter, len: usize) -> Option<Vec<i64>> {
+    let mut reader = bits.reader();
+    let mut timestamps = Vec::with_capacity(len);
+    let (mut prev, mut prev_delta) = (0i64, 0i64);
+    for i in 0..len {
+        if i == 0 {
+            prev = reader.read_bits(64)? as i64;
+        } else {
+            let mut ones = 0;
+            while ones < 4 && reader.read_bit()? {
+                ones += 1;
+            }
+            let dod = match ones {
+                0 => 0,
+                4 => reader.read_bits(64)?,
+                n => reader.read_bits(DOD_CLASSES[n - 1].1)?,
+            };
+            prev_delta = prev_delta.wrapping_add(unzigzag(dod));
+            prev = prev.wrapping_add(prev_delta);
+        }
+        timestamps.push(prev);
+    }
+    Some(timestamps)
+}
+
+fn decode_values(bits: &BitWriter, len: usize) -> Option<Vec<f64>> {
+    let mut reader = bits.reader();
+    let mut values = Vec::with_capacity(len);
+    let mut prev = 0u64;
+    let (mut leading, mut trailing) = (0u32, 0u32);
+    for i in 0..len {
+        if i == 0 {
+            prev = reader.read_bits(64)?;
+        } else if reader.read_bit()? {
+            if reader.read_bit()? {
+                leading = reader.read_bits(5)? as u32;
+                let meaningful = reader.read_bits(6)? as u32 + 1;
+                trailing = 64 - leading - meaningful;
+            }
+            let xor = reader.read_bits(64 - leading - trailing)? << trailing;
+            prev ^= xor;
+        }
+        values.push(f64::from_bits(prev));
+    }
+    Some(values)
+}
+
+/// Compressed run of consecutive points
+#[derive(Debug, Default, Clone)]
+pub struct Chunk {
+    timestamps: TimestampColumn,
+    avg: ValueColumn,
+    min: ValueColumn,
+    max: ValueColumn,
+    len: usize,
+}
+
+impl Chunk {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Timestamp of the first point, `None` while empty
+    pub fn first_timestamp(&self) -> Option<i64> {
+        if self.is_empty() {
+            return None;
+        }
+        decode_timestamps(&self.timestamps.bits, 1).and_then(|t| t.first().copied())
+    }
+
+    /// Timestamp of the last point, `None` while empty
+    pub fn last_timestamp(&self) -> Option<i64> {
+        (!self.is_empty()).then_some(self.timestamps.prev)
+    }
+
+    /// Append a point; timestamps must not decrease
+    pub fn push(&mut self, point: Point) {
+        let first = self.len == 0;
+        self.timestamps.push(point.timestamp_ms, first);
+        self.avg.push(point.avg, first);
+        self.min.push(point.min, first);
+        self.max.push(point.max, first);
+        self.len += 1;
+    }
+
+    /// Release the spare capacity of a chunk that will not grow anymore
+    pub fn seal(&mut self) {
+        for bits in [
+            &mut self.timestamps.bits,
+            &mut self.avg.bits,
+            &mut self.min.bits,
+            &mut self.max.bits,
+        ] {
+            bits.bytes.shrink_to_fit();
+        }
+    }
+
+    /// Decode all points
+    pub fn points(&self) -> Vec<Point> {
+        let decoded = (|| {
+            let timestamps = decode_timestamps(&self.timestamps.bits, self.len)?;
+            let avg = decode_values(&self.avg.bits, self.len)?;
+            let min = decode_values(&self.min.bits, self.len)?;
+            let max = decode_values(&self.max.bits, self.len)?;
+            Some(
+                (0..self.len)
+                    .map(|i| Point {
+                        timestamp_ms: timestamps[i],
+                        avg: avg[i],
+                        min: min[i],
+                        max: max[i],
+                    })
+                    .collect(),
+            )
+        })();
+        // The streams are only written by push, so decoding cannot run short
+        decoded.unwrap_or_default()
+    }
+
+    /// Bytes held by the compressed streams
+    pub fn size_bytes(&self) -> usize {
+        self.timestamps.bits.bytes.capacity()
+            + self.avg.bits.bytes.capacity()
+            + self.min.bits.bytes.capacity()
+            + self.max.bits.bytes.capacity()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn point(timestamp_ms: i64, value: f64) -> Point {
+        Point {
+            timestamp_ms,
+            avg: value,
+            min: value - 1.0,
+            max: value + 1.0,
+        }
+    }
+
+    #[test]
+    fn test_round_trip_irregular_points() {
+        let points: Vec<Point> = [
+            (1_700_000_000_000, 12.5),
+            (1_700_000_001_000, 12.5),
+            (1_700_000_002_000, 13.25),
+            (1_700_000_002_001, -4.0),
+            (1_700_000_090_000, f64::MAX),
+            (1_700_000_090_000, 0.0),
+            (1_800_000_000_000, 1e-300),
+        ]
+        .iter()
+        .map(|&(t, v)| point(t, v))
+        .collect();
+
+        let mut chunk = Chunk::new();
+        for p in &points {
+            chunk.push(*p);
+        }
+        assert_eq!(chunk.points(), points);
+        assert_eq!(chunk.first_timestamp(), Some(1_700_000_000_000));
+        assert_eq!(chunk.last_timestamp(), Some(1_800_000_000_000));
+    }
+
+    #[test]
+    fn test_regular_points_compress() {
+        let mut chunk = Chunk::new();
+        for i in 0..120 {
+            chunk.push(point(1_700_000_000_000 + i * 10_000, 40.0 + (i % 3) as f64));
+        }
+        chunk.seal();
+        // 120 uncompressed points take 120 * 32 bytes
+        assert!(chunk.size_bytes() < 120 * 32 / 4, "{}", chunk.size_bytes());
+        assert_eq!(chunk.points().len(), 120);
+        assert_eq!(chunk.points()[119].avg, 40.0 + (119 % 3) as f64);
+    }
+
+    #[test]
+    fn test_zigzag_round_trip() {
+        for n in [0, 1, -1, 63, -64, i64::MAX, i64::MIN] {
+            assert_eq!(unzigzag(zigzag(n)), n);
+        }
+    }
+}
@@ -0,0 +1,483 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! In-memory metric history with bounded memory
+//!
+//! Every numeric field of the received NodeInfo and ContainerInfo is recorded
+//! as a series named `node/{node_name}/{field}` or
+//! `container/{container_id}/{stats key}`. Instead of raw samples each series
+//! keeps rollups of fixed resolution (see [`TIERS`]); a rollup point holds the
+//! average, minimum and maximum of the samples within its step.
+//!
+//! Each tier is a ring of compressed [`chunk::Chunk`]s: once it holds its
+//! configured number of points the oldest chunk is dropped, so the memory of
+//! a series does not grow with uptime. The number of series is capped as
+//! well, and series that stopped receiving samples are evicted.
+//!
+//! History is never written to etcd; only the latest values are.
+
+pub mod chunk;
+
+use chunk::Chunk;
+use common::monitoringserver::{ContainerInfo, NodeInfo};
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// Points per compressed chunk
+pub const CHUNK_POINTS: usize = 120;
+/// Default upper bound of the number of series
+pub const DEFAULT_MAX_SERIES: usize = 4096;
+
+/// Resolution of one rollup tier and the number of points it keeps
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Tier {
+    pub step_ms: i64,
+    pub points: usize,
+}
+
+/// 15 minutes at 1 s, 2 hours at 10 s and 24 hours at 1 min
+pub const TIERS: [Tier; 3] = [
+    Tier {
+        step_ms: 1_000,
+        points: 900,
+    },
+    Tier {
+        step_ms: 10_000,
+        points: 720,
+    },
+    Tier {
+        step_ms: 60_000,
+        points: 1_440,
+    },
+];
+
+/// Aggregate of the samples in `[timestamp_ms, timestamp_ms + step)`
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Point {
+    pub timestamp_ms: i64,
+    pub avg: f64,
+    pub min: f64,
+    pub max: f64,
+}
+
+/// Points of one series returned by [`TimeSeriesStore::query`]
+#[derive(Debug, Clone, PartialEq)]
+pub struct SeriesRange {
+    pub name: String,
+    pub step_ms: i64,
+    pub points: Vec<Point>,
+}
+
+/// Point-in-time copy of the store's counters
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct StoreStats {
+    pub series: usize,
+    /// Bytes held by compressed chunks
+    pub chunk_bytes: usize,
+    pub samples: u64,
+    /// Samples refused because the series limit was reached
+    pub dropped_samples: u64,
+    pub evicted_series: u64,
+}
+
+/// Samples of the step currently being filled
+#[derive(Debug, Clone, Copy)]
+struct Bucket {
+    start_ms: i64,
+    sum: f64,
+    count: u32,
+    min: f64,
+    max: f64,
+}
+
+impl Bucket {
+    fn new(start_ms: i64, value: f64) -> Self {
+        Self {
+            start_ms,
+            sum: value,
+            count: 1,
+            min: value,
+            max: value,
+        }
+    }
+
+    fn add(&mut self, value: f64) {
+        self.sum += value;
+        self.count += 1;
+        self.min = self.min.min(value);
+        self.max = self.max.max(value);
+    }
+
+    fn point(&self) -> Point {
+        Point {
+            timestamp_ms: self.start_ms,
+            avg: self.sum / self.count as f64,
+            min: self.min,
+            max: self.max,
+        }
+    }
+}
+
+/// Fixed-size history of one series at one resolution
+///
+/// Holds at least the tier's number of points and less than two chunks more.
+#[derive(Debug)]
+struct Ring {
+    step_ms: i64,
+    /// Sealed chunks kept next to the open one
+    max_chunks: usize,
+    sealed: VecDeque<Chunk>,
+    open: Chunk,
+    bucket: Option<Bucket>,
+}
+
+impl Ring {
+    fn new(tier: Tier) -> Self {
+        Self {
+            step_ms: tier.step_ms,
+            max_chunks: tier.points.div_ceil(CHUNK_POINTS),
+            sealed: VecDeque::new(),
+            open: Chunk::new(),
+            bucket: None,
+        }
+    }
+
+    fn record(&mut self, timestamp_ms: i64, value: f64) {
+        let start_ms = timestamp_ms - timestamp_ms.rem_euclid(self.step_ms);
+        if let Some(bucket) = &mut self.bucket {
+            if bucket.start_ms == start_ms {
+                bucket.add(value);
+                return;
+            }
+            // Late samples of a step that is already stored are dropped
+            if bucket.start_ms > start_ms {
+                return;
+            }
+        }
+        if let Some(done) = self.bucket.replace(Bucket::new(start_ms, value)) {
+            self.append(done.point());
+        }
+    }
+
+    fn append(&mut self, point: Point) {
+        self.open.push(point);
+        if self.open.len() == CHUNK_POINTS {
+            let mut full = std::mem::take(&mut self.open);
+            full.seal();
+            self.sealed.push_back(full);
+            if self.sealed.len() > self.max_chunks {
+                self.sealed.pop_front();
+            }
+        }
+    }
+
+    /// Points within `[start_ms, end_ms]`, including the step being filled
+    fn range(&self, start_ms: i64, end_ms: i64) -> Vec<Point> {
+        let overlaps = |chunk: &Chunk| {
+            chunk.last_timestamp().is_some_and(|last| last >= start_ms)
+                && chunk.first_timestamp().is_some_and(|first| first <= end_ms)
+        };
+        self.sealed
+            .iter()
+            .chain(std::iter::once(&self.open))
+            .filter(|chunk| overlaps(*chunk))
+            .flat_map(|chunk| chunk.points())
+            .chain(self.bucket.map(|bucket| bucket.point()))
+            .filter(|p| p.timestamp_ms >= start_ms && p.timestamp_ms <= end_ms)
+            .collect()
+    }
+
+    fn chunk_bytes(&self) -> usize {
+        self.sealed.iter().map(Chunk::size_bytes).sum::<usize>() + self.open.size_bytes()
+    }
+}
+
+#[derive(Debug)]
+struct Series {
+    rings: Vec<Ring>,
+    last_sample_ms: i64,
+}
+
+impl Series {
+    fn new() -> Self {
+        Self {
+            rings: TIERS.iter().map(|tier| Ring::new(*tier)).collect(),
+            last_sample_ms: i64::MIN,
+        }
+    }
+
+    fn record(&mut self, timestamp_ms: i64, value: f64) {
+        for ring in &mut self.rings {
+            ring.record(timestamp_ms, value);
+        }
+        self.last_sample_ms = self.last_sample_ms.max(timestamp_ms);
+    }
+}
+
+/// Metric history of all nodes and containers
+pub struct TimeSeriesStore {
+    series: Mutex<HashMap<String, Series>>,
+    max_series: usize,
+    samples: AtomicU64,
+    dropped_samples: AtomicU64,
+    evicted_series: AtomicU64,
+}
+
+impl TimeSeriesStore {
+    pub fn new(max_series: usize) -> Self {
+        Self {
+            series: Mutex::new(HashMap::new()),
+            max_series,
+            samples: AtomicU64::new(0),
+            dropped_samples: AtomicU64::new(0),
+            evicted_series: AtomicU64::new(0),
+        }
+    }
+
+    /// Record one sample of `name`
+    ///
+    /// Non-finite values are ignored. A new series is refused while the
+    /// series limit is reached and no idle series can be evicted.
+    pub fn record(&self, name: &str, timestamp_ms: i64, value: f64) {
+        if !value.is_finite() {
+            return;
+        }
+        let mut series = self.lock();
+        if !series.contains_key(name) && series.len() >= self.max_series {
+            self.evict_idle(&mut series, timestamp_ms);
+            if series.len() >= self.max_series {
+                self.dropped_samples.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+        }
+        series
+            .entry(name.to_string())
+            .or_insert_with(Series::new)
+            .record(timestamp_ms, value);
+        self.samples.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Record the numeric fields of `node_info`
+    pub fn record_node(&self, node_info: &NodeInfo, timestamp_ms: i64) {
+        let fields = [
+            ("cpu_usage", node_info.cpu_usage),
+            ("mem_usage", node_info.mem_usage),
+            ("used_memory", node_info.used_memory as f64),
+            ("total_memory", node_info.total_memory as f64),
+            ("rx_bytes", node_info.rx_bytes as f64),
+            ("tx_bytes", node_info.tx_bytes as f64),
+            ("read_bytes", node_info.read_bytes as f64),
+            ("write_bytes", node_info.write_bytes as f64),
+        ];
+        for (field, value) in fields {
+            let name = format!("node/{}/{}", node_info.node_name, field);
+            self.record(&name, timestamp_ms, value);
+        }
+    }
+
+    /// Record the numeric stats of `container_info`
+    pub fn record_container(&self, container_info: &ContainerInfo, timestamp_ms: i64) {
+        for (key, value) in &container_info.stats {
+            if let Ok(value) = value.parse::<f64>() {
+                let name = format!("container/{}/{}", container_info.id, key);
+                self.record(&name, timestamp_ms, value);
+            }
+        }
+    }
+
+    /// History of all series starting with `prefix` within `[start_ms, end_ms]`
+    ///
+    /// The finest tier whose step is at least `step_ms` is used, or the
+    /// coarsest one if none is. Results are sorted by series name and hold at
+    /// most `limit` series.
+    pub fn query(
+        &self,
+        prefix: &str,
+        start_ms: i64,
+        end_ms: i64,
+        step_ms: i64,
+        limit: usize,
+    ) -> Vec<SeriesRange> {
+        let tier = TIERS
+            .iter()
+            .position(|tier| tier.step_ms >= step_ms)
+            .unwrap_or(TIERS.len() - 1);
+
+        let series = self.lock();
+        let mut names: Vec<&String> = series
+            .keys()
+            .filter(|name| name.starts_with(prefix))
+            .collect();
+        names.sort();
+        names
+            .into_iter()
+            .take(limit)
+            .map(|name| SeriesRange {
+                name: name.clone(),
+                step_ms: TIERS[tier].step_ms,
+                points: series[name].rings[tier].range(start_ms, end_ms),
+            })
+            .collect()
+    }
+
+    pub fn stats(&self) -> StoreStats {
+        let series = self.lock();
+        StoreStats {
+            series: series.len(),
+            chunk_bytes: series
+                .values()
+                .flat_map(|s| s.rings.iter())
+                .map(Ring::chunk_bytes)
+                .sum(),
+            samples: self.samples.load(Ordering::Relaxed),
+            dropped_samples: self.dropped_samples.load(Ordering::Relaxed),
+            evicted_series: self.evicted_series.load(Ordering::Relaxed),
+        }
+    }
+
+    /// Drop series without samples for as long as the coarsest tier reaches back
+    fn evict_idle(&self, series: &mut HashMap<String, Series>, now_ms: i64) {
+        let coarsest = TIERS[TIERS.len() - 1];
+        let horizon = now_ms - coarsest.step_ms * coarsest.points as i64;
+        let before = series.len();
+        series.retain(|_, s| s.last_sample_ms >= horizon);
+        self.evicted_series
+            .fetch_add((before - series.len()) as u64, Ordering::Relaxed);
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, HashMap<String, Series>> {
+        self.series.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+impl Default for TimeSeriesStore {
+    fn default() -> Self {
+        Self::new(DEFAULT_MAX_SERIES)
+    }
+}
+
+/// Current Unix time in milliseconds
+pub fn now_ms() -> i64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_millis() as i64)
+        .unwrap_or_default()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const T0: i64 = 1_700_000_000_000;
+
+    #[test]
+    fn test_rollups_aggregate_per_step() {
+        let store = TimeSeriesStore::default();
+        // Two samples per second for 30 s
+        for i in 0..60 {
+            store.record("node/n1/cpu_usage", T0 + i * 500, i as f64);
+        }
+
+        let fine = store.query("node/n1/", T0, T0 + 60_000, 0, 10);
+        assert_eq!(fine.len(), 1);
+        assert_eq!(fine[0].step_ms, 1_000);
+        assert_eq!(fine[0].points.len(), 30);
+        assert_eq!(
+            fine[0].points[0],
+            Point {
+                timestamp_ms: T0,
+                avg: 0.5,
+                min: 0.0,
+                max: 1.0,
+            }
+        );
+
+        let coarse = store.query("node/n1/", T0, T0 + 60_000, 10_000, 10);
+        assert_eq!(coarse[0].step_ms, 10_000);
+        assert_eq!(coarse[0].points.len(), 3);
+        assert_eq!(coarse[0].points[1].min, 20.0);
+        assert_eq!(coarse[0].points[1].max, 39.0);
+    }
+
+    #[test]
+    fn test_ring_keeps_bounded_history() {
+        let store = TimeSeriesStore::default();
+        let seconds = 3_000;
+        let fine_ring_bytes = |store: &TimeSeriesStore| {
+            let series = store.lock();
+            let ring = &series["node/n1/cpu_usage"].rings[0];
+            assert_eq!(ring.sealed.len(), ring.max_chunks);
+            ring.sealed.iter().map(Chunk::size_bytes).sum::<usize>()
+        };
+        for i in 0..seconds {
+            store.record("node/n1/cpu_usage", T0 + i * 1_000, (i % 7) as f64);
+        }
+        let before = fine_ring_bytes(&store);
+        for i in seconds..seconds * 2 {
+            store.record("node/n1/cpu_usage", T0 + i * 1_000, (i % 7) as f64);
+        }
+        // The 1 s tier is full; more samples replace old chunks
+        assert!(fine_ring_bytes(&store) <= before + 256);
+
+        let all = store.query("node/n1/cpu_usage", 0, i64::MAX, 0, 1);
+        let points = &all[0].points;
+        assert!(points.len() < TIERS[0].points + 2 * CHUNK_POINTS);
+        assert!(points.len() >= TIERS[0].points);
+        assert_eq!(
+            points.last().unwrap().timestamp_ms,
+            T0 + (seconds * 2 - 1) * 1_000
+        );
+    }
+
+    #[test]
+    fn test_record_node_and_container() {
+        let store = TimeSeriesStore::default();
+        let node = NodeInfo {
+            node_name: "n1".to_string(),
+            cpu_usage: 12.0,
+            ..Default::default()
+        };
+        store.record_node(&node, T0);
+        let container = ContainerInfo {
+            id: "c1".to_string(),
+            stats: HashMap::from([
+                ("MemoryUsage".to_string(), "1024".to_string()),
+                ("Networks".to_string(), "None".to_string()),
+            ]),
+            ..Default::default()
+        };
+        store.record_container(&container, T0);
+
+        let node_series = store.query("node/n1/", T0, T0, 0, 100);
+        assert_eq!(node_series.len(), 8);
+        let cpu = node_series
+            .iter()
+            .find(|s| s.name == "node/n1/cpu_usage")
+            .unwrap();
+        assert_eq!(cpu.points[0].avg, 12.0);
+
+        let container_series = store.query("container/c1/", T0, T0, 0, 100);
+        assert_eq!(container_series.len(), 1);
+        assert_eq!(container_series[0].name, "container/c1/MemoryUsage");
+    }
+
+    #[test]
+    fn test_series_limit_evicts_idle_series() {
+        let store = TimeSeriesStore::new(2);
+        store.record("a", T0, 1.0);
+        store.record("b", T0, 1.0);
+        store.record("c", T0, 1.0);
+        assert_eq!(store.stats().dropped_samples, 1);
+
+        // A day later a and b are idle and make room
+        store.record("b", T0 + 86_400_000, 1.0);
+        store.record("c", T0 + 86_400_001, 1.0);
+        let stats = store.stats();
+        assert_eq!((stats.series, stats.evicted_series), (2, 1));
+        assert!(store.query("a", 0, i64::MAX, 0, 10).is_empty());
+    }
+}
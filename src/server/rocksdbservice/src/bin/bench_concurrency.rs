@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Concurrency benchmark for a running RocksDB service.
+//!
+//! Measures point `Get` latency on a hot key twice: once on an idle service
+//! and once while background tasks keep issuing large prefix scans. With
+//! reads served concurrently the two distributions should stay close.
+
+use clap::Parser;
+use common::etcd;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+const KEY_PREFIX: &str = "bench/scan/";
+const HOT_KEY: &str = "bench/hot";
+
+#[derive(Parser)]
+#[command(name = "bench_concurrency")]
+#[command(about = "p99 Get latency with and without a concurrent prefix scan")]
+struct Args {
+    /// RocksDB service URL
+    #[arg(short, long, default_value = "http://localhost:47007")]
+    url: String,
+
+    /// Number of keys under the scanned prefix
+    #[arg(short, long, default_value = "20000")]
+    keys: usize,
+
+    /// Value size in bytes for seeded keys
+    #[arg(long, default_value = "256")]
+    value_size: usize,
+
+    /// Number of Get requests measured per phase
+    #[arg(short, long, default_value = "2000")]
+    gets: usize,
+
+    /// Number of background tasks running prefix scans
+    #[arg(short, long, default_value = "2")]
+    scanners: usize,
+
+    /// Keep the seeded keys after the run
+    #[arg(long)]
+    keep: bool,
+}
+
+/// Latency distribution of one measured phase.
+struct Summary {
+    p50: Duration,
+    p99: Duration,
+    max: Duration,
+}
+
+fn summarize(mut samples: Vec<Duration>) -> Summary {
+    samples.sort_unstable();
+    let at = |q: f64| samples[((samples.len() - 1) as f64 * q).round() as usize];
+    Summary {
+        p50: at(0.50),
+        p99: at(0.99),
+        max: *samples.last().unwrap(),
+    }
+}
+
+async fn measure_gets(count: usize) -> Result<Vec<Duration>, String> {
+    let mut samples = Vec::with_capacity(count);
+    for _ in 0..count {
+        let start = Instant::now();
+        etcd::get(HOT_KEY).await?;
+        samples.push(start.elapsed());
+    }
+    Ok(samples)
+}
+
+async fn seed(keys: usize, value_size: usize) -> Result<(), String> {
+    let value = "x".repeat(value_size);
+    let items: Vec<(String, String)> = (0..keys)
+        .map(|i| (format!("{}{:08}", KEY_PREFIX, i), value.clone()))
+        .collect();
+    for chunk in items.chunks(1000) {
+        etcd::batch_put(chunk.to_vec()).await?;
+    }
+    etcd::put(HOT_KEY, "hot").await
+}
+
+async fn cleanup(keys: usize) {
+    for i in 0..keys {
+        let _ = etcd::delete(&format!("{}{:08}", KEY_PREFIX, i)).await;
+    }
+    let _ = etcd::delete(HOT_KEY).await;
+}
+
+fn print_summary(label: &str, summary: &Summary) {
+    println!(
+        "{:<14} p50 {:>9.3} ms   p99 {:>9.3} ms   max {:>9.3} ms",
+        label,
+        summary.p50.as_secs_f64() * 1000.0,
+        summary.p99.as_secs_f64() * 1000.0,
+        summary.max.as_secs_f64() * 1000.0
+    );
+}
+
+#[tokio::main]
+async fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let args = Args::parse();
+    std::env::set_var("ROCKSDB_SERVICE_URL", &args.url);
+
+    if !etcd::health_check().await? {
+        return Err("RocksDB service is not healthy".into());
+    }
+
+    println!(
+        "Seeding {} keys of {} bytes under '{}'...",
+        args.keys, args.value_size, KEY_PREFIX
+    );
+    seed(args.keys, args.value_size).await?;
+
+    // Warm up connections and caches
+    measure_gets(100).await?;
+
+    let idle = summarize(measure_gets(args.gets).await?);
+
+    let stop = Arc::new(AtomicBool::new(false));
+    let scans = Arc::new(AtomicU64::new(0));
+    let mut scanners = Vec::new();
+    for _ in 0..args.scanners {
+        let (stop, scans) = (stop.clone(), scans.clone());
+        scanners.push(tokio::spawn(async move {
+            while !stop.load(Ordering::Relaxed) {
+                if etcd::get_all_with_prefix(KEY_PREFIX).await.is_ok() {
+                    scans.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+        }));
+    }
+
+    // Give the scanners time to saturate the service
+    tokio::time::sleep(Duration::from_millis(200)).await;
+    let started = Instant::now();
+    let busy = summarize(measure_gets(args.gets).await?);
+    let busy_elapsed = started.elapsed();
+
+    stop.store(true, Ordering::Relaxed);
+    for scanner in scanners {
+        let _ = scanner.await;
+    }
+
+    println!();
+    println!("Get latency over {} requests:", args.gets);
+    print_summary("idle", &idle);
+    print_summary("during scans", &busy);
+    println!(
+        "{} background scans of {} keys completed in {:.2} s",
+        scans.load(Ordering::Relaxed),
+        args.keys,
+        busy_elapsed.as_secs_f64()
+    );
+
+    if !args.keep {
+        println!("Cleaning up seeded keys...");
+        cleanup(args.keys).await;
+    }
+
+    Ok(())
+}
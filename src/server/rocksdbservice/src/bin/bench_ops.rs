@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Per-operation latency of a running RocksDB service.
+//!
+//! Seeds a key family, then times each client call the components use on
+//! their hot paths one request at a time, so the numbers are round trips
+//! through the gRPC client, the service and RocksDB.
+
+use clap::Parser;
+use common::etcd;
+use common::trace::LatencySummary;
+use std::future::Future;
+use std::time::{Duration, Instant};
+
+const KEY_PREFIX: &str = "bench/ops/";
+
+#[derive(Parser)]
+#[command(name = "bench_ops")]
+#[command(about = "p50/p99 latency of each RocksDB service operation")]
+struct Args {
+    /// RocksDB service URL
+    #[arg(short, long, default_value = "http://localhost:47007")]
+    url: String,
+
+    /// Number of keys under the seeded prefix
+    #[arg(short, long, default_value = "1000")]
+    keys: usize,
+
+    /// Value size in bytes for written keys
+    #[arg(long, default_value = "256")]
+    value_size: usize,
+
+    /// Number of requests measured per operation
+    #[arg(short, long, default_value = "1000")]
+    requests: usize,
+
+    /// Keep the seeded keys after the run
+    #[arg(long)]
+    keep: bool,
+}
+
+fn key(i: usize) -> String {
+    format!("{}{:08}", KEY_PREFIX, i)
+}
+
+async fn measure<F, Fut, T>(requests: usize, mut op: F) -> Result<LatencySummary, String>
+where
+    F: FnMut(usize) -> Fut,
+    Fut: Future<Output = Result<T, String>>,
+{
+    let mut samples: Vec<Duration> = Vec::with_capacity(requests);
+    for i in 0..requests {
+        let start = Instant::now();
+        op(i).await?;
+        samples.push(start.elapsed());
+    }
+    LatencySummary::from_samples(samples).ok_or_else(|| "no requests".to_string())
+}
+
+async fn cleanup(keys: usize) {
+    for i in 0..keys {
+        let _ = etcd::delete(&key(i)).await;
+    }
+}
+
+#[tokio::main]
+async fn main() -> Result<(), Box<dyn std::error::Error>> {
+    let args = Args::parse();
+    std::env::set_var("ROCKSDB_SERVICE_URL", &args.url);
+
+    if !etcd::health_check().await? {
+        return Err("RocksDB service is not healthy".into());
+    }
+
+    let value = "x".repeat(args.value_size);
+    let (keys, requests) = (args.keys.max(1), args.requests);
+    println!(
+        "Seeding {} keys of {} bytes under '{}'...",
+        keys, args.value_size, KEY_PREFIX
+    );
+    let items: Vec<(String, String)> = (0..keys).map(|i| (key(i), value.clone())).collect();
+    for chunk in items.chunks(1000) {
+        etcd::batch_put(chunk.to_vec()).await?;
+    }
+
+    // Warm up connections and caches
+    measure(100, |i| async move { etcd::get(&key(i % keys)).await }).await?;
+
+    let mut results = Vec::new();
+    results.push((
+        "put",
+        measure(requests, |i| {
+            let value = value.clone();
+            async move { etcd::put(&key(i % keys), &value).await }
+        })
+        .await?,
+    ));
+    results.push((
+        "get",
+        measure(requests, |i| async move { etcd::get(&key(i % keys)).await }).await?,
+    ));
+    results.push((
+        "multi_get x16",
+        measure(requests, |i| async move {
+            let batch: Vec<String> = (0..16).map(|j| key((i * 16 + j) % keys)).collect();
+            etcd::multi_get(&batch).await
+        })
+        .await?,
+    ));
+    results.push((
+        "batch_put x16",
+        measure(requests, |i| {
+            let batch: Vec<(String, String)> = (0..16)
+                .map(|j| (key((i * 16 + j) % keys), value.clone()))
+                .collect();
+            etcd::batch_put(batch)
+        })
+        .await?,
+    ));
+    results.push((
+        "newest 10",
+        measure(requests, |_| {
+            etcd::get_with_prefix_reverse(KEY_PREFIX, "", 10)
+        })
+        .await?,
+    ));
+    let scans = (requests / 10).max(1);
+    results.push((
+        "full prefix",
+        measure(scans, |_| etcd::get_all_with_prefix(KEY_PREFIX)).await?,
+    ));
+
+    println!();
+    println!("Latency of {} keys of {} bytes:", keys, args.value_size);
+    for (label, summary) in &results {
+        println!("{:<14} {}", label, summary);
+    }
+
+    if !args.keep {
+        println!("Cleaning up seeded keys...");
+        cleanup(keys).await;
+    }
+
+    Ok(())
+}
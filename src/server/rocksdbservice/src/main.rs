@@ -3,23 +3,46 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+mod watch;
+
 use clap::Parser;
-use rocksdb::{IteratorMode, Options, WriteBatch, DB};
+use rocksdb::{
+    BlockBasedOptions, Direction, IteratorMode, Options, ReadOptions, SliceTransform, Snapshot,
+    WriteBatch, DB,
+};
 use std::sync::{Arc, OnceLock};
-use tokio::sync::Mutex;
+use tokio::sync::broadcast::error::RecvError;
+use tokio::sync::{mpsc, Semaphore};
+use tokio_stream::wrappers::ReceiverStream;
 use tonic::{transport::Server, Request, Response, Status};
-use tracing::{error, info};
+use tracing::{error, info, warn};
+use watch::{KeyStripes, WatchHub};
 
 // Import protobuf definitions
 use common::rocksdbservice::{
+    is_valid_key,
     rocks_db_service_server::{RocksDbService, RocksDbServiceServer},
-    BatchPutRequest, BatchPutResponse, DeleteRequest, DeleteResponse, GetByPrefixRequest,
+    write_op, BatchPutRequest, BatchPutResponse, DeleteRequest, DeleteResponse, GetByPrefixRequest,
     GetByPrefixResponse, GetRequest, GetResponse, HealthRequest, HealthResponse, KeyValue,
-    ListKeysRequest, ListKeysResponse, PutRequest, PutResponse,
+    ListKeysRequest, ListKeysResponse, MultiGetRequest, MultiGetResponse, MultiGetResult,
+    PutRequest, PutResponse, SnapshotRequest, SnapshotResponse, WatchEvent, WatchRequest,
+    WatchResponse, WriteBatchRequest, WriteBatchResponse,
 };
+use common::snapshot::Snapshot as ExportedSnapshot;
+
+// Global RocksDB instance. `DB` is internally synchronized, so handlers
+// share it without an outer lock.
+static DB_INSTANCE: OnceLock<Arc<DB>> = OnceLock::new();
 
-// Global RocksDB instance
-static DB_INSTANCE: OnceLock<Arc<Mutex<DB>>> = OnceLock::new();
+/// Length of the fixed key prefix indexed by the prefix bloom filter.
+///
+/// Four bytes separate the top-level key families ("Scen", "Pack", "/mod",
+/// "node", "clus", ...) and are shorter than any prefix the components
+/// query, so almost every scan can use the filter.
+const PREFIX_EXTRACTOR_LEN: usize = 4;
+
+/// Number of keys per message when streaming a watch's initial snapshot.
+const WATCH_INITIAL_CHUNK: usize = 512;
 
 #[derive(Parser)]
 #[command(name = "rocksdbservice")]
@@ -36,6 +59,10 @@ struct Args {
     /// Bind address
     #[arg(short, long, default_value = "0.0.0.0")]
     addr: String,
+
+    /// Maximum number of RocksDB calls running concurrently on the blocking pool
+    #[arg(long, default_value = "16")]
+    max_blocking: usize,
 }
 
 // Initialize RocksDB
@@ -55,12 +82,22 @@ fn init_db(path: &str) -> anyhow::Result<()> {
     // Compression
     opts.set_compression_type(rocksdb::DBCompressionType::Lz4);
 
+    // Prefix seek: bloom filters on the key family prefix let GetByPrefix
+    // skip SST blocks that cannot contain matching keys, while whole-key
+    // filtering keeps point lookups fast.
+    opts.set_prefix_extractor(SliceTransform::create_fixed_prefix(PREFIX_EXTRACTOR_LEN));
+    opts.set_memtable_prefix_bloom_ratio(0.1);
+    let mut table_opts = BlockBasedOptions::default();
+    table_opts.set_bloom_filter(10.0, false);
+    table_opts.set_whole_key_filtering(true);
+    opts.set_block_based_table_factory(&table_opts);
+
     info!("Opening RocksDB with optimized settings...");
 
     let db = DB::open(&opts, path)?;
 
     DB_INSTANCE
-        .set(Arc::new(Mutex::new(db)))
+        .set(Arc::new(db))
         .map_err(|_| anyhow::anyhow!("RocksDB already initialized"))?;
 
     info!("RocksDB successfully initialized at path: '{}'", path);
@@ -68,15 +105,214 @@ fn init_db(path: &str) -> anyhow::Result<()> {
 }
 
 // Get DB instance safely
-fn get_db() -> Result<Arc<Mutex<DB>>, Status> {
+fn get_db() -> Result<Arc<DB>, Status> {
     DB_INSTANCE
         .get()
         .ok_or_else(|| Status::unavailable("RocksDB not initialized"))
         .map(|db| db.clone())
 }
 
+/// Smallest key strictly greater than every key starting with `prefix`, or
+/// `None` when there is no such bound (empty or all-0xFF prefix).
+fn prefix_upper_bound(prefix: &[u8]) -> Option<Vec<u8>> {
+    let mut bound = prefix.to_vec();
+    while let Some(last) = bound.pop() {
+        if last < u8::MAX {
+            bound.push(last + 1);
+            return Some(bound);
+        }
+    }
+    None
+}
+
+/// One page of a prefix scan.
+struct ScanPage {
+    entries: Vec<(Box<[u8]>, Box<[u8]>)>,
+    has_more: bool,
+}
+
+/// Collect up to `limit` entries under `prefix` in key order, resuming after
+/// `start_after` when it is non-empty. With `snapshot`, the scan reads that
+/// point-in-time view instead of the latest state.
+///
+/// The scan seeks directly to the first candidate key and stops at the
+/// prefix upper bound, so its cost depends on the size of the result rather
+/// than the size of the database.
+fn scan_prefix(
+    db: &DB,
+    prefix: &str,
+    start_after: &str,
+    limit: usize,
+    snapshot: Option<&Snapshot>,
+) -> Result<ScanPage, rocksdb::Error> {
+    let prefix = prefix.as_bytes();
+    let start_after = start_after.as_bytes();
+
+    let mut read_opts = ReadOptions::default();
+    if let Some(snapshot) = snapshot {
+        read_opts.set_snapshot(snapshot);
+    }
+    if let Some(bound) = prefix_upper_bound(prefix) {
+        read_opts.set_iterate_upper_bound(bound);
+    }
+    // Prefixes shorter than the extractor span several bloom domains
+    read_opts.set_total_order_seek(prefix.len() < PREFIX_EXTRACTOR_LEN);
+
+    let seek_from = if start_after > prefix {
+        start_after
+    } else {
+        prefix
+    };
+    let iter = db.iterator_opt(IteratorMode::From(seek_from, Direction::Forward), read_opts);
+
+    let mut entries = Vec::new();
+    for item in iter {
+        let (key, value) = item?;
+        if !key.starts_with(prefix) {
+            break;
+        }
+        if !start_after.is_empty() && &*key == start_after {
+            continue;
+        }
+        if entries.len() >= limit {
+            return Ok(ScanPage {
+                entries,
+                has_more: true,
+            });
+        }
+        entries.push((key, value));
+    }
+
+    Ok(ScanPage {
+        entries,
+        has_more: false,
+    })
+}
+
+/// Collect up to `limit` entries under `prefix` in descending key order,
+/// starting below `start_before` when it is non-empty.
+///
+/// Both ends of the range become iterator bounds, so reading the newest
+/// entries of a key family costs as much as the page that is returned.
+fn scan_prefix_reverse(
+    db: &DB,
+    prefix: &str,
+    start_before: &str,
+    limit: usize,
+) -> Result<ScanPage, rocksdb::Error> {
+    let prefix = prefix.as_bytes();
+    let start_before = start_before.as_bytes();
+
+    let upper = match prefix_upper_bound(prefix) {
+        Some(bound) if start_before.is_empty() || start_before > bound.as_slice() => Some(bound),
+        _ if !start_before.is_empty() => Some(start_before.to_vec()),
+        _ => None,
+    };
+    if upper.as_deref().is_some_and(|upper| upper <= prefix) {
+        return Ok(ScanPage {
+            entries: Vec::new(),
+            has_more: false,
+        });
+    }
+
+    let mut read_opts = ReadOptions::default();
+    read_opts.set_iterate_lower_bound(prefix.to_vec());
+    if let Some(upper) = upper {
+        read_opts.set_iterate_upper_bound(upper);
+    }
+    // Backward seeks are not served by the prefix bloom filters
+    read_opts.set_total_order_seek(true);
+
+    let mut entries = Vec::new();
+    for item in db.iterator_opt(IteratorMode::End, read_opts) {
+        let (key, value) = item?;
+        if !key.starts_with(prefix) {
+            break;
+        }
+        if entries.len() >= limit {
+            return Ok(ScanPage {
+                entries,
+                has_more: true,
+            });
+        }
+        entries.push((key, value));
+    }
+
+    Ok(ScanPage {
+        entries,
+        has_more: false,
+    })
+}
+
+/// Convert a request limit (0 or negative means unlimited) to a count.
+fn page_limit(limit: i32) -> usize {
+    if limit > 0 {
+        limit as usize
+    } else {
+        usize::MAX
+    }
+}
+
 // gRPC service implementation
-pub struct RocksDbServiceImpl;
+pub struct RocksDbServiceImpl {
+    /// Permits for RocksDB calls on the blocking pool. Bounding them keeps a
+    /// burst of slow scans from exhausting tokio's blocking threads.
+    blocking: Arc<Semaphore>,
+
+    /// Publishes committed writes to Watch subscribers.
+    watch: Arc<WatchHub>,
+}
+
+impl RocksDbServiceImpl {
+    pub fn new(max_blocking: usize) -> Self {
+        Self {
+            blocking: Arc::new(Semaphore::new(max_blocking.max(1))),
+            watch: Arc::new(WatchHub::new(watch::WATCH_BUFFER)),
+        }
+    }
+
+    /// Commit a write batch on the blocking pool and notify watchers.
+    ///
+    /// `keys` are the keys the batch writes. `events` runs inside
+    /// [`WatchHub::commit`] and only when someone is watching.
+    async fn commit<E>(
+        &self,
+        batch: WriteBatch,
+        keys: KeyStripes,
+        events: E,
+    ) -> Result<Result<u64, rocksdb::Error>, Status>
+    where
+        E: FnOnce() -> Vec<WatchEvent> + Send + 'static,
+    {
+        let hub = self.watch.clone();
+        self.run_blocking(move |db| hub.commit(db, batch, &keys, events))
+            .await
+    }
+
+    /// Run a RocksDB call on the blocking pool so it never stalls the async
+    /// reactor. Reads and writes proceed concurrently; RocksDB iterators read
+    /// from an implicit snapshot, so scans stay consistent while writes land.
+    async fn run_blocking<T, F>(&self, f: F) -> Result<T, Status>
+    where
+        F: FnOnce(&DB) -> T + Send + 'static,
+        T: Send + 'static,
+    {
+        let db = get_db()?;
+        let permit = self
+            .blocking
+            .clone()
+            .acquire_owned()
+            .await
+            .map_err(|_| Status::unavailable("RocksDB service is shutting down"))?;
+
+        tokio::task::spawn_blocking(move || {
+            let _permit = permit;
+            f(&db)
+        })
+        .await
+        .map_err(|e| Status::internal(format!("RocksDB task failed: {}", e)))
+    }
+}
 
 #[tonic::async_trait]
 impl RocksDbService for RocksDbServiceImpl {
@@ -84,16 +320,11 @@ impl RocksDbService for RocksDbServiceImpl {
         &self,
         _request: Request<HealthRequest>,
     ) -> Result<Response<HealthResponse>, Status> {
-        let db_initialized = DB_INSTANCE.get().is_some();
-
-        let status = if db_initialized {
-            // Try a simple read operation
-            match get_db() {
-                Ok(db) => match db.try_lock() {
-                    Ok(_) => "healthy".to_string(),
-                    Err(_) => "busy".to_string(),
-                },
-                Err(_) => "error".to_string(),
+        let status = if DB_INSTANCE.get().is_some() {
+            if self.blocking.available_permits() > 0 {
+                "healthy".to_string()
+            } else {
+                "busy".to_string()
             }
         } else {
             "error".to_string()
@@ -128,19 +359,26 @@ impl RocksDbService for RocksDbServiceImpl {
             ));
         }
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
-
-        match db_lock.put(req.key.as_bytes(), req.value.as_bytes()) {
-            Ok(()) => {
-                info!("Successfully stored key: '{}'", req.key);
+        let PutRequest { key, value } = req;
+        let mut batch = WriteBatch::default();
+        batch.put(key.as_bytes(), value.as_bytes());
+        let event_key = key.clone();
+        let result = self
+            .commit(batch, KeyStripes::of([key.as_str()]), move || {
+                vec![watch::put_event(&event_key, &value)]
+            })
+            .await?;
+
+        match result {
+            Ok(_) => {
+                info!("Successfully stored key: '{}'", key);
                 Ok(Response::new(PutResponse {
                     success: true,
                     error: String::new(),
                 }))
             }
             Err(e) => {
-                error!("Failed to store key '{}': {}", req.key, e);
+                error!("Failed to store key '{}': {}", key, e);
                 Err(Status::internal(format!("RocksDB put error: {}", e)))
             }
         }
@@ -153,10 +391,12 @@ impl RocksDbService for RocksDbServiceImpl {
             return Err(Status::invalid_argument("Key cannot be empty"));
         }
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
+        let result = {
+            let key = req.key.clone();
+            self.run_blocking(move |db| db.get(key.as_bytes())).await?
+        };
 
-        match db_lock.get(req.key.as_bytes()) {
+        match result {
             Ok(Some(value)) => match String::from_utf8(value) {
                 Ok(value_str) => {
                     info!("Successfully retrieved key: '{}'", req.key);
@@ -196,11 +436,17 @@ impl RocksDbService for RocksDbServiceImpl {
             return Err(Status::invalid_argument("Key cannot be empty"));
         }
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
-
-        match db_lock.delete(req.key.as_bytes()) {
-            Ok(()) => {
+        let mut batch = WriteBatch::default();
+        batch.delete(req.key.as_bytes());
+        let event_key = req.key.clone();
+        let result = self
+            .commit(batch, KeyStripes::of([req.key.as_str()]), move || {
+                vec![watch::delete_event(&event_key)]
+            })
+            .await?;
+
+        match result {
+            Ok(_) => {
                 info!("Successfully deleted key: '{}'", req.key);
                 Ok(Response::new(DeleteResponse {
                     success: true,
@@ -230,10 +476,7 @@ impl RocksDbService for RocksDbServiceImpl {
 
         // Validate all keys first
         for item in &req.pairs {
-            if item.key.is_empty()
-                || item.key.len() > 1024
-                || item.key.contains(['<', '>', '?', '{', '}'])
-            {
+            if !is_valid_key(&item.key) {
                 return Err(Status::invalid_argument(format!(
                     "Invalid key: {}",
                     item.key
@@ -241,20 +484,135 @@ impl RocksDbService for RocksDbServiceImpl {
             }
         }
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
         let mut batch = WriteBatch::default();
 
         for item in &req.pairs {
             batch.put(item.key.as_bytes(), item.value.as_bytes());
         }
 
-        match db_lock.write(batch) {
-            Ok(()) => {
-                info!("Successfully stored {} items in batch", req.pairs.len());
+        let count = req.pairs.len();
+        let keys = KeyStripes::of(req.pairs.iter().map(|item| item.key.as_str()));
+        let events = move || {
+            req.pairs
+                .iter()
+                .map(|item| watch::put_event(&item.key, &item.value))
+                .collect()
+        };
+
+        match self.commit(batch, keys, events).await? {
+            Ok(_) => {
+                info!("Successfully stored {} items in batch", count);
                 Ok(Response::new(BatchPutResponse {
                     success: true,
-                    processed_count: req.pairs.len() as i32,
+                    processed_count: count as i32,
+                    error: String::new(),
+                }))
+            }
+            Err(e) => {
+                error!("Batch write failed: {}", e);
+                Err(Status::internal(format!(
+                    "RocksDB batch write error: {}",
+                    e
+                )))
+            }
+        }
+    }
+
+    async fn multi_get(
+        &self,
+        request: Request<MultiGetRequest>,
+    ) -> Result<Response<MultiGetResponse>, Status> {
+        let req = request.into_inner();
+
+        if req.keys.iter().any(|key| key.is_empty()) {
+            return Err(Status::invalid_argument("Key cannot be empty"));
+        }
+
+        // MultiGet reads every key at the same sequence number, so callers
+        // see one consistent view of the batch.
+        let keys = req.keys.clone();
+        let values = self.run_blocking(move |db| db.multi_get(&keys)).await?;
+
+        let mut results = Vec::with_capacity(values.len());
+        for (key, value) in req.keys.into_iter().zip(values) {
+            match value {
+                Ok(Some(bytes)) => match String::from_utf8(bytes) {
+                    Ok(value) => results.push(MultiGetResult {
+                        key,
+                        found: true,
+                        value,
+                    }),
+                    Err(e) => {
+                        error!("UTF-8 conversion error for key '{}': {}", key, e);
+                        return Err(Status::internal(format!("UTF-8 conversion error: {}", e)));
+                    }
+                },
+                Ok(None) => results.push(MultiGetResult {
+                    key,
+                    found: false,
+                    value: String::new(),
+                }),
+                Err(e) => {
+                    error!("Failed to get key '{}': {}", key, e);
+                    return Err(Status::internal(format!("RocksDB get error: {}", e)));
+                }
+            }
+        }
+
+        info!("Multi-get of {} keys", results.len());
+        Ok(Response::new(MultiGetResponse {
+            results,
+            error: String::new(),
+        }))
+    }
+
+    async fn write_batch(
+        &self,
+        request: Request<WriteBatchRequest>,
+    ) -> Result<Response<WriteBatchResponse>, Status> {
+        let req = request.into_inner();
+
+        if req.ops.is_empty() {
+            return Ok(Response::new(WriteBatchResponse {
+                success: true,
+                processed_count: 0,
+                error: String::new(),
+            }));
+        }
+
+        // Validate all keys first so a bad entry rejects the whole batch
+        for op in &req.ops {
+            if !is_valid_key(&op.key) {
+                return Err(Status::invalid_argument(format!("Invalid key: {}", op.key)));
+            }
+        }
+
+        let mut batch = WriteBatch::default();
+        for op in &req.ops {
+            match op.kind() {
+                write_op::Kind::Put => batch.put(op.key.as_bytes(), op.value.as_bytes()),
+                write_op::Kind::Delete => batch.delete(op.key.as_bytes()),
+            }
+        }
+
+        let count = req.ops.len();
+        let keys = KeyStripes::of(req.ops.iter().map(|op| op.key.as_str()));
+        let events = move || {
+            req.ops
+                .iter()
+                .map(|op| match op.kind() {
+                    write_op::Kind::Put => watch::put_event(&op.key, &op.value),
+                    write_op::Kind::Delete => watch::delete_event(&op.key),
+                })
+                .collect()
+        };
+
+        match self.commit(batch, keys, events).await? {
+            Ok(_) => {
+                info!("Successfully applied {} operations in batch", count);
+                Ok(Response::new(WriteBatchResponse {
+                    success: true,
+                    processed_count: count as i32,
                     error: String::new(),
                 }))
             }
@@ -278,29 +636,36 @@ impl RocksDbService for RocksDbServiceImpl {
             return Err(Status::invalid_argument("Prefix cannot be empty"));
         }
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
-        let mut results = Vec::new();
-        let iter = db_lock.iterator(IteratorMode::Start);
-
-        for item in iter {
-            match item {
-                Ok((key_bytes, value_bytes)) => {
-                    match (
-                        String::from_utf8(key_bytes.to_vec()),
-                        String::from_utf8(value_bytes.to_vec()),
-                    ) {
-                        (Ok(key), Ok(value)) => {
-                            if key.starts_with(&req.prefix) {
-                                results.push(KeyValue { key, value });
-                            }
-                        }
-                        _ => continue, // Skip invalid UTF-8 entries
-                    }
+        let page = {
+            let (prefix, start_after) = (req.prefix.clone(), req.start_after.clone());
+            let (limit, reverse) = (page_limit(req.limit), req.reverse);
+            self.run_blocking(move |db| {
+                if reverse {
+                    scan_prefix_reverse(db, &prefix, &start_after, limit)
+                } else {
+                    scan_prefix(db, &prefix, &start_after, limit, None)
                 }
-                Err(_) => continue, // Skip errors
-            }
+            })
+            .await?
         }
+        .map_err(|e| {
+            error!("Prefix scan failed for '{}': {}", req.prefix, e);
+            Status::internal(format!("RocksDB iterator error: {}", e))
+        })?;
+
+        let results: Vec<KeyValue> = page
+            .entries
+            .into_iter()
+            .filter_map(|(key_bytes, value_bytes)| {
+                match (
+                    String::from_utf8(key_bytes.into_vec()),
+                    String::from_utf8(value_bytes.into_vec()),
+                ) {
+                    (Ok(key), Ok(value)) => Some(KeyValue { key, value }),
+                    _ => None, // Skip invalid UTF-8 entries
+                }
+            })
+            .collect();
 
         let count = results.len() as i32;
         info!("Found {} keys with prefix '{}'", count, req.prefix);
@@ -308,6 +673,7 @@ impl RocksDbService for RocksDbServiceImpl {
             pairs: results,
             total_count: count,
             error: String::new(),
+            has_more: page.has_more,
         }))
     }
 
@@ -317,41 +683,209 @@ impl RocksDbService for RocksDbServiceImpl {
     ) -> Result<Response<ListKeysResponse>, Status> {
         let req = request.into_inner();
 
-        let db = get_db()?;
-        let db_lock = db.lock().await;
-        let mut keys = Vec::new();
-        let iter = db_lock.iterator(IteratorMode::Start);
+        let page = {
+            let (prefix, start_after) = (req.prefix.clone(), req.start_after.clone());
+            let limit = page_limit(req.limit);
+            self.run_blocking(move |db| scan_prefix(db, &prefix, &start_after, limit, None))
+                .await?
+        }
+        .map_err(|e| {
+            error!("Key listing failed for '{}': {}", req.prefix, e);
+            Status::internal(format!("RocksDB iterator error: {}", e))
+        })?;
+
+        let keys: Vec<String> = page
+            .entries
+            .into_iter()
+            .filter_map(|(key_bytes, _)| String::from_utf8(key_bytes.into_vec()).ok())
+            .collect();
+
+        let count = keys.len() as i32;
+        info!("Listed {} keys with prefix '{}'", count, req.prefix);
+        Ok(Response::new(ListKeysResponse {
+            keys,
+            total_count: count,
+            error: String::new(),
+            has_more: page.has_more,
+        }))
+    }
+
+    type WatchStream = ReceiverStream<Result<WatchResponse, Status>>;
+
+    async fn watch(
+        &self,
+        request: Request<WatchRequest>,
+    ) -> Result<Response<Self::WatchStream>, Status> {
+        let req = request.into_inner();
 
-        let mut count = 0;
-        let limit = if req.limit > 0 {
-            req.limit as usize
+        // Subscribe before reading the snapshot so no commit can fall between
+        // the initial contents and the live events.
+        let mut commits = self.watch.subscribe();
+
+        let initial = if req.send_initial {
+            let hub = self.watch.clone();
+            let prefix = req.prefix.clone();
+            let (revision, page) = self
+                .run_blocking(move |db| {
+                    let (revision, snapshot) = hub.snapshot(db);
+                    scan_prefix(db, &prefix, "", usize::MAX, Some(&snapshot))
+                        .map(|page| (revision, page))
+                })
+                .await?
+                .map_err(|e| {
+                    error!("Watch snapshot failed for '{}': {}", req.prefix, e);
+                    Status::internal(format!("RocksDB iterator error: {}", e))
+                })?;
+
+            let events: Vec<WatchEvent> = page
+                .entries
+                .into_iter()
+                .filter_map(|(key_bytes, value_bytes)| {
+                    match (
+                        String::from_utf8(key_bytes.into_vec()),
+                        String::from_utf8(value_bytes.into_vec()),
+                    ) {
+                        (Ok(key), Ok(value)) => Some(watch::put_event(&key, &value)),
+                        _ => None, // Skip invalid UTF-8 entries
+                    }
+                })
+                .collect();
+            Some((revision, events))
         } else {
-            usize::MAX
+            None
         };
 
-        for item in iter {
-            if count >= limit {
-                break;
+        info!(
+            "Watch started for prefix '{}' (initial: {})",
+            req.prefix, req.send_initial
+        );
+
+        let (tx, rx) = mpsc::channel(16);
+        let prefix = req.prefix;
+        tokio::spawn(async move {
+            let mut revision = 0;
+
+            if let Some((snapshot_revision, events)) = initial {
+                revision = snapshot_revision;
+                let chunks: Vec<Vec<WatchEvent>> = if events.is_empty() {
+                    vec![Vec::new()]
+                } else {
+                    events
+                        .chunks(WATCH_INITIAL_CHUNK)
+                        .map(|chunk| chunk.to_vec())
+                        .collect()
+                };
+                let last = chunks.len() - 1;
+                for (i, events) in chunks.into_iter().enumerate() {
+                    let response = WatchResponse {
+                        revision,
+                        events,
+                        initial: true,
+                        synced: i == last,
+                    };
+                    if tx.send(Ok(response)).await.is_err() {
+                        return;
+                    }
+                }
             }
 
-            match item {
-                Ok((key_bytes, _)) => {
-                    if let Ok(key) = String::from_utf8(key_bytes.to_vec()) {
-                        if req.prefix.is_empty() || key.starts_with(&req.prefix) {
-                            keys.push(key);
-                            count += 1;
+            loop {
+                let batch = tokio::select! {
+                    batch = commits.recv() => batch,
+                    _ = tx.closed() => break,
+                };
+
+                match batch {
+                    Ok(batch) => {
+                        let Some(events) = watch::events_for_prefix(&batch, &prefix, revision)
+                        else {
+                            continue;
+                        };
+                        revision = batch.revision;
+                        let response = WatchResponse {
+                            revision,
+                            events,
+                            initial: false,
+                            synced: false,
+                        };
+                        if tx.send(Ok(response)).await.is_err() {
+                            break;
                         }
                     }
+                    Err(RecvError::Lagged(skipped)) => {
+                        warn!(
+                            "Watcher on '{}' fell behind by {} commits, closing",
+                            prefix, skipped
+                        );
+                        let _ = tx
+                            .send(Err(Status::data_loss(format!(
+                                "watch fell behind by {} commits; resync required",
+                                skipped
+                            ))))
+                            .await;
+                        break;
+                    }
+                    Err(RecvError::Closed) => break,
                 }
-                Err(_) => continue,
             }
+
+            info!("Watch ended for prefix '{}'", prefix);
+        });
+
+        Ok(Response::new(ReceiverStream::new(rx)))
+    }
+
+    async fn snapshot(
+        &self,
+        request: Request<SnapshotRequest>,
+    ) -> Result<Response<SnapshotResponse>, Status> {
+        let mut prefixes = request.into_inner().prefixes;
+        if prefixes.is_empty() {
+            prefixes.push(String::new());
         }
 
-        let count = keys.len() as i32;
-        info!("Listed {} keys with prefix '{}'", count, req.prefix);
-        Ok(Response::new(ListKeysResponse {
-            keys,
-            total_count: count,
+        let hub = self.watch.clone();
+        let scanned = prefixes.clone();
+        let (revision, entries) = self
+            .run_blocking(move |db| {
+                let (revision, snapshot) = hub.snapshot(db);
+                let mut entries = Vec::new();
+                for prefix in &scanned {
+                    let page = scan_prefix(db, prefix, "", usize::MAX, Some(&snapshot))?;
+                    entries.extend(page.entries.into_iter().filter_map(
+                        |(key_bytes, value_bytes)| {
+                            match (
+                                String::from_utf8(key_bytes.into_vec()),
+                                String::from_utf8(value_bytes.into_vec()),
+                            ) {
+                                (Ok(key), Ok(value)) => Some((key, value)),
+                                _ => None, // Skip invalid UTF-8 entries
+                            }
+                        },
+                    ));
+                }
+                Ok::<_, rocksdb::Error>((revision, entries))
+            })
+            .await?
+            .map_err(|e| {
+                error!("Snapshot failed for {:?}: {}", prefixes, e);
+                Status::internal(format!("RocksDB iterator error: {}", e))
+            })?;
+
+        // Overlapping prefixes are merged into one sorted set of keys
+        let snapshot = ExportedSnapshot::new(revision, entries);
+        let data = snapshot.encode();
+        info!(
+            "Snapshot of {:?}: {} keys, {} bytes at revision {}",
+            prefixes,
+            snapshot.len(),
+            data.len(),
+            revision
+        );
+        Ok(Response::new(SnapshotResponse {
+            revision,
+            data,
+            entry_count: snapshot.len() as u32,
             error: String::new(),
         }))
     }
@@ -368,7 +902,7 @@ async fn main() -> anyhow::Result<()> {
     init_db(&args.path)?;
 
     let bind_addr = format!("{}:{}", args.addr, args.port).parse()?;
-    let rocksdb_service = RocksDbServiceImpl;
+    let rocksdb_service = RocksDbServiceImpl::new(args.max_blocking);
 
     info!("🚀 RocksDB gRPC Service starting on {}", bind_addr);
     info!("📁 Database path: {}", args.path);
@@ -382,3 +916,74 @@ async fn main() -> anyhow::Result<()> {
 
     Ok(())
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_is_valid_key() {
+        assert!(is_valid_key("/model/m1/state"));
+        assert!(!is_valid_key(""));
+        assert!(is_valid_key(&"k".repeat(1024)));
+        assert!(!is_valid_key(&"k".repeat(1025)));
+        assert!(!is_valid_key("Package/{name}"));
+    }
+
+    #[test]
+    fn test_prefix_upper_bound() {
+        assert_eq!(prefix_upper_bound(b"Package/"), Some(b"Package0".to_vec()));
+        assert_eq!(prefix_upper_bound(b"a\xff"), Some(b"b".to_vec()));
+        assert_eq!(prefix_upper_bound(b"\xff\xff"), None);
+        assert_eq!(prefix_upper_bound(b""), None);
+    }
+
+    #[test]
+    fn test_scan_prefix_pagination() {
+        let path = std::env::temp_dir().join(format!("rocksdbservice_scan_{}", std::process::id()));
+        {
+            let mut opts = Options::default();
+            opts.create_if_missing(true);
+            opts.set_prefix_extractor(SliceTransform::create_fixed_prefix(PREFIX_EXTRACTOR_LEN));
+            let db = DB::open(&opts, &path).unwrap();
+            for key in [
+                "Package/a",
+                "Package/b",
+                "Package/c",
+                "Packagf",
+                "Scenario/a",
+            ] {
+                db.put(key, "v").unwrap();
+            }
+
+            let page = scan_prefix(&db, "Package/", "", 2, None).unwrap();
+            let keys: Vec<&[u8]> = page.entries.iter().map(|(k, _)| &**k).collect();
+            assert_eq!(keys, vec![&b"Package/a"[..], &b"Package/b"[..]]);
+            assert!(page.has_more);
+
+            let page = scan_prefix(&db, "Package/", "Package/b", 2, None).unwrap();
+            let keys: Vec<&[u8]> = page.entries.iter().map(|(k, _)| &**k).collect();
+            assert_eq!(keys, vec![&b"Package/c"[..]]);
+            assert!(!page.has_more);
+
+            let page = scan_prefix(&db, "", "", usize::MAX, None).unwrap();
+            assert_eq!(page.entries.len(), 5);
+
+            let page = scan_prefix_reverse(&db, "Package/", "", 2).unwrap();
+            let keys: Vec<&[u8]> = page.entries.iter().map(|(k, _)| &**k).collect();
+            assert_eq!(keys, vec![&b"Package/c"[..], &b"Package/b"[..]]);
+            assert!(page.has_more);
+
+            let page = scan_prefix_reverse(&db, "Package/", "Package/b", 2).unwrap();
+            let keys: Vec<&[u8]> = page.entries.iter().map(|(k, _)| &**k).collect();
+            assert_eq!(keys, vec![&b"Package/a"[..]]);
+            assert!(!page.has_more);
+
+            assert!(scan_prefix_reverse(&db, "Package/", "Package/", 2)
+                .unwrap()
+                .entries
+                .is_empty());
+        }
+        let _ = DB::destroy(&Options::default(), &path);
+    }
+}
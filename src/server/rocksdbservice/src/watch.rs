@@ -0,0 +1,307 @@
+/*
+ * SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//! Commit fan-out for the Watch RPC.
+//!
+//! Every write goes through [`WatchHub::commit`], which applies the batch and
+//! publishes its events at a revision taken right after the write.
+//!
+//! Commits do not exclude each other, so concurrent writes still reach
+//! RocksDB together and share its group commit. Only commits touching a
+//! common key are serialized, through a striped key lock held from the write
+//! until the publish; watchers therefore see the writes of one key in the
+//! order they were applied. Revisions are handed out under a short lock
+//! after the write, so they are strictly increasing in publish order and
+//! never below the RocksDB sequence number of the batch.
+
+use common::rocksdbservice::{watch_event, WatchEvent};
+use rocksdb::{Snapshot, WriteBatch, DB};
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+use std::sync::{Arc, Mutex, MutexGuard, RwLock};
+use tokio::sync::broadcast;
+
+/// Number of commits buffered per watcher. A watcher that falls further
+/// behind is disconnected and has to resync.
+pub const WATCH_BUFFER: usize = 4096;
+
+/// Number of key locks; commits on keys of different stripes run in parallel.
+const KEY_STRIPES: usize = 64;
+
+/// Key locks a commit holds: sorted, unique stripe indices, so commits
+/// always acquire them in the same order.
+pub struct KeyStripes(Vec<usize>);
+
+impl KeyStripes {
+    pub fn of<'a>(keys: impl IntoIterator<Item = &'a str>) -> Self {
+        let mut stripes: Vec<usize> = keys
+            .into_iter()
+            .map(|key| {
+                let mut hasher = DefaultHasher::new();
+                key.hash(&mut hasher);
+                (hasher.finish() % KEY_STRIPES as u64) as usize
+            })
+            .collect();
+        stripes.sort_unstable();
+        stripes.dedup();
+        Self(stripes)
+    }
+}
+
+/// Events of one committed write batch.
+#[derive(Clone)]
+pub struct CommittedBatch {
+    pub revision: u64,
+    pub events: Arc<Vec<WatchEvent>>,
+}
+
+pub struct WatchHub {
+    tx: broadcast::Sender<CommittedBatch>,
+    /// Shared by commits, exclusive for [`WatchHub::snapshot`]
+    gate: RwLock<()>,
+    key_locks: Vec<Mutex<()>>,
+    /// Last revision handed out; publishes happen under this lock
+    published: Mutex<u64>,
+}
+
+impl WatchHub {
+    pub fn new(capacity: usize) -> Self {
+        let (tx, _) = broadcast::channel(capacity);
+        Self {
+            tx,
+            gate: RwLock::new(()),
+            key_locks: (0..KEY_STRIPES).map(|_| Mutex::new(())).collect(),
+            published: Mutex::new(0),
+        }
+    }
+
+    pub fn subscribe(&self) -> broadcast::Receiver<CommittedBatch> {
+        self.tx.subscribe()
+    }
+
+    /// Apply `batch` and publish its events at the revision it committed at.
+    ///
+    /// `keys` must cover every key the batch writes. `events` is only
+    /// invoked when someone is watching, so unwatched writes do not pay for
+    /// copying keys and values. The check and the whole commit run under the
+    /// shared side of the gate [`WatchHub::snapshot`] takes exclusively: a
+    /// watcher subscribes before taking its snapshot, so any commit after
+    /// that snapshot sees it and publishes.
+    pub fn commit<E>(
+        &self,
+        db: &DB,
+        batch: WriteBatch,
+        keys: &KeyStripes,
+        events: E,
+    ) -> Result<u64, rocksdb::Error>
+    where
+        E: FnOnce() -> Vec<WatchEvent>,
+    {
+        let _gate = self.gate.read().unwrap_or_else(|e| e.into_inner());
+        let _keys: Vec<MutexGuard<'_, ()>> = keys
+            .0
+            .iter()
+            .map(|&stripe| lock(&self.key_locks[stripe]))
+            .collect();
+        let events = if self.tx.receiver_count() > 0 {
+            events()
+        } else {
+            Vec::new()
+        };
+        db.write(batch)?;
+
+        let mut published = lock(&self.published);
+        // Read after the write, so at least the sequence number of this
+        // batch; bumped when a concurrent commit already took that value
+        let revision = db.latest_sequence_number().max(*published + 1);
+        *published = revision;
+        if !events.is_empty() {
+            // Only fails when nobody is watching
+            let _ = self.tx.send(CommittedBatch {
+                revision,
+                events: Arc::new(events),
+            });
+        }
+        Ok(revision)
+    }
+
+    /// Take a snapshot together with its revision. The gate waits for
+    /// commits in flight and holds new ones back, so every batch published
+    /// at or below the revision is in the snapshot and every later one has a
+    /// higher revision.
+    pub fn snapshot<'a>(&self, db: &'a DB) -> (u64, Snapshot<'a>) {
+        let _gate = self.gate.write().unwrap_or_else(|e| e.into_inner());
+        let published = *lock(&self.published);
+        (db.latest_sequence_number().max(published), db.snapshot())
+    }
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+pub fn put_event(key: &str, value: &str) -> WatchEvent {
+    WatchEvent {
+        kind: watch_event::Kind::Put as i32,
+        key: key.to_string(),
+        value: value.to_string(),
+    }
+}
+
+pub fn delete_event(key: &str) -> WatchEvent {
+    WatchEvent {
+        kind: watch_event::Kind::Delete as i32,
+        key: key.to_string(),
+        value: String::new(),
+    }
+}
+
+/// Events of `batch` under `prefix`, or `None` when the batch is already
+/// covered by `after_revision` or touches no watched key.
+pub fn events_for_prefix(
+    batch: &CommittedBatch,
+    prefix: &str,
+    after_revision: u64,
+) -> Option<Vec<WatchEvent>> {
+    if batch.revision <= after_revision {
+        return None;
+    }
+    let events: Vec<WatchEvent> = batch
+        .events
+        .iter()
+        .filter(|event| event.key.starts_with(prefix))
+        .cloned()
+        .collect();
+    if events.is_empty() {
+        None
+    } else {
+        Some(events)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn batch(revision: u64, keys: &[&str]) -> CommittedBatch {
+        CommittedBatch {
+            revision,
+            events: Arc::new(keys.iter().map(|k| put_event(k, "v")).collect()),
+        }
+    }
+
+    #[test]
+    fn test_events_for_prefix_filters_keys() {
+        let b = batch(10, &["Package/a", "Scenario/a", "Package/b"]);
+        let events = events_for_prefix(&b, "Package/", 0).unwrap();
+        let keys: Vec<&str> = events.iter().map(|e| e.key.as_str()).collect();
+        assert_eq!(keys, vec!["Package/a", "Package/b"]);
+
+        assert!(events_for_prefix(&b, "Model/", 0).is_none());
+        assert_eq!(events_for_prefix(&b, "", 0).unwrap().len(), 3);
+    }
+
+    #[test]
+    fn test_events_for_prefix_skips_covered_revisions() {
+        let b = batch(10, &["Package/a"]);
+        assert!(events_for_prefix(&b, "Package/", 10).is_none());
+        assert!(events_for_prefix(&b, "Package/", 9).is_some());
+    }
+
+    #[test]
+    fn test_delete_event_has_no_value() {
+        let event = delete_event("Package/a");
+        assert_eq!(event.kind(), watch_event::Kind::Delete);
+        assert!(event.value.is_empty());
+    }
+
+    #[test]
+    fn test_commit_publishes_revision_in_order() {
+        let path =
+            std::env::temp_dir().join(format!("rocksdbservice_watch_{}", std::process::id()));
+        {
+            let mut opts = rocksdb::Options::default();
+            opts.create_if_missing(true);
+            let db = DB::open(&opts, &path).unwrap();
+            let hub = WatchHub::new(16);
+            let mut rx = hub.subscribe();
+
+            for key in ["k1", "k2"] {
+                let mut wb = WriteBatch::default();
+                wb.put(key, "v");
+                hub.commit(&db, wb, &KeyStripes::of([key]), || {
+                    vec![put_event(key, "v")]
+                })
+                .unwrap();
+            }
+
+            let first = rx.try_recv().unwrap();
+            let second = rx.try_recv().unwrap();
+            assert!(first.revision < second.revision);
+            assert_eq!(second.events[0].key, "k2");
+
+            let (revision, _snapshot) = hub.snapshot(&db);
+            assert_eq!(revision, second.revision);
+        }
+        let _ = DB::destroy(&rocksdb::Options::default(), &path);
+    }
+
+    #[test]
+    fn test_key_stripes_are_sorted_and_unique() {
+        let stripes = KeyStripes::of(["a", "b", "a", "c"]);
+        assert!(stripes.0.windows(2).all(|pair| pair[0] < pair[1]));
+        assert_eq!(stripes.0.len(), KeyStripes::of(["a", "b", "c"]).0.len());
+        assert!(KeyStripes::of(Vec::<&str>::new()).0.is_empty());
+    }
+
+    #[test]
+    fn test_concurrent_commits_publish_increasing_revisions() {
+        let path = std::env::temp_dir().join(format!(
+            "rocksdbservice_watch_concurrent_{}",
+            std::process::id()
+        ));
+        {
+            let mut opts = rocksdb::Options::default();
+            opts.create_if_missing(true);
+            let db = DB::open(&opts, &path).unwrap();
+            let hub = WatchHub::new(1024);
+            let mut rx = hub.subscribe();
+
+            std::thread::scope(|scope| {
+                for writer in 0..4 {
+                    let (db, hub) = (&db, &hub);
+                    scope.spawn(move || {
+                        for i in 0..50 {
+                            // Every writer also updates the shared key
+                            let own = format!("k{}", writer);
+                            let value = format!("{}-{}", writer, i);
+                            let mut wb = WriteBatch::default();
+                            wb.put(&own, &value);
+                            wb.put("shared", &value);
+                            let keys = KeyStripes::of([own.as_str(), "shared"]);
+                            hub.commit(db, wb, &keys, || {
+                                vec![put_event(&own, &value), put_event("shared", &value)]
+                            })
+                            .unwrap();
+                        }
+                    });
+                }
+            });
+
+            let mut last_revision = 0;
+            let mut last_shared = String::new();
+            while let Ok(batch) = rx.try_recv() {
+                assert!(batch.revision > last_revision);
+                last_revision = batch.revision;
+                last_shared = batch.events[1].value.clone();
+            }
+            // The last published value of the shared key is the stored one
+            let stored = db.get("shared").unwrap().unwrap();
+            assert_eq!(last_shared.as_bytes(), stored.as_slice());
+            assert_eq!(hub.snapshot(&db).0, last_revision);
+        }
+        let _ = DB::destroy(&rocksdb::Options::default(), &path);
+    }
+}
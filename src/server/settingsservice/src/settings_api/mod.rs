@@ -8,7 +8,7 @@ use crate::settings_config::{Config, ConfigManager, ConfigSummary, ValidationRes
 use crate::settings_history::{HistoryEntry, HistoryManager};
 use crate::settings_monitoring::{
     BoardListResponse, FilterSummary, Metric, MetricsFilter, MonitoringManager, NodeListResponse,
-    SocListResponse,
+    SocListResponse, TEMP_FILTER_ID,
 };
 use crate::settings_utils::error::SettingsError;
 use axum::{
@@ -265,16 +265,27 @@ async fn get_metrics(
 ) -> Result<Json<Vec<Metric>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics with query: {:?}", query);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
-
     let filter = if let Some(filter_id) = query.filter_id {
-        match monitoring_manager.get_filter(&filter_id).await {
-            Ok(filter) => Some(filter),
-            Err(_) => return Err(not_found_error("Filter not found")),
+        let cached = state
+            .monitoring_manager
+            .read()
+            .await
+            .cached_filter(&filter_id);
+        match cached {
+            Some(filter) => Some(filter),
+            None => {
+                // Filters not seen yet are read from storage, which needs
+                // exclusive access; afterwards they are served from memory
+                let mut monitoring_manager = state.monitoring_manager.write().await;
+                match monitoring_manager.get_filter(&filter_id).await {
+                    Ok(filter) => Some(filter),
+                    Err(_) => return Err(not_found_error("Filter not found")),
+                }
+            }
         }
     } else if query.component.is_some() || query.metric_type.is_some() {
         Some(MetricsFilter {
-            id: "temp".to_string(),
+            id: TEMP_FILTER_ID.to_string(),
             name: "Temporary filter".to_string(),
             enabled: true,
             components: query.component.map(|c| vec![c]),
@@ -291,6 +302,7 @@ async fn get_metrics(
         None
     };
 
+    let monitoring_manager = state.monitoring_manager.read().await;
     match monitoring_manager.get_metrics(filter.as_ref()).await {
         Ok(metrics) => Ok(Json(metrics)),
         Err(e) => Err(internal_error(&format!("Failed to get metrics: {}", e))),
@@ -303,7 +315,7 @@ async fn get_metric_by_id(
 ) -> Result<Json<Metric>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/{}", id);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_metric_by_id(&id).await {
         Ok(Some(metric)) => Ok(Json(metric)),
@@ -318,7 +330,7 @@ async fn get_metrics_by_component(
 ) -> Result<Json<Vec<Metric>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/component/{}", component);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager
         .get_metrics_by_component(&component)
@@ -335,7 +347,7 @@ async fn get_metrics_by_type(
 ) -> Result<Json<Vec<Metric>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/type/{}", metric_type);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_metrics_by_type(&metric_type).await {
         Ok(metrics) => Ok(Json(metrics)),
@@ -790,7 +802,7 @@ async fn get_pod_metrics(
 ) -> Result<Json<PodMetricsResponse>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/nodes/{}/pods/metrics", node_name);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_containers_by_node(&node_name).await {
         Ok(containers) => {
@@ -968,7 +980,7 @@ async fn get_all_node_metrics(
 ) -> Result<Json<Vec<NodeInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/nodes");
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_node_metrics().await {
         Ok(nodes) => {
@@ -992,7 +1004,7 @@ async fn list_containers(
 ) -> Result<Json<Vec<ContainerInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/containers with query: {:?}", query);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_container_metrics().await {
         Ok(containers) => {
@@ -1023,7 +1035,7 @@ async fn get_container(
 ) -> Result<Json<ContainerInfo>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/containers/{}", id);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_container_metric_by_id(&id).await {
         Ok(Some(container)) => {
@@ -1052,7 +1064,7 @@ async fn get_containers_by_node(
 ) -> Result<Json<Vec<ContainerInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/nodes/{}/containers", node_name);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_containers_by_node(&node_name).await {
         Ok(mut containers) => {
@@ -1189,7 +1201,7 @@ async fn get_all_container_metrics(
 ) -> Result<Json<Vec<ContainerInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/containers");
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_container_metrics().await {
         Ok(containers) => {
@@ -1211,7 +1223,7 @@ async fn get_all_soc_metrics(
 ) -> Result<Json<Vec<SocInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/socs");
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_soc_metrics().await {
         Ok(socs) => {
@@ -1230,7 +1242,7 @@ async fn get_all_board_metrics(
 ) -> Result<Json<Vec<BoardInfo>>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/boards");
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_board_metrics().await {
         Ok(boards) => {
@@ -1340,7 +1352,7 @@ async fn get_node_metric_by_name(
 ) -> Result<Json<NodeInfo>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/nodes/{}", name);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_node_metric_by_name(&name).await {
         Ok(Some(node)) => Ok(Json(node)),
@@ -1355,7 +1367,7 @@ async fn get_container_metric_by_id(
 ) -> Result<Json<ContainerInfo>, (StatusCode, Json<ErrorResponse>)> {
     debug!("GET /api/v1/metrics/containers/{}", id);
 
-    let mut monitoring_manager = state.monitoring_manager.write().await;
+    let monitoring_manager = state.monitoring_manager.read().await;
 
     match monitoring_manager.get_container_metric_by_id(&id).await {
         Ok(Some(container)) => Ok(Json(container)),
@@ -68,10 +68,14 @@ impl CoreManager {
         // Initialize managers
         let config_manager = Arc::new(RwLock::new(ConfigManager::new(Box::new(storage_config))));
         let history_manager = Arc::new(RwLock::new(HistoryManager::new(Box::new(storage_history))));
-        let monitoring_manager = Arc::new(RwLock::new(MonitoringManager::new(
+        // Writes under /piccolo/metrics/ invalidate the cache, so the TTL
+        // only bounds staleness while that watch reconnects
+        let monitoring_manager = MonitoringManager::new(
             Box::new(storage_monitoring),
-            1, // 1 seconds cache TTL
-        )));
+            10, // 10 seconds cache TTL
+        );
+        monitoring_manager.spawn_cache_invalidation();
+        let monitoring_manager = Arc::new(RwLock::new(monitoring_manager));
 
         // Initialize API server
         let api_server = ApiServer::new(
@@ -2,15 +2,32 @@
 // SPDX-License-Identifier: Apache-2.0
 
 //! Configuration history management module
-
-use crate::settings_config::{Config, ConfigManager};
-use crate::settings_storage::{history_key, Storage};
+//!
+//! Every version of a configuration is stored under [`history_key`], whose
+//! zero-padded version makes key order version order. A version recorded
+//! right after the one before it holds only the `calculate_diff` delta to
+//! that version; every `SNAPSHOT_INTERVAL`th version, and any version whose
+//! predecessor this manager did not record, holds the full configuration.
+//! Reading a version therefore needs at most one short reverse scan back
+//! to the nearest full snapshot.
+//!
+//! Entries recorded before keys were padded (`…/v42`) sort above every
+//! padded key. They are moved to their padded keys the first time a
+//! configuration's history is read.
+
+use crate::settings_config::{Config, ConfigManager, ConfigMetadata};
+use crate::settings_storage::{history_key, history_version_prefix, Storage};
 use crate::settings_utils::error::SettingsError;
 use chrono::{DateTime, Utc};
 use serde::{Deserialize, Serialize};
 use serde_json::Value;
+use std::collections::{HashMap, HashSet};
 use tracing::{debug, info, warn};
 
+/// Versions that are multiples of this always store the full configuration,
+/// which bounds a delta chain to `SNAPSHOT_INTERVAL - 1` entries
+const SNAPSHOT_INTERVAL: u64 = 10;
+
 /// History entry for configuration changes
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct HistoryEntry {
@@ -52,11 +69,20 @@ pub enum DiffOperation {
 /// History manager for tracking configuration changes
 pub struct HistoryManager {
     storage: Box<dyn Storage>,
+    /// Last version recorded per configuration; a delta is only written on
+    /// top of a version known to be in storage
+    last_recorded: HashMap<String, u64>,
+    /// Configurations whose legacy unpadded keys were already migrated
+    migrated: HashSet<String>,
 }
 #[allow(dead_code)]
 impl HistoryManager {
     pub fn new(storage: Box<dyn Storage>) -> Self {
-        Self { storage }
+        Self {
+            storage,
+            last_recorded: HashMap::new(),
+            migrated: HashSet::new(),
+        }
     }
 
     /// Record a configuration change
@@ -88,14 +114,30 @@ impl HistoryManager {
             change_summary,
         };
 
-        // Store the full config as well for rollback purposes
-        let history_data = serde_json::json!({
-            "entry": history_entry,
-            "config": new_config
+        let base = old_config.filter(|old| {
+            version % SNAPSHOT_INTERVAL != 0
+                && old.metadata.version.checked_add(1) == Some(version)
+                && self.last_recorded.get(config_path) == Some(&old.metadata.version)
         });
+        let delta = base.and_then(|old| Self::compact_delta(&old.content, &new_config.content));
+
+        let history_data = match delta {
+            Some(delta) => serde_json::json!({
+                "entry": history_entry,
+                "base": version - 1,
+                "metadata": new_config.metadata,
+                "delta": delta
+            }),
+            // Store the full config as well for rollback purposes
+            None => serde_json::json!({
+                "entry": history_entry,
+                "config": new_config
+            }),
+        };
 
         let key = history_key(config_path, version);
         self.storage.put_json(&key, &history_data).await?;
+        self.last_recorded.insert(config_path.to_string(), version);
 
         info!(
             "Recorded history entry for {} version {}",
@@ -112,14 +154,19 @@ impl HistoryManager {
     ) -> Result<Vec<HistoryEntry>, SettingsError> {
         debug!("Listing history for: {}", config_path);
 
-        let prefix = format!(
-            "{}{}/",
-            crate::settings_storage::KeyPrefixes::HISTORY,
-            config_path
-        );
-
-        let entries = self.storage.list(&prefix).await?;
-        let mut history_entries = Vec::new();
+        if limit == Some(0) {
+            return Ok(Vec::new());
+        }
+        self.migrate_legacy_keys(config_path).await?;
+
+        // Keys sort by version, so the newest `limit` entries are the first
+        // `limit` keys of a reverse scan and older ones are never read
+        let prefix = history_version_prefix(config_path);
+        let entries = self
+            .storage
+            .list_reverse(&prefix, "", limit.unwrap_or(usize::MAX))
+            .await?;
+        let mut history_entries = Vec::with_capacity(entries.len());
 
         for (key, value) in entries {
             match serde_json::from_str::<serde_json::Value>(&value) {
@@ -153,25 +200,188 @@ impl HistoryManager {
         version: u64,
     ) -> Result<Config, SettingsError> {
         debug!("Getting version {} of {}", version, config_path);
+        self.migrate_legacy_keys(config_path).await?;
 
         let key = history_key(config_path, version);
-        if let Some(history_data) = self.storage.get_json(&key).await? {
-            if let Some(config_data) = history_data.get("config") {
-                let config: Config = serde_json::from_value(config_data.clone()).map_err(|e| {
-                    SettingsError::History(format!("Failed to deserialize config: {}", e))
-                })?;
-
-                Ok(config)
-            } else {
-                Err(SettingsError::History(
-                    "Config data not found in history entry".to_string(),
-                ))
-            }
-        } else {
-            Err(SettingsError::History(format!(
+        let history_data = self.storage.get_json(&key).await?.ok_or_else(|| {
+            SettingsError::History(format!(
                 "Version {} not found for config {}",
                 version, config_path
-            )))
+            ))
+        })?;
+
+        if let Some(config_data) = history_data.get("config") {
+            let config: Config = serde_json::from_value(config_data.clone()).map_err(|e| {
+                SettingsError::History(format!("Failed to deserialize config: {}", e))
+            })?;
+
+            Ok(config)
+        } else if history_data.get("delta").is_some() {
+            self.rebuild_version(config_path, version, &key, history_data)
+                .await
+        } else {
+            Err(SettingsError::History(
+                "Config data not found in history entry".to_string(),
+            ))
+        }
+    }
+
+    /// Rebuild a delta-encoded version from the nearest full snapshot
+    /// below it, read with one bounded reverse scan
+    async fn rebuild_version(
+        &mut self,
+        config_path: &str,
+        version: u64,
+        key: &str,
+        history_data: Value,
+    ) -> Result<Config, SettingsError> {
+        let metadata: ConfigMetadata = history_data
+            .get("metadata")
+            .cloned()
+            .ok_or_else(|| SettingsError::History("Delta entry without metadata".to_string()))
+            .and_then(|metadata| {
+                serde_json::from_value(metadata).map_err(|e| {
+                    SettingsError::History(format!("Failed to deserialize metadata: {}", e))
+                })
+            })?;
+
+        let older = self
+            .storage
+            .list_reverse(
+                &history_version_prefix(config_path),
+                key,
+                SNAPSHOT_INTERVAL as usize,
+            )
+            .await?;
+
+        // Deltas from `version` down to the snapshot, newest first
+        let mut deltas = vec![Self::parse_delta(&history_data)?];
+        let mut expected = version;
+        let mut content = None;
+        for (older_key, value) in older {
+            let data: Value = serde_json::from_str(&value).map_err(|e| {
+                SettingsError::History(format!("Failed to parse history data {}: {}", older_key, e))
+            })?;
+            expected = match expected.checked_sub(1) {
+                Some(expected) => expected,
+                None => break,
+            };
+            if data.pointer("/entry/version").and_then(Value::as_u64) != Some(expected) {
+                break;
+            }
+            if let Some(config) = data.pointer("/config/content") {
+                content = Some(config.clone());
+                break;
+            }
+            deltas.push(Self::parse_delta(&data)?);
+        }
+
+        let mut content = content.ok_or_else(|| {
+            SettingsError::History(format!(
+                "History of config {} has no snapshot below version {}",
+                config_path, version
+            ))
+        })?;
+        for delta in deltas.iter().rev() {
+            Self::apply_diff(&mut content, delta);
+        }
+
+        Ok(Config {
+            path: config_path.to_string(),
+            content,
+            metadata,
+        })
+    }
+
+    /// Move the unpadded keys of `config_path` to their padded form, once
+    /// per configuration. Legacy entries all hold full configurations, so
+    /// their values are copied as they are.
+    async fn migrate_legacy_keys(&mut self, config_path: &str) -> Result<(), SettingsError> {
+        if self.migrated.contains(config_path) {
+            return Ok(());
+        }
+
+        let prefix = history_version_prefix(config_path);
+        for (key, value) in self.storage.list(&prefix).await? {
+            let Some(version) = key.strip_prefix(&prefix).and_then(legacy_version) else {
+                continue;
+            };
+            let padded = history_key(config_path, version);
+            if self.storage.get(&padded).await?.is_none() {
+                self.storage.put(&padded, &value).await?;
+            }
+            self.storage.delete(&key).await?;
+            info!("Migrated history entry {} to {}", key, padded);
+        }
+
+        self.migrated.insert(config_path.to_string());
+        Ok(())
+    }
+
+    fn parse_delta(history_data: &Value) -> Result<Vec<DiffEntry>, SettingsError> {
+        let delta = history_data.get("delta").cloned().ok_or_else(|| {
+            SettingsError::History("Config data not found in history entry".to_string())
+        })?;
+        serde_json::from_value(delta)
+            .map_err(|e| SettingsError::History(format!("Failed to deserialize delta: {}", e)))
+    }
+
+    /// Delta from `old` to `new`, `None` when a full snapshot is as small or
+    /// the dotted paths cannot reproduce `new` (keys containing `.`)
+    fn compact_delta(old: &Value, new: &Value) -> Option<Vec<DiffEntry>> {
+        let mut delta = Self::calculate_diff(old, new);
+        let mut rebuilt = old.clone();
+        Self::apply_diff(&mut rebuilt, &delta);
+        if &rebuilt != new {
+            return None;
+        }
+        // Rebuilding only walks forward, the old values are not needed
+        for diff in &mut delta {
+            diff.old_value = None;
+        }
+
+        let delta_len = serde_json::to_vec(&delta).ok()?.len();
+        let full_len = serde_json::to_vec(new).ok()?.len();
+        (delta_len < full_len).then_some(delta)
+    }
+
+    /// Apply differences produced by [`HistoryManager::calculate_diff`]
+    pub fn apply_diff(config: &mut Value, diffs: &[DiffEntry]) {
+        for diff in diffs {
+            if diff.path.is_empty() {
+                *config = diff.new_value.clone().unwrap_or(Value::Null);
+                continue;
+            }
+
+            let mut segments: Vec<&str> = diff.path.split('.').collect();
+            let last = segments.pop().unwrap_or_default();
+            let mut target = &mut *config;
+            for segment in segments {
+                if !target.is_object() {
+                    *target = Value::Object(Default::default());
+                }
+                target = target
+                    .as_object_mut()
+                    .expect("target is an object")
+                    .entry(segment)
+                    .or_insert_with(|| Value::Object(Default::default()));
+            }
+            if !target.is_object() {
+                *target = Value::Object(Default::default());
+            }
+            let map = target.as_object_mut().expect("target is an object");
+
+            match diff.operation {
+                DiffOperation::Remove => {
+                    map.remove(last);
+                }
+                DiffOperation::Add | DiffOperation::Change => {
+                    map.insert(
+                        last.to_string(),
+                        diff.new_value.clone().unwrap_or(Value::Null),
+                    );
+                }
+            }
         }
     }
 
@@ -367,6 +577,15 @@ impl HistoryManager {
     }
 }
 
+/// Version of a legacy key suffix such as `42`; padded suffixes always have
+/// the full width and are not legacy
+fn legacy_version(suffix: &str) -> Option<u64> {
+    if suffix.is_empty() || suffix.len() == 20 || !suffix.bytes().all(|b| b.is_ascii_digit()) {
+        return None;
+    }
+    suffix.parse().ok()
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -868,7 +1087,7 @@ mod tests {
     async fn test_list_history_empty() {
         let mut storage = MockStorage::new();
         storage.set_list_result(
-            "/piccolo/settings/history//test/config/".to_string(),
+            "/piccolo/settings/history//test/config/v".to_string(),
             HashMap::new(),
         );
 
@@ -926,7 +1145,7 @@ mod tests {
         );
 
         storage.set_list_result(
-            "/piccolo/settings/history//test/config/".to_string(),
+            "/piccolo/settings/history//test/config/v".to_string(),
             list_result,
         );
 
@@ -972,7 +1191,7 @@ mod tests {
         }
 
         storage.set_list_result(
-            "/piccolo/settings/history//test/config/".to_string(),
+            "/piccolo/settings/history//test/config/v".to_string(),
             list_result,
         );
 
@@ -985,6 +1204,123 @@ mod tests {
         assert_eq!(history.len(), 3); // Limited to 3 entries
     }
 
+    #[tokio::test]
+    async fn test_versions_rebuilt_from_deltas() {
+        let mut manager = HistoryManager::new(Box::new(MockStorage::new()));
+
+        let mut first = create_test_config();
+        first.content["bio"] = json!("x".repeat(200));
+        let mut configs = vec![first];
+        manager
+            .record_change("/test/config", None, &configs[0], ChangeAction::Create)
+            .await
+            .unwrap();
+        for version in 2..=12 {
+            let old = configs.last().unwrap().clone();
+            let mut new = old.clone();
+            new.metadata.version = version;
+            new.content["age"] = json!(29 + version);
+            new.content["nested"] = json!({ "level": version, "tags": ["a", "b"] });
+            if version == 5 {
+                new.content.as_object_mut().unwrap().remove("email");
+            }
+            manager
+                .record_change("/test/config", Some(&old), &new, ChangeAction::Update)
+                .await
+                .unwrap();
+            configs.push(new);
+        }
+
+        // Version 2 follows version 1 and is stored as a delta; 10 is a snapshot
+        let stored = manager
+            .storage
+            .get_json(&history_key("/test/config", 2))
+            .await
+            .unwrap()
+            .unwrap();
+        assert!(stored.get("delta").is_some() && stored.get("config").is_none());
+        let stored = manager
+            .storage
+            .get_json(&history_key("/test/config", 10))
+            .await
+            .unwrap()
+            .unwrap();
+        assert!(stored.get("config").is_some());
+
+        for config in &configs {
+            let version = config.metadata.version;
+            let rebuilt = manager.get_version("/test/config", version).await.unwrap();
+            assert_eq!(rebuilt.content, config.content, "version {}", version);
+            assert_eq!(rebuilt.metadata.version, version);
+        }
+
+        let history = manager.list_history("/test/config", Some(3)).await.unwrap();
+        let versions: Vec<u64> = history.iter().map(|entry| entry.version).collect();
+        assert_eq!(versions, vec![12, 11, 10]);
+    }
+
+    #[tokio::test]
+    async fn test_legacy_keys_migrated_before_listing() {
+        let mut manager = HistoryManager::new(Box::new(MockStorage::new()));
+        let full = |version: u64| {
+            let mut config = create_test_config();
+            config.metadata.version = version;
+            let mut entry = create_test_history_entry();
+            entry.version = version;
+            serde_json::json!({ "entry": entry, "config": config }).to_string()
+        };
+        // Recorded before keys were padded, plus a nested configuration
+        for version in [1, 2, 42] {
+            let key = format!("/piccolo/settings/history//test/config/v{}", version);
+            manager.storage.put(&key, &full(version)).await.unwrap();
+        }
+        manager
+            .storage
+            .put(&history_key("/test/config", 43), &full(43))
+            .await
+            .unwrap();
+        manager
+            .storage
+            .put(&history_key("/test/config/nested", 99), &full(99))
+            .await
+            .unwrap();
+
+        let history = manager.list_history("/test/config", Some(2)).await.unwrap();
+        let versions: Vec<u64> = history.iter().map(|entry| entry.version).collect();
+        assert_eq!(versions, vec![43, 42]);
+
+        let keys = manager
+            .storage
+            .list(&history_version_prefix("/test/config"))
+            .await
+            .unwrap();
+        assert!(keys.iter().all(|(key, _)| !key.ends_with("/v42")));
+        assert_eq!(
+            manager
+                .get_version("/test/config", 2)
+                .await
+                .unwrap()
+                .metadata
+                .version,
+            2
+        );
+    }
+
+    #[test]
+    fn test_apply_diff_round_trip() {
+        let old = json!({ "a": 1, "b": { "c": 2, "d": [1, 2] }, "e": "x" });
+        let new = json!({ "a": 1, "b": { "c": 3, "f": null }, "g": { "h": true } });
+
+        let diffs = HistoryManager::calculate_diff(&old, &new);
+        let mut rebuilt = old.clone();
+        HistoryManager::apply_diff(&mut rebuilt, &diffs);
+        assert_eq!(rebuilt, new);
+
+        // Dotted keys cannot be addressed by a diff path; a snapshot is kept
+        let dotted = json!({ "a.b": 1 });
+        assert!(HistoryManager::compact_delta(&json!({ "a.b": 0 }), &dotted).is_none());
+    }
+
     #[tokio::test]
     async fn test_get_version_success() {
         let mut storage = MockStorage::new();
@@ -0,0 +1,365 @@
+// SPDX-FileCopyrightText: Copyright 2024 LG Electronics Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Shared metrics cache with single-flight refresh
+//!
+//! Values live behind shared references, so REST handlers read the cache
+//! concurrently. When an entry is missing, expired or invalidated, exactly
+//! one caller fetches it from the backend; callers arriving during that
+//! fetch get the previous value if there is one (stale-while-revalidate)
+//! and otherwise wait for the fetch instead of starting their own.
+//!
+//! A fetch that overlaps an invalidation stores its value but leaves the
+//! entry invalidated, since it may have read the backend before the change.
+
+use super::CacheEntry;
+use std::collections::HashMap;
+use std::future::Future;
+use std::sync::{Arc, Mutex, RwLock};
+use std::time::{Duration, Instant};
+
+struct Slot<T> {
+    state: Mutex<SlotState<T>>,
+    /// Held by the caller that refreshes the entry
+    refresh: tokio::sync::Mutex<()>,
+}
+
+struct SlotState<T> {
+    entry: Option<CacheEntry<T>>,
+    /// Set by watch events; the value is still served while it is refetched
+    invalidated: bool,
+    /// Bumped by every invalidation
+    generation: u64,
+    /// Last read or write, for evicting the least recently used entries
+    used: Instant,
+}
+
+impl<T: Clone> Slot<T> {
+    fn new() -> Self {
+        Self {
+            state: Mutex::new(SlotState {
+                entry: None,
+                invalidated: false,
+                generation: 0,
+                used: Instant::now(),
+            }),
+            refresh: tokio::sync::Mutex::new(()),
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, SlotState<T>> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn fresh(&self) -> Option<T> {
+        let mut state = self.lock();
+        let now = Instant::now();
+        state.used = now;
+        let entry = state.entry.as_ref()?;
+        (!state.invalidated && entry.expiry > now).then(|| entry.data.clone())
+    }
+
+    fn any(&self) -> Option<T> {
+        let mut state = self.lock();
+        state.used = Instant::now();
+        state.entry.as_ref().map(|entry| entry.data.clone())
+    }
+
+    fn generation(&self) -> u64 {
+        self.lock().generation
+    }
+
+    /// Store `data` read at `generation`; it only counts as fresh if no
+    /// invalidation happened since
+    fn store(&self, data: T, ttl: Duration, generation: u64) {
+        let mut state = self.lock();
+        let now = Instant::now();
+        state.entry = Some(CacheEntry {
+            data,
+            expiry: now + ttl,
+        });
+        state.used = now;
+        if state.generation == generation {
+            state.invalidated = false;
+        }
+    }
+
+    fn invalidate(&self) {
+        let mut state = self.lock();
+        state.invalidated = true;
+        state.generation += 1;
+    }
+}
+
+/// String-keyed cache of values shared by concurrent readers
+pub struct MetricsCache<T> {
+    ttl: Duration,
+    slots: RwLock<HashMap<String, Arc<Slot<T>>>>,
+}
+
+impl<T: Clone> MetricsCache<T> {
+    pub fn new(ttl: Duration) -> Self {
+        Self {
+            ttl,
+            slots: RwLock::new(HashMap::new()),
+        }
+    }
+
+    /// Cached value for `key`, or the result of `fetch` run by a single
+    /// caller. Fetch errors are returned to that caller and not cached.
+    pub async fn get_or_fetch<F, Fut, E>(&self, key: &str, fetch: F) -> Result<T, E>
+    where
+        F: FnOnce() -> Fut,
+        Fut: Future<Output = Result<T, E>>,
+    {
+        let slot = self.slot(key);
+        if let Some(data) = slot.fresh() {
+            return Ok(data);
+        }
+
+        let _refresh = match slot.refresh.try_lock() {
+            Ok(guard) => guard,
+            Err(_) => {
+                if let Some(data) = slot.any() {
+                    return Ok(data);
+                }
+                let guard = slot.refresh.lock().await;
+                if let Some(data) = slot.fresh() {
+                    return Ok(data);
+                }
+                // The fetch we waited for failed; try again ourselves
+                guard
+            }
+        };
+
+        let generation = slot.generation();
+        let data = fetch().await?;
+        slot.store(data.clone(), self.ttl, generation);
+        Ok(data)
+    }
+
+    /// Value for `key` if it is neither expired nor invalidated
+    pub fn get(&self, key: &str) -> Option<T> {
+        self.read().get(key)?.fresh()
+    }
+
+    pub fn insert(&self, key: &str, data: T) {
+        let slot = self.slot(key);
+        slot.store(data, self.ttl, slot.generation());
+    }
+
+    /// Drop `key`; the next read fetches it again
+    pub fn remove(&self, key: &str) {
+        self.write().remove(key);
+    }
+
+    /// Drop every key that starts with `prefix`
+    pub fn remove_prefix(&self, prefix: &str) {
+        self.write().retain(|key, _| !key.starts_with(prefix));
+    }
+
+    /// Evict the least recently used keys under `prefix` until at most
+    /// `max` remain. Keys chosen by clients are trimmed this way so that
+    /// request parameters cannot grow the cache without bound.
+    pub fn trim_prefix(&self, prefix: &str, max: usize) {
+        let mut used: Vec<(Instant, String)> = self
+            .read()
+            .iter()
+            .filter(|(key, _)| key.starts_with(prefix))
+            .map(|(key, slot)| (slot.lock().used, key.clone()))
+            .collect();
+        if used.len() <= max {
+            return;
+        }
+        used.sort_unstable();
+        let mut slots = self.write();
+        for (_, key) in &used[..used.len() - max] {
+            slots.remove(key);
+        }
+    }
+
+    /// Mark matching keys for refetch while keeping their values for
+    /// readers that arrive during the refetch
+    pub fn invalidate_where(&self, matches: impl Fn(&str) -> bool) {
+        for (key, slot) in self.read().iter() {
+            if matches(key) {
+                slot.invalidate();
+            }
+        }
+    }
+
+    pub fn clear(&self) {
+        self.write().clear();
+    }
+
+    /// Number of entries and how many of them can be served without a fetch
+    pub fn stats(&self) -> (usize, usize) {
+        let slots = self.read();
+        let valid = slots
+            .values()
+            .filter(|slot| {
+                let state = slot.lock();
+                !state.invalidated
+                    && state
+                        .entry
+                        .as_ref()
+                        .is_some_and(|entry| entry.expiry > Instant::now())
+            })
+            .count();
+        let total = slots
+            .values()
+            .filter(|slot| slot.lock().entry.is_some())
+            .count();
+        (total, valid)
+    }
+
+    fn slot(&self, key: &str) -> Arc<Slot<T>> {
+        if let Some(slot) = self.read().get(key) {
+            return Arc::clone(slot);
+        }
+        Arc::clone(
+            self.write()
+                .entry(key.to_string())
+                .or_insert_with(|| Arc::new(Slot::new())),
+        )
+    }
+
+    fn read(&self) -> std::sync::RwLockReadGuard<'_, HashMap<String, Arc<Slot<T>>>> {
+        self.slots.read().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn write(&self) -> std::sync::RwLockWriteGuard<'_, HashMap<String, Arc<Slot<T>>>> {
+        self.slots.write().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    #[tokio::test]
+    async fn test_concurrent_misses_fetch_once() {
+        let cache = Arc::new(MetricsCache::<u32>::new(Duration::from_secs(60)));
+        let fetches = Arc::new(AtomicUsize::new(0));
+
+        let mut tasks = Vec::new();
+        for _ in 0..8 {
+            let (cache, fetches) = (Arc::clone(&cache), Arc::clone(&fetches));
+            tasks.push(tokio::spawn(async move {
+                cache
+                    .get_or_fetch("nodes", || async {
+                        fetches.fetch_add(1, Ordering::SeqCst);
+                        tokio::time::sleep(Duration::from_millis(50)).await;
+                        Ok::<_, String>(7)
+                    })
+                    .await
+            }));
+        }
+        for task in tasks {
+            assert_eq!(task.await.unwrap(), Ok(7));
+        }
+        assert_eq!(fetches.load(Ordering::SeqCst), 1);
+    }
+
+    #[tokio::test]
+    async fn test_invalidated_value_served_during_refetch() {
+        let cache = Arc::new(MetricsCache::<u32>::new(Duration::from_secs(60)));
+        cache.insert("nodes", 1);
+        cache.invalidate_where(|key| key == "nodes");
+        assert_eq!(cache.get("nodes"), None);
+        assert_eq!(cache.stats(), (1, 0));
+
+        let (started_tx, started_rx) = tokio::sync::oneshot::channel();
+        let (release_tx, release_rx) = tokio::sync::oneshot::channel::<()>();
+        let refresher = {
+            let cache = Arc::clone(&cache);
+            tokio::spawn(async move {
+                cache
+                    .get_or_fetch("nodes", || async move {
+                        started_tx.send(()).unwrap();
+                        release_rx.await.unwrap();
+                        Ok::<_, String>(2)
+                    })
+                    .await
+            })
+        };
+        started_rx.await.unwrap();
+
+        // A refetch is in flight, so the old value is served
+        let served = cache
+            .get_or_fetch("nodes", || async { Err::<u32, _>("second fetch") })
+            .await;
+        assert_eq!(served, Ok(1));
+
+        release_tx.send(()).unwrap();
+        assert_eq!(refresher.await.unwrap(), Ok(2));
+        assert_eq!(cache.get("nodes"), Some(2));
+        assert_eq!(cache.stats(), (1, 1));
+    }
+
+    #[tokio::test]
+    async fn test_invalidation_during_fetch_keeps_entry_invalidated() {
+        let cache = Arc::new(MetricsCache::<u32>::new(Duration::from_secs(60)));
+        let (started_tx, started_rx) = tokio::sync::oneshot::channel();
+        let (release_tx, release_rx) = tokio::sync::oneshot::channel::<()>();
+        let refresher = {
+            let cache = Arc::clone(&cache);
+            tokio::spawn(async move {
+                cache
+                    .get_or_fetch("nodes", || async move {
+                        started_tx.send(()).unwrap();
+                        release_rx.await.unwrap();
+                        Ok::<_, String>(1)
+                    })
+                    .await
+            })
+        };
+        started_rx.await.unwrap();
+
+        // The backend changes after the fetch read it
+        cache.invalidate_where(|key| key == "nodes");
+        release_tx.send(()).unwrap();
+        assert_eq!(refresher.await.unwrap(), Ok(1));
+
+        assert_eq!(cache.get("nodes"), None);
+        let refetched = cache
+            .get_or_fetch("nodes", || async { Ok::<_, String>(2) })
+            .await;
+        assert_eq!(refetched, Ok(2));
+        assert_eq!(cache.get("nodes"), Some(2));
+    }
+
+    #[test]
+    fn test_trim_prefix_evicts_least_recently_used() {
+        let cache = MetricsCache::<u32>::new(Duration::from_secs(60));
+        cache.insert("all", 0);
+        for i in 0..4 {
+            cache.insert(&format!("filter:temp:{}", i), i);
+            std::thread::sleep(Duration::from_millis(2));
+        }
+        // Reading an entry makes it recently used
+        assert_eq!(cache.get("filter:temp:0"), Some(0));
+
+        cache.trim_prefix("filter:temp:", 2);
+        assert_eq!(cache.get("filter:temp:0"), Some(0));
+        assert_eq!(cache.get("filter:temp:1"), None);
+        assert_eq!(cache.get("filter:temp:2"), None);
+        assert_eq!(cache.get("filter:temp:3"), Some(3));
+        assert_eq!(cache.get("all"), Some(0));
+    }
+
+    #[tokio::test]
+    async fn test_fetch_error_is_not_cached() {
+        let cache = MetricsCache::<u32>::new(Duration::from_secs(60));
+        let failed = cache
+            .get_or_fetch("socs", || async { Err::<u32, _>("down") })
+            .await;
+        assert_eq!(failed, Err("down"));
+        assert_eq!(cache.stats(), (0, 0));
+        let fetched = cache
+            .get_or_fetch("socs", || async { Ok::<_, &str>(3) })
+            .await;
+        assert_eq!(fetched, Ok(3));
+    }
+}
@@ -2,15 +2,19 @@
 // SPDX-License-Identifier: Apache-2.0
 
 //! Monitoring and metrics management module
+mod cache;
+
+use crate::monitoring_etcd::MonitoringEtcdError;
 use crate::monitoring_types::{BoardInfo, NodeInfo, SocInfo, StressMetrics};
 use crate::settings_storage::filter_key;
 use crate::settings_storage::Storage;
 use crate::settings_utils::error::SettingsError;
+use cache::MetricsCache;
 use chrono::{DateTime, Utc};
 use common::monitoringserver::ContainerInfo;
 use serde::{Deserialize, Serialize};
-use std::collections::HashMap;
-use std::sync::RwLock;
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::sync::{Arc, RwLock};
 use std::time::{Duration, Instant};
 use tracing::{debug, info, warn};
 use uuid::Uuid;
@@ -127,218 +131,93 @@ pub struct CacheEntry<T> {
     pub expiry: Instant,
 }
 
+/// Resource types stored by the monitoring server under `/piccolo/metrics/`
+const RESOURCE_TYPES: [&str; 5] = ["nodes", "containers", "socs", "boards", "stress"];
+
+/// Prefix watched to invalidate cached metrics
+const METRICS_PREFIX: &str = "/piccolo/metrics/";
+
+/// Cache keys of per-resource entries; every other key is a filtered view
+const RESOURCE_KEY_PREFIX: &str = "resource:";
+
+/// ID of the ad-hoc filters built from query parameters
+pub const TEMP_FILTER_ID: &str = "temp";
+/// Ad-hoc filtered views kept in the cache; every parameter combination is
+/// its own view, so they are evicted least recently used beyond this
+const MAX_TEMP_VIEWS: usize = 64;
+
+/// First delay before reopening a dropped metrics watch
+const WATCH_RETRY_MIN: Duration = Duration::from_millis(500);
+/// Upper bound of the watch reopen backoff
+const WATCH_RETRY_MAX: Duration = Duration::from_secs(30);
+
 /// Monitoring manager for metrics filtering and caching - RESTRUCTURED
+///
+/// Metric reads take `&self`, so concurrent requests share the cache. Each
+/// resource type is read from monitoring ETCD at most once per refresh no
+/// matter how many filters or callers ask for it.
 pub struct MonitoringManager {
     storage: Box<dyn Storage>, // Only used for filters, not metrics
-    cache: RwLock<HashMap<String, CacheEntry<Vec<Metric>>>>,
-    cache_ttl: Duration,
+    cache: Arc<MetricsCache<Vec<Metric>>>,
+    /// Filters read from or written to storage, so readers holding `&self`
+    /// can resolve a filter ID without exclusive access
+    filters: RwLock<HashMap<String, MetricsFilter>>,
 }
 #[allow(dead_code)]
 impl MonitoringManager {
     pub fn new(storage: Box<dyn Storage>, cache_ttl_seconds: u64) -> Self {
         Self {
             storage,
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(cache_ttl_seconds),
+            cache: Arc::new(MetricsCache::new(Duration::from_secs(cache_ttl_seconds))),
+            filters: RwLock::new(HashMap::new()),
         }
     }
 
+    /// Invalidate cached metrics whenever the monitoring server writes
+    /// them, so the TTL only bounds staleness while the watch is down.
+    /// Must be called from within a tokio runtime.
+    pub fn spawn_cache_invalidation(&self) -> tokio::task::JoinHandle<()> {
+        let cache = Arc::clone(&self.cache);
+        tokio::spawn(async move { watch_metrics(&cache).await })
+    }
+
     /// Get metrics with optional filtering
     pub async fn get_metrics(
-        &mut self,
+        &self,
         filter: Option<&MetricsFilter>,
     ) -> Result<Vec<Metric>, SettingsError> {
         debug!("Getting metrics with filter: {:?}", filter.map(|f| &f.name));
 
-        // Generate cache key
-        let cache_key = if let Some(f) = filter {
-            format!("filter:{}", f.id)
-        } else {
-            "all".to_string()
-        };
-
-        // Check cache first
-        if let Some(cached) = self.get_cached(&cache_key) {
-            debug!("Returning cached metrics for key: {}", cache_key);
-            return Ok(cached);
+        let cache_key = filter.map_or_else(|| "all".to_string(), filter_cache_key);
+        let metrics = self
+            .cache
+            .get_or_fetch(&cache_key, || self.collect_metrics(filter))
+            .await;
+        if filter.is_some_and(|filter| filter.id == TEMP_FILTER_ID) {
+            self.cache
+                .trim_prefix(&filter_view_prefix(TEMP_FILTER_ID), MAX_TEMP_VIEWS);
         }
-
-        // Fetch from monitoring ETCD directly
-        let metrics = self.fetch_metrics_from_monitoring_etcd(filter).await?;
-
-        // Cache the results
-        self.set_cached(&cache_key, metrics.clone());
-
-        Ok(metrics)
+        metrics
     }
 
-    /// Fetch metrics directly from monitoring ETCD
-    async fn fetch_metrics_from_monitoring_etcd(
-        &mut self,
+    /// Build the filtered view from the per-resource entries
+    async fn collect_metrics(
+        &self,
         filter: Option<&MetricsFilter>,
     ) -> Result<Vec<Metric>, SettingsError> {
         let mut metrics = Vec::new();
 
-        // Get nodes and convert to Metric format - using monitoring_etcd
-        match crate::monitoring_etcd::get_all_nodes().await {
-            Ok(nodes) => {
-                for node_info in nodes {
-                    let metric = Metric {
-                        id: node_info.node_name.clone(),
-                        component: "node".to_string(),
-                        metric_type: "NodeInfo".to_string(),
-                        labels: {
-                            let mut labels = HashMap::new();
-                            labels.insert("node_name".to_string(), node_info.node_name.clone());
-                            labels.insert("ip".to_string(), node_info.ip.clone());
-                            labels.insert("os".to_string(), node_info.os.clone());
-                            labels.insert("arch".to_string(), node_info.arch.clone());
-                            labels
-                        },
-                        value: MetricValue::NodeInfo { value: node_info },
-                        timestamp: Utc::now(),
-                    };
-
-                    if self.metric_matches_filter(&metric, filter) {
-                        metrics.push(metric);
-                    }
-                }
-            }
-            Err(e) => {
-                debug!("No node metrics available: {}", e);
-            }
-        }
-
-        // Get containers and convert to Metric format - using monitoring_etcd
-        match crate::monitoring_etcd::get_all_containers().await {
-            Ok(containers) => {
-                for container_info in containers {
-                    let metric = Metric {
-                        id: container_info.id.clone(),
-                        component: "container".to_string(),
-                        metric_type: "ContainerInfo".to_string(),
-                        labels: {
-                            let mut labels = HashMap::new();
-                            labels.insert("container_id".to_string(), container_info.id.clone());
-                            labels.insert("image".to_string(), container_info.image.clone());
-                            if let Some(name) = container_info.names.first() {
-                                labels.insert("container_name".to_string(), name.clone());
-                            }
-                            if let Some(status) = container_info.state.get("Status") {
-                                labels.insert("status".to_string(), status.clone());
-                            }
-                            labels
-                        },
-                        value: MetricValue::ContainerInfo {
-                            value: container_info,
-                        },
-                        timestamp: Utc::now(),
-                    };
-
-                    if self.metric_matches_filter(&metric, filter) {
-                        metrics.push(metric);
-                    }
-                }
-            }
-            Err(e) => {
-                debug!("No container metrics available: {}", e);
-            }
-        }
-
-        // Get SoCs and convert to Metric format - using monitoring_etcd
-        match crate::monitoring_etcd::get_all_socs().await {
-            Ok(socs) => {
-                for soc_info in socs {
-                    let metric = Metric {
-                        id: soc_info.soc_id.clone(),
-                        component: "soc".to_string(),
-                        metric_type: "SocInfo".to_string(),
-                        labels: {
-                            let mut labels = HashMap::new();
-                            labels.insert("soc_id".to_string(), soc_info.soc_id.clone());
-                            labels
-                                .insert("node_count".to_string(), soc_info.nodes.len().to_string());
-                            labels
-                        },
-                        value: MetricValue::SocInfo { value: soc_info },
-                        timestamp: Utc::now(),
-                    };
-
-                    if self.metric_matches_filter(&metric, filter) {
-                        metrics.push(metric);
-                    }
-                }
-            }
-            Err(e) => {
-                debug!("No SoC metrics available: {}", e);
-            }
-        }
-
-        // Get boards and convert to Metric format - using monitoring_etcd
-        match crate::monitoring_etcd::get_all_boards().await {
-            Ok(boards) => {
-                for board_info in boards {
-                    let metric = Metric {
-                        id: board_info.board_id.clone(),
-                        component: "board".to_string(),
-                        metric_type: "BoardInfo".to_string(),
-                        labels: {
-                            let mut labels = HashMap::new();
-                            labels.insert("board_id".to_string(), board_info.board_id.clone());
-                            labels.insert(
-                                "node_count".to_string(),
-                                board_info.nodes.len().to_string(),
-                            );
-                            labels
-                                .insert("soc_count".to_string(), board_info.socs.len().to_string());
-                            labels
-                        },
-                        value: MetricValue::BoardInfo { value: board_info },
-                        timestamp: Utc::now(),
-                    };
-
-                    if self.metric_matches_filter(&metric, filter) {
-                        metrics.push(metric);
-                    }
-                }
-            }
-            Err(e) => {
-                debug!("No board metrics available: {}", e);
-            }
-        }
-
-        // Get stress metrics and convert to Metric format - using monitoring_etcd
-        match crate::monitoring_etcd::get_all_stress_metrics().await {
-            Ok(stress_list) => {
-                for stress in stress_list {
-                    // try to populate sensible labels; adjust field names to your StressMetrics struct
-                    let proc_name = stress.process_name.clone();
-                    let pid_str = stress.pid.to_string();
-
-                    let metric = Metric {
-                        id: format!("stress:{}:{}", proc_name, pid_str),
-                        component: "stress".to_string(),
-                        metric_type: "StressMetrics".to_string(),
-                        labels: {
-                            let mut labels = HashMap::new();
-                            labels.insert("process_name".to_string(), proc_name.clone());
-                            labels.insert("pid".to_string(), pid_str);
-                            labels
-                        },
-                        value: MetricValue::StressMetrics {
-                            value: stress.clone(),
-                        },
-                        timestamp: Utc::now(),
-                    };
-
-                    if self.metric_matches_filter(&metric, filter) {
-                        metrics.push(metric);
-                    }
+        for resource_type in RESOURCE_TYPES {
+            match self.resource_metrics(resource_type).await {
+                Ok(resource) => metrics.extend(
+                    resource
+                        .into_iter()
+                        .filter(|metric| self.metric_matches_filter(metric, filter)),
+                ),
+                Err(e) => {
+                    debug!("No {} metrics available: {}", resource_type, e);
                 }
             }
-            Err(e) => {
-                debug!("No stress metrics available: {}", e);
-            }
         }
 
         // Apply limits and sorting
@@ -351,17 +230,36 @@ impl MonitoringManager {
         // Sort by timestamp (newest first)
         metrics.sort_by(|a, b| b.timestamp.cmp(&a.timestamp));
 
-        info!("Fetched {} metrics from monitoring ETCD", metrics.len());
+        debug!("Collected {} metrics", metrics.len());
         Ok(metrics)
     }
 
-    /// Get all node metrics - SIMPLIFIED to use monitoring_etcd directly
-    pub async fn get_node_metrics(&mut self) -> Result<Vec<NodeInfo>, SettingsError> {
+    /// All metrics of one resource type, shared by every caller
+    async fn resource_metrics(
+        &self,
+        resource_type: &'static str,
+    ) -> Result<Vec<Metric>, MonitoringEtcdError> {
+        self.cache
+            .get_or_fetch(&format!("{}{}", RESOURCE_KEY_PREFIX, resource_type), || {
+                fetch_resource_metrics(resource_type)
+            })
+            .await
+    }
+
+    /// Get all node metrics
+    pub async fn get_node_metrics(&self) -> Result<Vec<NodeInfo>, SettingsError> {
         debug!("Getting all node metrics");
 
-        match crate::monitoring_etcd::get_all_nodes().await {
-            Ok(nodes) => {
-                info!("Retrieved {} node metrics", nodes.len());
+        match self.resource_metrics("nodes").await {
+            Ok(metrics) => {
+                let nodes: Vec<NodeInfo> = metrics
+                    .into_iter()
+                    .filter_map(|metric| match metric.value {
+                        MetricValue::NodeInfo { value } => Some(value),
+                        _ => None,
+                    })
+                    .collect();
+                debug!("Retrieved {} node metrics", nodes.len());
                 Ok(nodes)
             }
             Err(e) => {
@@ -374,22 +272,27 @@ impl MonitoringManager {
         }
     }
 
-    /// Get all container metrics - SIMPLIFIED to use monitoring_etcd directly
-    pub async fn get_container_metrics(&mut self) -> Result<Vec<ContainerInfo>, SettingsError> {
+    /// Get all container metrics
+    pub async fn get_container_metrics(&self) -> Result<Vec<ContainerInfo>, SettingsError> {
         debug!("Getting all container metrics");
 
-        crate::monitoring_etcd::get_all_containers()
-            .await
-            .map_err(|e| {
-                SettingsError::Storage(crate::settings_utils::error::StorageError::OperationFailed(
-                    format!("Failed to get containers: {}", e),
-                ))
+        let metrics = self.resource_metrics("containers").await.map_err(|e| {
+            SettingsError::Storage(crate::settings_utils::error::StorageError::OperationFailed(
+                format!("Failed to get containers: {}", e),
+            ))
+        })?;
+        Ok(metrics
+            .into_iter()
+            .filter_map(|metric| match metric.value {
+                MetricValue::ContainerInfo { value } => Some(value),
+                _ => None,
             })
+            .collect())
     }
 
     /// Get container metric by ID
     pub async fn get_container_metric_by_id(
-        &mut self,
+        &self,
         container_id: &str,
     ) -> Result<Option<ContainerInfo>, SettingsError> {
         debug!("Getting container metric for ID: {}", container_id);
@@ -408,7 +311,7 @@ impl MonitoringManager {
 
     /// Get stress metric by process name
     pub async fn get_stress_metric_by_process_name(
-        &mut self,
+        &self,
         process_name: &str,
     ) -> Result<Option<StressMetrics>, SettingsError> {
         debug!("Getting stress metric for process: {}", process_name);
@@ -427,7 +330,7 @@ impl MonitoringManager {
 
     /// Get container logs
     pub async fn get_container_logs(
-        &mut self,
+        &self,
         container_id: &str,
     ) -> Result<Vec<String>, SettingsError> {
         debug!("Getting logs for container: {}", container_id);
@@ -441,13 +344,20 @@ impl MonitoringManager {
             })
     }
 
-    /// Get all soc metrics - SIMPLIFIED to use monitoring_etcd directly
-    pub async fn get_soc_metrics(&mut self) -> Result<Vec<SocInfo>, SettingsError> {
+    /// Get all soc metrics
+    pub async fn get_soc_metrics(&self) -> Result<Vec<SocInfo>, SettingsError> {
         debug!("Getting all soc metrics");
 
-        match crate::monitoring_etcd::get_all_socs().await {
-            Ok(socs) => {
-                info!("Retrieved {} soc metrics", socs.len());
+        match self.resource_metrics("socs").await {
+            Ok(metrics) => {
+                let socs: Vec<SocInfo> = metrics
+                    .into_iter()
+                    .filter_map(|metric| match metric.value {
+                        MetricValue::SocInfo { value } => Some(value),
+                        _ => None,
+                    })
+                    .collect();
+                debug!("Retrieved {} soc metrics", socs.len());
                 Ok(socs)
             }
             Err(e) => {
@@ -460,13 +370,20 @@ impl MonitoringManager {
         }
     }
 
-    /// Get all board metrics - SIMPLIFIED to use monitoring_etcd directly
-    pub async fn get_board_metrics(&mut self) -> Result<Vec<BoardInfo>, SettingsError> {
+    /// Get all board metrics
+    pub async fn get_board_metrics(&self) -> Result<Vec<BoardInfo>, SettingsError> {
         debug!("Getting all board metrics");
 
-        match crate::monitoring_etcd::get_all_boards().await {
-            Ok(boards) => {
-                info!("Retrieved {} board metrics", boards.len());
+        match self.resource_metrics("boards").await {
+            Ok(metrics) => {
+                let boards: Vec<BoardInfo> = metrics
+                    .into_iter()
+                    .filter_map(|metric| match metric.value {
+                        MetricValue::BoardInfo { value } => Some(value),
+                        _ => None,
+                    })
+                    .collect();
+                debug!("Retrieved {} board metrics", boards.len());
                 Ok(boards)
             }
             Err(e) => {
@@ -479,14 +396,21 @@ impl MonitoringManager {
         }
     }
 
-    /// Get all board StressMetrics - SIMPLIFIED to use monitoring_etcd directly
-    pub async fn get_board_stress_metrics(&mut self) -> Result<Vec<StressMetrics>, SettingsError> {
+    /// Get all board StressMetrics
+    pub async fn get_board_stress_metrics(&self) -> Result<Vec<StressMetrics>, SettingsError> {
         debug!("Getting all board stress metrics");
 
-        match crate::monitoring_etcd::get_all_stress_metrics().await {
+        match self.resource_metrics("stress").await {
             Ok(metrics) => {
-                info!("Retrieved {} board stress metrics", metrics.len());
-                Ok(metrics)
+                let stress: Vec<StressMetrics> = metrics
+                    .into_iter()
+                    .filter_map(|metric| match metric.value {
+                        MetricValue::StressMetrics { value } => Some(value),
+                        _ => None,
+                    })
+                    .collect();
+                debug!("Retrieved {} board stress metrics", stress.len());
+                Ok(stress)
             }
             Err(e) => {
                 warn!("Failed to get board stress metrics: {}", e);
@@ -500,7 +424,7 @@ impl MonitoringManager {
 
     /// Get node metric by name - SIMPLIFIED to use monitoring_etcd directly
     pub async fn get_node_metric_by_name(
-        &mut self,
+        &self,
         node_name: &str,
     ) -> Result<Option<NodeInfo>, SettingsError> {
         debug!("Getting node metric for: {}", node_name);
@@ -513,7 +437,7 @@ impl MonitoringManager {
 
     /// Delete a metric by component and ID
     pub async fn delete_metric(
-        &mut self,
+        &self,
         component: &str,
         metric_id: &str,
     ) -> Result<(), SettingsError> {
@@ -560,15 +484,14 @@ impl MonitoringManager {
         }
 
         // Clear cache
-        let mut cache = self.cache.write().unwrap();
-        cache.clear();
+        self.clear_cache();
 
         info!("Deleted metric {} from component {}", metric_id, component);
         Ok(())
     }
 
     /// Get metric summary statistics
-    pub async fn get_metric_stats(&mut self) -> Result<HashMap<String, usize>, SettingsError> {
+    pub async fn get_metric_stats(&self) -> Result<HashMap<String, usize>, SettingsError> {
         let metrics = self.get_metrics(None).await?;
         let mut stats = HashMap::new();
 
@@ -600,18 +523,33 @@ impl MonitoringManager {
             .map_err(|e| SettingsError::Metrics(format!("Failed to serialize filter: {}", e)))?;
 
         self.storage.put_json(&key, &filter_value).await?;
+        self.remember_filter(filter_with_id);
         Ok(filter_id)
     }
 
+    /// Filter by ID if it was already read or written, without touching
+    /// storage
+    pub fn cached_filter(&self, id: &str) -> Option<MetricsFilter> {
+        self.filters
+            .read()
+            .unwrap_or_else(|e| e.into_inner())
+            .get(id)
+            .cloned()
+    }
+
     /// Get filter by ID
     pub async fn get_filter(&mut self, id: &str) -> Result<MetricsFilter, SettingsError> {
         debug!("Getting filter: {}", id);
 
+        if let Some(filter) = self.cached_filter(id) {
+            return Ok(filter);
+        }
         let key = filter_key(id);
         if let Some(filter_data) = self.storage.get_json(&key).await? {
             let filter: MetricsFilter = serde_json::from_value(filter_data).map_err(|e| {
                 SettingsError::Metrics(format!("Failed to deserialize filter: {}", e))
             })?;
+            self.remember_filter(filter.clone());
             Ok(filter)
         } else {
             Err(SettingsError::Metrics(format!("Filter not found: {}", id)))
@@ -639,16 +577,14 @@ impl MonitoringManager {
             .map_err(|e| SettingsError::Metrics(format!("Failed to serialize filter: {}", e)))?;
 
         self.storage.put_json(&key, &filter_value).await?;
-        self.invalidate_cache(&format!("filter:{}", id));
+        self.invalidate_filter(id);
+        self.remember_filter(updated_filter);
 
         Ok(())
     }
 
     /// Get metric by ID
-    pub async fn get_metric_by_id(
-        &mut self,
-        metric_id: &str,
-    ) -> Result<Option<Metric>, SettingsError> {
+    pub async fn get_metric_by_id(&self, metric_id: &str) -> Result<Option<Metric>, SettingsError> {
         debug!("Getting metric by ID: {}", metric_id);
 
         // Try to find in different component types
@@ -696,7 +632,7 @@ impl MonitoringManager {
 
     /// Get metrics by component
     pub async fn get_metrics_by_component(
-        &mut self,
+        &self,
         component: &str,
     ) -> Result<Vec<Metric>, SettingsError> {
         debug!("Getting metrics for component: {}", component);
@@ -721,7 +657,7 @@ impl MonitoringManager {
 
     /// Get metrics by type
     pub async fn get_metrics_by_type(
-        &mut self,
+        &self,
         metric_type: &str,
     ) -> Result<Vec<Metric>, SettingsError> {
         debug!("Getting metrics for type: {}", metric_type);
@@ -753,7 +689,7 @@ impl MonitoringManager {
             warn!("Filter not found for deletion: {}", id);
         }
 
-        self.invalidate_cache(&format!("filter:{}", id));
+        self.invalidate_filter(id);
         Ok(())
     }
 
@@ -790,39 +726,36 @@ impl MonitoringManager {
 
     /// Cache management methods
     fn get_cached(&self, key: &str) -> Option<Vec<Metric>> {
-        let cache = self.cache.read().ok()?;
-        let entry = cache.get(key)?;
-
-        if entry.expiry > Instant::now() {
-            Some(entry.data.clone())
-        } else {
-            None
-        }
+        self.cache.get(key)
     }
 
     fn set_cached(&self, key: &str, metrics: Vec<Metric>) {
-        if let Ok(mut cache) = self.cache.write() {
-            cache.insert(
-                key.to_string(),
-                CacheEntry {
-                    data: metrics,
-                    expiry: Instant::now() + self.cache_ttl,
-                },
-            );
-        }
+        self.cache.insert(key, metrics);
     }
 
     fn invalidate_cache(&self, key: &str) {
-        if let Ok(mut cache) = self.cache.write() {
-            cache.remove(key);
-        }
+        self.cache.remove(key);
+    }
+
+    /// Drop every cached view of a stored filter
+    fn invalidate_filter(&self, id: &str) {
+        self.cache.remove_prefix(&filter_view_prefix(id));
+        self.filters
+            .write()
+            .unwrap_or_else(|e| e.into_inner())
+            .remove(id);
+    }
+
+    fn remember_filter(&self, filter: MetricsFilter) {
+        self.filters
+            .write()
+            .unwrap_or_else(|e| e.into_inner())
+            .insert(filter.id.clone(), filter);
     }
 
     /// Clear all cache entries
     pub fn clear_cache(&self) {
-        if let Ok(mut cache) = self.cache.write() {
-            cache.clear();
-        }
+        self.cache.clear();
         debug!("Cleared metrics cache");
     }
 
@@ -830,17 +763,10 @@ impl MonitoringManager {
     pub fn get_cache_stats(&self) -> HashMap<String, usize> {
         let mut stats = HashMap::new();
 
-        if let Ok(cache) = self.cache.read() {
-            stats.insert("total_entries".to_string(), cache.len());
-
-            let valid_entries = cache
-                .values()
-                .filter(|entry| entry.expiry > Instant::now())
-                .count();
-
-            stats.insert("valid_entries".to_string(), valid_entries);
-            stats.insert("expired_entries".to_string(), cache.len() - valid_entries);
-        }
+        let (total_entries, valid_entries) = self.cache.stats();
+        stats.insert("total_entries".to_string(), total_entries);
+        stats.insert("valid_entries".to_string(), valid_entries);
+        stats.insert("expired_entries".to_string(), total_entries - valid_entries);
 
         stats
     }
@@ -932,7 +858,7 @@ impl MonitoringManager {
 
     /// Get containers by node name with proper hostname extraction
     pub async fn get_containers_by_node(
-        &mut self,
+        &self,
         node_name: &str,
     ) -> Result<Vec<ContainerInfo>, SettingsError> {
         debug!("Getting containers for node: {}", node_name);
@@ -988,7 +914,7 @@ impl MonitoringManager {
 
     /// Get pod metrics for a specific node (enhanced to include hostname)
     pub async fn get_pod_metrics_for_node(
-        &mut self,
+        &self,
         node_name: &str,
     ) -> Result<Vec<Metric>, SettingsError> {
         debug!("Getting pod metrics for node: {}", node_name);
@@ -1047,7 +973,7 @@ impl MonitoringManager {
 
     /// Get containers with enhanced node information
     pub async fn get_container_metrics_with_node_info(
-        &mut self,
+        &self,
     ) -> Result<Vec<ContainerInfo>, SettingsError> {
         debug!("Getting all container metrics with node information");
 
@@ -1099,6 +1025,222 @@ impl MonitoringManager {
     }
 }
 
+/// Cache key of a filtered view; ad-hoc filters share an id, so the key
+/// includes everything that selects metrics
+fn filter_cache_key(filter: &MetricsFilter) -> String {
+    let labels: Option<BTreeMap<&String, &String>> = filter
+        .label_selectors
+        .as_ref()
+        .map(|selectors| selectors.iter().collect());
+    let selection = serde_json::json!([
+        filter.enabled,
+        filter.components,
+        filter.metric_types,
+        labels,
+        filter.time_range,
+        filter.max_items,
+    ]);
+    format!("{}{}", filter_view_prefix(&filter.id), selection)
+}
+
+/// Common prefix of the cache keys of every view of filter `id`
+fn filter_view_prefix(id: &str) -> String {
+    format!("filter:{}:", id)
+}
+
+/// Read one resource type from monitoring ETCD as metrics
+async fn fetch_resource_metrics(
+    resource_type: &'static str,
+) -> Result<Vec<Metric>, MonitoringEtcdError> {
+    let metrics: Vec<Metric> = match resource_type {
+        "nodes" => crate::monitoring_etcd::get_all_nodes()
+            .await?
+            .into_iter()
+            .map(node_metric)
+            .collect(),
+        "containers" => crate::monitoring_etcd::get_all_containers()
+            .await?
+            .into_iter()
+            .map(container_metric)
+            .collect(),
+        "socs" => crate::monitoring_etcd::get_all_socs()
+            .await?
+            .into_iter()
+            .map(soc_metric)
+            .collect(),
+        "boards" => crate::monitoring_etcd::get_all_boards()
+            .await?
+            .into_iter()
+            .map(board_metric)
+            .collect(),
+        "stress" => crate::monitoring_etcd::get_all_stress_metrics()
+            .await?
+            .into_iter()
+            .map(stress_metric)
+            .collect(),
+        other => {
+            return Err(MonitoringEtcdError::Other(format!(
+                "Unknown resource type: {}",
+                other
+            )))
+        }
+    };
+
+    info!(
+        "Fetched {} {} metrics from monitoring ETCD",
+        metrics.len(),
+        resource_type
+    );
+    Ok(metrics)
+}
+
+fn node_metric(node_info: NodeInfo) -> Metric {
+    Metric {
+        id: node_info.node_name.clone(),
+        component: "node".to_string(),
+        metric_type: "NodeInfo".to_string(),
+        labels: {
+            let mut labels = HashMap::new();
+            labels.insert("node_name".to_string(), node_info.node_name.clone());
+            labels.insert("ip".to_string(), node_info.ip.clone());
+            labels.insert("os".to_string(), node_info.os.clone());
+            labels.insert("arch".to_string(), node_info.arch.clone());
+            labels
+        },
+        value: MetricValue::NodeInfo { value: node_info },
+        timestamp: Utc::now(),
+    }
+}
+
+fn container_metric(container_info: ContainerInfo) -> Metric {
+    Metric {
+        id: container_info.id.clone(),
+        component: "container".to_string(),
+        metric_type: "ContainerInfo".to_string(),
+        labels: {
+            let mut labels = HashMap::new();
+            labels.insert("container_id".to_string(), container_info.id.clone());
+            labels.insert("image".to_string(), container_info.image.clone());
+            if let Some(name) = container_info.names.first() {
+                labels.insert("container_name".to_string(), name.clone());
+            }
+            if let Some(status) = container_info.state.get("Status") {
+                labels.insert("status".to_string(), status.clone());
+            }
+            labels
+        },
+        value: MetricValue::ContainerInfo {
+            value: container_info,
+        },
+        timestamp: Utc::now(),
+    }
+}
+
+fn soc_metric(soc_info: SocInfo) -> Metric {
+    Metric {
+        id: soc_info.soc_id.clone(),
+        component: "soc".to_string(),
+        metric_type: "SocInfo".to_string(),
+        labels: {
+            let mut labels = HashMap::new();
+            labels.insert("soc_id".to_string(), soc_info.soc_id.clone());
+            labels.insert("node_count".to_string(), soc_info.nodes.len().to_string());
+            labels
+        },
+        value: MetricValue::SocInfo { value: soc_info },
+        timestamp: Utc::now(),
+    }
+}
+
+fn board_metric(board_info: BoardInfo) -> Metric {
+    Metric {
+        id: board_info.board_id.clone(),
+        component: "board".to_string(),
+        metric_type: "BoardInfo".to_string(),
+        labels: {
+            let mut labels = HashMap::new();
+            labels.insert("board_id".to_string(), board_info.board_id.clone());
+            labels.insert("node_count".to_string(), board_info.nodes.len().to_string());
+            labels.insert("soc_count".to_string(), board_info.socs.len().to_string());
+            labels
+        },
+        value: MetricValue::BoardInfo { value: board_info },
+        timestamp: Utc::now(),
+    }
+}
+
+fn stress_metric(stress: StressMetrics) -> Metric {
+    let proc_name = stress.process_name.clone();
+    let pid_str = stress.pid.to_string();
+
+    Metric {
+        id: format!("stress:{}:{}", proc_name, pid_str),
+        component: "stress".to_string(),
+        metric_type: "StressMetrics".to_string(),
+        labels: {
+            let mut labels = HashMap::new();
+            labels.insert("process_name".to_string(), proc_name);
+            labels.insert("pid".to_string(), pid_str);
+            labels
+        },
+        value: MetricValue::StressMetrics { value: stress },
+        timestamp: Utc::now(),
+    }
+}
+
+/// Mark the entries that depend on changed resource types for refetch
+fn invalidate_resources(cache: &MetricsCache<Vec<Metric>>, changed: &HashSet<String>) {
+    cache.invalidate_where(|key| match key.strip_prefix(RESOURCE_KEY_PREFIX) {
+        Some(resource_type) => changed.contains(resource_type),
+        // Filtered views combine all resource types
+        None => true,
+    });
+}
+
+/// Follow writes under `/piccolo/metrics/` for the lifetime of the service,
+/// reopening the watch with exponential backoff when it drops
+async fn watch_metrics(cache: &MetricsCache<Vec<Metric>>) {
+    let mut delay = WATCH_RETRY_MIN;
+    loop {
+        match common::etcd::watch(METRICS_PREFIX, false).await {
+            Ok(mut watcher) => {
+                // Writes made while the watch was down are unknown
+                cache.invalidate_where(|_| true);
+                loop {
+                    match watcher.next().await {
+                        Ok(Some(batch)) => {
+                            delay = WATCH_RETRY_MIN;
+                            let changed: HashSet<String> = batch
+                                .events
+                                .iter()
+                                .filter_map(|event| {
+                                    let rest = event.key().strip_prefix(METRICS_PREFIX)?;
+                                    rest.split('/').next().map(str::to_string)
+                                })
+                                .collect();
+                            if !changed.is_empty() {
+                                invalidate_resources(cache, &changed);
+                            }
+                        }
+                        Ok(None) => {
+                            warn!("Metrics watch closed by the service");
+                            break;
+                        }
+                        Err(e) => {
+                            warn!("Metrics watch failed: {}", e);
+                            break;
+                        }
+                    }
+                }
+            }
+            Err(e) => warn!("Failed to watch {}: {}", METRICS_PREFIX, e),
+        }
+
+        tokio::time::sleep(delay).await;
+        delay = (delay * 2).min(WATCH_RETRY_MAX);
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -1517,11 +1659,7 @@ mod tests {
 
     #[test]
     fn test_simple_wildcard_matching() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         // Test exact match
         assert!(manager.simple_wildcard_match("test", "test"));
@@ -1541,11 +1679,7 @@ mod tests {
 
     #[test]
     fn test_metric_matches_filter() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         let mut labels = HashMap::new();
         labels.insert("node_name".to_string(), "test-node".to_string());
@@ -1617,11 +1751,7 @@ mod tests {
 
     #[test]
     fn test_metric_matches_filter_with_labels() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         let mut labels = HashMap::new();
         labels.insert("node_name".to_string(), "test-node-001".to_string());
@@ -1679,11 +1809,7 @@ mod tests {
 
     #[test]
     fn test_metric_matches_filter_with_time_range() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         let now = Utc::now();
         let metric = Metric {
@@ -1742,11 +1868,7 @@ mod tests {
 
     #[test]
     fn test_container_belongs_to_node() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         // Test container with hostname in config
         let mut config_container = create_test_container_info();
@@ -1780,11 +1902,7 @@ mod tests {
 
     #[test]
     fn test_ensure_node_hostname_in_container() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         // Test container with only hostname
         let mut container_with_hostname = create_test_container_info();
@@ -1861,6 +1979,11 @@ mod tests {
 
         let created_id = filter_id.unwrap();
         assert!(!created_id.is_empty());
+        // Readers resolve it without exclusive access
+        assert_eq!(
+            manager.cached_filter(&created_id).map(|f| f.name),
+            Some(filter.name.clone())
+        );
 
         // Get filter
         let retrieved_filter = manager.get_filter(&created_id).await;
@@ -1887,6 +2010,7 @@ mod tests {
         // Delete filter
         let delete_result = manager.delete_filter(&created_id).await;
         assert!(delete_result.is_ok());
+        assert!(manager.cached_filter(&created_id).is_none());
 
         // Verify deletion
         let deleted_retrieved = manager.get_filter(&created_id).await;
@@ -1981,11 +2105,7 @@ mod tests {
 
     #[test]
     fn test_error_scenarios() {
-        let mut manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         // Test invalid cache operations
         let invalid_cached = manager.get_cached("non-existent-key");
@@ -1999,13 +2119,35 @@ mod tests {
         assert!(manager.get_cached("test-key").is_none());
     }
 
+    #[test]
+    fn test_watch_invalidates_dependent_entries() {
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
+
+        // Ad-hoc filters share an id but select different metrics
+        let nodes = create_test_metrics_filter();
+        let mut containers = nodes.clone();
+        containers.components = Some(vec!["container".to_string()]);
+        let (nodes_key, containers_key) = (filter_cache_key(&nodes), filter_cache_key(&containers));
+        assert_ne!(nodes_key, containers_key);
+        assert!(nodes_key.starts_with("filter:test-filter:"));
+
+        manager.set_cached("resource:nodes", vec![]);
+        manager.set_cached("resource:socs", vec![]);
+        manager.set_cached(&nodes_key, vec![]);
+
+        let changed: HashSet<String> = ["nodes".to_string()].into_iter().collect();
+        invalidate_resources(&manager.cache, &changed);
+        assert!(manager.get_cached("resource:nodes").is_none());
+        assert!(manager.get_cached(&nodes_key).is_none());
+        assert!(manager.get_cached("resource:socs").is_some());
+
+        manager.invalidate_filter("test-filter");
+        assert_eq!(manager.get_cache_stats()["total_entries"], 2);
+    }
+
     #[tokio::test]
     async fn test_complex_filtering_scenarios() {
-        let manager = MonitoringManager {
-            storage: Box::new(MockStorage::new()),
-            cache: RwLock::new(HashMap::new()),
-            cache_ttl: Duration::from_secs(300),
-        };
+        let manager = MonitoringManager::new(Box::new(MockStorage::new()), 300);
 
         // Create metric with multiple labels
         let mut labels = HashMap::new();
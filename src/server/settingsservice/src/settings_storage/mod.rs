@@ -65,6 +65,24 @@ impl EtcdClient {
         Ok(results)
     }
 
+    /// List up to `limit` keys with a prefix, highest key first, starting
+    /// below `start_before` when it is non-empty
+    pub async fn list_reverse(
+        &mut self,
+        prefix: &str,
+        start_before: &str,
+        limit: usize,
+    ) -> Result<Vec<(String, String)>, StorageError> {
+        debug!(
+            "Listing up to {} keys with prefix: {} (reverse)",
+            limit, prefix
+        );
+
+        common::etcd::get_with_prefix_reverse(prefix, start_before, limit)
+            .await
+            .map_err(|e| StorageError::OperationFailed(format!("List operation failed: {}", e)))
+    }
+
     /// Get JSON value by key
     pub async fn get_json(&mut self, key: &str) -> Result<Option<Value>, StorageError> {
         if let Some(value_str) = self.get(key).await? {
@@ -97,6 +115,27 @@ pub trait Storage: Send + Sync {
     async fn list(&mut self, prefix: &str) -> Result<Vec<(String, String)>, StorageError>;
     async fn get_json(&mut self, key: &str) -> Result<Option<Value>, StorageError>;
     async fn put_json(&mut self, key: &str, value: &Value) -> Result<(), StorageError>;
+
+    /// Up to `limit` entries under `prefix` in descending key order, only
+    /// keys below `start_before` when it is non-empty. Backends with a
+    /// native reverse range scan override the default, which lists and
+    /// sorts the whole prefix.
+    async fn list_reverse(
+        &mut self,
+        prefix: &str,
+        start_before: &str,
+        limit: usize,
+    ) -> Result<Vec<(String, String)>, StorageError> {
+        let mut entries: Vec<(String, String)> = self
+            .list(prefix)
+            .await?
+            .into_iter()
+            .filter(|(key, _)| start_before.is_empty() || key.as_str() < start_before)
+            .collect();
+        entries.sort_by(|a, b| b.0.cmp(&a.0));
+        entries.truncate(limit);
+        Ok(entries)
+    }
 }
 
 #[async_trait]
@@ -124,6 +163,15 @@ impl Storage for EtcdClient {
     async fn put_json(&mut self, key: &str, value: &Value) -> Result<(), StorageError> {
         self.put_json(key, value).await
     }
+
+    async fn list_reverse(
+        &mut self,
+        prefix: &str,
+        start_before: &str,
+        limit: usize,
+    ) -> Result<Vec<(String, String)>, StorageError> {
+        self.list_reverse(prefix, start_before, limit).await
+    }
 }
 
 /// Key prefixes for different data types
@@ -142,8 +190,21 @@ pub fn config_key(path: &str) -> String {
     format!("{}{}", KeyPrefixes::CONFIG, path)
 }
 
+/// Prefix of all history entries of one configuration
+pub fn history_prefix(config_path: &str) -> String {
+    format!("{}{}/", KeyPrefixes::HISTORY, config_path)
+}
+
+/// Prefix of the version keys of one configuration; unlike
+/// [`history_prefix`] it does not also match the history of nested paths
+pub fn history_version_prefix(config_path: &str) -> String {
+    format!("{}v", history_prefix(config_path))
+}
+
+/// History entry key; the version is zero-padded to the width of `u64::MAX`
+/// so that key order is version order
 pub fn history_key(config_path: &str, version: u64) -> String {
-    format!("{}{}/v{}", KeyPrefixes::HISTORY, config_path, version)
+    format!("{}{:020}", history_version_prefix(config_path), version)
 }
 #[allow(dead_code)]
 pub fn metrics_key(resource_type: &str, resource_id: &str) -> String {
@@ -315,17 +376,23 @@ mod tests {
     fn test_history_key() {
         assert_eq!(
             history_key("test/config", 1),
-            "/piccolo/settings/history/test/config/v1"
+            "/piccolo/settings/history/test/config/v00000000000000000001"
         );
         assert_eq!(
             history_key("/absolute/path", 42),
-            "/piccolo/settings/history//absolute/path/v42"
+            "/piccolo/settings/history//absolute/path/v00000000000000000042"
+        );
+        assert_eq!(
+            history_key("", 0),
+            "/piccolo/settings/history//v00000000000000000000"
         );
-        assert_eq!(history_key("", 0), "/piccolo/settings/history//v0");
         assert_eq!(
             history_key("simple", 999),
-            "/piccolo/settings/history/simple/v999"
+            "/piccolo/settings/history/simple/v00000000000000000999"
         );
+        assert!(history_key("simple", 10) > history_key("simple", 9));
+        assert!(history_key("simple", u64::MAX).starts_with(&history_version_prefix("simple")));
+        assert!(!history_key("simple/nested", 1).starts_with(&history_version_prefix("simple")));
     }
 
     #[test]